@@ -95,6 +95,7 @@ enum formatters {
 static enum formatters formatter = NOformatter;
 char *separator = NULL;		/* column separator for CSV/TAB format */
 bool csvheader = false;		/* include header line in CSV format */
+static bool binary = false;	/* ask for binary result sets */
 
 #define DEFWIDTH 80
 
@@ -1696,6 +1697,15 @@ setFormatter(const char *s)
 	}
 }
 
+/* Binary result sets are only used with the formatters that work on
+ * fields, not with those that print the lines as received. */
+static void
+setBinaryResults(Mapi mid)
+{
+	if (binary && mode == SQL)
+		mapi_set_binary_results(mid, formatter != RAWformatter && formatter != TESTformatter);
+}
+
 static void
 setWidth(void)
 {
@@ -2799,8 +2809,10 @@ doFile(Mapi mid, stream *fp, bool useinserts, bool interactive, bool save_histor
 							mnstr_printf(toConsole, "none\n");
 							break;
 						}
-					} else
+					} else {
 						setFormatter(line);
+						setBinaryResults(mid);
+					}
 					continue;
 				case 't':
 					while (my_isspace(line[length - 1]))
@@ -3061,6 +3073,7 @@ usage(const char *prog, int xit)
 	mnstr_printf(stderr_stream, "\nSQL specific opions \n");
 	mnstr_printf(stderr_stream, " -n nullstr  | --null=nullstr     change NULL representation for sql, csv and tab output modes\n");
 	mnstr_printf(stderr_stream, " -a          | --autocommit       turn off autocommit mode\n");
+	mnstr_printf(stderr_stream, " -b          | --binary           receive result sets in binary form\n");
 	mnstr_printf(stderr_stream, " -R          | --allow-remote     allow remote content\n");
 	mnstr_printf(stderr_stream, " -r nr       | --rows=nr          for pagination\n");
 	mnstr_printf(stderr_stream, " -w nr       | --width=nr         for pagination\n");
@@ -3113,6 +3126,7 @@ main(int argc, char **argv)
 	bool passwd_set_as_flag = false;
 	static struct option long_options[] = {
 		{"autocommit", 0, 0, 'a'},
+		{"binary", 0, 0, 'b'},
 		{"database", 1, 0, 'd'},
 		{"dump", 0, 0, 'D'},
 		{"inserts", 0, 0, 'N'},
@@ -3217,7 +3231,7 @@ main(int argc, char **argv)
 		mode = SQL;
 	}
 
-	while ((c = getopt_long(argc, argv, "ad:De"
+	while ((c = getopt_long(argc, argv, "abd:De"
 #ifdef HAVE_ICONV
 				"E:"
 #endif
@@ -3235,6 +3249,9 @@ main(int argc, char **argv)
 		case 'a':
 			autocommit = false;
 			break;
+		case 'b':
+			binary = true;
+			break;
 		case 'd':
 			assert(optarg);
 			if (dbname)
@@ -3519,6 +3536,7 @@ main(int argc, char **argv)
 			setFormatter("raw");
 		}
 	}
+	setBinaryResults(mid);
 	/* give the user a welcome message with some general info */
 	if (!has_fileargs && command == NULL && isatty(fileno(stdin))) {
 		char *lang;
@@ -258,6 +258,7 @@
  * @item mapi_bind_var()	@tab	Bind typed C-variable to a field
  * @item mapi_cache_freeup()	@tab Forcefully shuffle fraction for cache refreshment
  * @item mapi_cache_limit()	@tab Set the tuple cache limit
+ * @item mapi_cache_prefetch()	@tab Set the number of blocks requested ahead
  * @item mapi_clear_bindings()	@tab Clear all field bindings
  * @item mapi_clear_params()	@tab Clear all parameter bindings
  * @item mapi_close_handle()	@tab	Close query handle and free resources
@@ -631,6 +632,17 @@
  * non-read elements.  Filling the cache quicker than reading leads to an
  * error.
  *
+ * @item MapiMsg mapi_cache_prefetch(Mapi mid, int blocks)
+ *
+ * Keep up to this many blocks of maxrows tuples requested from the
+ * server beyond the block being received (default 0, i.e. the next
+ * block is only requested when the cache runs dry).  The server
+ * produces and transmits the following blocks while the
+ * application is still consuming the current one, which hides the
+ * round trip at each block boundary.  Only SQL result sets are
+ * prefetched, and only once the reply to the query itself has been
+ * read.
+ *
  * @item MapiMsg mapi_cache_freeup(MapiHdl hdl, int percentage)
  *
  * Forcefully shuffle the cache making room for new rows.  It ignores the
@@ -912,12 +924,14 @@ struct MapiStruct {
 	int handshake_options;	/* which settings can be sent during challenge/response? */
 	bool auto_commit;
 	bool columnar_protocol;
+	bool binary_results;
 	bool sizeheader;
 	int time_zone;		/* seconds EAST of UTC */
 	MapiHdl first;		/* start of doubly-linked list */
 	MapiHdl active;		/* set when not all rows have been received */
 
 	int cachelimit;		/* default maximum number of rows to cache */
+	int prefetch;		/* max # of row blocks requested ahead */
 	int redircnt;		/* redirection count, used to cut of redirect loops */
 	int redirmax;		/* maximum redirects before giving up */
 #define MAXREDIR 50
@@ -961,6 +975,9 @@ struct MapiStatement {
 	struct MapiParam *params;
 	struct MapiResultSet *result, *active, *lastresult;
 	bool needmore;		/* need more input */
+	bool exporting;		/* reply being read is a block of result */
+	int prefetched;		/* # of block replies queued behind it */
+	int64_t prefetchrow;	/* first row not yet requested */
 	int *pending_close;
 	int npending_close;
 	MapiHdl prev, next;
@@ -1413,6 +1430,13 @@ mapi_get_columnar_protocol(Mapi mid)
 	return mid->columnar_protocol;
 }
 
+bool
+mapi_get_binary_results(Mapi mid)
+{
+	mapi_check0(mid);
+	return mid->binary_results;
+}
+
 int
 mapi_get_time_zone(Mapi mid)
 {
@@ -1555,6 +1579,9 @@ close_result(MapiHdl hdl)
 	assert(mid != NULL);
 	if (mid->trace)
 		printf("closing result set\n");
+	if (hdl->exporting && mid->active == hdl &&
+	    read_into_cache(hdl, 0) != MOK)
+		return MERROR;
 	if (result->tableid >= 0 && result->querytype != Q_PREPARE) {
 		if (mid->active &&
 		    result->next == NULL &&
@@ -2833,6 +2860,9 @@ mapi_reconnect(Mapi mid)
 	if (mid->handshake_options > MAPI_HANDSHAKE_TIME_ZONE) {
 		CHECK_SNPRINTF(",time_zone=%d", mid->time_zone);
 	}
+	if (mid->handshake_options > MAPI_HANDSHAKE_BINARY_RESULTS) {
+		CHECK_SNPRINTF(",binary_results=%d", mid->binary_results);
+	}
 	if (mid->handshake_options > 0) {
 		CHECK_SNPRINTF(":");
 	}
@@ -3061,6 +3091,10 @@ mapi_reconnect(Mapi mid)
 	if (mid->handshake_options <= MAPI_HANDSHAKE_TIME_ZONE) {
 		mapi_set_time_zone(mid, mid->time_zone);
 	}
+	// Likewise, a server that doesn't know binary_results in the
+	// handshake doesn't know the Xcommand either.
+	if (mid->handshake_options <= MAPI_HANDSHAKE_BINARY_RESULTS)
+		mid->binary_results = false;
 
 	return mid->error;
 }
@@ -3802,6 +3836,30 @@ mapi_set_columnar_protocol(Mapi mid, bool columnar_protocol)
 		return mapi_Xcommand(mid, "columnar_protocol", "0");
 }
 
+MapiMsg
+mapi_set_binary_results(Mapi mid, bool binary_results)
+{
+	if (mid->languageId != LANG_SQL) {
+		mapi_setError(mid, "binary result sets only supported in SQL", __func__, MERROR);
+		return MERROR;
+	}
+	if (mid->binary_results == binary_results)
+		return MOK;
+	if (!mid->connected) {
+		mid->binary_results = binary_results;
+		return MOK;
+	}
+	if (mid->handshake_options <= MAPI_HANDSHAKE_BINARY_RESULTS) {
+		mapi_setError(mid, "binary result sets not supported by server", __func__, MERROR);
+		return MERROR;
+	}
+	mid->binary_results = binary_results;
+	if (binary_results)
+		return mapi_Xcommand(mid, "binary_results", "1");
+	else
+		return mapi_Xcommand(mid, "binary_results", "0");
+}
+
 MapiMsg
 mapi_set_size_header(Mapi mid, bool value)
 {
@@ -4355,6 +4413,297 @@ read_file(MapiHdl hdl, uint64_t off, char *filename, bool binary)
 	(void) read_line(mid);
 }
 
+/* Read the n bytes that follow the current line into dst. */
+static bool
+read_bytes(Mapi mid, char *dst, size_t n)
+{
+	size_t avail = (size_t) (mid->blk.end - mid->blk.nxt);
+
+	if (avail > n)
+		avail = n;
+	memcpy(dst, mid->blk.buf + mid->blk.nxt, avail);
+	mid->blk.nxt += (int) avail;
+	dst += avail;
+	n -= avail;
+	while (n > 0) {
+		ssize_t len = mnstr_read(mid->from, dst, 1, n);
+
+		check_stream(mid, mid->from, "Connection terminated during read", false);
+		if (len <= 0) {
+			mapi_setError(mid, "binary chunk truncated", __func__, MERROR);
+			return false;
+		}
+		if (mid->tracelog) {
+			mapi_log_header(mid, "R");
+			mnstr_printf(mid->tracelog, "(%zd bytes of binary data)\n", len);
+			mnstr_flush(mid->tracelog, MNSTR_FLUSH_DATA);
+		}
+		dst += len;
+		n -= (size_t) len;
+	}
+	return true;
+}
+
+struct bincol {
+	int enc;
+	int scale;
+	int width;
+	const unsigned char *nulls;
+	const unsigned char *vals;
+	const unsigned char *offs;
+};
+
+/* values are sent little-endian */
+static inline uint64_t
+get_le(const unsigned char *p, int n)
+{
+	uint64_t v = 0;
+
+	while (n-- > 0)
+		v = v << 8 | p[n];
+	return v;
+}
+
+/* Format an integer the way the server does, with a decimal point if
+ * scale > 0. */
+static char *
+format_integer(const unsigned char *p, int width, int scale, size_t *lenp)
+{
+	char buf[64], *s = buf + sizeof(buf);
+	bool neg;
+#ifdef HAVE_HGE
+	uhge v;
+
+	if (width == 16)
+		v = (uhge) get_le(p + 8, 8) << 64 | get_le(p, 8);
+	else
+		v = get_le(p, width);
+	neg = (p[width - 1] & 0x80) != 0;
+	if (neg) {
+		/* sign extend and negate */
+		if (width < 16)
+			v |= ~(uhge) 0 << (8 * width);
+		v = -v;
+	}
+#else
+	uint64_t v;
+
+	if (width > 8)
+		return NULL;
+	v = get_le(p, width);
+	neg = (p[width - 1] & 0x80) != 0;
+	if (neg) {
+		if (width < 8)
+			v |= ~(uint64_t) 0 << (8 * width);
+		v = -v;
+	}
+#endif
+	*--s = 0;
+	for (int i = 0; i < scale; i++) {
+		*--s = (char) ('0' + v % 10);
+		v /= 10;
+	}
+	if (scale > 0)
+		*--s = '.';
+	do {
+		*--s = (char) ('0' + v % 10);
+		v /= 10;
+	} while (v > 0);
+	if (neg)
+		*--s = '-';
+	*lenp = (size_t) (buf + sizeof(buf) - 1 - s);
+	return strdup(s);
+}
+
+static char *
+format_binary_field(const struct bincol *c, int64_t r, size_t *lenp)
+{
+	char buf[64], *s;
+	const unsigned char *p = c->vals + r * c->width;
+
+	switch (c->enc) {
+	case MAPI_BINARY_TEXT: {
+		uint64_t beg = get_le(c->offs + 8 * r, 8);
+		uint64_t end = get_le(c->offs + 8 * (r + 1), 8);
+
+		if ((s = malloc(end - beg + 1)) != NULL) {
+			memcpy(s, c->vals + beg, end - beg);
+			s[end - beg] = 0;
+			*lenp = end - beg;
+		}
+		return s;
+	}
+	case MAPI_BINARY_BOOL:
+		s = *p ? "true" : "false";
+		*lenp = strlen(s);
+		return strdup(s);
+	case MAPI_BINARY_FLOAT32: {
+		union { uint32_t i; float f; } u = { .i = (uint32_t) get_le(p, 4) };
+
+		/* the shortest representation that reads back the same */
+		for (int i = 4; i < 10; i++) {
+			snprintf(buf, sizeof(buf), "%.*g", i, u.f);
+			if (strtof(buf, NULL) == u.f)
+				break;
+		}
+		*lenp = strlen(buf);
+		return strdup(buf);
+	}
+	case MAPI_BINARY_FLOAT64: {
+		union { uint64_t i; double f; } u = { .i = get_le(p, 8) };
+
+		for (int i = 4; i < 18; i++) {
+			snprintf(buf, sizeof(buf), "%.*g", i, u.f);
+			if (strtod(buf, NULL) == u.f)
+				break;
+		}
+		*lenp = strlen(buf);
+		return strdup(buf);
+	}
+	default:
+		return format_integer(p, c->width, c->scale, lenp);
+	}
+}
+
+/* Read a chunk of a binary result set (see mapi_prompt.h) and add its
+   rows to the cache, already sliced into fields. */
+static MapiMsg
+read_binary_chunk(MapiHdl hdl, struct MapiResultSet *result, const char *line, int lookahead)
+{
+	Mapi mid = hdl->mid;
+	int64_t nrows;
+	size_t nbytes, nullsize;
+	unsigned char *chunk = NULL, *p, *end;
+	struct bincol *cols = NULL;
+	int ncols = result->fieldcnt;
+
+	/* every column has at least a bit per row */
+	if (sscanf(line, "%" SCNd64 " %zu", &nrows, &nbytes) != 2 || nrows < 0 ||
+	    (uint64_t) nrows / 8 > nbytes || nbytes % 8 != 0 || ncols <= 0) {
+		mapi_setError(mid, "invalid binary chunk header", __func__, MERROR);
+		goto bailout;
+	}
+	if ((chunk = malloc(nbytes + 1)) == NULL ||
+	    (cols = malloc(ncols * sizeof(*cols))) == NULL) {
+		mapi_setError(mid, nomem, __func__, MERROR);
+		goto bailout;
+	}
+	if (!read_bytes(mid, (char *) chunk, nbytes))
+		goto bailout;
+
+	/* locate the columns */
+	p = chunk;
+	end = chunk + nbytes;
+	nullsize = (size_t) ((nrows + 7) / 8 + 7) & ~(size_t) 7;
+	for (int j = 0; j < ncols; j++) {
+		struct bincol *c = &cols[j];
+		size_t size;
+
+		if ((size_t) (end - p) < 8 + nullsize)
+			goto invalid;
+		c->enc = p[0];
+		c->scale = p[1];
+		if (c->scale > 38)	/* more than format_integer can do */
+			goto invalid;
+		c->nulls = p + 8;
+		p += 8 + nullsize;
+		switch (c->enc) {
+		case MAPI_BINARY_TEXT:
+			if ((size_t) (end - p) < (size_t) (nrows + 1) * 8)
+				goto invalid;
+			c->offs = p;
+			p += (nrows + 1) * 8;
+			size = get_le(c->offs + 8 * nrows, 8);
+			c->vals = p;
+			c->width = 0;
+			/* the values of the rows are consecutive and
+			 * within the chunk */
+			if (size > (size_t) (end - p))
+				goto invalid;
+			for (int64_t r = 0; r < nrows; r++) {
+				if (get_le(c->offs + 8 * r, 8) > get_le(c->offs + 8 * (r + 1), 8))
+					goto invalid;
+			}
+			break;
+		case MAPI_BINARY_BOOL:
+		case MAPI_BINARY_INT8:
+		case MAPI_BINARY_INT16:
+		case MAPI_BINARY_INT32:
+		case MAPI_BINARY_INT64:
+		case MAPI_BINARY_INT128:
+#ifndef HAVE_HGE
+			if (c->enc == MAPI_BINARY_INT128) {
+				mapi_setError(mid, "binary result set contains 128-bit integers, which this client cannot format", __func__, MERROR);
+				goto bailout;
+			}
+#endif
+			c->width = 1 << (c->enc == MAPI_BINARY_BOOL ? 0 : c->enc - MAPI_BINARY_INT8);
+			size = (size_t) nrows * c->width;
+			c->vals = p;
+			break;
+		case MAPI_BINARY_FLOAT32:
+		case MAPI_BINARY_FLOAT64:
+			c->width = c->enc == MAPI_BINARY_FLOAT32 ? 4 : 8;
+			size = (size_t) nrows * c->width;
+			c->vals = p;
+			break;
+		default:
+			goto invalid;
+		}
+		size = (size + 7) & ~(size_t) 7;
+		if ((size_t) (end - p) < size)
+			goto invalid;
+		p += size;
+	}
+
+	for (int64_t r = 0; r < nrows; r++) {
+		char **anchors = malloc(ncols * sizeof(*anchors));
+		size_t *lens = malloc(ncols * sizeof(*lens));
+		char *row = strdup("[");
+		int w;
+
+		if (anchors == NULL || lens == NULL || row == NULL) {
+			free(anchors);
+			free(lens);
+			free(row);
+			mapi_setError(mid, nomem, __func__, MERROR);
+			goto bailout;
+		}
+		for (int j = 0; j < ncols; j++) {
+			anchors[j] = NULL;
+			lens[j] = 0;
+			if ((cols[j].nulls[r >> 3] & (1 << (r & 7))) == 0 &&
+			    (anchors[j] = format_binary_field(&cols[j], r, &lens[j])) == NULL) {
+				/* not a NULL value, so we ran out of memory */
+				while (--j >= 0)
+					free(anchors[j]);
+				free(anchors);
+				free(lens);
+				free(row);
+				mapi_setError(mid, nomem, __func__, MERROR);
+				goto bailout;
+			}
+		}
+		/* the row is already sliced, mapi_fetch_line only gets to
+		 * see that it is a row */
+		add_cache(result, row, !lookahead);
+		w = result->cache.writer - 1;
+		result->cache.line[w].anchors = anchors;
+		result->cache.line[w].lens = lens;
+		result->cache.line[w].fldcnt = ncols;
+	}
+	free(cols);
+	free(chunk);
+	return MOK;
+
+  invalid:
+	mapi_setError(mid, "invalid binary chunk", __func__, MERROR);
+  bailout:
+	free(cols);
+	free(chunk);
+	return mid->error;
+}
+
 /* Read ahead and cache data read.  Depending on the second argument,
    reading may stop at the first non-header and non-error line, or at
    a prompt.
@@ -4387,6 +4736,8 @@ read_into_cache(MapiHdl hdl, int lookahead)
 	for (;;) {
 		line = read_line(mid);
 		if (line == NULL) {
+			hdl->exporting = false;
+			hdl->prefetched = 0;
 			if (mnstr_eof(mid->from)) {
 				mapi_log_record(mid, "unexpected end of file");
 				mapi_log_record(mid, __func__);
@@ -4443,6 +4794,14 @@ read_into_cache(MapiHdl hdl, int lookahead)
 				}
 				continue;
 			}
+			if (hdl->prefetched > 0) {
+				/* the next prefetched block follows */
+				hdl->prefetched--;
+				mid->active = hdl;
+				hdl->active = result;
+				continue;
+			}
+			hdl->exporting = false;
 			return mid->error;
 		case '!':
 			/* start a new result set if we don't have one
@@ -4459,6 +4818,16 @@ read_into_cache(MapiHdl hdl, int lookahead)
 			if (!mid->error)
 				mid->error = MSERVER;
 			break;
+		case BINARY_CHUNK_BEG:
+			if (result == NULL) {
+				result = new_result(hdl);
+				hdl->active = result;
+			}
+			if (read_binary_chunk(hdl, result, line + 1, lookahead) != MOK)
+				return mid->error;
+			if (lookahead > 0 && result->querytype == Q_TABLE)
+				return mid->error;
+			break;
 		case '%':
 		case '#':
 		case '&':
@@ -4739,6 +5108,14 @@ mapi_cache_limit(Mapi mid, int limit)
 	return MOK;
 }
 
+MapiMsg
+mapi_cache_prefetch(Mapi mid, int blocks)
+{
+	mapi_clrError(mid);
+	mid->prefetch = blocks < 0 ? 0 : blocks;
+	return MOK;
+}
+
 MapiMsg
 mapi_fetch_reset(MapiHdl hdl)
 {
@@ -4754,6 +5131,10 @@ mapi_seek_row(MapiHdl hdl, int64_t rownr, int whence)
 	struct MapiResultSet *result;
 
 	mapi_hdl_check(hdl);
+	/* prefetched blocks would land after a repositioned cache */
+	if (hdl->exporting && hdl->mid->active == hdl &&
+	    read_into_cache(hdl, 0) != MOK)
+		return MERROR;
 	result = hdl->result;
 	switch (whence) {
 	case MAPI_SEEK_SET:
@@ -4831,6 +5212,62 @@ mapi_fetch_line_internal(MapiHdl hdl)
 	return reply;
 }
 
+/*
+ * Ask the server for the blocks of the current result set that follow
+ * the rows already requested, so that they are produced and sent
+ * while the application works its way through the cache.  Blocks are
+ * only requested behind our own block replies (or on an idle
+ * connection), since the reply to the query itself may contain more
+ * result sets.  The replies are read lazily by read_into_cache, which
+ * skips the prompts between them.
+ */
+static void
+prefetch_rows(MapiHdl hdl)
+{
+	Mapi mid = hdl->mid;
+	struct MapiResultSet *result = hdl->result;
+	int inflight;
+
+	if (result == NULL ||
+	    mid->languageId != LANG_SQL ||
+	    result->querytype != Q_TABLE ||
+	    result->tableid < 0 ||
+	    mid->cachelimit <= 0 ||
+	    hdl->needmore)
+		return;
+	if (mid->active == NULL) {
+		inflight = 0;
+		hdl->prefetchrow = result->cache.first + result->cache.tuplecount;
+	} else if (mid->active == hdl && hdl->exporting && hdl->active == result) {
+		inflight = hdl->prefetched + 1;
+	} else {
+		return;
+	}
+	while (inflight <= mid->prefetch && hdl->prefetchrow < result->row_count) {
+		if (mid->tracelog) {
+			mapi_log_header(mid, "W");
+			mnstr_printf(mid->tracelog, "X" "export %d %" PRId64 " %d\n",
+				     result->tableid, hdl->prefetchrow, mid->cachelimit);
+			mnstr_flush(mid->tracelog, MNSTR_FLUSH_DATA);
+		}
+		if (mnstr_printf(mid->to, "X" "export %d %" PRId64 " %d\n",
+				 result->tableid, hdl->prefetchrow, mid->cachelimit) < 0 ||
+		    mnstr_flush(mid->to, MNSTR_FLUSH_DATA)) {
+			close_connection(mid);
+			mapi_setError(mid, "sending export command", __func__, MTIMEOUT);
+			return;
+		}
+		if (inflight++ == 0) {
+			mid->active = hdl;
+			hdl->active = result;
+			hdl->exporting = true;
+		} else {
+			hdl->prefetched++;
+		}
+		hdl->prefetchrow += mid->cachelimit;
+	}
+}
+
 /*
  * The routine mapi_fetch_line forms the basic interaction with the server.
  * It simply retrieves the next line and stores it in the row cache.
@@ -4858,6 +5295,8 @@ mapi_fetch_line(MapiHdl hdl)
 			read_into_cache(hdl->mid->active, 0);
 		hdl->mid->active = hdl;
 		hdl->active = result;
+		hdl->exporting = true;
+		hdl->prefetchrow = result->cache.first + result->cache.tuplecount + hdl->mid->cachelimit;
 		if (hdl->mid->tracelog) {
 			mapi_log_header(hdl->mid, "W");
 			mnstr_printf(hdl->mid->tracelog, "X" "export %d %" PRId64 "\n",
@@ -4872,6 +5311,8 @@ mapi_fetch_line(MapiHdl hdl)
 			check_stream(hdl->mid, hdl->mid->to, "sending export command", NULL);
 		reply = mapi_fetch_line_internal(hdl);
 	}
+	if (reply && hdl->mid->prefetch > 0)
+		prefetch_rows(hdl);
 	return reply;
 }
 
@@ -33,6 +33,7 @@ enum mapi_handshake_options_levels {
 	MAPI_HANDSHAKE_SIZE_HEADER = 3,
 	MAPI_HANDSHAKE_COLUMNAR_PROTOCOL = 4,
 	MAPI_HANDSHAKE_TIME_ZONE = 5,
+	MAPI_HANDSHAKE_BINARY_RESULTS = 6,
 	// make sure to insert new option levels before this one.
 	// it is the value sent by the server during the initial handshake.
 	MAPI_HANDSHAKE_OPTIONS_LEVEL,
@@ -120,6 +121,8 @@ mapi_export bool mapi_get_autocommit(Mapi mid)
 	__attribute__((__nonnull__(1)));
 mapi_export bool mapi_get_columnar_protocol(Mapi mid)
 	__attribute__((__nonnull__(1)));
+mapi_export bool mapi_get_binary_results(Mapi mid)
+	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_log(Mapi mid, const char *nme)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_set_time_zone(Mapi mid, int seconds_east_of_utc)
@@ -128,6 +131,8 @@ mapi_export MapiMsg mapi_setAutocommit(Mapi mid, bool autocommit)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_set_columnar_protocol(Mapi mid, bool columnar_protocol)
 	__attribute__((__nonnull__(1)));
+mapi_export MapiMsg mapi_set_binary_results(Mapi mid, bool binary_results)
+	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_set_size_header(Mapi mid, bool value)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_release_id(Mapi mid, int id)
@@ -187,6 +192,8 @@ mapi_export MapiMsg mapi_read_response(MapiHdl hdl)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_cache_limit(Mapi mid, int limit)
 	__attribute__((__nonnull__(1)));
+mapi_export MapiMsg mapi_cache_prefetch(Mapi mid, int blocks)
+	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_cache_freeup(MapiHdl hdl, int percentage)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_seek_row(MapiHdl hdl, int64_t rowne, int whence)
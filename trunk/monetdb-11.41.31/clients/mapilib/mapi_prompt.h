@@ -15,4 +15,28 @@
 #define PROMPT2		"\001\002\n"	/* prompt: more data needed */
 #define PROMPT3		"\001\003\n"	/* prompt: get file content */
 
+/* Binary result sets.  Instead of tuple lines, the rows of a result
+ * set are sent in chunks, each announced by a line "@<rows> <bytes>"
+ * and followed by <bytes> bytes that hold the columns one after the
+ * other.  A column starts with 8 bytes: the encoding below, the
+ * decimal scale, and 6 bytes of padding.  Then follows a null bitmap
+ * of (rows + 7) / 8 bytes (bit i of byte i / 8 is set if row i is
+ * NULL) and the values.  Fixed width values are stored little-endian,
+ * one per row.  Text is stored as rows + 1 64-bit offsets followed by
+ * the bytes of the strings without terminating NUL byte; string i
+ * consists of the bytes between offsets i and i + 1.  The bitmap and
+ * the values are each padded to a multiple of 8 bytes. */
+#define BINARY_CHUNK_BEG	'@'
+enum mapi_binary_encoding {
+	MAPI_BINARY_TEXT = 0,
+	MAPI_BINARY_INT8,
+	MAPI_BINARY_INT16,
+	MAPI_BINARY_INT32,
+	MAPI_BINARY_INT64,
+	MAPI_BINARY_INT128,
+	MAPI_BINARY_FLOAT32,
+	MAPI_BINARY_FLOAT64,
+	MAPI_BINARY_BOOL,
+};
+
 #endif /* _MAPI_PROMPT_H_INCLUDED */
@@ -108,6 +108,7 @@ function(monetdb_configure_defines)
   check_symbol_exists("strncasecmp" "strings.h" HAVE_STRNCASECMP)
   check_function_exists("strptime" HAVE_STRPTIME)
   check_function_exists("strsignal" HAVE_STRSIGNAL)
+  check_symbol_exists("syncfs" "unistd.h" HAVE_SYNCFS)
   check_symbol_exists("sysconf" "unistd.h" HAVE_SYSCONF)
   check_function_exists("task_info" HAVE_TASK_INFO)
   check_function_exists("times" HAVE_TIMES)
@@ -563,14 +563,19 @@ typedef struct {
 		cleanhash:1,	/* string heaps must clean hash */
 		dirty:1,	/* specific heap dirty marker */
 		remove:1,	/* remove storage file when freeing */
-		wasempty:1;	/* heap was empty when last saved/created */
+		wasempty:1,	/* heap was empty when last saved/created */
+		distinct:1;	/* string heap without duplicate strings */
 	storage_t storage;	/* storage mode (mmap/malloc). */
 	storage_t newstorage;	/* new desired storage mode at re-allocation. */
 	bat parentid;		/* cache id of VIEW parent bat */
+	struct heappages *pages; /* page hashes of saved image (gdk_heap.c) */
+	struct strdedup *dedup;	/* string-to-offset table (gdk_string.c) */
 } Heap;
 
 typedef struct Hash Hash;
 typedef struct Imprints Imprints;
+typedef struct ZoneMap ZoneMap;
+typedef struct NgramIdx NgramIdx;
 
 /*
  * @+ Binary Association Tables
@@ -691,6 +696,8 @@ gdk_export bool VALisnil(const ValRecord *v);
  *           Hash   *thash;           // linear chained hash table on tail
  *           Imprints *timprints;     // column imprints index on tail
  *           orderidx torderidx;      // order oid index on tail
+ *           ZoneMap *tzonemap;       // per-block min/max summary of tail
+ *           NgramIdx *tngram;        // trigram index on string tail
  *  } BAT;
  * @end verbatim
  *
@@ -735,6 +742,8 @@ typedef struct {
 	Hash *hash;		/* hash table */
 	Imprints *imprints;	/* column imprints index */
 	Heap *orderidx;		/* order oid index */
+	ZoneMap *zonemap;	/* per-block min/max summary */
+	NgramIdx *ngram;	/* trigram posting lists of string values */
 
 	PROPrec *props;		/* list of dynamic properties stored in the bat descriptor */
 } COLrec;
@@ -788,6 +797,8 @@ typedef struct BAT {
 #define trevsorted	T.revsorted
 #define tident		T.id
 #define torderidx	T.orderidx
+#define tzonemap	T.zonemap
+#define tngram		T.ngram
 #define twidth		T.width
 #define tshift		T.shift
 #define tnonil		T.nonil
@@ -1781,6 +1792,12 @@ gdk_export gdk_return BATorderidx(BAT *b, bool stable);
 gdk_export gdk_return GDKmergeidx(BAT *b, BAT**a, int n_ar);
 gdk_export bool BATcheckorderidx(BAT *b);
 
+/* The trigram index on string columns */
+
+gdk_export gdk_return BATngramidx(BAT *b);
+gdk_export gdk_return BATngramselect(BAT **candp, BAT *b, BAT *s, const char *lits, bool caseignore);
+gdk_export void NGRAMdestroy(BAT *b);
+
 #include "gdk_delta.h"
 #include "gdk_hash.h"
 #include "gdk_bbp.h"
@@ -1790,6 +1807,7 @@ gdk_export bool BATcheckorderidx(BAT *b);
 gdk_export gdk_return void_inplace(BAT *b, oid id, const void *val, bool force)
 	__attribute__((__warn_unused_result__));
 gdk_export BAT *BATattach(int tt, const char *heapfile, role_t role);
+gdk_export BAT *BATattach_mmap(int tt, const char *heapfile);
 
 #ifdef NATIVE_WIN32
 #ifdef _MSC_VER
@@ -1854,6 +1872,7 @@ gdk_export void THRdel(Thread t);
 gdk_export void THRsetdata(int, void *);
 gdk_export void *THRgetdata(int);
 gdk_export int THRhighwater(void);
+gdk_export gdk_return GDKparallel(gdk_return (*func)(void *, size_t), void *arg, size_t ntasks, int nthreads, const char *name);
 
 gdk_export void *THRdata[THREADDATA];
 
@@ -877,6 +877,364 @@ dosum(const void *restrict values, bool nonil, oid seqb,
 	return BUN_NONE;
 }
 
+/* Parallel grouped aggregates.
+ *
+ * For large inputs with many groups, the work of BATgroupsum and
+ * BATgroupcount is divided over multiple threads.  If there are
+ * relatively few groups, each thread aggregates a slice of the input
+ * into its own array of results, after which the partial results are
+ * added up per group.  If there are many groups, that would take too
+ * much memory, so instead the input is first partitioned on ranges of
+ * group ids (a histogram and a scatter pass over slices of the input),
+ * after which each thread aggregates the values of one range of
+ * groups.  Either way, every group is finished by a single thread. */
+
+#define AGGRPAR_MINSIZE	((BUN) 1 << 20)	/* min size of input */
+
+struct aggrpar {
+	const void *values;
+	bool nonil;
+	oid seqb;
+	struct canditer *ci;	/* must be dense */
+	void *results;
+	BUN ngrp;
+	int tp1, tp2;
+	const oid *gids;
+	oid min;
+	bool skip_nils;
+	bool abort_on_error;
+	const char *func;
+	BUN ntasks;
+	bool slices;		/* divide input, not groups */
+	void *partials;		/* ntasks arrays of ngrp partial results */
+	BUN *nils;		/* per task number of nils */
+	/* group range mode: the input partitioned on ranges of rsize
+	 * groups */
+	BUN rsize;
+	BUN *offsets;		/* per slice and range: next position */
+	BUN *rstart;		/* ntasks+1 range boundaries */
+	oid *pgids;		/* partitioned group ids */
+	char *pvals;		/* partitioned values (if needed) */
+	int width;		/* width of values, 0 if not needed */
+};
+
+/* the groups combined by task t in slice mode */
+#define AGGRPAR_GROUPS(ap, t, glo, ghi)				\
+	do {							\
+		glo = (ap)->ngrp * (t) / (ap)->ntasks;		\
+		ghi = (ap)->ngrp * ((t) + 1) / (ap)->ntasks;	\
+	} while (0)
+
+/* the groups aggregated by task t in group range mode */
+#define AGGRPAR_RANGE(ap, t, glo, ghi)				\
+	do {							\
+		glo = MIN((ap)->rsize * (t), (ap)->ngrp);	\
+		ghi = MIN(glo + (ap)->rsize, (ap)->ngrp);	\
+	} while (0)
+
+/* the slice of the input handled by task t */
+#define AGGRPAR_SLICE(ap, t, lo, hi)				\
+	do {							\
+		lo = (ap)->ci->ncand * (t) / (ap)->ntasks;	\
+		hi = (ap)->ci->ncand * ((t) + 1) / (ap)->ntasks; \
+	} while (0)
+
+static bool
+aggrpar_use(struct canditer *ci, const oid *gids, BUN ngrp)
+{
+	return GDKnr_threads > 1 && gids != NULL &&
+		ci->tpe == cand_dense && ci->ncand >= AGGRPAR_MINSIZE &&
+		ngrp >= 2 * (BUN) GDKnr_threads;
+}
+
+/* initialize the parallel aggregation; results points to an array
+ * of ngrp values of type tp2 that is initialized to nil for sums and
+ * to zero for counts */
+static gdk_return
+aggrpar_init(struct aggrpar *ap, bool slices)
+{
+	ap->ntasks = (BUN) GDKnr_threads;
+	ap->slices = slices;
+	if ((ap->nils = GDKzalloc(ap->ntasks * sizeof(BUN))) == NULL)
+		return GDK_FAIL;
+	if (slices) {
+		size_t sz = ATOMsize(ap->tp2) * ap->ngrp;
+		if ((ap->partials = GDKmalloc(ap->ntasks * sz)) == NULL) {
+			GDKfree(ap->nils);
+			return GDK_FAIL;
+		}
+		for (BUN t = 0; t < ap->ntasks; t++)
+			memcpy((char *) ap->partials + t * sz, ap->results, sz);
+	}
+	return GDK_SUCCEED;
+}
+
+static BUN
+aggrpar_done(struct aggrpar *ap, gdk_return rc)
+{
+	BUN nils = 0;
+
+	for (BUN t = 0; t < ap->ntasks; t++)
+		nils += ap->nils[t];
+	GDKfree(ap->nils);
+	GDKfree(ap->partials);
+	GDKfree(ap->offsets);
+	GDKfree(ap->rstart);
+	GDKfree(ap->pgids);
+	GDKfree(ap->pvals);
+	return rc == GDK_SUCCEED ? nils : BUN_NONE;
+}
+
+/* count the values of slice t per range of groups */
+static gdk_return
+aggrpar_histogram(void *arg, size_t t)
+{
+	struct aggrpar *ap = arg;
+	const oid *restrict gids = ap->gids;
+	BUN *restrict hist = ap->offsets + t * ap->ntasks;
+	BUN lo, hi;
+
+	AGGRPAR_SLICE(ap, t, lo, hi);
+	for (BUN i = lo; i < hi; i++) {
+		if (gids[i] >= ap->min && gids[i] - ap->min < ap->ngrp)
+			hist[(gids[i] - ap->min) / ap->rsize]++;
+	}
+	return GDK_SUCCEED;
+}
+
+#define AGGRPAR_SCATTER(TYPE)						\
+	do {								\
+		const TYPE *restrict vals = (const TYPE *) ap->values + ap->ci->seq - ap->seqb; \
+		TYPE *restrict pvals = (TYPE *) ap->pvals;		\
+		for (BUN i = lo; i < hi; i++) {				\
+			if (gids[i] >= ap->min &&			\
+			    gids[i] - ap->min < ap->ngrp) {		\
+				BUN p = offs[(gids[i] - ap->min) / ap->rsize]++; \
+				pgids[p] = gids[i];			\
+				pvals[p] = vals[i];			\
+			}						\
+		}							\
+	} while (0)
+
+/* move the group ids (and values) of slice t to their range */
+static gdk_return
+aggrpar_scatter(void *arg, size_t t)
+{
+	struct aggrpar *ap = arg;
+	const oid *restrict gids = ap->gids;
+	oid *restrict pgids = ap->pgids;
+	BUN *restrict offs = ap->offsets + t * ap->ntasks;
+	BUN lo, hi;
+
+	AGGRPAR_SLICE(ap, t, lo, hi);
+	switch (ap->width) {
+	case 0:
+		for (BUN i = lo; i < hi; i++) {
+			if (gids[i] >= ap->min && gids[i] - ap->min < ap->ngrp)
+				pgids[offs[(gids[i] - ap->min) / ap->rsize]++] = gids[i];
+		}
+		break;
+	case 1:
+		AGGRPAR_SCATTER(bte);
+		break;
+	case 2:
+		AGGRPAR_SCATTER(sht);
+		break;
+	case 4:
+		AGGRPAR_SCATTER(int);
+		break;
+	case 8:
+		AGGRPAR_SCATTER(lng);
+		break;
+#ifdef HAVE_HGE
+	case 16:
+		AGGRPAR_SCATTER(hge);
+		break;
+#endif
+	default:
+		assert(0);
+		return GDK_FAIL;
+	}
+	return GDK_SUCCEED;
+}
+
+/* partition the input on ranges of groups for group range mode */
+static gdk_return
+aggrpar_partition(struct aggrpar *ap)
+{
+	BUN n = ap->ci->ncand, off = 0;
+
+	ap->rsize = (ap->ngrp + ap->ntasks - 1) / ap->ntasks;
+	if ((ap->offsets = GDKzalloc(ap->ntasks * ap->ntasks * sizeof(BUN))) == NULL ||
+	    (ap->rstart = GDKmalloc((ap->ntasks + 1) * sizeof(BUN))) == NULL ||
+	    (ap->pgids = GDKmalloc(n * sizeof(oid))) == NULL ||
+	    (ap->width > 0 &&
+	     (ap->pvals = GDKmalloc(n * ap->width)) == NULL))
+		return GDK_FAIL;
+	if (GDKparallel(aggrpar_histogram, ap, ap->ntasks, GDKnr_threads,
+			"aggrhist") != GDK_SUCCEED)
+		return GDK_FAIL;
+	/* the values of range r come in order of slice */
+	for (BUN r = 0; r < ap->ntasks; r++) {
+		ap->rstart[r] = off;
+		for (BUN t = 0; t < ap->ntasks; t++) {
+			BUN c = ap->offsets[t * ap->ntasks + r];
+			ap->offsets[t * ap->ntasks + r] = off;
+			off += c;
+		}
+	}
+	ap->rstart[ap->ntasks] = off;
+	return GDKparallel(aggrpar_scatter, ap, ap->ntasks, GDKnr_threads,
+			   "aggrscat");
+}
+
+static gdk_return
+aggrpar_sum(void *arg, size_t t)
+{
+	struct aggrpar *ap = arg;
+	struct canditer ci = *ap->ci;
+	const char *algo;
+	BUN nils;
+
+	assert(ci.tpe == cand_dense);
+	if (ap->slices) {
+		BUN lo, hi;
+		AGGRPAR_SLICE(ap, t, lo, hi);
+		ci.seq += lo;
+		ci.ncand = hi - lo;
+		ci.next = 0;
+		nils = dosum(ap->values, ap->nonil, ap->seqb, &ci, ci.ncand,
+			     (char *) ap->partials + t * ATOMsize(ap->tp2) * ap->ngrp,
+			     ap->ngrp, ap->tp1, ap->tp2, ap->gids + lo,
+			     ap->min, ap->min + ap->ngrp - 1,
+			     ap->skip_nils, ap->abort_on_error, true,
+			     ap->func, &algo);
+	} else {
+		/* all values of the partition belong to the range, so
+		 * it doesn't matter that with a single group, dosum
+		 * ignores gids */
+		BUN glo, ghi;
+		AGGRPAR_RANGE(ap, t, glo, ghi);
+		if (glo == ghi) {
+			ap->nils[t] = 0;
+			return GDK_SUCCEED;
+		}
+		ci.seq = 0;
+		ci.ncand = ap->rstart[t + 1] - ap->rstart[t];
+		ci.next = 0;
+		nils = dosum(ap->pvals + ap->rstart[t] * ap->width, ap->nonil,
+			     0, &ci, ci.ncand,
+			     (char *) ap->results + glo * ATOMsize(ap->tp2),
+			     ghi - glo, ap->tp1, ap->tp2,
+			     ap->pgids + ap->rstart[t],
+			     ap->min + glo, ap->min + ghi - 1,
+			     ap->skip_nils, ap->abort_on_error, true,
+			     ap->func, &algo);
+	}
+	if (nils == BUN_NONE)
+		return GDK_FAIL;
+	ap->nils[t] = nils;
+	return GDK_SUCCEED;
+}
+
+#define AGGRPAR_SUM_MERGE(TYPE)						\
+	do {								\
+		const TYPE *restrict parts = ap->partials;		\
+		TYPE *restrict sums = ap->results;			\
+		for (BUN g = glo; g < ghi; g++) {			\
+			TYPE sum = TYPE##_nil;				\
+			for (BUN p = 0; p < ap->ntasks; p++) {		\
+				TYPE x = parts[p * ap->ngrp + g];	\
+				if (is_##TYPE##_nil(x))			\
+					continue;			\
+				if (is_##TYPE##_nil(sum))		\
+					sum = x;			\
+				else					\
+					ADD_WITH_CHECK(x, sum, TYPE, sum, \
+						       GDK_##TYPE##_max, \
+						       goto overflow);	\
+			}						\
+			sums[g] = sum;					\
+			nils += is_##TYPE##_nil(sum);			\
+		}							\
+	} while (0)
+
+/* add up the partial sums of a range of groups */
+static gdk_return
+aggrpar_summerge(void *arg, size_t t)
+{
+	struct aggrpar *ap = arg;
+	bool abort_on_error = true;
+	BUN glo, ghi, nils = 0;
+
+	AGGRPAR_GROUPS(ap, t, glo, ghi);
+	switch (ap->tp2) {
+	case TYPE_lng:
+		AGGRPAR_SUM_MERGE(lng);
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		AGGRPAR_SUM_MERGE(hge);
+		break;
+#endif
+	default:
+		assert(0);
+		return GDK_FAIL;
+	}
+	ap->nils[t] = nils;
+	return GDK_SUCCEED;
+
+  overflow:
+	GDKerror("22003!overflow in sum aggregate.\n");
+	return GDK_FAIL;
+}
+
+/* parallel version of dosum for a dense candidate list with groups;
+ * only integer sums are supported */
+static BUN
+dosum_parallel(const void *restrict values, bool nonil, oid seqb,
+	       struct canditer *restrict ci, void *restrict results,
+	       BUN ngrp, int tp1, int tp2, const oid *restrict gids,
+	       oid min, bool skip_nils, bool abort_on_error,
+	       const char *func, const char **algo)
+{
+	struct aggrpar ap = {
+		.values = values,
+		.nonil = nonil,
+		.seqb = seqb,
+		.ci = ci,
+		.results = results,
+		.ngrp = ngrp,
+		.tp1 = tp1,
+		.tp2 = tp2,
+		.gids = gids,
+		.min = min,
+		.skip_nils = skip_nils,
+		.abort_on_error = abort_on_error,
+		.func = func,
+	};
+	gdk_return rc;
+	/* in slice mode an empty group and a group with nil result
+	 * are indistinguishable in a partial result, so only use it if
+	 * the latter cannot happen */
+	bool slices = ngrp * GDKnr_threads <= ci->ncand &&
+		(skip_nils || nonil) && abort_on_error;
+
+	if (aggrpar_init(&ap, slices) != GDK_SUCCEED)
+		return BUN_NONE;
+	ap.width = ATOMsize(tp1);
+	rc = slices ? GDK_SUCCEED : aggrpar_partition(&ap);
+	if (rc == GDK_SUCCEED)
+		rc = GDKparallel(aggrpar_sum, &ap, ap.ntasks, GDKnr_threads,
+				 "sumpar");
+	if (rc == GDK_SUCCEED && slices)
+		rc = GDKparallel(aggrpar_summerge, &ap, ap.ntasks,
+				 GDKnr_threads, "summerge");
+	*algo = slices ? "sum: parallel, slices of input" :
+		"sum: parallel, partitioned on groups";
+	return aggrpar_done(&ap, rc);
+}
+
 /* calculate group sums with optional candidates list */
 BAT *
 BATgroupsum(BAT *b, BAT *g, BAT *e, BAT *s, int tp, bool skip_nils, bool abort_on_error)
@@ -928,9 +1286,21 @@ BATgroupsum(BAT *b, BAT *g, BAT *e, BAT *s, int tp, bool skip_nils, bool abort_o
 		gids = (const oid *) Tloc(g, 0);
 
 	BATiter bi = bat_iterator(b);
-	nils = dosum(bi.base, b->tnonil, b->hseqbase, &ci, ncand,
-		     Tloc(bn, 0), ngrp, b->ttype, tp, gids, min, max,
-		     skip_nils, abort_on_error, true, __func__, &algo);
+	if (aggrpar_use(&ci, gids, ngrp) &&
+	    (tp == TYPE_lng
+#ifdef HAVE_HGE
+	     || tp == TYPE_hge
+#endif
+		    ) && ATOMstorage(b->ttype) != TYPE_flt &&
+	    ATOMstorage(b->ttype) != TYPE_dbl)
+		nils = dosum_parallel(bi.base, b->tnonil, b->hseqbase, &ci,
+				      Tloc(bn, 0), ngrp, b->ttype, tp, gids,
+				      min, skip_nils, abort_on_error,
+				      __func__, &algo);
+	else
+		nils = dosum(bi.base, b->tnonil, b->hseqbase, &ci, ncand,
+			     Tloc(bn, 0), ngrp, b->ttype, tp, gids, min, max,
+			     skip_nils, abort_on_error, true, __func__, &algo);
 	bat_iterator_end(&bi);
 
 	if (nils < BUN_NONE) {
@@ -3025,6 +3395,79 @@ BATcalcavg(BAT *b, BAT *s, dbl *avg, BUN *vals, int scale)
 		}							\
 	} while (0)
 
+static gdk_return
+aggrpar_count(void *arg, size_t t)
+{
+	struct aggrpar *ap = arg;
+	const oid *restrict gids = ap->gids;
+	oid min = ap->min;
+	lng *restrict cnts;
+	BUN lo, hi;
+
+	if (ap->slices) {
+		AGGRPAR_SLICE(ap, t, lo, hi);
+		cnts = (lng *) ap->partials + t * ap->ngrp;
+		for (BUN i = lo; i < hi; i++) {
+			if (gids[i] >= min && gids[i] - min < ap->ngrp)
+				cnts[gids[i] - min]++;
+		}
+	} else {
+		/* all group ids of the partition belong to the range */
+		cnts = ap->results;
+		for (BUN i = ap->rstart[t], n = ap->rstart[t + 1]; i < n; i++)
+			cnts[ap->pgids[i] - min]++;
+	}
+	return GDK_SUCCEED;
+}
+
+/* add up the partial counts of a range of groups */
+static gdk_return
+aggrpar_countmerge(void *arg, size_t t)
+{
+	struct aggrpar *ap = arg;
+	const lng *restrict parts = ap->partials;
+	lng *restrict cnts = ap->results;
+	BUN glo, ghi;
+
+	AGGRPAR_GROUPS(ap, t, glo, ghi);
+	for (BUN p = 0; p < ap->ntasks; p++) {
+		for (BUN g = glo; g < ghi; g++)
+			cnts[g] += parts[p * ap->ngrp + g];
+	}
+	return GDK_SUCCEED;
+}
+
+/* parallel version of counting all values of a dense candidate list
+ * per group; cnts must be initialized to zero */
+static gdk_return
+docount_parallel(struct canditer *ci, lng *cnts, BUN ngrp,
+		 const oid *gids, oid min, const char **algo)
+{
+	struct aggrpar ap = {
+		.ci = ci,
+		.results = cnts,
+		.ngrp = ngrp,
+		.tp2 = TYPE_lng,
+		.gids = gids,
+		.min = min,
+	};
+	gdk_return rc;
+	bool slices = ngrp * GDKnr_threads <= ci->ncand;
+
+	if (aggrpar_init(&ap, slices) != GDK_SUCCEED)
+		return GDK_FAIL;
+	rc = slices ? GDK_SUCCEED : aggrpar_partition(&ap);
+	if (rc == GDK_SUCCEED)
+		rc = GDKparallel(aggrpar_count, &ap, ap.ntasks, GDKnr_threads,
+				 "countpar");
+	if (rc == GDK_SUCCEED && slices)
+		rc = GDKparallel(aggrpar_countmerge, &ap, ap.ntasks,
+				 GDKnr_threads, "countmerge");
+	*algo = slices ? "count: parallel, slices of input" :
+		"count: parallel, partitioned on groups";
+	return aggrpar_done(&ap, rc) == BUN_NONE ? GDK_FAIL : GDK_SUCCEED;
+}
+
 /* calculate group counts with optional candidates list */
 BAT *
 BATgroupcount(BAT *b, BAT *g, BAT *e, BAT *s, int tp, bool skip_nils, bool abort_on_error)
@@ -3041,6 +3484,7 @@ BATgroupcount(BAT *b, BAT *g, BAT *e, BAT *s, int tp, bool skip_nils, bool abort
 	struct canditer ci;
 	BUN ncand;
 	const char *err;
+	const char *algo = NULL;
 	lng t0 = 0;
 
 	TRC_DEBUG_IF(ALGO) t0 = GDKusec();
@@ -3079,7 +3523,15 @@ BATgroupcount(BAT *b, BAT *g, BAT *e, BAT *s, int tp, bool skip_nils, bool abort
 	if (!skip_nils || b->tnonil) {
 		/* if nils are nothing special, or if there are no
 		 * nils, we don't need to look at the values at all */
-		if (gids) {
+		if (aggrpar_use(&ci, gids, ngrp)) {
+			/* note, gids is indexed by position in b */
+			if (docount_parallel(&ci, cnts, ngrp,
+					     gids + ci.seq - b->hseqbase, min,
+					     &algo) != GDK_SUCCEED) {
+				BBPreclaim(bn);
+				return NULL;
+			}
+		} else if (gids) {
 			while (ncand > 0) {
 				ncand--;
 				i = canditer_next(&ci) - b->hseqbase;
@@ -3152,10 +3604,10 @@ BATgroupcount(BAT *b, BAT *g, BAT *e, BAT *s, int tp, bool skip_nils, bool abort
 	bn->tnonil = true;
 	TRC_DEBUG(ALGO, "b=" ALGOBATFMT ",g=" ALGOOPTBATFMT ","
 		  "e=" ALGOOPTBATFMT ",s=" ALGOOPTBATFMT " -> " ALGOOPTBATFMT
-		  "; start " OIDFMT ", count " BUNFMT " (" LLFMT " usec)\n",
+		  "; start " OIDFMT ", count " BUNFMT " (%s -- " LLFMT " usec)\n",
 		  ALGOBATPAR(b), ALGOOPTBATPAR(g), ALGOOPTBATPAR(e),
 		  ALGOOPTBATPAR(s), ALGOOPTBATPAR(bn),
-		  ci.seq, ncand, GDKusec() - t0);
+		  ci.seq, ncand, algo ? algo : "", GDKusec() - t0);
 	return bn;
 }
 
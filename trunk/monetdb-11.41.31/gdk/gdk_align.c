@@ -133,6 +133,8 @@ VIEWcreate(oid seq, BAT *b)
 	bn->timprints = NULL;
 	/* Order OID index */
 	bn->torderidx = NULL;
+	bn->tzonemap = NULL;
+	bn->tngram = NULL;
 	if (BBPcacheit(bn, true) != GDK_SUCCEED) {	/* enter in BBP */
 		if (tp) {
 			BBPunshare(tp);
@@ -188,6 +190,8 @@ BATmaterialize(BAT *b)
 	HASHdestroy(b);
 	IMPSdestroy(b);
 	OIDXdestroy(b);
+	ZMdestroy(b);
+	NGRAMdestroy(b);
 
 	*tail = (Heap) {
 		.farmid = BBPselectfarm(b->batRole, TYPE_oid, offheap),
@@ -367,6 +371,7 @@ VIEWdestroy(BAT *b)
 	HASHdestroy(b);
 	IMPSdestroy(b);
 	OIDXdestroy(b);
+	NGRAMdestroy(b);
 	VIEWunlink(b);
 
 	MT_lock_set(&b->theaplock);
@@ -381,6 +381,9 @@ ATOMreplaceVAR(BAT *b, var_t *dst, const void *src)
 #define GDK_STRHASHSIZE		(GDK_STRHASHTABLE * sizeof(stridx_t))
 #define GDK_ELIMPOWER		16	/* 64KiB is the threshold */
 #define GDK_ELIMDOUBLES(h)	((h)->free < GDK_ELIMLIMIT)
+/* no string occurs twice in the heap, so strings are equal iff their
+ * offsets are */
+#define GDK_DISTINCTSTR(h)	(GDK_ELIMDOUBLES(h) || (h)->distinct)
 #define GDK_ELIMLIMIT		(1<<GDK_ELIMPOWER)	/* equivalently: ELIMBASE == 0 */
 #define GDK_ELIMBASE(x)		(((x) >> GDK_ELIMPOWER) << GDK_ELIMPOWER)
 #define GDK_VAROFFSET		((var_t) GDK_STRHASHSIZE)
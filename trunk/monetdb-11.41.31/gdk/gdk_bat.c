@@ -483,6 +483,78 @@ BATattach(int tt, const char *heapfile, role_t role)
 	return NULL;
 }
 
+/* Create a transient BAT whose tail heap is a private memory map of
+ * heapfile, a file with the native representation of values of the
+ * fixed width type tt.  Nothing is read up front: the pages are
+ * shared with the file system cache until they are written to,
+ * after which the changes stay private to the BAT.  The file must
+ * not be truncated while the BAT exists. */
+BAT *
+BATattach_mmap(int tt, const char *heapfile)
+{
+	BAT *bn;
+	struct stat st;
+	size_t atomsize;
+	char *base;
+	BUN cap;
+
+	ERRORcheck(tt <= 0 || ATOMvarsized(tt) || ATOMstorage(tt) == TYPE_msk, "bad tail type\n", NULL);
+	ERRORcheck(heapfile == NULL, "bad heapfile name\n", NULL);
+
+	if (MT_stat(heapfile, &st) < 0) {
+		GDKsyserror("BATattach_mmap: cannot stat %s\n", heapfile);
+		return NULL;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		GDKerror("%s is not a regular file\n", heapfile);
+		return NULL;
+	}
+	atomsize = ATOMsize(tt);
+	if (st.st_size % atomsize != 0) {
+		GDKerror("heapfile size not integral number of atoms\n");
+		return NULL;
+	}
+	if ((size_t) (st.st_size / atomsize) > (size_t) BUN_MAX) {
+		GDKerror("heapfile too large\n");
+		return NULL;
+	}
+	cap = (BUN) (st.st_size / atomsize);
+	bn = COLnew(0, tt, 0, TRANSIENT);
+	if (bn == NULL || cap == 0)
+		return bn;
+	base = GDKmmap(heapfile, MMAP_READ | MMAP_COPY, (size_t) st.st_size);
+	if (base == NULL) {
+		BBPreclaim(bn);
+		return NULL;
+	}
+#ifdef HAVE_POSIX_MADVISE
+	/* the BAT is typically consumed front to back */
+	(void) posix_madvise(base, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+#endif
+	/* replace the empty heap by the map */
+	HEAPfree(bn->theap, false);
+	bn->theap->base = base;
+	bn->theap->size = (size_t) st.st_size;
+	bn->theap->free = (size_t) st.st_size;
+	bn->theap->storage = bn->theap->newstorage = STORE_PRIV;
+	bn->theap->dirty = true;
+	bn->batCapacity = cap;
+	BATsetcount(bn, cap);
+	bn->tnonil = false;
+	bn->tnil = false;
+	bn->tseqbase = oid_nil;
+	if (cap > 1) {
+		bn->tsorted = false;
+		bn->trevsorted = false;
+		bn->tkey = false;
+	} else {
+		bn->tsorted = ATOMlinear(tt);
+		bn->trevsorted = ATOMlinear(tt);
+		bn->tkey = true;
+	}
+	return bn;
+}
+
 /*
  * If the BAT runs out of storage for BUNS it will reallocate space.
  * For memory mapped BATs we simple extend the administration after
@@ -593,6 +665,8 @@ BATclear(BAT *b, bool force)
 	HASHdestroy(b);
 	IMPSdestroy(b);
 	OIDXdestroy(b);
+	ZMdestroy(b);
+	NGRAMdestroy(b);
 	PROPdestroy(b);
 
 	/* we must dispose of all inserted atoms */
@@ -677,6 +751,8 @@ BATfree(BAT *b)
 	HASHfree(b);
 	IMPSfree(b);
 	OIDXfree(b);
+	ZMfree(b);
+	NGRAMfree(b);
 	MT_lock_set(&b->theaplock);
 	if (nunique != BUN_NONE) {
 		BATsetprop_nolock(b, GDK_NUNIQUE, TYPE_oid, &(oid){nunique});
@@ -878,6 +954,7 @@ COLcopy(BAT *b, int tt, bool writable, role_t role)
 				memcpy(bn->tvheap->base, bi.vh->base, bi.vhfree);
 				bn->tvheap->free = bi.vhfree;
 				bn->tvheap->dirty = true;
+				bn->tvheap->distinct = bi.vh->distinct;
 			}
 
 			/* make sure we use the correct capacity */
@@ -1049,6 +1126,9 @@ BUNappendmulti(BAT *b, const void *values, BUN count, bool force)
 		return GDK_FAIL;
 	}
 
+	/* load zone map so that we can maintain it */
+	(void) BATcheckzonemap(b);
+
 	if (BATcount(b) + count > BATcapacity(b)) {
 		/* if needed space exceeds a normal growth extend just
 		 * with what's needed */
@@ -1302,6 +1382,7 @@ BUNappendmulti(BAT *b, const void *values, BUN count, bool force)
 
 	IMPSdestroy(b); /* no support for inserts in imprints yet */
 	OIDXdestroy(b);
+	ZMappend(b);
 	return GDK_SUCCEED;
 }
 
@@ -1406,6 +1487,8 @@ BUNdelete(BAT *b, oid o)
 	MT_lock_unset(&b->theaplock);
 	IMPSdestroy(b);
 	OIDXdestroy(b);
+	ZMdestroy(b);
+	NGRAMdestroy(b);
 	return GDK_SUCCEED;
 }
 
@@ -1437,6 +1520,8 @@ BUNinplacemulti(BAT *b, const oid *positions, const void *values, BUN count, boo
 			 BATgetId(b));
 		return GDK_FAIL;
 	}
+	/* load zone map so that we can maintain it */
+	(void) BATcheckzonemap(b);
 	MT_rwlock_wrlock(&b->thashlock);
 	for (BUN i = 0; i < count; i++) {
 		BUN p = autoincr ? positions[0] - b->hseqbase + i : positions[i] - b->hseqbase;
@@ -1556,6 +1641,7 @@ BUNinplacemulti(BAT *b, const oid *positions, const void *values, BUN count, boo
 		}
 		OIDXdestroy(b);
 		IMPSdestroy(b);
+		NGRAMdestroy(b);
 
 		if (b->tvarsized && b->ttype) {
 			var_t _d;
@@ -1696,6 +1782,14 @@ BUNinplacemulti(BAT *b, const oid *positions, const void *values, BUN count, boo
 		MT_lock_unset(&b->theaplock);
 	}
 	MT_rwlock_wrunlock(&b->thashlock);
+	if (b->tzonemap) {
+		/* widen the zone map with the new values */
+		if (autoincr)
+			ZMreplace(b, positions[0] - b->hseqbase, count);
+		else
+			for (BUN i = 0; i < count; i++)
+				ZMreplace(b, positions[i] - b->hseqbase, 1);
+	}
 	MT_lock_set(&b->theaplock);
 	b->theap->dirty = true;
 	if (b->tvheap)
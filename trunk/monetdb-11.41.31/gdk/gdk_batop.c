@@ -112,6 +112,7 @@ insert_string_bat(BAT *b, BAT *n, struct canditer *ci, bool force, bool mayshare
 			return GDK_FAIL;
 		}
 		if (oldcnt == 0 || (!GDK_ELIMDOUBLES(b->tvheap) &&
+				    !b->tvheap->distinct &&
 				    !GDK_ELIMDOUBLES(ni.vh) &&
 				    b->tvheap->hashash == ni.vh->hashash)) {
 			/* we'll consider copying the string heap completely
@@ -154,6 +155,13 @@ insert_string_bat(BAT *b, BAT *n, struct canditer *ci, bool force, bool mayshare
 				memcpy(b->tvheap->base + toff, ni.vh->base, ni.vhfree);
 				b->tvheap->free = toff + ni.vhfree;
 				b->tvheap->dirty = true;
+				/* a copy of a heap without duplicates
+				 * has none either, but we lost track of
+				 * the strings that were in b */
+				strDedupDestroy(b->tvheap);
+				b->tvheap->distinct = toff == 0 &&
+					ni.vh->distinct &&
+					b->tvheap->hashash == ni.vh->hashash;
 			}
 		}
 	}
@@ -261,7 +269,8 @@ insert_string_bat(BAT *b, BAT *n, struct canditer *ci, bool force, bool mayshare
 			}
 		}
 	} else if (b->tvheap->free < ni.vhfree / 2 ||
-		   GDK_ELIMDOUBLES(b->tvheap)) {
+		   GDK_ELIMDOUBLES(b->tvheap) ||
+		   b->tvheap->distinct) {
 		/* if b's string heap is much smaller than n's string
 		 * heap, don't bother checking whether n's string
 		 * values occur in b's string heap; also, if b is
@@ -711,6 +720,8 @@ BATappend2(BAT *b, BAT *n, BAT *s, bool force, bool mayshare)
 
 	IMPSdestroy(b);		/* imprints do not support updates yet */
 	OIDXdestroy(b);
+	/* load zone map so that we can maintain it */
+	(void) BATcheckzonemap(b);
 
 	MT_lock_set(&n->theaplock);
 	const ValRecord *npropmaxpos, *npropmaxval, *npropminpos, *npropminval;
@@ -923,6 +934,7 @@ BATappend2(BAT *b, BAT *n, BAT *s, bool force, bool mayshare)
 
   doreturn:
 	bat_iterator_end(&ni);
+	ZMappend(b);
 	TRC_DEBUG(ALGO, "b=%s,n=" ALGOBATFMT ",s=" ALGOOPTBATFMT
 		  " -> " ALGOBATFMT " (" LLFMT " usec)\n",
 		  buf, ALGOBATPAR(n), ALGOOPTBATPAR(s), ALGOBATPAR(b),
@@ -951,6 +963,8 @@ BATdel(BAT *b, BAT *d)
 		return GDK_SUCCEED;
 	IMPSdestroy(b);
 	OIDXdestroy(b);
+	ZMdestroy(b);
+	NGRAMdestroy(b);
 	HASHdestroy(b);
 	PROPdestroy(b);
 	if (BATtdense(d)) {
@@ -1146,8 +1160,10 @@ BATappend_or_update(BAT *b, BAT *p, const oid *positions, BAT *n,
 
 	OIDXdestroy(b);
 	IMPSdestroy(b);
-	/* load hash so that we can maintain it */
+	NGRAMdestroy(b);
+	/* load hash and zone map so that we can maintain them */
 	(void) BATcheckhash(b);
+	(void) BATcheckzonemap(b);
 
 	BATiter ni = bat_iterator(n);
 	MT_lock_set(&b->theaplock);
@@ -1521,6 +1537,7 @@ BATappend_or_update(BAT *b, BAT *p, const oid *positions, BAT *n,
 		}
 		MT_rwlock_wrunlock(&b->thashlock);
 		locked = false;
+		ZMreplace(b, pos, ni.count);
 		if (ni.count == BATcount(b)) {
 			/* if we replaced all values of b by values
 			 * from n, we can also copy the min/max
@@ -1547,6 +1564,7 @@ BATappend_or_update(BAT *b, BAT *p, const oid *positions, BAT *n,
 			}
 		}
 	} else {
+		const oid *updpos = positions;
 		for (BUN i = 0, j = ni.count; i < j; i++) {
 			oid updid;
 			if (positions) {
@@ -1683,6 +1701,11 @@ BATappend_or_update(BAT *b, BAT *p, const oid *positions, BAT *n,
 			MT_rwlock_wrunlock(&b->thashlock);
 			locked = false;
 		}
+		if (b->tzonemap) {
+			/* widen the zone map with the new values */
+			for (BUN i = 0, j = ni.count; i < j; i++)
+				ZMreplace(b, (updpos ? updpos[i] : BUNtoid(p, i)) - b->hseqbase, 1);
+		}
 	}
 	bat_iterator_end(&ni);
 	MT_lock_set(&b->theaplock);
@@ -1703,6 +1726,8 @@ BATappend_or_update(BAT *b, BAT *p, const oid *positions, BAT *n,
 		MT_rwlock_wrunlock(&b->thashlock);
 		doHASHdestroy(b, h);
 	}
+	/* some values may have been replaced already */
+	ZMdestroy(b);
 	return GDK_FAIL;
 }
 
@@ -2189,6 +2214,283 @@ BATordered_rev(BAT *b)
 	return b->trevsorted;
 }
 
+/* Parallel sort.  The values are cut into one run per thread, the
+ * runs are sorted independently using the sequential sort functions,
+ * and then merged in pairs, in rounds, alternating between the input
+ * arrays and a scratch copy.  Each pairwise merge is cut into pieces
+ * of equal output size by finding the position in both runs where
+ * each piece starts (the "co-rank"), so that also the merge rounds,
+ * including the last one, use all threads.  On equal values the merge
+ * takes the value from the left run first, so the parallel sort is
+ * stable if the run sort is.  */
+
+/* minimum number of values per run */
+#define SORTPAR_MINSIZE		((size_t) 1 << 16)
+/* do_sort sorts in parallel from this number of values onward */
+#define SORTPAR_THRESHOLD	(2 * SORTPAR_MINSIZE)
+
+struct sortpar {
+	char *h[2];		/* values: input, scratch */
+	oid *t[2];		/* oids that move along (or NULL) */
+	const char *base;	/* vheap of var-sized values */
+	int (*cmp)(const void *, const void *);
+	const void *nil;
+	int hs;
+	int tpe;		/* base type */
+	bool reverse, nilslast, stable;
+	int nruns;
+	size_t *bounds;		/* nruns+1 run boundaries */
+	/* the current merge round */
+	int src;		/* index in h and t of the input */
+	int step;		/* runs 2k*step and (2k+1)*step are merged */
+	size_t piece;		/* output size of a merge piece */
+	size_t *pstart;		/* first piece of each pair */
+	int npairs;
+};
+
+/* compare values i and j of array h in sort order */
+static int
+sortpar_cmp(const struct sortpar *sp, const char *h, size_t i, size_t j)
+{
+	const void *x, *y;
+	int c;
+
+	if (sp->base) {
+		x = sp->base + VarHeapVal(h, i, sp->hs);
+		y = sp->base + VarHeapVal(h, j, sp->hs);
+	} else {
+		x = h + i * sp->hs;
+		y = h + j * sp->hs;
+	}
+	if (sp->reverse != sp->nilslast) {
+		/* nil is not at the end where the comparison
+		 * function would put it */
+		bool xn = (*sp->cmp)(x, sp->nil) == 0;
+		bool yn = (*sp->cmp)(y, sp->nil) == 0;
+		if (xn || yn)
+			return sp->nilslast ? xn - yn : yn - xn;
+	}
+	c = (*sp->cmp)(x, y);
+	return sp->reverse ? -c : c;
+}
+
+static gdk_return
+sortpar_run(void *arg, size_t i)
+{
+	struct sortpar *sp = arg;
+	size_t lo = sp->bounds[i], n = sp->bounds[i + 1] - lo;
+	char *h = sp->h[sp->src] + lo * sp->hs;
+	oid *t = sp->t[sp->src] ? sp->t[sp->src] + lo : NULL;
+
+	if (sp->src != 0) {
+		/* sort the copy, so that the last merge round writes
+		 * into the input arrays */
+		memcpy(h, sp->h[0] + lo * sp->hs, n * sp->hs);
+		if (t)
+			memcpy(t, sp->t[0] + lo, n * sizeof(oid));
+	}
+	if (sp->stable) {
+		if (sp->reverse)
+			return GDKssort_rev(h, t, sp->base, n, sp->hs, t ? (int) sizeof(oid) : 0, sp->tpe);
+		return GDKssort(h, t, sp->base, n, sp->hs, t ? (int) sizeof(oid) : 0, sp->tpe);
+	}
+	GDKqsort(h, t, sp->base, n, sp->hs, t ? (int) sizeof(oid) : 0, sp->tpe, sp->reverse, sp->nilslast);
+	return GDK_SUCCEED;
+}
+
+/* the number of values of run [a, a+la) among the first k values of
+ * the merge of the runs [a, a+la) and [b, b+lb) */
+static size_t
+sortpar_corank(const struct sortpar *sp, const char *h,
+	       size_t a, size_t la, size_t b, size_t lb, size_t k)
+{
+	size_t lo = k > lb ? k - lb : 0, hi = k < la ? k : la;
+
+	while (lo < hi) {
+		size_t i = (lo + hi) / 2;
+		/* value i of the left run goes before value k-i-1 of
+		 * the right run if it is not larger */
+		if (sortpar_cmp(sp, h, b + k - i - 1, a + i) >= 0)
+			lo = i + 1;
+		else
+			hi = i;
+	}
+	return lo;
+}
+
+#define sortpar_lt(TYPE, x, y)						\
+	(is_##TYPE##_nil(x) || is_##TYPE##_nil(y)			\
+	 ? (nilslast ? !is_##TYPE##_nil(x) && is_##TYPE##_nil(y)	\
+	    : is_##TYPE##_nil(x) && !is_##TYPE##_nil(y))		\
+	 : reverse ? (x) > (y) : (x) < (y))
+
+#define SORTPAR_MERGE(TYPE)						\
+	do {								\
+		const TYPE *restrict vs = (const TYPE *) sh;		\
+		TYPE *restrict vd = (TYPE *) dh;			\
+		while (i < ie && j < je) {				\
+			if (sortpar_lt(TYPE, vs[j], vs[i])) {		\
+				if (st)					\
+					dt[o] = st[j];			\
+				vd[o++] = vs[j++];			\
+			} else {					\
+				if (st)					\
+					dt[o] = st[i];			\
+				vd[o++] = vs[i++];			\
+			}						\
+		}							\
+	} while (0)
+
+static gdk_return
+sortpar_merge(void *arg, size_t pc)
+{
+	struct sortpar *sp = arg;
+	int pair;
+	size_t a, la, b, lb, k0, k1, i, ie, j, je, o;
+	const char *sh = sp->h[sp->src];
+	char *dh = sp->h[1 - sp->src];
+	const oid *st = sp->t[sp->src];
+	oid *dt = sp->t[1 - sp->src];
+	const bool reverse = sp->reverse, nilslast = sp->nilslast;
+	const int hs = sp->hs;
+
+	for (pair = 0; pc >= sp->pstart[pair + 1]; pair++)
+		;
+	a = sp->bounds[2 * pair * sp->step];
+	b = sp->bounds[MIN((2 * pair + 1) * sp->step, sp->nruns)];
+	la = b - a;
+	lb = sp->bounds[MIN((2 * pair + 2) * sp->step, sp->nruns)] - b;
+	k0 = (pc - sp->pstart[pair]) * sp->piece;
+	k1 = MIN(k0 + sp->piece, la + lb);
+	/* this piece merges [i, ie) and [j, je) into [o, a+k1) */
+	i = sortpar_corank(sp, sh, a, la, b, lb, k0);
+	ie = sortpar_corank(sp, sh, a, la, b, lb, k1);
+	j = b + k0 - i;
+	je = b + k1 - ie;
+	i += a;
+	ie += a;
+	o = a + k0;
+	switch (sp->base ? TYPE_void : sp->tpe) {
+	case TYPE_bte:
+		SORTPAR_MERGE(bte);
+		break;
+	case TYPE_sht:
+		SORTPAR_MERGE(sht);
+		break;
+	case TYPE_int:
+		SORTPAR_MERGE(int);
+		break;
+	case TYPE_lng:
+		SORTPAR_MERGE(lng);
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		SORTPAR_MERGE(hge);
+		break;
+#endif
+	case TYPE_flt:
+		SORTPAR_MERGE(flt);
+		break;
+	case TYPE_dbl:
+		SORTPAR_MERGE(dbl);
+		break;
+	default:
+		while (i < ie && j < je) {
+			size_t x = sortpar_cmp(sp, sh, j, i) < 0 ? j++ : i++;
+			memcpy(dh + o * hs, sh + x * hs, hs);
+			if (st)
+				dt[o] = st[x];
+			o++;
+		}
+		break;
+	}
+	/* copy what remains of either run */
+	if (i < ie) {
+		memcpy(dh + o * hs, sh + i * hs, (ie - i) * hs);
+		if (st)
+			memcpy(dt + o, st + i, (ie - i) * sizeof(oid));
+	} else if (j < je) {
+		memcpy(dh + o * hs, sh + j * hs, (je - j) * hs);
+		if (st)
+			memcpy(dt + o, st + j, (je - j) * sizeof(oid));
+	}
+	return GDK_SUCCEED;
+}
+
+/* sort in parallel; on failure the values (and oids) are still a
+ * permutation of the input, so that the caller can sort them
+ * sequentially */
+static gdk_return
+do_sort_par(void *restrict h, void *restrict t, const void *restrict base,
+	    size_t n, int hs, int tpe, bool reverse, bool nilslast,
+	    bool stable)
+{
+	int nthreads = GDKnr_threads;
+	int rounds = 0;
+	int whole = 0;		/* index in h and t of a complete copy */
+	struct sortpar sp = {
+		.h[0] = h,
+		.t[0] = t,
+		.base = base,
+		.cmp = ATOMcompare(tpe),
+		.nil = ATOMnilptr(tpe),
+		.hs = hs,
+		.tpe = ATOMbasetype(tpe),
+		.reverse = reverse,
+		.nilslast = nilslast,
+		.stable = stable,
+	};
+	gdk_return rc = GDK_FAIL;
+
+	sp.nruns = (int) MIN((size_t) nthreads, n / SORTPAR_MINSIZE);
+	assert(sp.nruns >= 2);
+	while ((1 << rounds) < sp.nruns)
+		rounds++;
+	if ((sp.h[1] = GDKmalloc(n * hs)) == NULL ||
+	    (t && (sp.t[1] = GDKmalloc(n * sizeof(oid))) == NULL) ||
+	    (sp.bounds = GDKmalloc((sp.nruns + 1) * sizeof(size_t))) == NULL ||
+	    (sp.pstart = GDKmalloc((sp.nruns + 1) * sizeof(size_t))) == NULL) {
+		GDKclrerr();
+		goto bailout;
+	}
+	for (int r = 0; r <= sp.nruns; r++)
+		sp.bounds[r] = n / sp.nruns * r + MIN(n % sp.nruns, (size_t) r);
+
+	/* sort the runs where the last merge round wants them */
+	sp.src = rounds & 1;
+	if (GDKparallel(sortpar_run, &sp, sp.nruns, nthreads, "sortrun") != GDK_SUCCEED)
+		goto bailout;
+	whole = sp.src;
+	sp.piece = (n + 2 * nthreads - 1) / (2 * nthreads);
+	for (sp.step = 1; sp.step < sp.nruns; sp.step *= 2) {
+		sp.npairs = 0;
+		sp.pstart[0] = 0;
+		for (int r = 0; r < sp.nruns; r += 2 * sp.step) {
+			size_t len = sp.bounds[MIN(r + 2 * sp.step, sp.nruns)] - sp.bounds[r];
+			sp.pstart[sp.npairs + 1] = sp.pstart[sp.npairs] + (len + sp.piece - 1) / sp.piece;
+			sp.npairs++;
+		}
+		if (GDKparallel(sortpar_merge, &sp, sp.pstart[sp.npairs], nthreads, "sortmerge") != GDK_SUCCEED)
+			goto bailout;
+		sp.src = 1 - sp.src;
+		whole = sp.src;
+	}
+	assert(whole == 0);
+	rc = GDK_SUCCEED;
+
+  bailout:
+	if (whole != 0) {
+		memcpy(h, sp.h[1], n * hs);
+		if (t)
+			memcpy(t, sp.t[1], n * sizeof(oid));
+	}
+	GDKfree(sp.h[1]);
+	GDKfree(sp.t[1]);
+	GDKfree(sp.bounds);
+	GDKfree(sp.pstart);
+	return rc;
+}
+
 /* figure out which sort function is to be called
  * stable sort can produce an error (not enough memory available),
  * "quick" sort does not produce errors */
@@ -2199,6 +2501,18 @@ do_sort(void *restrict h, void *restrict t, const void *restrict base,
 {
 	if (n <= 1)		/* trivially sorted */
 		return GDK_SUCCEED;
+	if (n >= SORTPAR_THRESHOLD && GDKnr_threads > 1 &&
+	    (ts == 0 || ts == (int) sizeof(oid))) {
+		lng t0 = GDKusec();
+		if (do_sort_par(h, t, base, n, hs, tpe, reverse, nilslast,
+				stable) == GDK_SUCCEED) {
+			TRC_DEBUG(ALGO, "parallel sort of %zu values with %d threads (" LLFMT " usec)\n", n, GDKnr_threads, GDKusec() - t0);
+			return GDK_SUCCEED;
+		}
+		/* a failing run sort leaves the values in some
+		 * order, so we can still sort them sequentially */
+		GDKclrerr();
+	}
 	if (stable) {
 		if (reverse)
 			return GDKssort_rev(h, t, base, n, hs, ts, tpe);
@@ -2210,6 +2524,99 @@ do_sort(void *restrict h, void *restrict t, const void *restrict base,
 	return GDK_SUCCEED;
 }
 
+/* Sort each group of the n values in h (with their oids in ords)
+ * separately, where a group is a series of equal values in grps.  The
+ * groups are divided over the threads in chunks of consecutive
+ * values; a chunk takes care of the groups that start in it.  Groups
+ * that are large enough to be sorted in parallel by themselves are
+ * left to the end. */
+struct sortgrp {
+	char *h;
+	oid *ords;
+	const void *base;
+	const oid *grps;
+	BUN n, chunk;
+	int hs, tpe;
+	bool reverse, nilslast, stable;
+	bool *large;		/* per chunk: skipped a large group */
+};
+
+static gdk_return
+sortgrp_chunk(void *arg, size_t c)
+{
+	struct sortgrp *sg = arg;
+	const oid *grps = sg->grps;
+	BUN r = c * sg->chunk, e = MIN(r + sg->chunk, sg->n), p;
+
+	if (r > 0) {
+		/* skip the group started in the previous chunk */
+		while (r < e && grps[r] == grps[r - 1])
+			r++;
+	}
+	for (; r < e; r = p) {
+		for (p = r + 1; p < sg->n && grps[p] == grps[r]; p++)
+			;
+		if (p - r >= SORTPAR_THRESHOLD) {
+			sg->large[c] = true;
+			continue;
+		}
+		if (do_sort(sg->h + r * sg->hs,
+			    sg->ords ? sg->ords + r : NULL, sg->base,
+			    p - r, sg->hs, sg->ords ? sizeof(oid) : 0,
+			    sg->tpe, sg->reverse, sg->nilslast,
+			    sg->stable) != GDK_SUCCEED)
+			return GDK_FAIL;
+	}
+	return GDK_SUCCEED;
+}
+
+static gdk_return
+do_sort_groups(void *restrict h, oid *restrict ords, const void *restrict base,
+	       const oid *grps, BUN n, int hs, int tpe, bool reverse,
+	       bool nilslast, bool stable)
+{
+	size_t nchunks = (size_t) GDKnr_threads * 4;
+	struct sortgrp sg = {
+		.h = h,
+		.ords = ords,
+		.base = base,
+		.grps = grps,
+		.n = n,
+		.chunk = (n + nchunks - 1) / nchunks,
+		.hs = hs,
+		.tpe = tpe,
+		.reverse = reverse,
+		.nilslast = nilslast,
+		.stable = stable,
+	};
+	gdk_return rc;
+
+	if ((sg.large = GDKzalloc(nchunks)) == NULL)
+		return GDK_FAIL;
+	rc = GDKparallel(sortgrp_chunk, &sg, nchunks, GDKnr_threads, "sortgrp");
+	for (size_t c = 0; rc == GDK_SUCCEED && c < nchunks; c++) {
+		if (!sg.large[c])
+			continue;
+		/* sort the large groups starting in this chunk with
+		 * all threads */
+		BUN r = c * sg.chunk, e = MIN(r + sg.chunk, n), p;
+		if (r > 0)
+			while (r < e && grps[r] == grps[r - 1])
+				r++;
+		for (; r < e && rc == GDK_SUCCEED; r = p) {
+			for (p = r + 1; p < n && grps[p] == grps[r]; p++)
+				;
+			if (p - r >= SORTPAR_THRESHOLD)
+				rc = do_sort((char *) h + r * hs,
+					     ords ? ords + r : NULL, base,
+					     p - r, hs, ords ? sizeof(oid) : 0,
+					     tpe, reverse, nilslast, stable);
+		}
+	}
+	GDKfree(sg.large);
+	return rc;
+}
+
 /* Sort the bat b according to both o and g.  The stable and reverse
  * parameters indicate whether the sort should be stable or descending
  * respectively.  The parameter b is required, o and g are optional
@@ -2574,26 +2981,39 @@ BATsort(BAT **sorted, BAT **order, BAT **groups,
 		prev = grps[0];
 		if (BATmaterialize(bn) != GDK_SUCCEED)
 			goto error;
-		for (r = 0, p = 1, q = BATcount(g); p < q; p++) {
-			if (grps[p] != prev) {
-				/* sub sort [r,p) */
-				if (do_sort(Tloc(bn, r),
-					    ords ? ords + r : NULL,
-					    bn->tvheap ? bn->tvheap->base : NULL,
-					    p - r, Tsize(bn), ords ? sizeof(oid) : 0,
-					    bn->ttype, reverse, nilslast, stable) != GDK_SUCCEED)
-					goto error;
-				r = p;
-				prev = grps[p];
+		q = BATcount(g);
+		if (GDKnr_threads > 1 && q >= SORTPAR_THRESHOLD &&
+		    grps[0] != grps[q - 1]) {
+			/* the groups are independent, so sort them
+			 * on multiple threads */
+			if (do_sort_groups(Tloc(bn, 0), ords,
+					   bn->tvheap ? bn->tvheap->base : NULL,
+					   grps, q, Tsize(bn), bn->ttype,
+					   reverse, nilslast, stable) != GDK_SUCCEED)
+				goto error;
+			r = q;	/* not a single group */
+		} else {
+			for (r = 0, p = 1; p < q; p++) {
+				if (grps[p] != prev) {
+					/* sub sort [r,p) */
+					if (do_sort(Tloc(bn, r),
+						    ords ? ords + r : NULL,
+						    bn->tvheap ? bn->tvheap->base : NULL,
+						    p - r, Tsize(bn), ords ? sizeof(oid) : 0,
+						    bn->ttype, reverse, nilslast, stable) != GDK_SUCCEED)
+						goto error;
+					r = p;
+					prev = grps[p];
+				}
 			}
+			/* sub sort [r,q) */
+			if (do_sort(Tloc(bn, r),
+				    ords ? ords + r : NULL,
+				    bn->tvheap ? bn->tvheap->base : NULL,
+				    p - r, Tsize(bn), ords ? sizeof(oid) : 0,
+				    bn->ttype, reverse, nilslast, stable) != GDK_SUCCEED)
+				goto error;
 		}
-		/* sub sort [r,q) */
-		if (do_sort(Tloc(bn, r),
-			    ords ? ords + r : NULL,
-			    bn->tvheap ? bn->tvheap->base : NULL,
-			    p - r, Tsize(bn), ords ? sizeof(oid) : 0,
-			    bn->ttype, reverse, nilslast, stable) != GDK_SUCCEED)
-			goto error;
 		/* if single group (r==0) the result is (rev)sorted,
 		 * otherwise (maybe) not */
 		bn->tsorted = r == 0 && !reverse && !nilslast;
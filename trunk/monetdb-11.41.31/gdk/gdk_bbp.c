@@ -547,13 +547,13 @@ vheapinit(BAT *b, const char *buf, int hashash, const char *filename, int lineno
 {
 	int n = 0;
 	uint64_t free, size;
-	uint16_t storage;
+	uint16_t distinct;
 
 	if (b->tvarsized && b->ttype != TYPE_void) {
 		if (sscanf(buf,
 			   " %" SCNu64 " %" SCNu64 " %" SCNu16
 			   "%n",
-			   &free, &size, &storage, &n) < 3) {
+			   &free, &size, &distinct, &n) < 3) {
 			TRC_CRITICAL(GDK, "invalid format for BBP.dir on line %d", lineno);
 			return -1;
 		}
@@ -573,6 +573,7 @@ vheapinit(BAT *b, const char *buf, int hashash, const char *filename, int lineno
 			.base = NULL,
 			.storage = STORE_INVALID,
 			.hashash = hashash != 0,
+			.distinct = distinct == 1 && hashash == 0,
 			.cleanhash = true,
 			.newstorage = STORE_INVALID,
 			.dirty = false,
@@ -1648,7 +1649,9 @@ vheap_entry(FILE *fp, BATiter *bi, BUN size)
 	(void) size;
 	if (bi->vh == NULL)
 		return 0;
-	return fprintf(fp, " %zu %zu %d", size == 0 ? 0 : bi->vhfree, bi->vh->size, 0);
+	/* the third value used to be the storage type (always 0), now
+	 * it records whether the string heap is free of duplicates */
+	return fprintf(fp, " %zu %zu %d", size == 0 ? 0 : bi->vhfree, bi->vh->size, bi->vh->distinct);
 }
 
 static gdk_return
@@ -2947,6 +2950,10 @@ BBPsave(BAT *b)
 		    (b->thash->heaplink.dirty || b->thash->heapbckt.dirty))
 			BAThashsave(b, (BBP_status(bid) & BBPPERSISTENT) != 0);
 		MT_rwlock_rdunlock(&b->thashlock);
+		if (!isVIEW(b)) {
+			ZMsave(b, BATcount(b), (BBP_status(bid) & BBPPERSISTENT) != 0);
+			NGRAMsave(b, BATcount(b), (BBP_status(bid) & BBPPERSISTENT) != 0);
+		}
 		return GDK_SUCCEED;
 	}
 	if (lock)
@@ -3344,6 +3351,24 @@ do_backup(const char *srcdir, const char *nme, const char *ext,
 		 * directory (see heap_move). */
 		gdk_return mvret = GDK_SUCCEED;
 		bool exists;
+		long_str undoext;
+
+		/* an undo file means that the heap file was saved
+		 * incrementally (see HEAPsave) but not committed:
+		 * restore the heap file so that it can be backed up
+		 * as usual */
+		strconcat_len(undoext, sizeof(undoext), ext, ".undo", NULL);
+		for (int d = 0; d < 2; d++) {
+			const char *dir = d == 0 ? BAKDIR : SUBDIR;
+			if (file_exists(h->farmid, dir, nme, undoext)) {
+				long_str name;
+
+				strconcat_len(name, sizeof(name), nme, ".", undoext, NULL);
+				if (HEAPundo(h->farmid, dir, name, srcdir) != GDK_SUCCEED)
+					return GDK_FAIL;
+				HEAPpages_invalidate();
+			}
+		}
 
 		if (istail) {
 			exists = file_exists(h->farmid, BAKDIR, nme, "tail.new") ||
@@ -3369,8 +3394,19 @@ do_backup(const char *srcdir, const char *nme, const char *ext,
 			 * file (with or without .new extension) in
 			 * the BAKDIR, move the heap (preferably with
 			 * .new extension) to the correct backup
-			 * directory */
-			if (istail) {
+			 * directory; if we can save the heap
+			 * incrementally, an undo file will do
+			 * instead */
+			bool done = false;
+			if (h->storage == STORE_MEM &&
+			    !file_exists(h->farmid, srcdir, nme, extnew) &&
+			    HEAPbackup_pages(h, srcdir, nme, ext,
+					     subcommit ? SUBDIR : BAKDIR,
+					     &done) != GDK_SUCCEED)
+				return GDK_FAIL;
+			if (done) {
+				/* nothing to move */
+			} else if (istail) {
 				if (file_exists(h->farmid, srcdir, nme, "tail.new"))
 					mvret = heap_move(h, srcdir,
 							  subcommit ? SUBDIR : BAKDIR,
@@ -3616,6 +3652,93 @@ BBPcheckBBPdir(bool subcommit)
 	}
 }
 
+/*
+ * The heaps of the bats of a BBPsync are saved by a pool of threads,
+ * and when there are many, they are not synced one by one but all at
+ * once by syncing the file systems of the farms afterwards.  The
+ * BBP.dir entries are still written in bat order by the calling
+ * thread.
+ */
+#define SYNCFS_MIN	64	/* min number of bats to sync with syncfs */
+#define SYNC_REPORT	10000	/* ms between progress reports */
+
+struct syncbat {
+	bat i;
+	BUN size;
+	BAT *b;			/* bat to save, if any */
+	BATiter bi;
+	oid minpos, maxpos;
+};
+
+struct syncsave {
+	struct syncbat *bats;
+	int *todo;		/* indexes in bats of the bats to save */
+	int ntodo;
+	bool lock;		/* whether to take the swap locks */
+	bool syncfs;		/* sync by syncfs instead of per file */
+	ATOMIC_TYPE saved;	/* number of bats saved so far */
+	ATOMIC_TYPE report;	/* time of last progress report */
+};
+
+static gdk_return
+BBPsync_save(void *arg, size_t n)
+{
+	struct syncsave *sync = arg;
+	struct syncbat *sb = &sync->bats[sync->todo[n]];
+	bat i = sb->i;
+	gdk_return ret;
+
+	/* wait for BBPSAVING so that we can set it, wait for
+	 * BBPUNLOADING before attempting to save */
+	for (;;) {
+		if (sync->lock)
+			MT_lock_set(&GDKswapLock(i));
+		if (!(BBP_status(i) & (BBPSAVING|BBPUNLOADING)))
+			break;
+		if (sync->lock)
+			MT_lock_unset(&GDKswapLock(i));
+		BBPspin(i, __func__, BBPSAVING|BBPUNLOADING);
+	}
+	BBP_status_on(i, BBPSAVING);
+	if (sync->lock)
+		MT_lock_unset(&GDKswapLock(i));
+	ret = BATsave_iter(sb->b, &sb->bi, sb->size, !sync->syncfs);
+	BBP_status_off(i, BBPSAVING);
+
+	ATOMIC_BASE_TYPE saved = ATOMIC_INC(&sync->saved);
+	ATOMIC_BASE_TYPE last = ATOMIC_GET(&sync->report);
+	ATOMIC_BASE_TYPE now = (ATOMIC_BASE_TYPE) GDKms();
+	if (now - last >= SYNC_REPORT &&
+	    ATOMIC_CAS(&sync->report, &last, now))
+		TRC_INFO(GDK, "saved %d of %d bats\n", (int) saved, sync->ntodo);
+	return ret;
+}
+
+#ifdef HAVE_SYNCFS
+/* sync the file systems of all persistent farms */
+static gdk_return
+BBPsyncfs(void)
+{
+	for (int i = 0; i < MAXFARMS; i++) {
+		if (BBPfarms[i].dirname == NULL ||
+		    !(BBPfarms[i].roles & (1U << PERSISTENT)))
+			continue;
+		int fd = open(BBPfarms[i].dirname, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			GDKsyserror("cannot open directory %s\n", BBPfarms[i].dirname);
+			return GDK_FAIL;
+		}
+		if (syncfs(fd) < 0) {
+			GDKsyserror("syncfs(%s) failed\n", BBPfarms[i].dirname);
+			close(fd);
+			return GDK_FAIL;
+		}
+		close(fd);
+	}
+	return GDK_SUCCEED;
+}
+#endif
+
 /*
  * @+ Atomic Write
  * The atomic BBPsync() function first safeguards the old images of
@@ -3637,6 +3760,9 @@ BBPsync(int cnt, bat *restrict subcommit, BUN *restrict sizes, lng logno, lng tr
 	char buf[3000];
 	int n = subcommit ? 0 : -1;
 	FILE *obbpf, *nbbpf;
+	struct syncbat *bats = NULL;
+	int nbats = 0;
+	struct syncsave sync = {0};
 
 	if(!(bakdir = GDKfilepath(0, NULL, subcommit ? SUBDIR : BAKDIR, NULL)))
 		return GDK_FAIL;
@@ -3721,18 +3847,28 @@ BBPsync(int cnt, bat *restrict subcommit, BUN *restrict sizes, lng logno, lng tr
 	TRC_DEBUG(PERF, "move time %d, %d files\n", (t1 = GDKms()) - t0, backup_files);
 
 	/* PHASE 2: save the repository and write new BBP.dir file */
+	if (ret == GDK_SUCCEED) {
+		bats = GDKmalloc(cnt * sizeof(struct syncbat));
+		sync.todo = GDKmalloc(cnt * sizeof(int));
+		if (bats == NULL || sync.todo == NULL)
+			ret = GDK_FAIL;
+	}
 	if (ret == GDK_SUCCEED) {
 		ret = BBPdir_first(subcommit != NULL, logno, transid,
 				   &obbpf, &nbbpf);
 	}
 
+	/* collect what needs saving, the saving itself is done below */
 	for (int idx = 1; ret == GDK_SUCCEED && idx < cnt; idx++) {
+		struct syncbat *sb = &bats[idx];
 		bat i = subcommit ? subcommit[idx] : idx;
 		/* BBP_desc(i) may be NULL */
 		BUN size = sizes ? sizes[idx] : BUN_NONE;
-		BATiter bi;
-		oid minpos = oid_nil, maxpos = oid_nil;
 
+		*sb = (struct syncbat) {
+			.minpos = oid_nil,
+			.maxpos = oid_nil,
+		};
 		if (BBP_status(i) & BBPPERSISTENT) {
 			BAT *b = dirty_bat(&i, subcommit != NULL);
 			if (i <= 0) {
@@ -3740,65 +3876,78 @@ BBPsync(int cnt, bat *restrict subcommit, BUN *restrict sizes, lng logno, lng tr
 				break;
 			}
 			MT_lock_set(&BBP_desc(i)->theaplock);
-			bi = bat_iterator_nolock(BBP_desc(i));
-			HEAPincref(bi.h);
-			if (bi.vh)
-				HEAPincref(bi.vh);
+			sb->bi = bat_iterator_nolock(BBP_desc(i));
+			HEAPincref(sb->bi.h);
+			if (sb->bi.vh)
+				HEAPincref(sb->bi.vh);
 #ifndef NDEBUG
-			bi.locked = true;
+			sb->bi.locked = true;
 #endif
-			assert(sizes == NULL || size <= bi.count);
-			assert(sizes == NULL || bi.width == 0 || (bi.type == TYPE_msk ? ((size + 31) / 32) * 4 : size << bi.shift) <= bi.hfree);
-			if (size > bi.count) /* includes sizes==NULL */
-				size = bi.count;
-			bi.b->batInserted = size;
-			if (size == 0) {
-				/* no need to save anything */
-				MT_lock_unset(&bi.b->theaplock);
-			} else {
+			assert(sizes == NULL || size <= sb->bi.count);
+			assert(sizes == NULL || sb->bi.width == 0 || (sb->bi.type == TYPE_msk ? ((size + 31) / 32) * 4 : size << sb->bi.shift) <= sb->bi.hfree);
+			if (size > sb->bi.count) /* includes sizes==NULL */
+				size = sb->bi.count;
+			sb->bi.b->batInserted = size;
+			if (size > 0) {
 				const ValRecord *prop;
-				prop = BATgetprop_nolock(bi.b, GDK_MIN_POS);
+				prop = BATgetprop_nolock(sb->bi.b, GDK_MIN_POS);
 				if (prop)
-					minpos = prop->val.oval;
-				prop = BATgetprop_nolock(bi.b, GDK_MAX_POS);
+					sb->minpos = prop->val.oval;
+				prop = BATgetprop_nolock(sb->bi.b, GDK_MAX_POS);
 				if (prop)
-					maxpos = prop->val.oval;
-				MT_lock_unset(&bi.b->theaplock);
-				if (b) {
-					/* wait for BBPSAVING so
-					 * that we can set it,
-					 * wait for BBPUNLOADING
-					 * before attempting to
-					 * save */
-					for (;;) {
-						if (lock)
-							MT_lock_set(&GDKswapLock(i));
-						if (!(BBP_status(i) & (BBPSAVING|BBPUNLOADING)))
-							break;
-						if (lock)
-							MT_lock_unset(&GDKswapLock(i));
-						BBPspin(i, __func__, BBPSAVING|BBPUNLOADING);
-					}
-					BBP_status_on(i, BBPSAVING);
-					if (lock)
-						MT_lock_unset(&GDKswapLock(i));
-					ret = BATsave_iter(b, &bi, size);
-					BBP_status_off(i, BBPSAVING);
-				}
+					sb->maxpos = prop->val.oval;
+				/* if size == 0 there is no need to
+				 * save anything */
+				if (b)
+					sync.todo[sync.ntodo++] = idx;
 			}
+			MT_lock_unset(&sb->bi.b->theaplock);
+			sb->b = b;
 		} else {
-			bi = bat_iterator(NULL);
+			sb->bi = bat_iterator(NULL);
 		}
+		sb->i = i;
+		sb->size = size;
+		nbats = idx + 1;
+	}
+
+	if (ret == GDK_SUCCEED && sync.ntodo > 0) {
+		sync.bats = bats;
+		sync.lock = lock;
+#ifdef HAVE_SYNCFS
+		/* with many files it is cheaper to sync the file
+		 * systems once when all have been written */
+		sync.syncfs = sync.ntodo >= SYNCFS_MIN && !(GDKdebug & NOSYNCMASK);
+#endif
+		ATOMIC_INIT(&sync.saved, 0);
+		ATOMIC_INIT(&sync.report, (ATOMIC_BASE_TYPE) GDKms());
+		/* when the BBP is locked by us (TMcommit), other
+		 * threads cannot save bats */
+		ret = GDKparallel(BBPsync_save, &sync, sync.ntodo,
+				  lock ? GDKnr_threads : 1, "bbpsync");
+		ATOMIC_DESTROY(&sync.saved);
+		ATOMIC_DESTROY(&sync.report);
+#ifdef HAVE_SYNCFS
+		if (ret == GDK_SUCCEED && sync.syncfs)
+			ret = BBPsyncfs();
+#endif
+	}
+
+	/* write the BBP.dir entries in bat order */
+	for (int idx = 1; idx < nbats; idx++) {
+		struct syncbat *sb = &bats[idx];
 		if (ret == GDK_SUCCEED) {
-			n = BBPdir_step(i, size, n, buf, sizeof(buf), &obbpf, nbbpf, &bi, (BUN) minpos, (BUN) maxpos);
+			n = BBPdir_step(sb->i, sb->size, n, buf, sizeof(buf), &obbpf, nbbpf, &sb->bi, (BUN) sb->minpos, (BUN) sb->maxpos);
 			if (n < -1)
 				ret = GDK_FAIL;
 		}
-		bat_iterator_end(&bi);
+		bat_iterator_end(&sb->bi);
 		/* we once again have a saved heap */
 	}
+	GDKfree(bats);
+	GDKfree(sync.todo);
 
-	TRC_DEBUG(PERF, "write time %d\n", (t0 = GDKms()) - t1);
+	TRC_DEBUG(PERF, "write time %d, %d bats saved%s\n", (t0 = GDKms()) - t1, sync.ntodo, sync.syncfs ? " (syncfs)" : "");
 
 	if (ret == GDK_SUCCEED) {
 		ret = BBPdir_last(n, buf, sizeof(buf), obbpf, nbbpf);
@@ -3870,7 +4019,11 @@ force_move(int farmid, const char *srcdir, const char *dstdir, const char *name)
 	char *dstpath, *killfile;
 	gdk_return ret = GDK_SUCCEED;
 
-	if ((p = strrchr(name, '.')) != NULL && strcmp(p, ".kill") == 0) {
+	if ((p = strrchr(name, '.')) != NULL && strcmp(p, ".undo") == 0) {
+		/* Found a X.undo file, ie restore X in place */
+		return HEAPundo(farmid, srcdir, name, dstdir);
+	}
+	if (p != NULL && strcmp(p, ".kill") == 0) {
 		/* Found a X.new.kill file, ie remove the X.new file */
 		ptrdiff_t len = p - name;
 		long_str srcpath;
@@ -4011,6 +4164,8 @@ BBPrecover(int farmid)
 			if (i < 0)
 				i = -i;
 		}
+		/* heap files change, so page hashes become invalid */
+		HEAPpages_invalidate();
 		if (i == 0 || i >= (bat) ATOMIC_GET(&BBPsize) || !BBPvalid(i)) {
 			force_move(farmid, BAKDIR, LEFTDIR, dent->d_name);
 		} else {
@@ -4268,6 +4423,16 @@ BBPdiskscan(const char *parent, size_t baseoff)
 #else
 				delete = true;
 #endif
+			} else if (strncmp(p + 1, "tzonemap", 8) == 0) {
+				BAT *b = getdesc(bid);
+				delete = b == NULL;
+				if (!delete)
+					b->tzonemap = (ZoneMap *) 1;
+			} else if (strncmp(p + 1, "tngram", 6) == 0) {
+				BAT *b = getdesc(bid);
+				delete = b == NULL;
+				if (!delete)
+					b->tngram = (NgramIdx *) 1;
 			} else if (strncmp(p + 1, "new", 3) != 0) {
 				ok = false;
 			}
@@ -579,6 +579,372 @@ ctz(oid x)
 	)
 
 
+/* Parallel grouping of 4 and 8 byte values.
+ *
+ * The input is hash-partitioned on the value (and the pre-existing
+ * group id, if any), after which the partitions are grouped
+ * independently, divided over a number of threads, each partition
+ * using its own small hash table.  Since the partitioning is stable,
+ * we know for each group where it first occurs in the input, and we
+ * use that to number the groups in the order of their first
+ * occurrence, just like the sequential code does.  This means the
+ * result does not depend on the number of threads used.  Finally, the
+ * group ids are gathered back into input order by replaying the
+ * partitioning, so that all writes to the output are sequential. */
+
+#define GRPPAR_MINSIZE	((BUN) 1 << 20)	/* min size of input */
+#define GRPPAR_MAXBITS	10		/* max number of partition bits */
+#define GRPPAR_PARTSIZE	((BUN) 1 << 16)	/* target size of partition */
+
+struct grppar {
+	struct canditer *ci;
+	const void *vals;	/* values of b */
+	oid hseqb;
+	const oid *grps;	/* pre-existing groups (or NULL) */
+	oid *ngrps;		/* the new groups (aligned with ci) */
+	oid *exts;		/* extents (or NULL) */
+	lng *cnts;		/* histogram (or NULL) */
+	int width;		/* width of the values (4 or 8) */
+	int bits;		/* number of partition bits */
+	BUN nchunks;		/* number of chunks the input is split into */
+	BUN chunksize;
+	BUN *hist;		/* partition offsets per chunk */
+	BUN *start;		/* copy of hist before scattering */
+	BUN *bounds;		/* start of each partition */
+	BUN *pos;		/* partitioned positions (index in ci) */
+	void *pvals;		/* partitioned values */
+	BUN *lgrp;		/* local, later global, group of each
+				 * partitioned value */
+	BUN *first;		/* first position of each local group */
+	lng *size;		/* size of each local group */
+	BUN *nlgrps;		/* number of local groups per partition */
+	uint8_t *mark;		/* which positions start a group */
+	BUN *chunkcnt;		/* number of groups starting in chunk */
+	BUN *chunklast;		/* last group start in chunk */
+};
+
+#define GRPPAR_HASH(TYPE, v, r)						\
+	(fmix_##TYPE(v) ^ (gp->grps ? fmix_lng((lng) gp->grps[r]) : 0))
+#define GRPPAR_PART(gp, h)	((h) >> (32 - (gp)->bits))
+
+/* loop over chunk c of the input */
+#define GRPPAR_CHUNKLOOP(TYPE, BODY)					\
+	do {								\
+		struct canditer ci = *gp->ci;				\
+		const TYPE *restrict vals = gp->vals;			\
+		BUN lo = c * gp->chunksize;				\
+		BUN hi = MIN(lo + gp->chunksize, ci.ncand);		\
+		canditer_setidx(&ci, lo);				\
+		for (BUN r = lo; r < hi; r++) {				\
+			TYPE v = vals[canditer_next(&ci) - gp->hseqb];	\
+			unsigned int h = GRPPAR_HASH(TYPE, v, r);	\
+			BODY;						\
+		}							\
+	} while (0)
+
+static gdk_return
+grppar_histogram(void *arg, size_t c)
+{
+	struct grppar *gp = arg;
+	BUN *restrict hist = gp->hist + (c << gp->bits);
+
+	if (gp->width == 4)
+		GRPPAR_CHUNKLOOP(int, hist[GRPPAR_PART(gp, h)]++);
+	else
+		GRPPAR_CHUNKLOOP(lng, hist[GRPPAR_PART(gp, h)]++);
+	return GDK_SUCCEED;
+}
+
+static gdk_return
+grppar_scatter(void *arg, size_t c)
+{
+	struct grppar *gp = arg;
+	BUN *restrict hist = gp->hist + (c << gp->bits);
+	BUN *restrict pos = gp->pos;
+
+	if (gp->width == 4) {
+		int *restrict pvals = gp->pvals;
+		GRPPAR_CHUNKLOOP(int, {
+				BUN p = hist[GRPPAR_PART(gp, h)]++;
+				pvals[p] = v;
+				pos[p] = r;
+			});
+	} else {
+		lng *restrict pvals = gp->pvals;
+		GRPPAR_CHUNKLOOP(lng, {
+				BUN p = hist[GRPPAR_PART(gp, h)]++;
+				pvals[p] = v;
+				pos[p] = r;
+			});
+	}
+	return GDK_SUCCEED;
+}
+
+/* group the values of one partition */
+#define GRPPAR_GROUP(TYPE)						\
+	do {								\
+		const TYPE *restrict vals = (const TYPE *) gp->pvals + lo; \
+		for (BUN i = 0; i < n; i++) {				\
+			TYPE v = vals[i];				\
+			BUN r = pos[i];					\
+			BUN k = GRPPAR_HASH(TYPE, v, r) & mask;		\
+			BUN j;						\
+			for (j = heads[k]; j != BUN_NONE; j = next[j]) { \
+				if (vals[rep[j]] == v &&		\
+				    (gp->grps == NULL ||		\
+				     gp->grps[pos[rep[j]]] == gp->grps[r])) \
+					break;				\
+			}						\
+			if (j == BUN_NONE) {				\
+				j = ng++;				\
+				rep[j] = i;				\
+				next[j] = heads[k];			\
+				heads[k] = j;				\
+				first[j] = r;				\
+				size[j] = 0;				\
+				gp->mark[r] = 1;			\
+			}						\
+			size[j]++;					\
+			lgrp[i] = j;					\
+		}							\
+	} while (0)
+
+static gdk_return
+grppar_group(void *arg, size_t k)
+{
+	struct grppar *gp = arg;
+	BUN lo = gp->bounds[k];
+	BUN n = gp->bounds[k + 1] - lo;
+	const BUN *restrict pos = gp->pos + lo;
+	BUN *restrict lgrp = gp->lgrp + lo;
+	BUN *restrict first = gp->first + lo;
+	lng *restrict size = gp->size + lo;
+	BUN *heads, *next, *rep;
+	BUN mask, ng = 0;
+
+	if (n == 0) {
+		gp->nlgrps[k] = 0;
+		return GDK_SUCCEED;
+	}
+	for (mask = 1; mask < n; mask <<= 1)
+		;
+	if ((heads = GDKmalloc((mask + 2 * n) * sizeof(BUN))) == NULL)
+		return GDK_FAIL;
+	next = heads + mask;
+	rep = next + n;
+	mask--;
+	for (BUN i = 0; i <= mask; i++)
+		heads[i] = BUN_NONE;
+	if (gp->width == 4)
+		GRPPAR_GROUP(int);
+	else
+		GRPPAR_GROUP(lng);
+	GDKfree(heads);
+	gp->nlgrps[k] = ng;
+	return GDK_SUCCEED;
+}
+
+/* count the number of groups that start in chunk c */
+static gdk_return
+grppar_count(void *arg, size_t c)
+{
+	struct grppar *gp = arg;
+	const uint8_t *restrict mark = gp->mark;
+	BUN lo = c * gp->chunksize;
+	BUN hi = MIN(lo + gp->chunksize, gp->ci->ncand);
+	BUN cnt = 0, last = BUN_NONE;
+
+	for (BUN r = lo; r < hi; r++) {
+		if (mark[r]) {
+			cnt++;
+			last = r;
+		}
+	}
+	gp->chunkcnt[c] = cnt;
+	gp->chunklast[c] = last;
+	return GDK_SUCCEED;
+}
+
+/* number the groups starting in chunk c */
+static gdk_return
+grppar_number(void *arg, size_t c)
+{
+	struct grppar *gp = arg;
+	const uint8_t *restrict mark = gp->mark;
+	oid *restrict ngrps = gp->ngrps;
+	BUN lo = c * gp->chunksize;
+	BUN hi = MIN(lo + gp->chunksize, gp->ci->ncand);
+	oid id = gp->chunkcnt[c];
+
+	for (BUN r = lo; r < hi; r++) {
+		if (mark[r])
+			ngrps[r] = id++;
+	}
+	return GDK_SUCCEED;
+}
+
+/* fill in the extents and histogram of the groups of partition k, and
+ * replace the local group ids by the global ones */
+static gdk_return
+grppar_assign(void *arg, size_t k)
+{
+	struct grppar *gp = arg;
+	BUN lo = gp->bounds[k];
+	BUN n = gp->bounds[k + 1] - lo;
+	BUN *restrict lgrp = gp->lgrp + lo;
+	BUN *restrict first = gp->first + lo;
+	const lng *restrict size = gp->size + lo;
+	const oid *restrict ngrps = gp->ngrps;
+
+	for (BUN j = 0, ng = gp->nlgrps[k]; j < ng; j++) {
+		oid gid = ngrps[first[j]];
+		if (gp->exts)
+			gp->exts[gid] = canditer_idx(gp->ci, first[j]);
+		if (gp->cnts)
+			gp->cnts[gid] = size[j];
+		first[j] = gid;
+	}
+	for (BUN i = 0; i < n; i++)
+		lgrp[i] = first[lgrp[i]];
+	return GDK_SUCCEED;
+}
+
+/* gather the group ids of chunk c back into input order */
+static gdk_return
+grppar_gather(void *arg, size_t c)
+{
+	struct grppar *gp = arg;
+	BUN *restrict start = gp->start + (c << gp->bits);
+	const BUN *restrict gids = gp->lgrp;
+	oid *restrict ngrps = gp->ngrps;
+
+	if (gp->width == 4)
+		GRPPAR_CHUNKLOOP(int, ngrps[r] = gids[start[GRPPAR_PART(gp, h)]++]);
+	else
+		GRPPAR_CHUNKLOOP(lng, ngrps[r] = gids[start[GRPPAR_PART(gp, h)]++]);
+	return GDK_SUCCEED;
+}
+
+/* group the values (of width 4 or 8) of the candidates in ci, with
+ * pre-existing groups grps (if not NULL) into ngrps, and if not NULL,
+ * fill in en and hn; return the number of groups, or BUN_NONE on
+ * error */
+static BUN
+grppar(struct canditer *ci, const void *vals, oid hseqb, int width,
+       const oid *grps, oid *ngrps, BAT *en, BAT *hn, BUN *maxgrppos)
+{
+	int nthreads = GDKnr_threads;
+	struct grppar gp = {
+		.ci = ci,
+		.vals = vals,
+		.hseqb = hseqb,
+		.grps = grps,
+		.ngrps = ngrps,
+		.width = width,
+	};
+	BUN cnt = ci->ncand;
+	BUN nparts, ngrp = BUN_NONE;
+	BUN off = 0;
+
+	assert(width == 4 || width == 8);
+	/* at least a few partitions per thread, and at most
+	 * GRPPAR_PARTSIZE values per partition if that is possible */
+	while (((BUN) 1 << gp.bits) < (BUN) nthreads * 4 ||
+	       (gp.bits < GRPPAR_MAXBITS && (cnt >> gp.bits) > GRPPAR_PARTSIZE))
+		gp.bits++;
+	nparts = (BUN) 1 << gp.bits;
+	gp.nchunks = (BUN) nthreads * 4;
+	gp.chunksize = (cnt + gp.nchunks - 1) / gp.nchunks;
+
+	if ((gp.hist = GDKzalloc((gp.nchunks << gp.bits) * sizeof(BUN))) == NULL ||
+	    (gp.start = GDKmalloc((gp.nchunks << gp.bits) * sizeof(BUN))) == NULL ||
+	    (gp.bounds = GDKmalloc((nparts + 1) * sizeof(BUN))) == NULL ||
+	    (gp.nlgrps = GDKmalloc(nparts * sizeof(BUN))) == NULL ||
+	    (gp.chunkcnt = GDKmalloc(gp.nchunks * sizeof(BUN))) == NULL ||
+	    (gp.chunklast = GDKmalloc(gp.nchunks * sizeof(BUN))) == NULL ||
+	    (gp.mark = GDKzalloc(cnt)) == NULL ||
+	    (gp.pos = GDKmalloc(cnt * sizeof(BUN))) == NULL ||
+	    (gp.pvals = GDKmalloc(cnt * width)) == NULL ||
+	    (gp.lgrp = GDKmalloc(cnt * sizeof(BUN))) == NULL ||
+	    (gp.first = GDKmalloc(cnt * sizeof(BUN))) == NULL ||
+	    (gp.size = GDKmalloc(cnt * sizeof(lng))) == NULL)
+		goto bailout;
+
+	/* partition */
+	if (GDKparallel(grppar_histogram, &gp, gp.nchunks, nthreads,
+			"grphist") != GDK_SUCCEED)
+		goto bailout;
+	for (BUN p = 0; p < nparts; p++) {
+		gp.bounds[p] = off;
+		for (BUN c = 0; c < gp.nchunks; c++) {
+			BUN n = gp.hist[(c << gp.bits) + p];
+			gp.hist[(c << gp.bits) + p] = off;
+			off += n;
+		}
+	}
+	assert(off == cnt);
+	gp.bounds[nparts] = off;
+	memcpy(gp.start, gp.hist, (gp.nchunks << gp.bits) * sizeof(BUN));
+	if (GDKparallel(grppar_scatter, &gp, gp.nchunks, nthreads,
+			"grpscat") != GDK_SUCCEED)
+		goto bailout;
+
+	/* group the partitions */
+	if (GDKparallel(grppar_group, &gp, nparts, nthreads,
+			"grpgroup") != GDK_SUCCEED)
+		goto bailout;
+
+	/* number the groups in order of first occurrence */
+	if (GDKparallel(grppar_count, &gp, gp.nchunks, nthreads,
+			"grpcount") != GDK_SUCCEED)
+		goto bailout;
+	off = 0;
+	*maxgrppos = BUN_NONE;
+	for (BUN c = 0; c < gp.nchunks; c++) {
+		BUN n = gp.chunkcnt[c];
+		gp.chunkcnt[c] = off;
+		off += n;
+		if (gp.chunklast[c] != BUN_NONE)
+			*maxgrppos = gp.chunklast[c];
+	}
+	if (GDKparallel(grppar_number, &gp, gp.nchunks, nthreads,
+			"grpnumber") != GDK_SUCCEED)
+		goto bailout;
+
+	/* fill in the results */
+	if (en) {
+		if (off > BATcapacity(en) && BATextend(en, off) != GDK_SUCCEED)
+			goto bailout;
+		gp.exts = (oid *) Tloc(en, 0);
+	}
+	if (hn) {
+		if (off > BATcapacity(hn) && BATextend(hn, off) != GDK_SUCCEED)
+			goto bailout;
+		gp.cnts = (lng *) Tloc(hn, 0);
+	}
+	if (GDKparallel(grppar_assign, &gp, nparts, nthreads,
+			"grpassign") != GDK_SUCCEED ||
+	    GDKparallel(grppar_gather, &gp, gp.nchunks, nthreads,
+			"grpgather") != GDK_SUCCEED)
+		goto bailout;
+	ngrp = off;
+
+  bailout:
+	GDKfree(gp.hist);
+	GDKfree(gp.start);
+	GDKfree(gp.bounds);
+	GDKfree(gp.nlgrps);
+	GDKfree(gp.chunkcnt);
+	GDKfree(gp.chunklast);
+	GDKfree(gp.mark);
+	GDKfree(gp.pos);
+	GDKfree(gp.pvals);
+	GDKfree(gp.lgrp);
+	GDKfree(gp.first);
+	GDKfree(gp.size);
+	return ngrp;
+}
+
 gdk_return
 BATgroup_internal(BAT **groups, BAT **extents, BAT **histo,
 		  BAT *b, BAT *s, BAT *g, BAT *e, BAT *h, bool subsorted)
@@ -823,7 +1189,7 @@ BATgroup_internal(BAT **groups, BAT **extents, BAT **histo,
 	/* for strings we can use the offset instead of the actual
 	 * string values if we know that the strings in the string
 	 * heap are unique */
-	if (t == TYPE_str && GDK_ELIMDOUBLES(bi.vh)) {
+	if (t == TYPE_str && GDK_DISTINCTSTR(bi.vh)) {
 		switch (bi.width) {
 		case 1:
 			t = TYPE_bte;
@@ -1011,6 +1377,26 @@ BATgroup_internal(BAT **groups, BAT **extents, BAT **histo,
 				cnts[v]++;
 		}
 		GDKfree(sgrps);
+	} else if (GDKnr_threads > 1 && cnt >= GRPPAR_MINSIZE &&
+		   (t == TYPE_int || t == TYPE_lng) &&
+		   /* finding a position in a masked candidate list
+		    * is linear */
+		   ci.tpe != cand_mask &&
+		   (g != NULL || !BATcheckhash(b))) {
+		/* large input and no hash table to use: partition
+		 * the input and group the partitions in parallel */
+		algomsg = "parallel partitioned hash -- ";
+		ngrp = grppar(&ci, bi.base, hseqb, t == TYPE_int ? 4 : 8,
+			      grps, ngrps, en, hn, &maxgrppos);
+		if (ngrp == BUN_NONE)
+			goto error1;
+		gn->tsorted = true;
+		for (r = 1; r < cnt; r++) {
+			if (ngrps[r] < ngrps[r - 1]) {
+				gn->tsorted = false;
+				break;
+			}
+		}
 	} else if (g == NULL &&
 		   (BATcheckhash(b) ||
 		    (!b->batTransient &&
@@ -181,6 +181,35 @@ HASHgetlink(const Hash *h, BUN i)
 			 ((uhge) (X) >> 116) ^	\
 			 (uhge) (X))
 #endif
+/* The mix_* functions above keep the low order bits of the value as
+ * they are, so they are not suitable if the high order bits of the
+ * hash are to be used (e.g. for partitioning); fmix_int and fmix_lng
+ * (the MurmurHash3 finalizers) spread all bits of the value over all
+ * bits of the (32 bit) result. */
+static inline unsigned int
+fmix_int(int v)
+{
+	unsigned int h = (unsigned int) v;
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline unsigned int
+fmix_lng(lng v)
+{
+	ulng h = (ulng) v;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (unsigned int) h;
+}
+
 #define hash_loc(H,V)	hash_any(H,V)
 #define hash_var(H,V)	hash_any(H,V)
 #define hash_any(H,V)	HASHbucket(H, ATOMhash((H)->type, (V)))
@@ -47,6 +47,10 @@
 #include "gdk_private.h"
 #include "mutils.h"
 
+static void HEAPpages_free(Heap *h);
+static void HEAPpages_compute(Heap *h, size_t size);
+static gdk_return HEAPundo_retire(Heap *h, const char *nme, const char *ext);
+
 static void *
 HEAPcreatefile(int farmid, size_t *maxsz, const char *fn)
 {
@@ -107,12 +111,21 @@ HEAPgrow(MT_Lock *lock, Heap **hp, size_t size, bool mayshare)
 			.remove = old->remove,
 			.parentid = old->parentid,
 			.wasempty = old->wasempty,
+			.distinct = old->distinct,
 		};
 		memcpy(new->filename, old->filename, sizeof(new->filename));
 		if (HEAPalloc(new, size, 1, 1) == GDK_SUCCEED) {
 			ATOMIC_INIT(&new->refs, 1);
 			new->free = old->free;
 			new->cleanhash = old->cleanhash;
+			/* only the owner of the heap enters strings */
+			new->dedup = old->dedup;
+			old->dedup = NULL;
+			/* the page hashes, and with them the undo
+			 * file that protects the next save, go with
+			 * the heap that will be saved */
+			new->pages = old->pages;
+			old->pages = NULL;
 			if (old->free > 0 &&
 			    (new->storage == STORE_MEM || old->storage == STORE_MEM))
 				memcpy(new->base, old->base, old->free);
@@ -271,6 +284,17 @@ HEAPextend(Heap *h, size_t size, bool mayshare)
 
 			assert(h->storage == STORE_MEM);
 			assert(ext != NULL);
+			/* the heap file is going to be written through
+			 * the memory map, so if an undo file protects
+			 * it, back it up the normal way first */
+			if (HEAPundo_retire(h, nme, ext) != GDK_SUCCEED) {
+				failure = "h->storage == STORE_MEM && HEAPundo_retire() != GDK_SUCCEED";
+				goto failed;
+			}
+			/* the page hashes stay with bak, the string
+			 * table goes with h */
+			h->pages = NULL;
+			bak.dedup = NULL;
 			/* if the heap file already exists, we want to switch
 			 * to STORE_PRIV (copy-on-write memory mapped files),
 			 * but if the heap file doesn't exist yet, the BAT is
@@ -339,6 +363,7 @@ HEAPextend(Heap *h, size_t size, bool mayshare)
 			}
 		}
 	  failed:
+		bak.dedup = h->dedup;
 		*h = bak;
 	}
 	GDKerror("failed to extend to %zu for %s%s%s: %s\n",
@@ -678,6 +703,7 @@ HEAPcopy(Heap *dst, Heap *src, size_t offset)
 		memcpy(dst->base, src->base + offset, src->free - offset);
 		dst->hashash = src->hashash;
 		dst->cleanhash = src->cleanhash;
+		dst->distinct = src->distinct && offset == 0;
 		dst->dirty = true;
 		return GDK_SUCCEED;
 	}
@@ -709,6 +735,8 @@ HEAPfree(Heap *h, bool rmheap)
 		}
 	}
 	h->base = NULL;
+	HEAPpages_free(h);
+	strDedupDestroy(h);
 #ifdef HAVE_FORK
 	if (h->storage == STORE_MMAPABS)  {
 		/* heap is stored in a mmap() file, but h->filename
@@ -846,6 +874,490 @@ HEAPload(Heap *h, const char *nme, const char *ext, bool trunc)
 	return HEAPload_intern(h, nme, ext, ".new", trunc);
 }
 
+/*
+ * @- Incremental saving
+ *
+ * A malloced heap is saved by writing all of it to its file.  For a
+ * large heap of which only a few pages were changed, or to which only
+ * a few values were appended, that is very wasteful.  For such heaps
+ * we remember a hash of each HEAP_PAGESIZE page of the heap file as
+ * it was last written.  Heaps are modified through plain pointers all
+ * over the place, so instead of tracking those modifications we
+ * compare the heap with the page hashes when saving it again and only
+ * write the pages that differ.  Heaps are not hashed when they are
+ * loaded, so the first save after loading a heap writes all of it.
+ *
+ * Overwriting the heap file in place is only safe if the original can
+ * be restored after a crash.  Where BBPbackup would otherwise move
+ * the heap file to the backup directory, HEAPbackup_pages creates an
+ * X.undo file there that records the original size of the heap file.
+ * Before HEAPsave overwrites any page of the heap file, it appends the
+ * original contents of that page to the undo file and syncs it.
+ * BBPrecover applies the undo files it finds using HEAPundo.  Since
+ * that changes heap files behind our back, it invalidates all page
+ * hashes.
+ */
+
+#define HEAP_PAGESHIFT	12
+#define HEAP_PAGESIZE	((size_t) 1 << HEAP_PAGESHIFT)
+#define HEAP_PAGES(sz)	(((sz) + HEAP_PAGESIZE - 1) >> HEAP_PAGESHIFT)
+/* maximum number of pages written at a time */
+#define HEAP_WRITEPAGES	((size_t) 256)
+/* smaller heaps are always written completely */
+#define HEAP_PAGES_MIN	((size_t) 1 << 20)
+
+#define UNDO_MAGIC	UINT64_C(0x314f444e554b4447)
+
+struct heappages {
+	size_t size;		/* size of the heap file that was hashed */
+	ATOMIC_BASE_TYPE epoch;	/* value of HEAPpages_epoch when hashed */
+	char *undo;		/* undo file that protects the next save */
+	const char *undodir;	/* backup directory of the undo file */
+	uint64_t hash[];	/* hash of each page of the heap file */
+};
+
+static ATOMIC_TYPE HEAPpages_epoch = ATOMIC_VAR_INIT(0);
+
+#define PAGEHASH_PRIME1	UINT64_C(0x9E3779B185EBCA87)
+#define PAGEHASH_PRIME2	UINT64_C(0xC2B2AE3D27D4EB4F)
+#define PAGEHASH_PRIME3	UINT64_C(0x165667B19E3779F9)
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t
+pagehash_round(uint64_t acc, uint64_t v)
+{
+	return rotl64(acc + v * PAGEHASH_PRIME2, 31) * PAGEHASH_PRIME1;
+}
+
+/* 64 bit hash of the len bytes at p, along the lines of xxHash64 */
+static uint64_t
+pagehash(const char *p, size_t len)
+{
+	uint64_t acc[4] = {
+		PAGEHASH_PRIME1 + PAGEHASH_PRIME2,
+		PAGEHASH_PRIME2,
+		0,
+		-PAGEHASH_PRIME1,
+	};
+	uint64_t v, h;
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32) {
+		for (int j = 0; j < 4; j++) {
+			memcpy(&v, p + i + 8 * j, sizeof(v));
+			acc[j] = pagehash_round(acc[j], v);
+		}
+	}
+	h = rotl64(acc[0], 1) + rotl64(acc[1], 7) +
+		rotl64(acc[2], 12) + rotl64(acc[3], 18);
+	for (int j = 0; j < 4; j++)
+		h = (h ^ pagehash_round(0, acc[j])) * PAGEHASH_PRIME1 + PAGEHASH_PRIME3;
+	h += len;
+	for (; i + 8 <= len; i += 8) {
+		memcpy(&v, p + i, sizeof(v));
+		h = rotl64(h ^ pagehash_round(0, v), 27) * PAGEHASH_PRIME1 + PAGEHASH_PRIME3;
+	}
+	for (; i < len; i++)
+		h = rotl64(h ^ ((uint8_t) p[i] * PAGEHASH_PRIME3), 11) * PAGEHASH_PRIME1;
+	h ^= h >> 33;
+	h *= PAGEHASH_PRIME2;
+	h ^= h >> 29;
+	h *= PAGEHASH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+static void
+HEAPpages_free(Heap *h)
+{
+	if (h->pages) {
+		GDKfree(h->pages->undo);
+		GDKfree(h->pages);
+		h->pages = NULL;
+	}
+}
+
+/* remember the page hashes of the first size bytes of the heap, which
+ * were just written to the heap file */
+static void
+HEAPpages_compute(Heap *h, size_t size)
+{
+	struct heappages *hp;
+	size_t npages = HEAP_PAGES(size);
+
+	HEAPpages_free(h);
+	if (size < HEAP_PAGES_MIN)
+		return;
+	hp = GDKmalloc(offsetof(struct heappages, hash) + npages * sizeof(uint64_t));
+	if (hp == NULL) {
+		/* we can do without */
+		GDKclrerr();
+		return;
+	}
+	hp->size = size;
+	hp->epoch = ATOMIC_GET(&HEAPpages_epoch);
+	hp->undo = NULL;
+	hp->undodir = NULL;
+	for (size_t p = 0; p < npages; p++) {
+		size_t off = p << HEAP_PAGESHIFT;
+		hp->hash[p] = pagehash(h->base + off, MIN(HEAP_PAGESIZE, size - off));
+	}
+	h->pages = hp;
+}
+
+/* forget all page hashes, the heap files may have changed */
+void
+HEAPpages_invalidate(void)
+{
+	(void) ATOMIC_INC(&HEAPpages_epoch);
+}
+
+static bool
+write_all(int fd, const char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = write(fd, buf, (unsigned) MIN(1 << 30, len));
+		if (ret < 0)
+			return false;
+		buf += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+static bool
+read_all(int fd, char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = read(fd, buf, (unsigned) MIN(1 << 30, len));
+		if (ret <= 0)
+			return false;
+		buf += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+static int
+sync_fd(int fd)
+{
+	if (GDKdebug & NOSYNCMASK)
+		return 0;
+#if defined(NATIVE_WIN32)
+	return _commit(fd);
+#elif defined(HAVE_FDATASYNC)
+	return fdatasync(fd);
+#elif defined(HAVE_FSYNC)
+	return fsync(fd);
+#else
+	(void) fd;
+	return 0;
+#endif
+}
+
+/* Called by BBPbackup for a dirty malloced heap whose file nme.ext in
+ * srcdir would otherwise be moved to the backup directory dstdir.  If
+ * we know the page hashes of the heap file, create an undo file for
+ * it in dstdir instead, so that the heap file can be saved
+ * incrementally, and set *done. */
+gdk_return
+HEAPbackup_pages(Heap *h, const char *srcdir, const char *nme, const char *ext, const char *dstdir, bool *done)
+{
+	struct heappages *hp = h->pages;
+	long_str undoext;
+	struct stat st;
+	char *path;
+	int fd, ret;
+
+	*done = false;
+	if (hp == NULL)
+		return GDK_SUCCEED;
+	if (h->storage != STORE_MEM || h->newstorage != STORE_MEM ||
+	    hp->epoch != ATOMIC_GET(&HEAPpages_epoch)) {
+		HEAPpages_free(h);
+		return GDK_SUCCEED;
+	}
+	GDKfree(hp->undo);
+	hp->undo = NULL;
+
+	/* the heap file must still be what we hashed */
+	if ((path = GDKfilepath(h->farmid, srcdir, nme, ext)) == NULL)
+		return GDK_FAIL;
+	ret = MT_stat(path, &st);
+	GDKfree(path);
+	if (ret != 0 || (size_t) st.st_size != hp->size) {
+		HEAPpages_free(h);
+		return GDK_SUCCEED;
+	}
+
+	strconcat_len(undoext, sizeof(undoext), ext, ".undo", NULL);
+	if ((path = GDKfilepath(h->farmid, dstdir, nme, undoext)) == NULL)
+		return GDK_FAIL;
+	fd = MT_open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC);
+	if (fd < 0 ||
+	    !write_all(fd, (const char *) (uint64_t[2]) {UNDO_MAGIC, hp->size}, 2 * sizeof(uint64_t))) {
+		GDKsyserror("cannot create undo file %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+			(void) MT_remove(path);
+		}
+		GDKfree(path);
+		return GDK_FAIL;
+	}
+	close(fd);
+	TRC_DEBUG(HEAP, "created %s\n", path);
+	hp->undo = path;
+	hp->undodir = dstdir;
+	*done = true;
+	return GDK_SUCCEED;
+}
+
+/* The heap file nme.ext of h is about to be overwritten other than by
+ * HEAPsave_pages.  If an undo file protects the heap file, do what
+ * BBPbackup would have done without it: move the heap file to the
+ * directory of the undo file (under its base name, like the undo file
+ * itself), then remove the undo file. */
+static gdk_return
+HEAPundo_retire(Heap *h, const char *nme, const char *ext)
+{
+	struct heappages *hp = h->pages;
+	const char *base;
+
+	if (hp == NULL || hp->undo == NULL)
+		return GDK_SUCCEED;
+	if ((base = strrchr(nme, DIR_SEP)) != NULL)
+		base++;
+	else
+		base = nme;
+	/* after a crash in between, both the backup and the undo file
+	 * restore the original heap file */
+	if (GDKmove(h->farmid, BATDIR, nme, ext, hp->undodir, base, ext, true) != GDK_SUCCEED)
+		return GDK_FAIL;
+	if (MT_remove(hp->undo) != 0) {
+		GDKsyserror("cannot remove %s\n", hp->undo);
+		return GDK_FAIL;
+	}
+	TRC_DEBUG(HEAP, "moved %s.%s to %s instead of %s\n", nme, ext, hp->undodir, hp->undo);
+	/* the heap file is gone, and with it what the hashes describe */
+	HEAPpages_free(h);
+	return GDK_SUCCEED;
+}
+
+/* Save a heap for which HEAPbackup_pages created an undo file: only
+ * write the pages that differ from the heap file, after saving their
+ * original contents in the undo file. */
+static gdk_return
+HEAPsave_pages(Heap *h, const char *nme, const char *ext, bool dosync, size_t free)
+{
+	struct heappages *hp = h->pages, *np;
+	size_t osize = hp->size;
+	size_t onpages = HEAP_PAGES(osize), npages = HEAP_PAGES(free);
+	size_t nundo = 0, nwritten = 0;
+	bool *changed, *written;
+	char *buf, *wbuf;
+	int fd = -1, ufd = -1;
+	bool ok = false;
+
+	np = GDKmalloc(offsetof(struct heappages, hash) + npages * sizeof(uint64_t));
+	changed = GDKzalloc(onpages + 1);
+	written = GDKzalloc(npages + 1);
+	buf = GDKmalloc(2 * sizeof(uint64_t) + HEAP_PAGESIZE);
+	wbuf = GDKmalloc(HEAP_WRITEPAGES << HEAP_PAGESHIFT);
+	if (np == NULL || changed == NULL || written == NULL ||
+	    buf == NULL || wbuf == NULL)
+		goto bailout;
+	if ((fd = GDKfdlocate(h->farmid, nme, "rb+", ext)) < 0)
+		goto bailout;
+	if ((ufd = MT_open(hp->undo, O_WRONLY | O_APPEND | O_CLOEXEC)) < 0) {
+		GDKsyserror("cannot open undo file %s\n", hp->undo);
+		goto bailout;
+	}
+
+	/* save the original contents of the pages that are going to
+	 * be overwritten or truncated */
+	for (size_t p = 0; p < onpages; p++) {
+		size_t off = p << HEAP_PAGESHIFT;
+		size_t len = MIN(HEAP_PAGESIZE, osize - off);
+
+		if (off + len <= free &&
+		    pagehash(h->base + off, len) == hp->hash[p])
+			continue;
+		changed[p] = true;
+		((uint64_t *) buf)[0] = off;
+		((uint64_t *) buf)[1] = len;
+		if (lseek(fd, (off_t) off, SEEK_SET) < 0 ||
+		    !read_all(fd, buf + 2 * sizeof(uint64_t), len) ||
+		    !write_all(ufd, buf, 2 * sizeof(uint64_t) + len)) {
+			GDKsyserror("cannot save page of %s.%s to %s\n",
+				    nme, ext, hp->undo);
+			goto bailout;
+		}
+		nundo++;
+	}
+
+	if (nundo > 0 || free != osize) {
+		/* pages beyond the old end of the heap file are
+		 * harmless, but the undo records must be on disk
+		 * before we overwrite anything */
+		if (nundo > 0 && sync_fd(ufd) < 0) {
+			GDKsyserror("cannot sync %s\n", hp->undo);
+			goto bailout;
+		}
+		/* write the changed pages and the pages beyond the
+		 * old end of the heap file in runs */
+		for (size_t p = 0; p < npages; ) {
+			size_t q;
+
+			for (q = p;
+			     q < npages &&
+				     (q >= onpages || changed[q] ||
+				      MIN((q + 1) << HEAP_PAGESHIFT, free) > osize);
+			     q++)
+				;
+			if (q == p) {
+				p++;
+				continue;
+			}
+			/* the heap may be changed in place while we
+			 * save it, so write a copy of the pages and
+			 * hash what was actually written */
+			if (q - p > HEAP_WRITEPAGES)
+				q = p + HEAP_WRITEPAGES;
+			size_t off = p << HEAP_PAGESHIFT;
+			size_t end = MIN(q << HEAP_PAGESHIFT, free);
+			memcpy(wbuf, h->base + off, end - off);
+			for (size_t r = p; r < q; r++) {
+				size_t roff = (r - p) << HEAP_PAGESHIFT;
+				np->hash[r] = pagehash(wbuf + roff, MIN(HEAP_PAGESIZE, end - off - roff));
+				written[r] = true;
+			}
+			if (lseek(fd, (off_t) off, SEEK_SET) < 0 ||
+			    !write_all(fd, wbuf, end - off)) {
+				GDKsyserror("cannot write %s.%s\n", nme, ext);
+				goto bailout;
+			}
+			nwritten += q - p;
+			p = q;
+		}
+		if (free < osize && ftruncate(fd, (off_t) free) < 0) {
+			GDKsyserror("cannot truncate %s.%s\n", nme, ext);
+			goto bailout;
+		}
+		if (dosync && sync_fd(fd) < 0) {
+			GDKsyserror("cannot sync %s.%s\n", nme, ext);
+			goto bailout;
+		}
+	}
+
+	for (size_t p = 0; p < npages; p++) {
+		/* pages that weren't written are as they were */
+		if (!written[p]) {
+			assert(p < onpages && !changed[p]);
+			np->hash[p] = hp->hash[p];
+		}
+	}
+	np->size = free;
+	np->epoch = hp->epoch;
+	np->undo = NULL;
+	np->undodir = NULL;
+	ok = true;
+	TRC_DEBUG(HEAP, "%s.%s: wrote %zu of %zu pages, saved %zu for undo\n",
+		  nme, ext, nwritten, npages, nundo);
+
+  bailout:
+	if (fd >= 0)
+		close(fd);
+	if (ufd >= 0)
+		close(ufd);
+	GDKfree(buf);
+	GDKfree(wbuf);
+	GDKfree(changed);
+	GDKfree(written);
+	HEAPpages_free(h);
+	if (ok) {
+		h->pages = np;
+		return GDK_SUCCEED;
+	}
+	GDKfree(np);
+	return GDK_FAIL;
+}
+
+/* Apply the undo file name in srcdir to the heap file in dstdir it
+ * protects: restore the original contents and size of the heap file,
+ * then remove the undo file.  An incomplete last record was never
+ * synced, so the page it belongs to wasn't overwritten yet. */
+gdk_return
+HEAPundo(int farmid, const char *srcdir, const char *name, const char *dstdir)
+{
+	long_str heapname;
+	size_t len = strlen(name) - strlen(".undo");
+	char *upath, *path, *buf;
+	uint64_t hdr[2], rec[2];
+	int ufd = -1, fd = -1;
+	gdk_return rc = GDK_FAIL;
+
+	if (len >= sizeof(heapname))
+		return GDK_FAIL;
+	memcpy(heapname, name, len);
+	heapname[len] = 0;
+	upath = GDKfilepath(farmid, srcdir, name, NULL);
+	path = GDKfilepath(farmid, dstdir, heapname, NULL);
+	buf = GDKmalloc(HEAP_PAGESIZE);
+	if (upath == NULL || path == NULL || buf == NULL)
+		goto bailout;
+
+	if ((ufd = MT_open(upath, O_RDONLY | O_CLOEXEC)) < 0) {
+		GDKsyserror("cannot open %s\n", upath);
+		goto bailout;
+	}
+	if (read_all(ufd, (char *) hdr, sizeof(hdr)) && hdr[0] == UNDO_MAGIC) {
+		if ((fd = MT_open(path, O_RDWR | O_CLOEXEC)) < 0 &&
+		    errno != ENOENT) {
+			GDKsyserror("cannot open %s\n", path);
+			goto bailout;
+		}
+		/* without heap file, there is nothing to restore */
+		while (fd >= 0 &&
+		       read_all(ufd, (char *) rec, sizeof(rec)) &&
+		       rec[1] <= HEAP_PAGESIZE &&
+		       read_all(ufd, buf, (size_t) rec[1])) {
+			if (lseek(fd, (off_t) rec[0], SEEK_SET) < 0 ||
+			    !write_all(fd, buf, (size_t) rec[1])) {
+				GDKsyserror("cannot restore %s\n", path);
+				goto bailout;
+			}
+		}
+		if (fd >= 0 &&
+		    (ftruncate(fd, (off_t) hdr[1]) < 0 || sync_fd(fd) < 0)) {
+			GDKsyserror("cannot restore %s\n", path);
+			goto bailout;
+		}
+	}
+	close(ufd);
+	ufd = -1;
+	if (MT_remove(upath) != 0) {
+		GDKsyserror("cannot remove %s\n", upath);
+		goto bailout;
+	}
+	TRC_DEBUG(IO_, "restored %s from %s\n", path, upath);
+	rc = GDK_SUCCEED;
+
+  bailout:
+	if (fd >= 0)
+		close(fd);
+	if (ufd >= 0)
+		close(ufd);
+	GDKfree(buf);
+	GDKfree(upath);
+	GDKfree(path);
+	return rc;
+}
+
 /*
  * @- HEAPsave
  *
@@ -875,6 +1387,7 @@ HEAPsave_intern(Heap *h, const char *nme, const char *ext, const char *suffix, b
 	if (free == 0) {
 		/* nothing to see, please move on */
 		h->wasempty = true;
+		HEAPpages_free(h);
 		TRC_DEBUG(HEAP,
 			  "not saving: "
 			  "(%s.%s,storage=%d,free=%zu,size=%zu,dosync=%s)\n",
@@ -896,7 +1409,19 @@ HEAPsave_intern(Heap *h, const char *nme, const char *ext, const char *suffix, b
 		  nme?nme:"", ext, (int) h->newstorage, free, h->size,
 		  dosync?"true":"false");
 	h->dirty = free != h->free;
-	rc = GDKsave(h->farmid, nme, ext, h->base, free, store, dosync);
+	if (store == STORE_MEM && h->storage == STORE_MEM &&
+	    h->pages && h->pages->undo) {
+		rc = HEAPsave_pages(h, nme, ext, dosync, free);
+	} else {
+		rc = HEAPundo_retire(h, nme, ext);
+		if (rc == GDK_SUCCEED)
+			rc = GDKsave(h->farmid, nme, ext, h->base, free, store, dosync);
+		if (rc == GDK_SUCCEED && store == STORE_MEM &&
+		    h->storage == STORE_MEM)
+			HEAPpages_compute(h, free);
+		else
+			HEAPpages_free(h);
+	}
 	if (rc == GDK_SUCCEED)
 		h->wasempty = false;
 	else
@@ -332,6 +332,7 @@ GDKbatread(char *src, BAT **bat, str *colname)
 		position += align(sizeof(Heap));
 		//[VHEAPDATA]
 		b->tvheap->base = (void *) (src + position);
+		b->tvheap->dedup = NULL;
 		position += align(b->tvheap->size);
 	}
 	*bat = b;
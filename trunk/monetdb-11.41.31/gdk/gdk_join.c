@@ -2956,6 +2956,519 @@ hashjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r,
 	return GDK_FAIL;
 }
 
+/* Radix-partitioned hash join.
+ *
+ * When both inputs are large, the hash table that hashjoin builds on
+ * the inner side does not fit in the CPU caches, so that practically
+ * every probe is a cache (and TLB) miss.  Instead, we partition both
+ * inputs on the high bits of a hash of the values until each
+ * partition of the smaller input fits in the cache, and then join
+ * matching partitions using a small hash table.  Partitioning is done
+ * in one or two passes, each pass creating at most 1<<RADIX_PASSBITS
+ * partitions so as not to thrash the TLB.  Both the partitioning and
+ * the partition joins are divided over multiple threads.
+ *
+ * This is only used for a plain inner equi-join on 4 or 8 byte
+ * integer types.  The result is not ordered on either side. */
+
+#define RADIX_CACHESIZE	((size_t) 256 << 10) /* target partition size */
+#define RADIX_PASSBITS	10	/* max number of bits per pass */
+#define RADIX_MINSIZE	((BUN) 1 << 18)	/* min size of smaller input */
+#define RADIX_CHUNKSIZE	((BUN) 1 << 16)	/* min size of first pass chunk */
+
+struct radixside {
+	BAT *b;
+	struct canditer *ci;
+	const void *vals;	/* tail values of b */
+	void *v[2];		/* partitioned values (two buffers) */
+	oid *o[2];		/* the corresponding head oids */
+	BUN *hist;		/* first pass histograms/offsets per chunk */
+	BUN *bounds;		/* start of each final partition */
+	BUN n;			/* number of values partitioned */
+	BUN chunksize;		/* first pass chunk size */
+	int final;		/* which buffer holds the final partitions */
+};
+
+struct radixres {
+	oid *o1, *o2;		/* matching oids of l and r */
+	BUN cnt, cap;
+};
+
+struct radixjoin {
+	struct radixside side[2]; /* l and r */
+	struct radixres *res;	/* results per partition */
+	BUN *resoff;		/* offset of each partition in the result */
+	oid *r1, *r2;		/* final result arrays */
+	BUN nchunks;		/* number of first pass chunks per input */
+	int width;		/* width of the values (4 or 8) */
+	int bits;		/* total number of radix bits */
+	int bits1, bits2;	/* number of bits in first and second pass */
+	bool nil_matches;
+};
+
+/* the partition of a hash value after the first pass, and after
+ * both passes */
+#define RADIX_PART1(rj, h)	((rj)->bits1 == 0 ? 0 : (h) >> (32 - (rj)->bits1))
+#define RADIX_PART(rj, h)	((rj)->bits == 0 ? 0 : (h) >> (32 - (rj)->bits))
+
+/* the number of radix bits needed for n values of width bytes */
+static int
+radixbits(BUN n, int width)
+{
+	/* per value we need the value, its oid, and a hash bucket and
+	 * link when building */
+	size_t size = (size_t) n * (width + sizeof(oid) + 2 * sizeof(BUN));
+	int bits = 0;
+
+	while (bits < 2 * RADIX_PASSBITS && (size >> bits) > RADIX_CACHESIZE)
+		bits++;
+	return bits;
+}
+
+/* loop over the values of chunk c of side s in the first pass, skipping
+ * nils if they don't match */
+#define RADIX_CHUNKLOOP(TYPE, BODY)					\
+	do {								\
+		struct canditer ci = *sd->ci;				\
+		const TYPE *restrict vals = sd->vals;			\
+		oid hseq = sd->b->hseqbase;				\
+		BUN lo = c * sd->chunksize;				\
+		BUN hi = lo + sd->chunksize;				\
+		if (hi > ci.ncand)					\
+			hi = ci.ncand;					\
+		canditer_setidx(&ci, lo);				\
+		for (BUN i = lo; i < hi; i++) {				\
+			oid o = canditer_next(&ci);			\
+			TYPE v = vals[o - hseq];			\
+			if (!rj->nil_matches && is_##TYPE##_nil(v))	\
+				continue;				\
+			uint32_t h = fmix_##TYPE(v);		\
+			BODY;						\
+		}							\
+	} while (0)
+
+static gdk_return
+radix_histogram(void *arg, size_t t)
+{
+	struct radixjoin *rj = arg;
+	struct radixside *sd = &rj->side[t / rj->nchunks];
+	BUN c = t % rj->nchunks;
+	BUN *restrict hist = sd->hist + (c << rj->bits1);
+
+	if (rj->width == 4)
+		RADIX_CHUNKLOOP(int, hist[RADIX_PART1(rj, h)]++);
+	else
+		RADIX_CHUNKLOOP(lng, hist[RADIX_PART1(rj, h)]++);
+	return GDK_SUCCEED;
+}
+
+static gdk_return
+radix_scatter(void *arg, size_t t)
+{
+	struct radixjoin *rj = arg;
+	struct radixside *sd = &rj->side[t / rj->nchunks];
+	BUN c = t % rj->nchunks;
+	BUN *restrict hist = sd->hist + (c << rj->bits1);
+	oid *restrict dsto = sd->o[0];
+
+	if (rj->width == 4) {
+		int *restrict dstv = sd->v[0];
+		RADIX_CHUNKLOOP(int, {
+				BUN p = hist[RADIX_PART1(rj, h)]++;
+				dstv[p] = v;
+				dsto[p] = o;
+			});
+	} else {
+		lng *restrict dstv = sd->v[0];
+		RADIX_CHUNKLOOP(lng, {
+				BUN p = hist[RADIX_PART1(rj, h)]++;
+				dstv[p] = v;
+				dsto[p] = o;
+			});
+	}
+	return GDK_SUCCEED;
+}
+
+/* second pass: partition a first pass partition further */
+#define RADIX_PASS2(TYPE)						\
+	do {								\
+		const TYPE *restrict srcv = sd->v[0];			\
+		TYPE *restrict dstv = sd->v[1];				\
+		for (BUN i = lo; i < hi; i++)				\
+			cnt[RADIX_PART(rj, fmix_##TYPE(srcv[i])) & mask]++; \
+		for (BUN j = 0, p = lo; j <= mask; j++) {		\
+			BUN n = cnt[j];					\
+			cnt[j] = bounds[j] = p;				\
+			p += n;						\
+		}							\
+		for (BUN i = lo; i < hi; i++) {				\
+			BUN p = cnt[RADIX_PART(rj, fmix_##TYPE(srcv[i])) & mask]++; \
+			dstv[p] = srcv[i];				\
+			dsto[p] = srco[i];				\
+		}							\
+	} while (0)
+
+static gdk_return
+radix_pass2(void *arg, size_t t)
+{
+	struct radixjoin *rj = arg;
+	struct radixside *sd = &rj->side[t >> rj->bits1];
+	BUN p1 = t & (((BUN) 1 << rj->bits1) - 1);
+	BUN mask = ((BUN) 1 << rj->bits2) - 1;
+	BUN *restrict bounds = sd->bounds + (p1 << rj->bits2);
+	BUN lo = bounds[0];
+	BUN hi = sd->bounds[(p1 + 1) << rj->bits2];
+	const oid *restrict srco = sd->o[0];
+	oid *restrict dsto = sd->o[1];
+	BUN cnt[(BUN) 1 << RADIX_PASSBITS] = {0};
+
+	if (rj->width == 4)
+		RADIX_PASS2(int);
+	else
+		RADIX_PASS2(lng);
+	return GDK_SUCCEED;
+}
+
+/* join one pair of partitions: build a hash table on the smaller of
+ * the two and probe it with the other */
+#define RADIX_JOIN(TYPE)						\
+	do {								\
+		const TYPE *restrict bv = (const TYPE *) bs->v[bs->final] + bb[0]; \
+		const TYPE *restrict pv = (const TYPE *) ps->v[ps->final] + pb[0]; \
+		for (BUN i = 0; i < bn; i++) {				\
+			BUN k = fmix_##TYPE(bv[i]) & mask;	\
+			next[i] = heads[k];				\
+			heads[k] = i;					\
+		}							\
+		for (BUN i = 0; i < pn; i++) {				\
+			TYPE v = pv[i];					\
+			for (BUN j = heads[fmix_##TYPE(v) & mask]; \
+			     j != BUN_NONE;				\
+			     j = next[j]) {				\
+				if (bv[j] != v)				\
+					continue;			\
+				if (res->cnt == res->cap &&		\
+				    radix_grow(res, pn) != GDK_SUCCEED)	\
+					goto bailout;			\
+				res->o1[res->cnt] = po[i];		\
+				res->o2[res->cnt] = bo[j];		\
+				res->cnt++;				\
+			}						\
+		}							\
+	} while (0)
+
+static gdk_return
+radix_grow(struct radixres *res, BUN n)
+{
+	BUN cap = res->cap == 0 ? n : res->cap * 2;
+	oid *o1, *o2;
+
+	if ((o1 = GDKrealloc(res->o1, cap * sizeof(oid))) == NULL)
+		return GDK_FAIL;
+	res->o1 = o1;
+	if ((o2 = GDKrealloc(res->o2, cap * sizeof(oid))) == NULL)
+		return GDK_FAIL;
+	res->o2 = o2;
+	res->cap = cap;
+	return GDK_SUCCEED;
+}
+
+static gdk_return
+radix_join(void *arg, size_t p)
+{
+	struct radixjoin *rj = arg;
+	struct radixside *bs = &rj->side[1], *ps = &rj->side[0];
+	const BUN *bb = bs->bounds + p, *pb = ps->bounds + p;
+	BUN bn = bb[1] - bb[0], pn = pb[1] - pb[0];
+	struct radixres *res = &rj->res[p], swapped = {0};
+	BUN *heads, *next;
+	BUN mask;
+
+	if (bn == 0 || pn == 0)
+		return GDK_SUCCEED;
+	if (bn > pn) {
+		/* build on the smaller partition, we then need to
+		 * swap the result oids */
+		bs = &rj->side[0];
+		ps = &rj->side[1];
+		bb = bs->bounds + p;
+		pb = ps->bounds + p;
+		bn = bb[1] - bb[0];
+		pn = pb[1] - pb[0];
+		res = &swapped;
+	}
+	for (mask = 1; mask < bn; mask <<= 1)
+		;
+	mask--;
+	heads = GDKmalloc((mask + 1 + bn) * sizeof(BUN));
+	if (heads == NULL)
+		return GDK_FAIL;
+	next = heads + mask + 1;
+	for (BUN i = 0; i <= mask; i++)
+		heads[i] = BUN_NONE;
+	const oid *restrict bo = bs->o[bs->final] + bb[0];
+	const oid *restrict po = ps->o[ps->final] + pb[0];
+
+	if (rj->width == 4)
+		RADIX_JOIN(int);
+	else
+		RADIX_JOIN(lng);
+	GDKfree(heads);
+	if (res != &rj->res[p]) {
+		/* we built on l, so o1 holds r oids and o2 holds l oids */
+		rj->res[p] = (struct radixres) {
+			.o1 = res->o2,
+			.o2 = res->o1,
+			.cnt = res->cnt,
+			.cap = res->cap,
+		};
+	}
+	return GDK_SUCCEED;
+
+  bailout:
+	GDKfree(heads);
+	if (res != &rj->res[p]) {
+		GDKfree(res->o1);
+		GDKfree(res->o2);
+	}
+	return GDK_FAIL;
+}
+
+static gdk_return
+radix_collect(void *arg, size_t p)
+{
+	struct radixjoin *rj = arg;
+	struct radixres *res = &rj->res[p];
+
+	if (res->cnt > 0) {
+		memcpy(rj->r1 + rj->resoff[p], res->o1, res->cnt * sizeof(oid));
+		if (rj->r2)
+			memcpy(rj->r2 + rj->resoff[p], res->o2, res->cnt * sizeof(oid));
+	}
+	GDKfree(res->o1);
+	GDKfree(res->o2);
+	*res = (struct radixres) {0};
+	return GDK_SUCCEED;
+}
+
+/* estimate the cost of a radix-partitioned join of l and r, or return
+ * -1 if it cannot be used */
+static double
+radixjoincost(BAT *l, BAT *r, struct canditer *lci, struct canditer *rci)
+{
+	BUN n = MIN(lci->ncand, rci->ncand);
+
+	if (GDKnr_threads <= 1 || n < RADIX_MINSIZE ||
+	    BATtvoid(l) || BATtvoid(r) ||
+	    /* finding a position in a masked candidate list is
+	     * linear */
+	    lci->tpe == cand_mask || rci->tpe == cand_mask)
+		return -1;
+	switch (ATOMbasetype(l->ttype)) {
+	case TYPE_int:
+	case TYPE_lng:
+#if SIZEOF_OID == SIZEOF_LNG
+	case TYPE_oid:
+#endif
+		break;
+	default:
+		return -1;
+	}
+	/* the first pass reads the inputs twice and the second pass
+	 * (if any) once, after which the partitions are joined in the
+	 * cache; all of this is divided over the threads */
+	int passes = radixbits(n, ATOMsize(l->ttype)) > RADIX_PASSBITS ? 2 : 1;
+	return (double) (lci->ncand + rci->ncand) * (passes + 2) / GDKnr_threads;
+}
+
+static gdk_return
+radixjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r,
+	  struct canditer *restrict lci, struct canditer *restrict rci,
+	  bool nil_matches, lng t0, const char *reason)
+{
+	struct radixjoin rj = {
+		.width = ATOMsize(l->ttype),
+		.nil_matches = nil_matches,
+	};
+	BATiter li, ri;
+	BAT *r1 = NULL, *r2 = NULL;
+	int nthreads = GDKnr_threads;
+	BUN nparts, n1, total;
+	gdk_return rc = GDK_FAIL;
+
+	MT_thread_setalgorithm(__func__);
+	assert(ATOMtype(l->ttype) == ATOMtype(r->ttype));
+	assert(rj.width == 4 || rj.width == 8);
+
+	li = bat_iterator(l);
+	ri = bat_iterator(r);
+	rj.side[0] = (struct radixside) {
+		.b = l,
+		.ci = lci,
+		.vals = li.base,
+	};
+	rj.side[1] = (struct radixside) {
+		.b = r,
+		.ci = rci,
+		.vals = ri.base,
+	};
+
+	rj.bits = radixbits(MIN(lci->ncand, rci->ncand), rj.width);
+	rj.bits1 = rj.bits > RADIX_PASSBITS ? (rj.bits + 1) / 2 : rj.bits;
+	rj.bits2 = rj.bits - rj.bits1;
+	nparts = (BUN) 1 << rj.bits;
+	n1 = (BUN) 1 << rj.bits1;
+
+	/* first pass: histograms per chunk, then scatter */
+	rj.nchunks = MAX(lci->ncand, rci->ncand) / RADIX_CHUNKSIZE;
+	if (rj.nchunks > (BUN) nthreads * 4)
+		rj.nchunks = (BUN) nthreads * 4;
+	if (rj.nchunks == 0)
+		rj.nchunks = 1;
+	for (int s = 0; s < 2; s++) {
+		struct radixside *sd = &rj.side[s];
+		sd->chunksize = (sd->ci->ncand + rj.nchunks - 1) / rj.nchunks;
+		sd->hist = GDKzalloc((rj.nchunks << rj.bits1) * sizeof(BUN));
+		sd->bounds = GDKmalloc((nparts + 1) * sizeof(BUN));
+		if (sd->hist == NULL || sd->bounds == NULL)
+			goto bailout;
+	}
+	if (GDKparallel(radix_histogram, &rj, 2 * rj.nchunks, nthreads,
+			"radixhist") != GDK_SUCCEED)
+		goto bailout;
+	for (int s = 0; s < 2; s++) {
+		struct radixside *sd = &rj.side[s];
+		BUN off = 0;
+		for (BUN p = 0; p < n1; p++) {
+			sd->bounds[p << rj.bits2] = off;
+			for (BUN c = 0; c < rj.nchunks; c++) {
+				BUN cnt = sd->hist[(c << rj.bits1) + p];
+				sd->hist[(c << rj.bits1) + p] = off;
+				off += cnt;
+			}
+		}
+		sd->bounds[nparts] = sd->n = off;
+		for (int i = 0; i < (rj.bits2 > 0 ? 2 : 1); i++) {
+			sd->v[i] = GDKmalloc(MAX(sd->n, 1) * rj.width);
+			sd->o[i] = GDKmalloc(MAX(sd->n, 1) * sizeof(oid));
+			if (sd->v[i] == NULL || sd->o[i] == NULL)
+				goto bailout;
+		}
+	}
+	if (GDKparallel(radix_scatter, &rj, 2 * rj.nchunks, nthreads,
+			"radixscat") != GDK_SUCCEED)
+		goto bailout;
+	for (int s = 0; s < 2; s++) {
+		GDKfree(rj.side[s].hist);
+		rj.side[s].hist = NULL;
+	}
+
+	/* second pass */
+	if (rj.bits2 > 0) {
+		if (GDKparallel(radix_pass2, &rj, 2 * n1, nthreads,
+				"radixpass") != GDK_SUCCEED)
+			goto bailout;
+		for (int s = 0; s < 2; s++) {
+			struct radixside *sd = &rj.side[s];
+			GDKfree(sd->v[0]);
+			GDKfree(sd->o[0]);
+			sd->v[0] = NULL;
+			sd->o[0] = NULL;
+			sd->final = 1;
+		}
+	}
+
+	/* join the partitions */
+	if ((rj.res = GDKzalloc(nparts * sizeof(struct radixres))) == NULL ||
+	    (rj.resoff = GDKmalloc(nparts * sizeof(BUN))) == NULL)
+		goto bailout;
+	if (GDKparallel(radix_join, &rj, nparts, nthreads,
+			"radixjoin") != GDK_SUCCEED)
+		goto bailout;
+	for (int s = 0; s < 2; s++) {
+		struct radixside *sd = &rj.side[s];
+		GDKfree(sd->v[sd->final]);
+		GDKfree(sd->o[sd->final]);
+		sd->v[sd->final] = NULL;
+		sd->o[sd->final] = NULL;
+	}
+
+	/* collect the results */
+	total = 0;
+	for (BUN p = 0; p < nparts; p++) {
+		rj.resoff[p] = total;
+		total += rj.res[p].cnt;
+	}
+	if ((r1 = COLnew(0, TYPE_oid, total, TRANSIENT)) == NULL)
+		goto bailout;
+	rj.r1 = (oid *) Tloc(r1, 0);
+	if (r2p) {
+		if ((r2 = COLnew(0, TYPE_oid, total, TRANSIENT)) == NULL)
+			goto bailout;
+		rj.r2 = (oid *) Tloc(r2, 0);
+	}
+	if (GDKparallel(radix_collect, &rj, nparts, nthreads,
+			"radixcoll") != GDK_SUCCEED)
+		goto bailout;
+
+	BATsetcount(r1, total);
+	r1->tsorted = r1->trevsorted = total <= 1;
+	r1->tkey = total <= 1 || r->tkey;
+	r1->tseqbase = total == 0 ? 0 : total == 1 ? rj.r1[0] : oid_nil;
+	r1->tnil = false;
+	r1->tnonil = true;
+	if (r2) {
+		BATsetcount(r2, total);
+		r2->tsorted = r2->trevsorted = total <= 1;
+		r2->tkey = total <= 1 || l->tkey;
+		r2->tseqbase = total == 0 ? 0 : total == 1 ? rj.r2[0] : oid_nil;
+		r2->tnil = false;
+		r2->tnonil = true;
+	}
+	*r1p = r1;
+	if (r2p)
+		*r2p = r2;
+	rc = GDK_SUCCEED;
+
+	TRC_DEBUG(ALGO, "l=" ALGOBATFMT "," "r=" ALGOBATFMT
+		  ",sl=" ALGOOPTBATFMT "," "sr=" ALGOOPTBATFMT ","
+		  "nil_matches=%s;%s %d bits, %d pass(es), %d threads"
+		  " -> " ALGOBATFMT "," ALGOOPTBATFMT
+		  " (" LLFMT "usec)\n",
+		  ALGOBATPAR(l), ALGOBATPAR(r),
+		  ALGOOPTBATPAR(lci->s), ALGOOPTBATPAR(rci->s),
+		  nil_matches ? "true" : "false", reason,
+		  rj.bits, rj.bits2 > 0 ? 2 : 1, nthreads,
+		  ALGOBATPAR(r1), ALGOOPTBATPAR(r2),
+		  GDKusec() - t0);
+
+  bailout:
+	bat_iterator_end(&li);
+	bat_iterator_end(&ri);
+	for (int s = 0; s < 2; s++) {
+		struct radixside *sd = &rj.side[s];
+		GDKfree(sd->hist);
+		GDKfree(sd->bounds);
+		for (int i = 0; i < 2; i++) {
+			GDKfree(sd->v[i]);
+			GDKfree(sd->o[i]);
+		}
+	}
+	if (rj.res) {
+		for (BUN p = 0; p < nparts; p++) {
+			GDKfree(rj.res[p].o1);
+			GDKfree(rj.res[p].o2);
+		}
+		GDKfree(rj.res);
+	}
+	GDKfree(rj.resoff);
+	if (rc != GDK_SUCCEED) {
+		BBPreclaim(r1);
+		BBPreclaim(r2);
+	}
+	return rc;
+}
+
 /* Count the number of unique values for the first half and the complete
  * set (the sample s of b) and return the two values in *cnt1 and
  * *cnt2. In case of error, both values are 0. */
@@ -3983,6 +4496,156 @@ BATthetajoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, int op, boo
 			 __func__, t0);
 }
 
+/* Strings in heaps without duplicates (see GDK_DISTINCTSTR) are equal
+ * if and only if their offsets are equal, so an equi-join on two such
+ * string columns can be done on integer codes instead.  The code of a
+ * string is its offset in the heap of l.  If r has a heap of its own,
+ * its offsets are translated to the offsets of the same strings in the
+ * heap of l (0 if l doesn't have the string) by walking both heaps
+ * once.  That only pays off if the heaps are small compared to the
+ * number of rows being joined, and if there is no hash on either
+ * column that the join could use instead. */
+
+#define STRCODE_NIL	((var_t) 1) /* no string starts at offset 1 */
+
+/* create a table that maps each offset in the heap of r to the offset
+ * of the same string in the heap of l */
+static var_t *
+strtrans(const BATiter *li, const BATiter *ri)
+{
+	const char *lbase = li->vh->base, *rbase = ri->vh->base;
+	size_t nstr = 0, mask;
+	var_t *slot, *trans;
+	var_t p;
+
+	for (p = strNext(li->vh, li->vhfree, 0); p; p = strNext(li->vh, li->vhfree, p))
+		nstr++;
+	for (mask = 1; mask < 2 * nstr; mask <<= 1)
+		;
+	mask--;
+	slot = GDKzalloc((mask + 1) * sizeof(var_t));
+	trans = GDKmalloc((ri->vhfree - GDK_VAROFFSET) * sizeof(var_t));
+	if (slot == NULL || trans == NULL) {
+		GDKfree(slot);
+		GDKfree(trans);
+		return NULL;
+	}
+	for (p = strNext(li->vh, li->vhfree, 0); p; p = strNext(li->vh, li->vhfree, p)) {
+		size_t i;
+		for (i = strHash(lbase + p) & mask; slot[i] != 0; i = (i + 1) & mask)
+			;
+		slot[i] = p;
+	}
+	for (p = strNext(ri->vh, ri->vhfree, 0); p; p = strNext(ri->vh, ri->vhfree, p)) {
+		const char *s = rbase + p;
+		size_t i;
+		if (strNil(s)) {
+			trans[p - GDK_VAROFFSET] = STRCODE_NIL;
+			continue;
+		}
+		for (i = strHash(s) & mask;
+		     slot[i] != 0 && strcmp(lbase + slot[i], s) != 0;
+		     i = (i + 1) & mask)
+			;
+		trans[p - GDK_VAROFFSET] = slot[i];
+	}
+	GDKfree(slot);
+	return trans;
+}
+
+/* create a bat with the codes of the values of b in the range of the
+ * candidates; trans is NULL if the codes are the offsets themselves */
+static BAT *
+strcodebat(BAT *b, BATiter *bi, struct canditer *ci, const var_t *trans, int tpe)
+{
+	oid lo = canditer_idx(ci, 0);
+	BUN n = canditer_last(ci) + 1 - lo;
+	BUN off = lo - b->hseqbase;
+	const char *base = bi->vh->base;
+	bool nonil = b->tnonil;
+	BAT *bn;
+
+	bn = COLnew(lo, tpe, n, TRANSIENT);
+	if (bn == NULL)
+		return NULL;
+#define STRCODES(TYPE)							\
+	do {								\
+		TYPE *restrict codes = Tloc(bn, 0);			\
+		for (BUN i = 0; i < n; i++) {				\
+			var_t v = VarHeapVal(bi->base, off + i, bi->width); \
+			if (trans)					\
+				v = trans[v - GDK_VAROFFSET];		\
+			else if (!nonil && strNil(base + v))		\
+				v = STRCODE_NIL;			\
+			codes[i] = v == STRCODE_NIL ? TYPE##_nil : (TYPE) v; \
+		}							\
+	} while (0)
+	if (tpe == TYPE_int)
+		STRCODES(int);
+	else
+		STRCODES(lng);
+	BATsetcount(bn, n);
+	/* strings missing from the other heap all get code 0 */
+	bn->tkey = b->tkey && trans == NULL;
+	bn->tnonil = nonil;
+	bn->tnil = false;
+	if (n > 1) {
+		bn->tsorted = bn->trevsorted = false;
+		bn->tnosorted = bn->tnorevsorted = 0;
+	}
+	return bn;
+}
+
+/* if l and r are string columns for which the join can be done on
+ * codes, create the bats with the codes */
+static bool
+strcodes(BAT *l, BAT *r, struct canditer *lci, struct canditer *rci,
+	 BAT **lcodes, BAT **rcodes)
+{
+	BATiter li, ri;
+	var_t *trans = NULL;
+	int tpe;
+
+	if (ATOMtype(l->ttype) != TYPE_str ||
+	    /* the codes bats span the range of the candidates */
+	    canditer_last(lci) + 1 - canditer_idx(lci, 0) > 2 * lci->ncand ||
+	    canditer_last(rci) + 1 - canditer_idx(rci, 0) > 2 * rci->ncand)
+		return false;
+	li = bat_iterator(l);
+	ri = bat_iterator(r);
+	if (!GDK_DISTINCTSTR(li.vh) || !GDK_DISTINCTSTR(ri.vh) ||
+	    (li.vh != ri.vh &&
+	     (li.vhfree + ri.vhfree > lci->ncand + rci->ncand ||
+	      /* the translation table has an entry per byte of
+	       * the heap of r, don't make it larger than a hash
+	       * table on r would be */
+	      ri.vhfree - GDK_VAROFFSET > rci->ncand))) {
+		bat_iterator_end(&li);
+		bat_iterator_end(&ri);
+		return false;
+	}
+	tpe = li.vhfree <= (size_t) GDK_int_max ? TYPE_int : TYPE_lng;
+	*lcodes = *rcodes = NULL;
+	if ((li.vh == ri.vh || (trans = strtrans(&li, &ri)) != NULL) &&
+	    (*lcodes = strcodebat(l, &li, lci, NULL, tpe)) != NULL)
+		*rcodes = strcodebat(r, &ri, rci, trans, tpe);
+	bat_iterator_end(&li);
+	bat_iterator_end(&ri);
+	GDKfree(trans);
+	if (*rcodes == NULL) {
+		/* fall back to joining the strings */
+		BBPreclaim(*lcodes);
+		GDKclrerr();
+		return false;
+	}
+	TRC_DEBUG(ALGO, "l=" ALGOBATFMT ",r=" ALGOBATFMT
+		  ": join on codes " ALGOBATFMT "," ALGOBATFMT "%s\n",
+		  ALGOBATPAR(l), ALGOBATPAR(r),
+		  ALGOBATPAR((*lcodes)), ALGOBATPAR((*rcodes)),
+		  trans ? " (translated)" : "");
+	return true;
+}
+
 gdk_return
 BATjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, bool nil_matches, BUN estimate)
 {
@@ -3993,9 +4656,11 @@ BATjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, bool nil_matches
 	bat parent;
 	double rcost = 0;
 	double lcost = 0;
+	double radixcost;
 	gdk_return rc;
 	lng t0 = 0;
 	BAT *r2 = NULL;
+	BAT *lcodes, *rcodes;
 
 	TRC_DEBUG_IF(ALGO) t0 = GDKusec();
 
@@ -4091,10 +4756,25 @@ BATjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, bool nil_matches
 	lcost = joincost(l, &rci, &lci, &lhash, &plhash, &lcand);
 	rcost = joincost(r, &lci, &rci, &rhash, &prhash, &rcand);
 
+	if (!lhash && !rhash &&
+	    strcodes(l, r, &lci, &rci, &lcodes, &rcodes)) {
+		/* there is no string hash to use, so join the strings
+		 * on their offsets */
+		rc = BATjoin(r1p, r2p, lcodes, rcodes, sl, sr,
+			     nil_matches, estimate);
+		BBPreclaim(lcodes);
+		BBPreclaim(rcodes);
+		goto doreturn;
+	}
+
 	/* if the cost of doing searches on l is lower than the cost
 	 * of doing searches on r, we swap */
 	swap = (lcost < rcost);
 
+	/* if both inputs are large, partitioning them first may
+	 * beat either hash join */
+	radixcost = radixjoincost(l, r, &lci, &rci);
+
 	if ((r->ttype == TYPE_void && r->tvheap != NULL) ||
 	    ((BATordered(r) || BATordered_rev(r)) &&
 	     (lci.ncand * (log2((double) rci.ncand) + 1) < (swap ? lcost : rcost)))) {
@@ -4113,6 +4793,9 @@ BATjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, bool nil_matches
 			       estimate, t0, true, __func__);
 		if (rc == GDK_SUCCEED && r2p == NULL)
 			BBPunfix(r2->batCacheid);
+	} else if (radixcost >= 0 && radixcost < (swap ? lcost : rcost)) {
+		rc = radixjoin(r1p, r2p, l, r, &lci, &rci, nil_matches,
+			       t0, __func__);
 	} else if (swap) {
 		rc = hashjoin(r2p ? r2p : &r2, r1p, r, l, &rci, &lci,
 			      nil_matches, false, false, false, false, false, false,
@@ -15,7 +15,7 @@
 #include <string.h>
 
 static gdk_return logger_add_bat(logger *lg, BAT *b, log_id id, int tid);
-static gdk_return logger_del_bat(logger *lg, log_bid bid);
+static gdk_return logger_del_bat(logger *lg, log_bid bid, int tid);
 /*
  * The logger uses a directory to store its log files. One master log
  * file stores information about the version of the logger and the
@@ -637,79 +637,65 @@ la_bat_update_count(logger *lg, log_id id, lng cnt, int tid)
 	return GDK_SUCCEED;
 }
 
+/* apply the changes of la to the bat with id bid; this only touches
+ * that bat, so updates to different bats can be applied concurrently */
 static gdk_return
-la_bat_updates(logger *lg, logaction *la, int tid)
+la_bat_apply(logger *lg, logaction *la, log_bid bid)
 {
-	log_bid bid = internal_find_bat(lg, la->cid, tid);
-	BAT *b = NULL;
+	BAT *b;
 
-	if (!bid) {
-		GDKerror("la_bat_updates failed to find bid for object %d\n", la->cid);
+	if (lg->flushing)
+		return GDK_SUCCEED;
+	b = BATdescriptor(bid);
+	if (b == NULL)
 		return GDK_FAIL;
-	}
-
-	if (!lg->flushing) {
-		b = BATdescriptor(bid);
-		if (b == NULL)
-			return GDK_FAIL;
-	}
 	if (la->type == LOG_UPDATE_BULK) {
-		BUN cnt = 0;
-
-		if (!lg->flushing) {
-			cnt = BATcount(b);
-			int is_msk = (b->ttype == TYPE_msk);
-			/* handle offset 0 ie clear */
-			if (/* DISABLES CODE */ (0) && la->offset == 0 && cnt)
-				BATclear(b, true);
-			/* handle offset */
-			if (cnt <= (BUN)la->offset) {
-				msk t = 1;
-				if (cnt < (BUN)la->offset) { /* insert nils */
-					const void *tv = (is_msk)?&t:ATOMnilptr(b->ttype);
-					lng i, d = la->offset - BATcount(b);
-					for(i=0;i<d;i++) {
-						if (BUNappend(b, tv, true) != GDK_SUCCEED) {
-							logbat_destroy(b);
-							return GDK_FAIL;
-						}
+		BUN cnt = BATcount(b);
+		int is_msk = (b->ttype == TYPE_msk);
+		/* handle offset 0 ie clear */
+		if (/* DISABLES CODE */ (0) && la->offset == 0 && cnt)
+			BATclear(b, true);
+		/* handle offset */
+		if (cnt <= (BUN)la->offset) {
+			msk t = 1;
+			if (cnt < (BUN)la->offset) { /* insert nils */
+				const void *tv = (is_msk)?&t:ATOMnilptr(b->ttype);
+				lng i, d = la->offset - BATcount(b);
+				for(i=0;i<d;i++) {
+					if (BUNappend(b, tv, true) != GDK_SUCCEED) {
+						logbat_destroy(b);
+						return GDK_FAIL;
 					}
 				}
-				if (BATcount(b) == (BUN)la->offset && BATappend(b, la->b, NULL, true) != GDK_SUCCEED) {
-					logbat_destroy(b);
-					return GDK_FAIL;
-				}
-			} else {
-				BATiter vi = bat_iterator(la->b);
-				BUN p, q;
+			}
+			if (BATcount(b) == (BUN)la->offset && BATappend(b, la->b, NULL, true) != GDK_SUCCEED) {
+				logbat_destroy(b);
+				return GDK_FAIL;
+			}
+		} else {
+			BATiter vi = bat_iterator(la->b);
+			BUN p, q;
 
-				for (p=0, q = (BUN)la->offset; p<(BUN)la->nr; p++, q++) {
-					const void *t = BUNtail(vi, p);
+			for (p=0, q = (BUN)la->offset; p<(BUN)la->nr; p++, q++) {
+				const void *t = BUNtail(vi, p);
 
-					if (q < cnt) {
-						if (BUNreplace(b, q, t, true) != GDK_SUCCEED) {
-							logbat_destroy(b);
-							bat_iterator_end(&vi);
-							return GDK_FAIL;
-						}
-					} else {
-						if (BUNappend(b, t, true) != GDK_SUCCEED) {
-							logbat_destroy(b);
-							bat_iterator_end(&vi);
-							return GDK_FAIL;
-						}
+				if (q < cnt) {
+					if (BUNreplace(b, q, t, true) != GDK_SUCCEED) {
+						logbat_destroy(b);
+						bat_iterator_end(&vi);
+						return GDK_FAIL;
+					}
+				} else {
+					if (BUNappend(b, t, true) != GDK_SUCCEED) {
+						logbat_destroy(b);
+						bat_iterator_end(&vi);
+						return GDK_FAIL;
 					}
 				}
-				bat_iterator_end(&vi);
 			}
+			bat_iterator_end(&vi);
 		}
-		cnt = (BUN)(la->offset + la->nr);
-		if (la_bat_update_count(lg, la->cid, cnt, tid) != GDK_SUCCEED) {
-			if (b)
-				logbat_destroy(b);
-			return GDK_FAIL;
-		}
-	} else if (!lg->flushing && la->type == LOG_UPDATE) {
+	} else if (la->type == LOG_UPDATE) {
 		BATiter vi = bat_iterator(la->b);
 		BUN p, q;
 
@@ -725,8 +711,23 @@ la_bat_updates(logger *lg, logaction *la, int tid)
 		}
 		bat_iterator_end(&vi);
 	}
-	if (b)
-		logbat_destroy(b);
+	logbat_destroy(b);
+	return GDK_SUCCEED;
+}
+
+static gdk_return
+la_bat_updates(logger *lg, logaction *la, int tid)
+{
+	log_bid bid = internal_find_bat(lg, la->cid, tid);
+
+	if (!bid) {
+		GDKerror("la_bat_updates failed to find bid for object %d\n", la->cid);
+		return GDK_FAIL;
+	}
+	if (la_bat_apply(lg, la, bid) != GDK_SUCCEED)
+		return GDK_FAIL;
+	if (la->type == LOG_UPDATE_BULK)
+		return la_bat_update_count(lg, la->cid, la->offset + la->nr, tid);
 	return GDK_SUCCEED;
 }
 
@@ -753,7 +754,7 @@ la_bat_destroy(logger *lg, logaction *la, int tid)
 		GDKclrerr();
 		return GDK_SUCCEED;
 	}
-	if (logger_del_bat(lg, bid) != GDK_SUCCEED)
+	if (logger_del_bat(lg, bid, tid) != GDK_SUCCEED)
 		return GDK_FAIL;
 	return GDK_SUCCEED;
 }
@@ -941,27 +942,231 @@ tr_abort(logger *lg, trans *tr)
 	return tr_abort_(lg, tr, 0);
 }
 
+/* A run of consecutive updates within a transaction can be applied
+ * to the different bats in parallel, as long as the updates to each
+ * bat are applied in log order.  Creates, destroys and clears change
+ * the catalog and end a run. */
+#define REPLAY_PAR_MIN	((lng) 1 << 16)	/* min rows for parallel apply */
+
+struct replay_run {
+	logger *lg;
+	logaction *changes;
+	int *order;		/* positions in changes, grouped by cid */
+	int *grps;		/* start of each group in order */
+	log_bid *bids;		/* bat of each group */
+};
+
+static gdk_return
+replay_apply_group(void *arg, size_t g)
+{
+	struct replay_run *run = arg;
+
+	for (int i = run->grps[g]; i < run->grps[g + 1]; i++) {
+		if (la_bat_apply(run->lg, &run->changes[run->order[i]], run->bids[g]) != GDK_SUCCEED)
+			return GDK_FAIL;
+	}
+	return GDK_SUCCEED;
+}
+
+/* apply the updates changes[s..e) of transaction tid, the updates of
+ * each bat by a single thread */
+static gdk_return
+la_apply_parallel(logger *lg, logaction *changes, int s, int e, int tid)
+{
+	int n = e - s, ngrp = 0;
+	lng *keys = GDKmalloc(n * sizeof(lng));
+	int *order = GDKmalloc(n * sizeof(int));
+	int *grps = GDKmalloc((n + 1) * sizeof(int));
+	log_bid *bids = GDKmalloc(n * sizeof(log_bid));
+	struct replay_run run = {
+		.lg = lg,
+		.changes = changes,
+		.order = order,
+		.grps = grps,
+		.bids = bids,
+	};
+	gdk_return rc = GDK_FAIL;
+
+	if (keys == NULL || order == NULL || grps == NULL || bids == NULL)
+		goto bailout;
+	/* sort on (cid, position), which keeps the log order per cid */
+	for (int i = 0; i < n; i++)
+		keys[i] = (lng) changes[s + i].cid * ((lng) 1 << 32) + s + i;
+	GDKqsort(keys, NULL, NULL, n, sizeof(lng), 0, TYPE_lng, false, false);
+	for (int i = 0; i < n; i++)
+		order[i] = (int) (keys[i] & 0xFFFFFFFF);
+	/* look up the bats up front: the catalog is not changed in
+	 * the run, so the workers only touch their own bats */
+	for (int i = 0; i < n; i++) {
+		if (i > 0 && changes[order[i]].cid == changes[order[i - 1]].cid)
+			continue;
+		grps[ngrp] = i;
+		bids[ngrp] = internal_find_bat(lg, changes[order[i]].cid, tid);
+		if (!bids[ngrp]) {
+			GDKerror("la_bat_updates failed to find bid for object %d\n", changes[order[i]].cid);
+			goto bailout;
+		}
+		ngrp++;
+	}
+	grps[ngrp] = n;
+	if (GDKparallel(replay_apply_group, &run, ngrp, GDKnr_threads, "replay") != GDK_SUCCEED)
+		goto bailout;
+	/* the counts are shared, update them here in log order */
+	for (int i = s; i < e; i++) {
+		if (changes[i].type == LOG_UPDATE_BULK &&
+		    la_bat_update_count(lg, changes[i].cid, changes[i].offset + changes[i].nr, tid) != GDK_SUCCEED)
+			goto bailout;
+	}
+	rc = GDK_SUCCEED;
+  bailout:
+	GDKfree(keys);
+	GDKfree(order);
+	GDKfree(grps);
+	GDKfree(bids);
+	return rc;
+}
+
 static trans *
 tr_commit(logger *lg, trans *tr)
 {
-	int i;
+	int i, j;
 
 	if (lg->debug & 1)
 		fprintf(stderr, "#tr_commit\n");
 
-	for (i = 0; i < tr->nr; i++) {
-		if (la_apply(lg, &tr->changes[i], tr->tid) != GDK_SUCCEED) {
-			do {
-				tr = tr_abort_(lg, tr, i);
-			} while (tr != NULL);
-			return (trans *) -1;
+	for (i = 0; i < tr->nr; i = j) {
+		lng nr = 0;
+		int ncid = 1;
+
+		/* find the run of updates starting at i */
+		for (j = i; j < tr->nr &&
+			     (tr->changes[j].type == LOG_UPDATE ||
+			      tr->changes[j].type == LOG_UPDATE_BULK); j++) {
+			nr += tr->changes[j].nr;
+			ncid += tr->changes[j].cid != tr->changes[i].cid;
+		}
+		if (!lg->flushing && GDKnr_threads > 1 &&
+		    ncid > 1 && nr >= REPLAY_PAR_MIN) {
+			if (la_apply_parallel(lg, tr->changes, i, j, tr->tid) != GDK_SUCCEED) {
+				do {
+					tr = tr_abort_(lg, tr, i);
+				} while (tr != NULL);
+				return (trans *) -1;
+			}
+			for (; i < j; i++)
+				la_destroy(&tr->changes[i]);
+			continue;
+		}
+		if (j == i)
+			j++;
+		for (; i < j; i++) {
+			if (la_apply(lg, &tr->changes[i], tr->tid) != GDK_SUCCEED) {
+				do {
+					tr = tr_abort_(lg, tr, i);
+				} while (tr != NULL);
+				return (trans *) -1;
+			}
+			la_destroy(&tr->changes[i]);
 		}
-		la_destroy(&tr->changes[i]);
 	}
 	lg->saved_tid = tr->tid;
 	return tr_destroy(tr);
 }
 
+/* During startup the log is replayed in a pipeline: the reading
+ * thread decodes the transactions and hands the committed ones to an
+ * apply thread, which applies them in log order while the next ones
+ * are being decoded. */
+#define REPLAY_QUEUE	4
+
+typedef struct replay {
+	logger *lg;
+	MT_Sema free;		/* free slots in queue */
+	MT_Sema filled;		/* transactions waiting in queue */
+	trans *queue[REPLAY_QUEUE];
+	int head, tail;
+	ATOMIC_TYPE failed;
+	MT_Id tid;
+	char errbuf[GDKMAXERRLEN];
+} replay;
+
+static void
+replay_worker(void *arg)
+{
+	replay *rp = arg;
+
+	rp->errbuf[0] = 0;
+	GDKsetbuf(rp->errbuf);
+	for (;;) {
+		MT_sema_down(&rp->filled);
+		trans *tr = rp->queue[rp->head];
+		rp->head = (rp->head + 1) % REPLAY_QUEUE;
+		MT_sema_up(&rp->free);
+		if (tr == NULL)
+			break;
+		if (ATOMIC_GET(&rp->failed))
+			tr_abort(rp->lg, tr);
+		else if (tr_commit(rp->lg, tr) == (trans *) -1)
+			ATOMIC_SET(&rp->failed, 1);
+	}
+	GDKsetbuf(NULL);
+}
+
+static void
+replay_enqueue(replay *rp, trans *tr)
+{
+	if (tr) {
+		/* the temporary bats are handed to the apply thread */
+		for (int i = 0; i < tr->nr; i++) {
+			logaction *la = &tr->changes[i];
+			if ((la->type == LOG_UPDATE || la->type == LOG_UPDATE_BULK) && la->b) {
+				BBP_pid(la->b->batCacheid) = 0;
+				if (la->type == LOG_UPDATE && la->uid)
+					BBP_pid(la->uid->batCacheid) = 0;
+			}
+		}
+	}
+	MT_sema_down(&rp->free);
+	rp->queue[rp->tail] = tr;
+	rp->tail = (rp->tail + 1) % REPLAY_QUEUE;
+	MT_sema_up(&rp->filled);
+}
+
+static gdk_return
+replay_start(logger *lg, replay *rp)
+{
+	*rp = (replay) {
+		.lg = lg,
+	};
+	MT_sema_init(&rp->free, REPLAY_QUEUE, "replay_free");
+	MT_sema_init(&rp->filled, 0, "replay_filled");
+	ATOMIC_INIT(&rp->failed, 0);
+	if ((rp->tid = THRcreate(replay_worker, rp, MT_THR_JOINABLE, "replay")) == 0) {
+		GDKclrerr();
+		MT_sema_destroy(&rp->free);
+		MT_sema_destroy(&rp->filled);
+		ATOMIC_DESTROY(&rp->failed);
+		return GDK_FAIL;
+	}
+	return GDK_SUCCEED;
+}
+
+/* wait for the apply thread to finish the queued transactions */
+static void
+replay_finish(replay *rp)
+{
+	replay_enqueue(rp, NULL);
+	MT_join_thread(rp->tid);
+	if (ATOMIC_GET(&rp->failed) && rp->errbuf[0] && GDKerrbuf) {
+		char *buf = GDKerrbuf;
+		size_t len = strlen(buf);
+		strcpy_len(buf + len, rp->errbuf, GDKMAXERRLEN - len);
+	}
+	MT_sema_destroy(&rp->free);
+	MT_sema_destroy(&rp->filled);
+	ATOMIC_DESTROY(&rp->failed);
+}
+
 static gdk_return
 logger_read_types_file(logger *lg, FILE *fp)
 {
@@ -1058,20 +1263,25 @@ logger_open_output(logger *lg)
 			return GDK_FAIL;
 		}
 
-		lg->output_log = open_wstream(filename);
-		if (lg->output_log) {
+		stream *output_log = open_wstream(filename);
+		if (output_log) {
 			short byteorder = 1234;
-			mnstr_write(lg->output_log, &byteorder, sizeof(byteorder), 1);
+			mnstr_write(output_log, &byteorder, sizeof(byteorder), 1);
 		}
 		lg->end = 0;
 
-		if (lg->output_log == NULL || mnstr_errnr(lg->output_log)) {
+		if (output_log == NULL || mnstr_errnr(output_log)) {
 			TRC_CRITICAL(GDK, "creating %s failed: %s\n", filename, mnstr_peek_error(NULL));
+			close_stream(output_log);
 			GDKfree(new_range);
 			GDKfree(filename);
 			return GDK_FAIL;
 		}
 		GDKfree(filename);
+		/* a group commit leader may be syncing concurrently */
+		MT_lock_set(&lg->sync_lock);
+		lg->output_log = output_log;
+		MT_lock_unset(&lg->sync_lock);
 	}
 	new_range->id = lg->id;
 	new_range->first_tid = lg->tid;
@@ -1094,12 +1304,36 @@ logger_close_input(logger *lg)
 	lg->input_log = NULL;
 }
 
+/* sync the output log on behalf of all transactions that wrote their
+ * log records before lsn_written was read as lsn; called with
+ * sync_lock held */
+static gdk_return
+logger_sync(logger *lg, ATOMIC_BASE_TYPE lsn)
+{
+	if (lg->output_log && !(GDKdebug & NOSYNCMASK) &&
+	    mnstr_fsync(lg->output_log)) {
+		TRC_CRITICAL(GDK, "sync failed\n");
+		return GDK_FAIL;
+	}
+	ATOMIC_SET(&lg->lsn_synced, lsn);
+	return GDK_SUCCEED;
+}
+
 static inline void
 logger_close_output(logger *lg)
 {
-	if (!LOG_DISABLED(lg))
+	MT_lock_set(&lg->sync_lock);
+	if (!LOG_DISABLED(lg)) {
+		/* committers still waiting for their sync may have
+		 * their records in this file (see log_tsync) */
+		ATOMIC_BASE_TYPE lsn = ATOMIC_GET(&lg->lsn_written);
+		if (ATOMIC_GET(&lg->lsn_synced) < lsn &&
+		    logger_sync(lg, lsn) != GDK_SUCCEED)
+			GDKfatal("Could not sync the log file\n");
 		close_stream(lg->output_log);
+	}
 	lg->output_log = NULL;
+	MT_lock_unset(&lg->sync_lock);
 }
 
 static gdk_return
@@ -1135,7 +1369,7 @@ logger_open_input(logger *lg, char *filename, bool *filemissing)
 }
 
 static log_return
-logger_read_transaction(logger *lg)
+logger_read_transaction(logger *lg, replay *rp)
 {
 	logformat l;
 	trans *tr = NULL;
@@ -1185,8 +1419,19 @@ logger_read_transaction(logger *lg)
 				err = LOG_EOF;
 			else if (tr->tid != l.id)	/* abort record */
 				tr = tr_abort(lg, tr);
-			else
+			else if (rp == NULL)
 				tr = tr_commit(lg, tr);
+			else if (ATOMIC_GET(&rp->failed)) {
+				/* applying an earlier transaction failed */
+				while (tr)
+					tr = tr_abort(lg, tr);
+				tr = (trans *) -1;
+			} else {
+				trans *p = tr->tr;
+				tr->tr = NULL;
+				replay_enqueue(rp, tr);
+				tr = p;
+			}
 			break;
 		case LOG_SEQ:
 			err = log_read_seq(lg, &l);
@@ -1266,6 +1511,14 @@ logger_readlog(logger *lg, char *filename, bool *filemissing)
 		printf("# Start reading the write-ahead log '%s'\n", filename);
 		fflush(stdout);
 	}
+	replay rps, *rp = NULL;
+	int dbg = GDKdebug;
+	if (GDKnr_threads > 1 && replay_start(lg, &rps) == GDK_SUCCEED) {
+		rp = &rps;
+		/* as in logger_read_transaction, but until the apply
+		 * thread is done */
+		GDKdebug &= ~(CHECKMASK|PROPMASK);
+	}
 	while (err != LOG_EOF && err != LOG_ERR) {
 		t1 = time(NULL);
 		if (t1 - t0 > 10) {
@@ -1278,7 +1531,11 @@ logger_readlog(logger *lg, char *filename, bool *filemissing)
 				fflush(stdout);
 			}
 		}
-		err = logger_read_transaction(lg);
+		err = logger_read_transaction(lg, rp);
+	}
+	if (rp) {
+		replay_finish(rp);
+		GDKdebug = dbg;
 	}
 	logger_close_input(lg);
 	lg->input_log = NULL;
@@ -2119,8 +2376,12 @@ logger_new(int debug, const char *fn, const char *logdir, int version, preversio
 		.end = 0,
 		.saved_id = getBBPlogno(), 		/* get saved log numer from bbp */
 		.saved_tid = (int)getBBPtransid(), 	/* get saved transaction id from bbp */
+		.commit_delay = GDKgetenv_int("gdk_group_commit_delay", 0),
 	};
 	MT_lock_init(&lg->lock, fn);
+	MT_lock_init(&lg->sync_lock, "logger_sync");
+	ATOMIC_INIT(&lg->lsn_written, 0);
+	ATOMIC_INIT(&lg->lsn_synced, 0);
 
 	/* probably open file and check version first, then call call old logger code */
 	if (snprintf(filename, sizeof(filename), "%s%c%s%c", logdir, DIR_SEP, fn, DIR_SEP) >= FILENAME_MAX) {
@@ -2192,6 +2453,9 @@ logger_destroy(logger *lg)
 	GDKfree(lg->buf);
 	logger_close_input(lg);
 	logger_close_output(lg);
+	MT_lock_destroy(&lg->sync_lock);
+	ATOMIC_DESTROY(&lg->lsn_written);
+	ATOMIC_DESTROY(&lg->lsn_synced);
 	GDKfree(lg);
 }
 
@@ -2311,7 +2575,7 @@ logger_flush(logger *lg, ulng ts)
 		/* we read the full file because skipping is impossible with current log format */
 		logger_lock(lg);
 		lg->flushing = 1;
-		res = logger_read_transaction(lg);
+		res = logger_read_transaction(lg, NULL);
 		lg->flushing = 0;
 		logger_unlock(lg);
 		if (res == LOG_EOF) {
@@ -2618,7 +2882,7 @@ log_bat_transient(logger *lg, log_id id)
 	BUN cnt = BATcount(BBPquickdesc(bid));
 	lg->end += cnt;
 	lg->drops += cnt;
-	gdk_return r =  logger_del_bat(lg, bid);
+	gdk_return r =  logger_del_bat(lg, bid, lg->tid);
 	logger_unlock(lg);
 	return r;
 }
@@ -2749,14 +3013,19 @@ new_logfile(logger *lg)
 	return GDK_SUCCEED;
 }
 
+/* Write the end of the transaction to the log.  The records are only
+ * handed to the OS here, the caller must call log_tsync with the
+ * returned *lsn (after releasing its commit lock) to get them on disk.
+ * An *lsn of 0 means nothing needs to be synced. */
 gdk_return
-log_tend(logger *lg)
+log_tend(logger *lg, ulng *lsn)
 {
 	logformat l;
 
 	if (lg->debug & 1)
 		fprintf(stderr, "#log_tend %d\n", lg->tid);
 
+	*lsn = 0;
 	l.flag = LOG_END;
 	l.id = lg->tid;
 	if (lg->flushnow) {
@@ -2770,14 +3039,53 @@ log_tend(logger *lg)
 	}
 
 	if (log_write_format(lg, &l) != GDK_SUCCEED ||
-	    mnstr_flush(lg->output_log, MNSTR_FLUSH_DATA) ||
-	    (!(GDKdebug & NOSYNCMASK) && mnstr_fsync(lg->output_log))) {
+	    mnstr_flush(lg->output_log, MNSTR_FLUSH_DATA)) {
 		TRC_CRITICAL(GDK, "write failed\n");
 		return GDK_FAIL;
 	}
+	*lsn = (ulng) ATOMIC_INC(&lg->lsn_written);
 	return GDK_SUCCEED;
 }
 
+/* Wait until the log records of the transaction with the given lsn
+ * are on disk.  The first committer to get the sync lock becomes the
+ * leader and syncs the log on behalf of every transaction that wrote
+ * its records so far; the others queue up on the lock behind it and
+ * usually find their records synced once they get it.  With
+ * gdk_group_commit_delay set, the leader waits (at most that many
+ * milliseconds) as long as new commits keep arriving, to make the
+ * groups larger.
+ *
+ * By then, the transaction is already visible to other transactions,
+ * so a failure to sync cannot be undone by failing the commit; like a
+ * failure in log_tdone, it is fatal. */
+gdk_return
+log_tsync(logger *lg, ulng lsn)
+{
+	gdk_return res = GDK_SUCCEED;
+
+	if (lsn == 0 || (ulng) ATOMIC_GET(&lg->lsn_synced) >= lsn)
+		return GDK_SUCCEED;
+	MT_lock_set(&lg->sync_lock);
+	if ((ulng) ATOMIC_GET(&lg->lsn_synced) < lsn) {
+		ATOMIC_BASE_TYPE written = ATOMIC_GET(&lg->lsn_written);
+		for (int i = 0; i < lg->commit_delay; i++) {
+			MT_sleep_ms(1);
+			ATOMIC_BASE_TYPE w = ATOMIC_GET(&lg->lsn_written);
+			if (w == written)
+				break;
+			written = w;
+		}
+		res = logger_sync(lg, written);
+	}
+	MT_lock_unset(&lg->sync_lock);
+	if (res != GDK_SUCCEED)
+		GDKfatal("Could not sync the log file\n");
+	if (lg->debug & 1)
+		fprintf(stderr, "#log_tsync " ULLFMT " (" ULLFMT ")\n", lsn, (ulng) ATOMIC_GET(&lg->lsn_synced));
+	return res;
+}
+
 gdk_return
 log_tdone(logger *lg, ulng commit_ts)
 {
@@ -2902,7 +3210,7 @@ logger_add_bat(logger *lg, BAT *b, log_id id, int tid)
 	assert(b->batRole == PERSISTENT);
 	if (bid) {
 		if (bid != b->batCacheid) {
-			if (logger_del_bat(lg, bid) != GDK_SUCCEED)
+			if (logger_del_bat(lg, bid, tid < 0 ? lg->tid : tid) != GDK_SUCCEED)
 				return GDK_FAIL;
 		} else {
 			return GDK_SUCCEED;
@@ -2922,12 +3230,14 @@ logger_add_bat(logger *lg, BAT *b, log_id id, int tid)
 	return GDK_SUCCEED;
 }
 
+/* tid is the transaction that deletes the bat: during replay of the
+ * log, lg->tid may already belong to a later transaction */
 static gdk_return
-logger_del_bat(logger *lg, log_bid bid)
+logger_del_bat(logger *lg, log_bid bid, int tid)
 {
 	BUN p = log_find(lg->catalog_bid, lg->dcatalog, bid);
 	oid pos;
-	lng lid = lg->tid;
+	lng lid = tid;
 
 	assert(p != BUN_NONE);
 	if (p == BUN_NONE) {
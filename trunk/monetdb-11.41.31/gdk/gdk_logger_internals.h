@@ -44,6 +44,14 @@ struct logger {
 	lng end;		/* end of pre-allocated blocks for faster f(data)sync */
 
 	MT_Lock lock;
+	/* group commit: committers write their log records under the
+	 * commit lock, but sync them afterwards, so that a single sync
+	 * covers all transactions that committed in the mean time */
+	MT_Lock sync_lock;	/* serializes syncing and switching output_log */
+	ATOMIC_TYPE lsn_written; /* number of commits written to the log */
+	ATOMIC_TYPE lsn_synced;	/* number of those known to be on disk */
+	int commit_delay;	/* max ms to wait for more commits before syncing */
+
 	/* Store log_bids (int) to circumvent trouble with reference counting */
 	BAT *catalog_bid;	/* int bid column */
 	BAT *catalog_id;	/* object identifier is unique */
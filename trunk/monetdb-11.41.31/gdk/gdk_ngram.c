@@ -0,0 +1,592 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 1997 - July 2008 CWI, August 2008 - 2021 MonetDB B.V.
+ */
+
+/*
+ * Implementation of trigram indexes on string columns.
+ *
+ * A trigram index records for each trigram (three consecutive bytes)
+ * the sorted list of positions of the values that contain it.  Upper
+ * case ASCII letters are folded to lower case, so the same index
+ * serves both LIKE and ILIKE.  Trigrams are hashed into NG_NBUCKETS
+ * buckets, so a posting list may contain positions of values that
+ * don't have the trigram: the index produces candidates, the caller
+ * must still check them.  A separate list (NG_NONASCII) holds the
+ * positions of values with non-ASCII bytes, since for those, case
+ * insensitive matching is not a matter of ASCII case folding.
+ *
+ * A trigram index is created explicitly (CREATE IMPRINTS INDEX on a
+ * string column ends up in BATngramidx).  It covers the first count
+ * values of the column.  Values that are appended later are not in
+ * the index and are always returned as candidates; once there are
+ * enough of them, the next lookup extends the index.  Any other
+ * change to the column destroys the index.
+ *
+ * On disk, the index is stored in a file with extension .tngram.  The
+ * file consists of a header of NGHEADER oids:
+ * - hdata[0] = NGRAM_VERSION, with bit 24 set when the file is
+ *   complete; this bit is written last;
+ * - hdata[1] = the number of values covered, which must not be larger
+ *   than BATcount(b) for the file to be usable;
+ * - hdata[2] = the total length of the posting lists;
+ * followed by the NG_NLISTS + 1 start offsets of the posting lists
+ * (BUN) and the posting lists themselves (oid).  The file is removed
+ * as soon as the in-memory copy is changed and written again when the
+ * BAT itself is saved.
+ */
+
+#include "monetdb_config.h"
+#include "gdk.h"
+#include "gdk_private.h"
+
+#define NGRAM_VERSION	((oid) 1)
+#define NGHEADER	3
+
+static inline unsigned char
+ng_lower(unsigned char c)
+{
+	return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+}
+
+static inline BUN
+ng_bucket(const unsigned char *s)
+{
+	uint32_t x = (uint32_t) ng_lower(s[0]) << 16 |
+		(uint32_t) ng_lower(s[1]) << 8 |
+		(uint32_t) ng_lower(s[2]);
+	return (BUN) ((x * 2654435761U) >> (32 - 16));
+}
+
+static void
+NGRAMfree_struct(NgramIdx *ng)
+{
+	if (ng) {
+		GDKfree(ng->offsets);
+		GDKfree(ng->posts);
+		GDKfree(ng);
+	}
+}
+
+/* call ADD(k) once for each posting list k that value s belongs to;
+ * last[k] is the last position added to list k */
+#define NGRAMSCAN(ADD)							\
+	do {								\
+		for (BUN p = lo; p < hi; p++) {				\
+			const unsigned char *s = (const unsigned char *) BUNtvar(*bi, p); \
+			bool ascii = true;				\
+			if (strNil((const char *) s))			\
+				continue;				\
+			for (size_t i = 0; s[i]; i++) {			\
+				ascii &= (s[i] & 0x80) == 0;		\
+				if (s[i + 1] != 0 && s[i + 2] != 0) {	\
+					BUN k = ng_bucket(s + i);	\
+					if (last[k] != p) {		\
+						last[k] = p;		\
+						ADD(k);			\
+					}				\
+				}					\
+			}						\
+			if (!ascii)					\
+				ADD(NG_NONASCII);			\
+		}							\
+	} while (0)
+
+/* return a new index which covers the values with index [0, hi) of b:
+ * the values in [0, ng->count) are taken from ng (which may be NULL),
+ * the others are read from the bat */
+static NgramIdx *
+NGRAMextend(BATiter *bi, const NgramIdx *ng, BUN hi)
+{
+	BUN lo = ng ? ng->count : 0;
+	BUN *cnt, *last;
+	NgramIdx *nng;
+	BUN total = 0;
+
+	assert(lo <= hi);
+	cnt = GDKzalloc(NG_NLISTS * sizeof(BUN));
+	last = GDKmalloc(NG_NLISTS * sizeof(BUN));
+	nng = GDKzalloc(sizeof(NgramIdx));
+	if (cnt == NULL || last == NULL || nng == NULL ||
+	    (nng->offsets = GDKmalloc((NG_NLISTS + 1) * sizeof(BUN))) == NULL)
+		goto bailout;
+	for (BUN k = 0; k < NG_NLISTS; k++)
+		last[k] = BUN_NONE;
+#define NGCOUNT(k)	cnt[k]++
+	NGRAMSCAN(NGCOUNT);
+	for (BUN k = 0; k < NG_NLISTS; k++) {
+		nng->offsets[k] = total;
+		total += cnt[k];
+		if (ng)
+			total += ng->offsets[k + 1] - ng->offsets[k];
+	}
+	nng->offsets[NG_NLISTS] = total;
+	if ((nng->posts = GDKmalloc(MAX(total, 1) * sizeof(oid))) == NULL)
+		goto bailout;
+	/* copy the old lists and make cnt[k] the position where the
+	 * next value of list k goes */
+	for (BUN k = 0; k < NG_NLISTS; k++) {
+		cnt[k] = nng->offsets[k];
+		if (ng) {
+			BUN n = ng->offsets[k + 1] - ng->offsets[k];
+			memcpy(nng->posts + cnt[k], ng->posts + ng->offsets[k],
+			       n * sizeof(oid));
+			cnt[k] += n;
+		}
+		last[k] = BUN_NONE;
+	}
+#define NGPOST(k)	nng->posts[cnt[k]++] = (oid) p
+	NGRAMSCAN(NGPOST);
+	GDKfree(cnt);
+	GDKfree(last);
+	nng->count = hi;
+	nng->dirty = true;
+	return nng;
+
+  bailout:
+	GDKfree(cnt);
+	GDKfree(last);
+	NGRAMfree_struct(nng);
+	return NULL;
+}
+
+/* remove the on-disk copy of the index (if any) since we're about to
+ * change the in-memory copy */
+static void
+NGRAMunpersist(BAT *b, NgramIdx *ng)
+{
+	if (ng->ondisk) {
+		GDKunlink(BBPselectfarm(b->batRole, b->ttype, ngramheap),
+			  BATDIR, BBP_physical(b->batCacheid), "tngram");
+		ng->ondisk = false;
+	}
+}
+
+/* write the index to disk; the caller holds b->batIdxLock */
+static void
+NGRAMpersist(BAT *b, NgramIdx *ng, bool dosync)
+{
+	const char *nme = BBP_physical(b->batCacheid);
+	const char *failed = " failed";
+	int farmid, fd;
+	lng t0 = GDKusec();
+
+	if (GDKinmemory(b->theap->farmid) ||
+	    (farmid = BBPselectfarm(b->batRole, b->ttype, ngramheap)) < 0)
+		return;
+	NGRAMunpersist(b, ng);
+	if ((fd = GDKfdlocate(farmid, nme, "wb", "tngram")) < 0) {
+		GDKclrerr();
+		return;
+	}
+	oid hdata[NGHEADER] = {
+		NGRAM_VERSION,
+		(oid) ng->count,
+		(oid) ng->offsets[NG_NLISTS],
+	};
+	size_t osize = (NG_NLISTS + 1) * sizeof(BUN);
+	size_t psize = ng->offsets[NG_NLISTS] * sizeof(oid);
+	bool ok = write(fd, hdata, sizeof(hdata)) == (ssize_t) sizeof(hdata) &&
+		write(fd, ng->offsets, osize) == (ssize_t) osize;
+	/* the posting lists can be large, write them in chunks */
+	for (size_t done = 0; ok && done < psize; ) {
+		size_t n = MIN(psize - done, (size_t) 1 << 30);
+		ok = write(fd, (const char *) ng->posts + done, n) == (ssize_t) n;
+		done += n;
+	}
+	if (ok) {
+		if (dosync && !(GDKdebug & NOSYNCMASK)) {
+#if defined(NATIVE_WIN32)
+			_commit(fd);
+#elif defined(HAVE_FDATASYNC)
+			fdatasync(fd);
+#elif defined(HAVE_FSYNC)
+			fsync(fd);
+#endif
+		}
+		/* the file is complete, now set the persisted bit */
+		hdata[0] |= (oid) 1 << 24;
+		if (lseek(fd, 0, SEEK_SET) == 0 &&
+		    write(fd, hdata, SIZEOF_OID) == SIZEOF_OID) {
+			if (dosync && !(GDKdebug & NOSYNCMASK)) {
+#if defined(NATIVE_WIN32)
+				_commit(fd);
+#elif defined(HAVE_FDATASYNC)
+				fdatasync(fd);
+#elif defined(HAVE_FSYNC)
+				fsync(fd);
+#endif
+			}
+			ng->ondisk = true;
+			ng->dirty = false;
+			failed = "";
+		}
+	}
+	close(fd);
+	if (!ng->ondisk)
+		GDKunlink(farmid, BATDIR, nme, "tngram");
+	TRC_DEBUG(ACCELERATOR, "NGRAMpersist(" ALGOBATFMT "): trigram index persisted"
+		  " (" LLFMT " usec)%s\n",
+		  ALGOBATPAR(b), GDKusec() - t0, failed);
+}
+
+/* load the index from disk if one was found by BBPdiskscan; the
+ * caller holds b->batIdxLock */
+static void
+NGRAMload(BAT *b)
+{
+	const char *nme = BBP_physical(b->batCacheid);
+	int farmid, fd;
+	NgramIdx *ng = NULL;
+
+	assert(b->tngram == (NgramIdx *) 1);
+	b->tngram = NULL;
+	if (ATOMstorage(b->ttype) != TYPE_str ||
+	    (farmid = BBPselectfarm(b->batRole, b->ttype, ngramheap)) < 0)
+		return;
+	if ((fd = GDKfdlocate(farmid, nme, "rb", "tngram")) >= 0) {
+		struct stat st;
+		oid hdata[NGHEADER];
+		size_t osize = (NG_NLISTS + 1) * sizeof(BUN);
+		size_t psize;
+		bool ok;
+
+		ok = read(fd, hdata, sizeof(hdata)) == (ssize_t) sizeof(hdata) &&
+			hdata[0] == (((oid) 1 << 24) | NGRAM_VERSION) &&
+			hdata[1] <= (oid) BATcount(b) &&
+			fstat(fd, &st) == 0 &&
+			st.st_size == (off_t) (sizeof(hdata) + osize + hdata[2] * sizeof(oid)) &&
+			(ng = GDKzalloc(sizeof(NgramIdx))) != NULL &&
+			(ng->offsets = GDKmalloc(osize)) != NULL &&
+			(ng->posts = GDKmalloc(MAX(hdata[2], 1) * sizeof(oid))) != NULL &&
+			read(fd, ng->offsets, osize) == (ssize_t) osize &&
+			ng->offsets[NG_NLISTS] == (BUN) hdata[2];
+		psize = ok ? hdata[2] * sizeof(oid) : 0;
+		for (size_t done = 0; ok && done < psize; ) {
+			size_t n = MIN(psize - done, (size_t) 1 << 30);
+			ok = read(fd, (char *) ng->posts + done, n) == (ssize_t) n;
+			done += n;
+		}
+		close(fd);
+		if (ok) {
+			ng->count = (BUN) hdata[1];
+			ng->ondisk = true;
+			b->tngram = ng;
+			TRC_DEBUG(ACCELERATOR, "BATcheckngram(" ALGOBATFMT "): reusing persisted trigram index\n", ALGOBATPAR(b));
+			return;
+		}
+		NGRAMfree_struct(ng);
+		/* unlink unusable file */
+		GDKunlink(farmid, BATDIR, nme, "tngram");
+	}
+	GDKclrerr();	/* we're not currently interested in errors */
+}
+
+/* return true if we have a trigram index on the tail, even if we need
+ * to read one from disk */
+bool
+BATcheckngram(BAT *b)
+{
+	bool ret;
+
+	if (b == NULL)
+		return false;
+	/* we don't need the lock just to read the value b->tngram */
+	if (b->tngram == (NgramIdx *) 1) {
+		/* but when we want to change it, we need the lock */
+		assert(!GDKinmemory(b->theap->farmid));
+		MT_lock_set(&b->batIdxLock);
+		if (b->tngram == (NgramIdx *) 1)
+			NGRAMload(b);
+		MT_lock_unset(&b->batIdxLock);
+	}
+	ret = b->tngram != NULL;
+	return ret;
+}
+
+/* create a trigram index on the string column b */
+gdk_return
+BATngramidx(BAT *b)
+{
+	NgramIdx *ng;
+	BATiter bi;
+	lng t0 = GDKusec();
+
+	BATcheck(b, GDK_FAIL);
+	if (ATOMstorage(b->ttype) != TYPE_str) {
+		GDKerror("unsupported type %s\n", ATOMname(b->ttype));
+		return GDK_FAIL;
+	}
+	if (VIEWtparent(b)) {
+		/* the index lives on the parent */
+		b = BBP_cache(VIEWtparent(b));
+		assert(b);
+	}
+	if (BATcheckngram(b))
+		return GDK_SUCCEED;
+	bi = bat_iterator(b);
+	MT_lock_set(&b->batIdxLock);
+	if (b->tngram == NULL) {
+		MT_thread_setalgorithm("create trigram index");
+		if ((ng = NGRAMextend(&bi, NULL, bi.count)) == NULL) {
+			MT_lock_unset(&b->batIdxLock);
+			bat_iterator_end(&bi);
+			return GDK_FAIL;
+		}
+		b->tngram = ng;
+		TRC_DEBUG(ACCELERATOR, "BATngramidx(" ALGOBATFMT "): " BUNFMT
+			  " postings (" LLFMT " usec)\n",
+			  ALGOBATPAR(b), ng->offsets[NG_NLISTS], GDKusec() - t0);
+		/* if the BAT is committed and saved, we can save the
+		 * index as well */
+		if ((BBP_status(b->batCacheid) & BBPEXISTING) &&
+		    b->batInserted == b->batCount &&
+		    !b->theap->dirty)
+			NGRAMpersist(b, ng, true);
+	}
+	MT_lock_unset(&b->batIdxLock);
+	bat_iterator_end(&bi);
+	return GDK_SUCCEED;
+}
+
+/* return the first index i >= lo in the sorted array v[0..n) with
+ * v[i] >= o, or n if there is none */
+static inline BUN
+ngram_search(const oid *v, BUN lo, BUN n, oid o)
+{
+	BUN step = 1, hi;
+
+	/* gallop, then binary search */
+	while (lo + step < n && v[lo + step] < o) {
+		lo += step;
+		step <<= 1;
+	}
+	hi = MIN(lo + step, n);
+	while (lo < hi) {
+		BUN mid = lo + (hi - lo) / 2;
+		if (v[mid] < o)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Produce a candidate list with the values of b (restricted to the
+ * candidates in s) that may contain all strings in lits, using the
+ * trigram index of b.  The strings in lits are each terminated by a
+ * NUL byte, the list ends with an empty string.  If caseignore, the
+ * strings must be lower case and values that contain them when
+ * ignoring case are returned.  If the index can't be used, *candp is
+ * set to NULL. */
+gdk_return
+BATngramselect(BAT **candp, BAT *b, BAT *s, const char *lits, bool caseignore)
+{
+	BAT *pb = b, *bn;
+	BUN off = 0, cnt = BATcount(b);
+	BUN *bkts, nbkts = 0;
+	size_t len = 0;
+	NgramIdx *ng;
+	BATiter bi;
+	oid *res = NULL, *tmp = NULL;
+	BUN nres = 0;
+	lng t0 = GDKusec();
+
+	*candp = NULL;
+	if (ATOMstorage(b->ttype) != TYPE_str || cnt == 0)
+		return GDK_SUCCEED;
+	if (VIEWtparent(b)) {
+		pb = BBP_cache(VIEWtparent(b));
+		if (pb == NULL || pb->theap != b->theap ||
+		    b->tbaseoff < pb->tbaseoff)
+			return GDK_SUCCEED;
+		off = b->tbaseoff - pb->tbaseoff;
+	}
+	if (!BATcheckngram(pb))
+		return GDK_SUCCEED;
+
+	/* the posting lists of all trigrams of the strings */
+	for (const char *l = lits; *l; l += strlen(l) + 1)
+		len += strlen(l);
+	if ((bkts = GDKmalloc(MAX(len, 1) * sizeof(BUN))) == NULL)
+		return GDK_FAIL;
+	for (const char *l = lits; *l; l += strlen(l) + 1) {
+		for (const unsigned char *t = (const unsigned char *) l; t[0] && t[1] && t[2]; t++) {
+			BUN k = ng_bucket(t), i;
+			for (i = 0; i < nbkts && bkts[i] != k; i++)
+				;
+			if (i == nbkts)
+				bkts[nbkts++] = k;
+		}
+	}
+	if (nbkts == 0) {
+		GDKfree(bkts);
+		return GDK_SUCCEED;
+	}
+
+	bi = bat_iterator(pb);
+	MT_lock_set(&pb->batIdxLock);
+	ng = pb->tngram;
+	if (ng == NULL || ng == (NgramIdx *) 1 || ng->count > bi.count) {
+		MT_lock_unset(&pb->batIdxLock);
+		bat_iterator_end(&bi);
+		GDKfree(bkts);
+		return GDK_SUCCEED;
+	}
+	if (bi.count - ng->count > ng->count / 8) {
+		/* too many values are not indexed, extend the index */
+		NgramIdx *nng = NGRAMextend(&bi, ng, bi.count);
+		if (nng != NULL) {
+			NGRAMunpersist(pb, ng);
+			NGRAMfree_struct(ng);
+			pb->tngram = ng = nng;
+		}
+		GDKclrerr();
+	}
+
+	/* start with the shortest list */
+	for (BUN i = 1; i < nbkts; i++) {
+		if (ng->offsets[bkts[i] + 1] - ng->offsets[bkts[i]] <
+		    ng->offsets[bkts[0] + 1] - ng->offsets[bkts[0]]) {
+			BUN k = bkts[0];
+			bkts[0] = bkts[i];
+			bkts[i] = k;
+		}
+	}
+	/* room for the intersection, the non-ASCII values and the
+	 * values that are not in the index */
+	BUN nlo = ng->offsets[bkts[0]], nhi = ng->offsets[bkts[0] + 1];
+	BUN nna = caseignore ? ng->offsets[NG_NONASCII + 1] - ng->offsets[NG_NONASCII] : 0;
+	BUN ntail = off + cnt > ng->count ? off + cnt - MAX(off, ng->count) : 0;
+	if ((res = GDKmalloc((nhi - nlo + nna + ntail + 1) * sizeof(oid))) == NULL ||
+	    (tmp = GDKmalloc((nhi - nlo + nna + 1) * sizeof(oid))) == NULL) {
+		MT_lock_unset(&pb->batIdxLock);
+		bat_iterator_end(&bi);
+		GDKfree(bkts);
+		GDKfree(res);
+		return GDK_FAIL;
+	}
+	for (BUN j = ngram_search(ng->posts, nlo, nhi, (oid) off);
+	     j < nhi && ng->posts[j] < off + cnt; j++)
+		res[nres++] = ng->posts[j];
+	for (BUN i = 1; i < nbkts && nres > 0; i++) {
+		const oid *v = ng->posts;
+		BUN j = ng->offsets[bkts[i]], n = ng->offsets[bkts[i] + 1];
+		BUN m = 0;
+		for (BUN r = 0; r < nres && j < n; r++) {
+			j = ngram_search(v, j, n, res[r]);
+			if (j < n && v[j] == res[r])
+				res[m++] = res[r];
+		}
+		nres = m;
+	}
+	if (nna > 0) {
+		/* merge in the values with non-ASCII bytes */
+		const oid *v = ng->posts;
+		BUN j = ngram_search(v, ng->offsets[NG_NONASCII], ng->offsets[NG_NONASCII + 1], (oid) off);
+		BUN n = ng->offsets[NG_NONASCII + 1];
+		BUN r = 0, m = 0;
+		while (r < nres || (j < n && v[j] < off + cnt)) {
+			if (j >= n || v[j] >= off + cnt || (r < nres && res[r] < v[j]))
+				tmp[m++] = res[r++];
+			else if (r < nres && res[r] == v[j]) {
+				tmp[m++] = res[r++];
+				j++;
+			} else
+				tmp[m++] = v[j++];
+		}
+		memcpy(res, tmp, m * sizeof(oid));
+		nres = m;
+	}
+	/* values that are not in the index may match */
+	for (BUN p = MAX(off, ng->count); p < off + cnt; p++)
+		res[nres++] = (oid) p;
+	MT_lock_unset(&pb->batIdxLock);
+	bat_iterator_end(&bi);
+	GDKfree(bkts);
+	GDKfree(tmp);
+
+	if ((bn = COLnew(0, TYPE_oid, nres, TRANSIENT)) == NULL) {
+		GDKfree(res);
+		return GDK_FAIL;
+	}
+	oid *o = Tloc(bn, 0);
+	for (BUN i = 0; i < nres; i++)
+		o[i] = b->hseqbase + (res[i] - off);
+	GDKfree(res);
+	BATsetcount(bn, nres);
+	bn->tsorted = true;
+	bn->trevsorted = nres <= 1;
+	bn->tkey = true;
+	bn->tnil = false;
+	bn->tnonil = true;
+	bn->tseqbase = nres == 0 ? 0 : nres == 1 ? o[0] : oid_nil;
+	if (s) {
+		BAT *c = BATintersectcand(bn, s);
+		BBPreclaim(bn);
+		if ((bn = c) == NULL)
+			return GDK_FAIL;
+	}
+	TRC_DEBUG(ACCELERATOR, "BATngramselect(b=" ALGOBATFMT ",s=" ALGOOPTBATFMT
+		  "): " BUNFMT " candidates (" LLFMT " usec)\n",
+		  ALGOBATPAR(b), ALGOOPTBATPAR(s), BATcount(bn), GDKusec() - t0);
+	*candp = bn;
+	return GDK_SUCCEED;
+}
+
+/* save the index if it covers at most the first size values of b
+ * which have just been saved */
+void
+NGRAMsave(BAT *b, BUN size, bool dosync)
+{
+	NgramIdx *ng;
+
+	if (b->tngram == NULL || b->tngram == (NgramIdx *) 1)
+		return;
+	MT_lock_set(&b->batIdxLock);
+	if ((ng = b->tngram) != NULL && ng != (NgramIdx *) 1 &&
+	    ng->dirty && ng->count <= size)
+		NGRAMpersist(b, ng, dosync);
+	MT_lock_unset(&b->batIdxLock);
+}
+
+/* free the in-memory copy of the index, keeping the persisted copy */
+void
+NGRAMfree(BAT *b)
+{
+	NgramIdx *ng;
+
+	if (b && b->tngram) {
+		MT_lock_set(&b->batIdxLock);
+		if ((ng = b->tngram) != NULL && ng != (NgramIdx *) 1) {
+			b->tngram = ng->ondisk && !GDKinmemory(b->theap->farmid) ? (NgramIdx *) 1 : NULL;
+			NGRAMfree_struct(ng);
+		}
+		MT_lock_unset(&b->batIdxLock);
+	}
+}
+
+/* remove the index, both from memory and from disk */
+void
+NGRAMdestroy(BAT *b)
+{
+	NgramIdx *ng;
+
+	if (b && b->tngram) {
+		MT_lock_set(&b->batIdxLock);
+		ng = b->tngram;
+		b->tngram = NULL;
+		MT_lock_unset(&b->batIdxLock);
+		if (ng == (NgramIdx *) 1 || (ng != NULL && ng->ondisk)) {
+			GDKunlink(BBPselectfarm(b->batRole, b->ttype, ngramheap),
+				  BATDIR,
+				  BBP_physical(b->batCacheid),
+				  "tngram");
+		}
+		if (ng != (NgramIdx *) 1)
+			NGRAMfree_struct(ng);
+	}
+}
@@ -25,7 +25,9 @@ enum heaptype {
 	varheap,
 	hashheap,
 	imprintsheap,
-	orderidxheap
+	orderidxheap,
+	zonemapheap,
+	ngramheap
 };
 
 gdk_return ATOMheap(int id, Heap *hp, size_t cap)
@@ -46,6 +48,10 @@ bool BATcheckhash(BAT *b)
 	__attribute__((__visibility__("hidden")));
 bool BATcheckimprints(BAT *b)
 	__attribute__((__visibility__("hidden")));
+bool BATcheckzonemap(BAT *b)
+	__attribute__((__visibility__("hidden")));
+bool BATcheckngram(BAT *b)
+	__attribute__((__visibility__("hidden")));
 gdk_return BATcheckmodes(BAT *b, bool persistent)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
@@ -81,7 +87,7 @@ void BATrmprop(BAT *b, enum prop_t idx)
 	__attribute__((__visibility__("hidden")));
 void BATrmprop_nolock(BAT *b, enum prop_t idx)
 	__attribute__((__visibility__("hidden")));
-gdk_return BATsave_iter(BAT *bd, BATiter *bi, BUN size)
+gdk_return BATsave_iter(BAT *bd, BATiter *bi, BUN size, bool dosync)
 	__attribute__((__visibility__("hidden")));
 void BATsetdims(BAT *b)
 	__attribute__((__visibility__("hidden")));
@@ -196,6 +202,9 @@ gdk_return HASHnew(Hash *h, int tpe, BUN size, BUN mask, BUN count, bool bcktonl
 gdk_return HEAPalloc(Heap *h, size_t nitems, size_t itemsize, size_t itemsizemmap)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
+gdk_return HEAPbackup_pages(Heap *h, const char *srcdir, const char *nme, const char *ext, const char *dstdir, bool *done)
+	__attribute__((__warn_unused_result__))
+	__attribute__((__visibility__("hidden")));
 gdk_return HEAPcopy(Heap *dst, Heap *src, size_t offset)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
@@ -206,6 +215,8 @@ gdk_return HEAPgrow(MT_Lock *lock, Heap **old, size_t size, bool mayshare)
 gdk_return HEAPload(Heap *h, const char *nme, const char *ext, bool trunc)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
+void HEAPpages_invalidate(void)
+	__attribute__((__visibility__("hidden")));
 void HEAP_recover(Heap *, const var_t *, BUN)
 	__attribute__((__visibility__("hidden")));
 gdk_return HEAPsave(Heap *h, const char *nme, const char *ext, bool dosync, BUN free)
@@ -214,6 +225,9 @@ gdk_return HEAPsave(Heap *h, const char *nme, const char *ext, bool dosync, BUN
 gdk_return HEAPshrink(Heap *h, size_t size)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
+gdk_return HEAPundo(int farmid, const char *srcdir, const char *name, const char *dstdir)
+	__attribute__((__warn_unused_result__))
+	__attribute__((__visibility__("hidden")));
 int HEAPwarm(Heap *h)
 	__attribute__((__visibility__("hidden")));
 void IMPSdecref(Imprints *imprints, bool remove)
@@ -255,10 +269,14 @@ void settailname(Heap *restrict tail, const char *restrict physnme, int tt, int
 	__attribute__((__visibility__("hidden")));
 void strCleanHash(Heap *hp, bool rebuild)
 	__attribute__((__visibility__("hidden")));
+void strDedupDestroy(Heap *h)
+	__attribute__((__visibility__("hidden")));
 void strHeap(Heap *d, size_t cap)
 	__attribute__((__visibility__("hidden")));
 var_t strLocate(Heap *h, const char *v)
 	__attribute__((__visibility__("hidden")));
+var_t strNext(const Heap *h, size_t free, var_t pos)
+	__attribute__((__visibility__("hidden")));
 var_t strPut(BAT *b, var_t *dst, const void *v)
 	__attribute__((__visibility__("hidden")));
 str strRead(str a, size_t *dstlen, stream *s, size_t cnt)
@@ -276,6 +294,25 @@ void VIEWunlink(BAT *b)
 	__attribute__((__visibility__("hidden")));
 BAT *virtualize(BAT *bn)
 	__attribute__((__visibility__("hidden")));
+gdk_return BATzonemap(BAT *b)
+	__attribute__((__warn_unused_result__))
+	__attribute__((__visibility__("hidden")));
+void ZMappend(BAT *b)
+	__attribute__((__visibility__("hidden")));
+uint8_t *ZMclassify(BAT *b, const void *tl, const void *th, bool anti, bool nilsel, BUN count, BUN *nblocks)
+	__attribute__((__visibility__("hidden")));
+void ZMdestroy(BAT *b)
+	__attribute__((__visibility__("hidden")));
+void ZMfree(BAT *b)
+	__attribute__((__visibility__("hidden")));
+void ZMreplace(BAT *b, BUN p, BUN cnt)
+	__attribute__((__visibility__("hidden")));
+void ZMsave(BAT *b, BUN size, bool dosync)
+	__attribute__((__visibility__("hidden")));
+void NGRAMfree(BAT *b)
+	__attribute__((__visibility__("hidden")));
+void NGRAMsave(BAT *b, BUN size, bool dosync)
+	__attribute__((__visibility__("hidden")));
 
 static inline const char *
 gettailnamebi(const BATiter *bi)
@@ -433,6 +470,39 @@ struct Imprints {
 	BUN dictcnt;		/* counter for cache dictionary               */
 };
 
+#define ZM_SHIFT	16	/* log2 of number of values per zone map block */
+#define ZM_BLOCKSIZE	((BUN) 1 << ZM_SHIFT)
+
+/* classification of a zone map block for a select */
+#define ZM_SKIP		0	/* no value in the block qualifies */
+#define ZM_ALL		1	/* all values in the block qualify */
+#define ZM_SCAN		2	/* the block must be scanned */
+
+struct ZoneMap {
+	int type;		/* storage type of the column */
+	uint16_t width;		/* width of the min/max values */
+	bool ondisk;		/* the .tzonemap file is up to date */
+	bool dirty;		/* changed since last written to disk */
+	BUN count;		/* number of values summarized */
+	BUN nblocks;		/* number of blocks in use */
+	BUN size;		/* number of blocks allocated */
+	char *mins;		/* smallest non-nil value per block */
+	char *maxs;		/* largest non-nil value per block */
+	BUN *nils;		/* upper bound of number of nils per block */
+};
+
+#define NG_NBUCKETS	((BUN) 1 << 16)	/* number of trigram buckets */
+#define NG_NONASCII	NG_NBUCKETS	/* list of values with non-ASCII bytes */
+#define NG_NLISTS	(NG_NBUCKETS + 1)
+
+struct NgramIdx {
+	bool ondisk;		/* the .tngram file is up to date */
+	bool dirty;		/* changed since last written to disk */
+	BUN count;		/* number of values indexed */
+	BUN *offsets;		/* start of each posting list (NG_NLISTS + 1) */
+	oid *posts;		/* the posting lists: sorted positions */
+};
+
 typedef struct {
 	MT_Lock swap;
 } batlock_t;
@@ -480,6 +550,9 @@ extern BUN HASH_DESTROY_UNIQUES_FRACTION;     /* likewise */
 /* if the estimated number of unique values is less than 1 in this
  * number, don't build a hash table to do a hashselect */
 extern dbl NO_HASH_SELECT_FRACTION;           /* same here */
+/* maximum number of distinct strings for which we keep large string
+ * heaps free of duplicates (0: don't) */
+extern BUN GDK_STRING_DEDUP_LIMIT;
 
 /* extra space in front of strings in string heaps when hashash is set
  * if at least (2*SIZEOF_BUN), also store length (heaps are then
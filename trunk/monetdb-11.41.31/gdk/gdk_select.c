@@ -68,6 +68,7 @@ virtualize(BAT *bn)
 			settailname(h, BBP_physical(bn->batCacheid), TYPE_oid, 0);
 			h->parentid = bn->batCacheid;
 			h->base = NULL;
+			h->pages = NULL;
 			ATOMIC_INIT(&h->refs, 1);
 			HEAPdecref(bn->theap, false);
 			bn->theap = h;
@@ -420,7 +421,7 @@ quickins(oid *dst, BUN cnt, oid o, BAT *bn)
 	do {								\
 		*algo = "select: " #NAME " " #TEST " (" #canditer_next ")"; \
 		if (BATcapacity(bn) < maximum) {			\
-			for (p = 0; p < ci->ncand; p++) {		\
+			for (p = ci->next; p < ci->ncand; p++) {	\
 				o = canditer_next(ci);			\
 				v = src[o-hseq];			\
 				if (TEST) {				\
@@ -436,7 +437,7 @@ quickins(oid *dst, BUN cnt, oid o, BAT *bn)
 				}					\
 			}						\
 		} else {						\
-			for (p = 0; p < ci->ncand; p++) {		\
+			for (p = ci->next; p < ci->ncand; p++) {	\
 				o = canditer_next(ci);			\
 				v = src[o-hseq];			\
 				assert(cnt < BATcapacity(bn));		\
@@ -729,7 +730,12 @@ fullscan_str(BAT *b, BATiter *bi, struct canditer *restrict ci, BAT *bn,
 	BUN p;
 	oid o;
 
-	if (!equi || !GDK_ELIMDOUBLES(b->tvheap))
+	/* if the strings are distinct, we can compare offsets; but
+	 * finding the offset of a string in a large heap means looking
+	 * at all strings in the heap, so only do that if there are
+	 * many more values to compare than strings in the heap */
+	if (!equi || !GDK_DISTINCTSTR(b->tvheap) ||
+	    (!GDK_ELIMDOUBLES(b->tvheap) && bi->vhfree / 8 > ci->ncand))
 		return fullscan_any(b, bi, ci, bn, tl, th, li, hi, equi, anti,
 				    lval, hval, lnil, cnt, hseq, dst,
 				    maximum, imprints, algo);
@@ -909,16 +915,134 @@ scan_sel(fullscan, )
 scan_sel(densescan, _dense)
 
 
+/* call the type-specific core scan select function for the
+ * candidates in ci starting at ci->next */
+static BUN
+scantype(BAT *b, BATiter *bi, struct canditer *restrict ci, BAT *bn,
+	 const void *tl, const void *th,
+	 bool li, bool hi, bool equi, bool anti, bool lval, bool hval,
+	 bool lnil, BUN cnt, oid *restrict dst, BUN maximum,
+	 Imprints *imprints, const char **algo)
+{
+	switch (ATOMbasetype(b->ttype)) {
+	case TYPE_bte:
+		if (ci->tpe == cand_dense)
+			return densescan_bte(scanargs);
+		return fullscan_bte(scanargs);
+	case TYPE_sht:
+		if (ci->tpe == cand_dense)
+			return densescan_sht(scanargs);
+		return fullscan_sht(scanargs);
+	case TYPE_int:
+		if (ci->tpe == cand_dense)
+			return densescan_int(scanargs);
+		return fullscan_int(scanargs);
+	case TYPE_flt:
+		if (ci->tpe == cand_dense)
+			return densescan_flt(scanargs);
+		return fullscan_flt(scanargs);
+	case TYPE_dbl:
+		if (ci->tpe == cand_dense)
+			return densescan_dbl(scanargs);
+		return fullscan_dbl(scanargs);
+	case TYPE_lng:
+		if (ci->tpe == cand_dense)
+			return densescan_lng(scanargs);
+		return fullscan_lng(scanargs);
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		if (ci->tpe == cand_dense)
+			return densescan_hge(scanargs);
+		return fullscan_hge(scanargs);
+#endif
+	case TYPE_str:
+		return fullscan_str(scanargs);
+	default:
+		return fullscan_any(scanargs);
+	}
+}
+
+/* scan select using a zone map: zmcls contains the classification
+ * of the zmnblks blocks of the zone map of the BAT that owns b's
+ * heap, b starting at position zmoff in that BAT; blocks classified
+ * as ZM_SKIP are not looked at, the candidates in blocks classified
+ * as ZM_ALL are copied, and only the remaining blocks are scanned */
+static BUN
+zonemapscan(BAT *b, BATiter *bi, struct canditer *restrict ci, BAT *bn,
+	    const void *tl, const void *th,
+	    bool li, bool hi, bool equi, bool anti, bool lval, bool hval,
+	    bool lnil, BUN maximum, const uint8_t *zmcls, BUN zmnblks,
+	    BUN zmoff, const char **algo)
+{
+	struct canditer sub;
+	BUN cnt = 0, p0 = 0, p1;
+	BUN nskip = 0, nall = 0, nscan = 0;
+	oid *restrict dst = (oid *) Tloc(bn, 0);
+	const oid hseq = b->hseqbase;
+
+	assert(ci->tpe != cand_mask);
+	while (p0 < ci->ncand) {
+		/* the block containing the next candidate */
+		oid o = canditer_idx(ci, p0);
+		BUN k = (o - hseq + zmoff) >> ZM_SHIFT;
+		p1 = canditer_search(ci, hseq + ((k + 1) << ZM_SHIFT) - zmoff, true);
+		assert(p1 > p0);
+		switch (k < zmnblks ? zmcls[k] : ZM_SCAN) {
+		case ZM_SKIP:
+			nskip++;
+			break;
+		case ZM_ALL:
+			nall++;
+			if (cnt + p1 - p0 > BATcapacity(bn)) {
+				BUN ncap = BATgrows(bn);
+				if (ncap > maximum)
+					ncap = maximum;
+				if (ncap < cnt + p1 - p0)
+					ncap = cnt + p1 - p0;
+				if (BATextend(bn, ncap) != GDK_SUCCEED) {
+					BBPreclaim(bn);
+					return BUN_NONE;
+				}
+				dst = (oid *) Tloc(bn, 0);
+			}
+			sub = *ci;
+			canditer_setidx(&sub, p0);
+			for (BUN p = p0; p < p1; p++)
+				dst[cnt++] = canditer_next(&sub);
+			break;
+		default:
+			nscan++;
+			sub = *ci;
+			canditer_setidx(&sub, p0);
+			sub.ncand = p1;
+			cnt = scantype(b, bi, &sub, bn, tl, th, li, hi, equi,
+				       anti, lval, hval, lnil, cnt, dst,
+				       maximum, NULL, algo);
+			if (cnt == BUN_NONE)
+				return BUN_NONE;
+			/* bn may have been extended */
+			dst = (oid *) Tloc(bn, 0);
+			break;
+		}
+		p0 = p1;
+	}
+	*algo = "select: zone map";
+	TRC_DEBUG(ACCELERATOR, "b=" ALGOBATFMT ": zone map blocks skipped "
+		  BUNFMT ", all " BUNFMT ", scanned " BUNFMT "\n",
+		  ALGOBATPAR(b), nskip, nall, nscan);
+	return cnt;
+}
+
 static BAT *
 scanselect(BAT *b, BATiter *bi, struct canditer *restrict ci, BAT *bn,
 	   const void *tl, const void *th,
 	   bool li, bool hi, bool equi, bool anti, bool lval, bool hval,
-	   bool lnil, BUN maximum, Imprints *imprints, const char **algo)
+	   bool lnil, BUN maximum, Imprints *imprints,
+	   const uint8_t *zmcls, BUN zmnblks, BUN zmoff, const char **algo)
 {
 #ifndef NDEBUG
 	int (*cmp)(const void *, const void *);
 #endif
-	int t;
 	BUN cnt = 0;
 	oid *restrict dst;
 
@@ -939,61 +1063,14 @@ scanselect(BAT *b, BATiter *bi, struct canditer *restrict ci, BAT *bn,
 
 	dst = (oid *) Tloc(bn, 0);
 
-	t = ATOMbasetype(b->ttype);
-
-	/* call type-specific core scan select function */
-	switch (t) {
-	case TYPE_bte:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_bte(scanargs);
-		else
-			cnt = fullscan_bte(scanargs);
-		break;
-	case TYPE_sht:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_sht(scanargs);
-		else
-			cnt = fullscan_sht(scanargs);
-		break;
-	case TYPE_int:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_int(scanargs);
-		else
-			cnt = fullscan_int(scanargs);
-		break;
-	case TYPE_flt:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_flt(scanargs);
-		else
-			cnt = fullscan_flt(scanargs);
-		break;
-	case TYPE_dbl:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_dbl(scanargs);
-		else
-			cnt = fullscan_dbl(scanargs);
-		break;
-	case TYPE_lng:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_lng(scanargs);
-		else
-			cnt = fullscan_lng(scanargs);
-		break;
-#ifdef HAVE_HGE
-	case TYPE_hge:
-		if (ci->tpe == cand_dense)
-			cnt = densescan_hge(scanargs);
-		else
-			cnt = fullscan_hge(scanargs);
-		break;
-#endif
-	case TYPE_str:
-		cnt = fullscan_str(scanargs);
-		break;
-	default:
-		cnt = fullscan_any(scanargs);
-		break;
-	}
+	if (zmcls)
+		cnt = zonemapscan(b, bi, ci, bn, tl, th, li, hi, equi, anti,
+				  lval, hval, lnil, maximum, zmcls, zmnblks,
+				  zmoff, algo);
+	else
+		cnt = scantype(b, bi, ci, bn, tl, th, li, hi, equi, anti,
+			       lval, hval, lnil, cnt, dst, maximum, imprints,
+			       algo);
 	if (cnt == BUN_NONE) {
 		return NULL;
 	}
@@ -1937,11 +2014,47 @@ BATselect(BAT *b, BAT *s, const void *tl, const void *th,
 				MT_lock_unset(&b->batIdxLock);
 			}
 		}
+		/* use a zone map if
+		 *   i) bat is persistent, or parent is persistent,
+		 *  ii) the type is supported,
+		 * iii) the bat (or parent) spans multiple zone map
+		 *      blocks, and
+		 *  iv) the candidate list is not a bit mask (we need
+		 *      to be able to search it cheaply).
+		 */
+		uint8_t *zmcls = NULL;
+		BUN zmnblks = 0, zmoff = 0;
+		tmp = parent ? BBP_cache(parent) : b;
+		if (imprints == NULL &&
+		    ci.tpe != cand_mask &&
+		    ci.ncand >= ZM_BLOCKSIZE &&
+		    tmp != NULL &&
+		    !tmp->batTransient &&
+		    tmp->theap == b->theap &&
+		    tmp->twidth == b->twidth &&
+		    ATOMbasetype(tmp->ttype) == t &&
+		    ATOMtype(b->ttype) != TYPE_oid &&
+		    ATOMtype(tmp->ttype) != TYPE_oid &&
+		    b->tbaseoff >= tmp->tbaseoff &&
+		    BATcount(tmp) >= 2 * ZM_BLOCKSIZE &&
+		    (t == TYPE_bte || t == TYPE_sht || t == TYPE_int ||
+		     t == TYPE_lng ||
+#ifdef HAVE_HGE
+		     t == TYPE_hge ||
+#endif
+		     t == TYPE_flt || t == TYPE_dbl) &&
+		    BATzonemap(tmp) == GDK_SUCCEED) {
+			zmoff = b->tbaseoff - tmp->tbaseoff;
+			zmcls = ZMclassify(tmp, tl, th, anti, equi && lnil,
+					   zmoff + bi.count, &zmnblks);
+		}
 		GDKclrerr();
 		bn = scanselect(b, &bi, &ci, bn, tl, th, li, hi, equi, anti,
-				lval, hval, lnil, maximum, imprints, &algo);
+				lval, hval, lnil, maximum, imprints,
+				zmcls, zmnblks, zmoff, &algo);
 		if (imprints)
 			IMPSdecref(imprints, false);
+		GDKfree(zmcls);
 	}
 	bat_iterator_end(&bi);
 
@@ -749,11 +749,10 @@ BATmsync(BAT *b)
 }
 
 gdk_return
-BATsave_iter(BAT *b, BATiter *bi, BUN size)
+BATsave_iter(BAT *b, BATiter *bi, BUN size, bool dosync)
 {
 	gdk_return err = GDK_SUCCEED;
 	const char *nme;
-	bool dosync;
 	bool locked = false;
 
 	BATcheck(b, GDK_FAIL);
@@ -761,7 +760,7 @@ BATsave_iter(BAT *b, BATiter *bi, BUN size)
 	if (MT_rwlock_rdtry(&b->thashlock))
 		locked = true;
 
-	dosync = (BBP_status(b->batCacheid) & BBPPERSISTENT) != 0;
+	dosync &= (BBP_status(b->batCacheid) & BBPPERSISTENT) != 0;
 	assert(!GDKinmemory(b->theap->farmid));
 	/* views cannot be saved, but make an exception for
 	 * force-remapped views */
@@ -856,6 +855,8 @@ BATsave_iter(BAT *b, BATiter *bi, BUN size)
 		MT_lock_unset(&b->theaplock);
 		if (locked &&  b->thash && b->thash != (Hash *) 1)
 			BAThashsave(b, dosync);
+		ZMsave(b, size, dosync);
+		NGRAMsave(b, size, dosync);
 	}
 	if (locked)
 		MT_rwlock_rdunlock(&b->thashlock);
@@ -868,7 +869,7 @@ BATsave(BAT *b)
 	gdk_return rc;
 
 	BATiter bi = bat_iterator(b);
-	rc = BATsave_iter(b, &bi, bi.count);
+	rc = BATsave_iter(b, &bi, bi.count, true);
 	bat_iterator_end(&bi);
 	return rc;
 }
@@ -974,6 +975,8 @@ BATdelete(BAT *b)
 	HASHdestroy(b);
 	IMPSdestroy(b);
 	OIDXdestroy(b);
+	ZMdestroy(b);
+	NGRAMdestroy(b);
 	PROPdestroy_nolock(b);
 	if (b->theap) {
 		HEAPfree(b->theap, true);
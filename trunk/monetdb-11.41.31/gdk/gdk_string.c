@@ -151,6 +151,36 @@ strCleanHash(Heap *h, bool rebuild)
 	h->cleanhash = false;
 }
 
+/*
+ * Walk the strings of a string heap that was filled by strPut only
+ * (which is the case for heaps without duplicates, see
+ * GDK_DISTINCTSTR), so that we know where the strings are.  Given the
+ * offset of a string (or 0 to start), return the offset of the next
+ * string below free, or 0 if there is none.
+ */
+var_t
+strNext(const Heap *h, size_t free, var_t pos)
+{
+	size_t pad;
+
+	if (pos == 0)
+		pos = GDK_STRHASHSIZE;
+	else
+		pos += strlen(h->base + pos) + 1;
+	if (pos >= free)
+		return 0;
+	/* the padding as inserted by strPut */
+	pad = GDK_VARALIGN - (pos & (GDK_VARALIGN - 1));
+	if (GDK_ELIMBASE(pos + pad) == 0) {
+		if (pad < sizeof(stridx_t))
+			pad += GDK_VARALIGN;
+	} else if (GDK_ELIMBASE(pos) != 0) {
+		pad = 0;
+	}
+	pos += pad + (h->hashash ? EXTRALEN : 0);
+	return pos < free ? pos : 0;
+}
+
 /*
  * The strPut routine. The routine strLocate can be used to identify
  * the location of a string in the heap if it exists. Otherwise it
@@ -164,17 +194,28 @@ strLocate(Heap *h, const char *v)
 
 	/* search hash-table, if double-elimination is still in place */
 	BUN off;
-	if (h->free == 0) {
+	size_t free = h->free;
+	if (free == 0) {
 		/* empty, so there are no strings */
 		return 0;
 	}
 
+	/* should only use strLocate iff fully double eliminated */
+	assert(GDK_DISTINCTSTR(h));
+
+	if (GDK_ELIMBASE(free) != 0) {
+		/* the hash table in the heap is incomplete, so look
+		 * at all strings */
+		for (var_t pos = strNext(h, free, 0); pos; pos = strNext(h, free, pos)) {
+			if (strcmp(v, h->base + pos) == 0)
+				return pos;
+		}
+		return 0;
+	}
+
 	off = strHash(v);
 	off &= GDK_STRHASHMASK;
 
-	/* should only use strLocate iff fully double eliminated */
-	assert(GDK_ELIMBASE(h->free) == 0);
-
 	/* search the linked list */
 	for (ref = ((stridx_t *) h->base) + off; *ref; ref = next) {
 		next = (stridx_t *) (h->base + *ref);
@@ -194,6 +235,134 @@ strLocate(Heap *h, const char *v)
 #define likely(expr)	(expr)
 #endif
 
+/*
+ * Duplicate elimination in large string heaps.
+ *
+ * The hash table at the start of a string heap eliminates all
+ * duplicates only while the heap is smaller than GDK_ELIMLIMIT; after
+ * that, a bucket only refers to the last string entered, so a column
+ * with few distinct values keeps growing.  If gdk_string_dedup_limit
+ * is set, we keep an additional string-to-offset table in memory for
+ * large heaps that are still free of duplicates (the distinct flag),
+ * and keep them that way for as long as the number of distinct
+ * strings stays below the limit.  When it gets too large, we give up:
+ * the table is freed and the flag cleared.
+ *
+ * The table itself isn't saved, but the flag is, and a heap with the
+ * flag set was filled by strPut only (or is a copy of such a heap), so
+ * we know its layout and can rebuild the table from the heap when we
+ * first need it.
+ */
+struct strdedup {
+	size_t mask;		/* number of slots - 1 (power of two) */
+	size_t nstr;		/* number of strings in the table */
+	var_t slot[];		/* offset of string, 0 for an empty slot */
+};
+
+#define STRDEDUP_MINSLOTS	(1 << 12)
+
+void
+strDedupDestroy(Heap *h)
+{
+	GDKfree(h->dedup);
+	h->dedup = NULL;
+}
+
+static void
+strdedup_abandon(Heap *h)
+{
+	TRC_DEBUG(HEAP, "%s: giving up on duplicate elimination\n", h->filename);
+	strDedupDestroy(h);
+	h->distinct = false;
+}
+
+static struct strdedup *
+strdedup_new(size_t nslots)
+{
+	struct strdedup *d;
+
+	d = GDKzalloc(offsetof(struct strdedup, slot) + nslots * sizeof(var_t));
+	if (d == NULL) {
+		/* not being able to eliminate duplicates is not an error */
+		GDKclrerr();
+		return NULL;
+	}
+	d->mask = nslots - 1;
+	return d;
+}
+
+static inline void
+strdedup_enter(struct strdedup *d, var_t pos, BUN strhash)
+{
+	size_t i;
+
+	for (i = strhash & d->mask; d->slot[i] != 0; i = (i + 1) & d->mask)
+		;
+	d->slot[i] = pos;
+	d->nstr++;
+}
+
+/* add the string at offset pos to the table; returns false if we gave
+ * up */
+static bool
+strdedup_add(Heap *h, var_t pos, BUN strhash)
+{
+	struct strdedup *d = h->dedup;
+
+	if (d->nstr >= GDK_STRING_DEDUP_LIMIT) {
+		strdedup_abandon(h);
+		return false;
+	}
+	if (2 * (d->nstr + 1) > d->mask + 1) {
+		/* keep the table at most half full */
+		struct strdedup *n = strdedup_new(2 * (d->mask + 1));
+
+		if (n == NULL) {
+			strdedup_abandon(h);
+			return false;
+		}
+		for (size_t i = 0; i <= d->mask; i++) {
+			if (d->slot[i] != 0)
+				strdedup_enter(n, d->slot[i], strHash(h->base + d->slot[i]));
+		}
+		GDKfree(d);
+		h->dedup = d = n;
+	}
+	strdedup_enter(d, pos, strhash);
+	return true;
+}
+
+/* build the table from the strings in the heap */
+static bool
+strdedup_build(Heap *h)
+{
+	assert(h->dedup == NULL);
+	if (GDK_STRING_DEDUP_LIMIT == 0 || h->hashash ||
+	    (h->dedup = strdedup_new(STRDEDUP_MINSLOTS)) == NULL) {
+		strdedup_abandon(h);
+		return false;
+	}
+	for (var_t pos = strNext(h, h->free, 0); pos; pos = strNext(h, h->free, pos)) {
+		if (!strdedup_add(h, pos, strHash(h->base + pos)))
+			return false;
+	}
+	TRC_DEBUG(HEAP, "%s: %zu distinct strings\n", h->filename, h->dedup->nstr);
+	return true;
+}
+
+static inline var_t
+strdedup_find(const Heap *h, const char *v, BUN strhash)
+{
+	const struct strdedup *d = h->dedup;
+
+	for (size_t i = strhash & d->mask; d->slot[i] != 0; i = (i + 1) & d->mask) {
+		assert(d->slot[i] < h->free);
+		if (strcmp(h->base + d->slot[i], v) == 0)
+			return d->slot[i];
+	}
+	return 0;
+}
+
 var_t
 strPut(BAT *b, var_t *dst, const void *V)
 {
@@ -221,6 +390,9 @@ strPut(BAT *b, var_t *dst, const void *V)
 		memset(h->base, 0, h->size);
 #endif
 		h->hashash = false;
+		/* an empty heap is free of duplicates */
+		h->distinct = GDK_STRING_DEDUP_LIMIT > 0;
+		strDedupDestroy(h);
 	}
 
 	off = strHash(v);
@@ -228,7 +400,13 @@ strPut(BAT *b, var_t *dst, const void *V)
 	off &= GDK_STRHASHMASK;
 	bucket = ((stridx_t *) h->base) + off;
 
-	if (*bucket) {
+	if (h->distinct && GDK_ELIMBASE(h->free) != 0 &&
+	    (h->dedup != NULL || strdedup_build(h))) {
+		/* large string heap without duplicates: the table
+		 * knows all strings */
+		if ((pos = strdedup_find(h, v, strhash)) != 0)
+			return *dst = (var_t) pos;
+	} else if (*bucket) {
 		/* the hash list is not empty */
 		if (*bucket < GDK_ELIMLIMIT) {
 			/* small string heap (<64KiB) -- fully double
@@ -336,6 +514,9 @@ strPut(BAT *b, var_t *dst, const void *V)
 	}
 	*bucket = (stridx_t) pos;	/* set bucket to the new string */
 
+	if (h->dedup)
+		(void) strdedup_add(h, *dst, strhash);
+
 	return *dst;
 }
 
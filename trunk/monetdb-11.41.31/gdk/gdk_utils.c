@@ -66,6 +66,9 @@ BUN HASH_DESTROY_UNIQUES_FRACTION = 1000;     /* likewise */
 /* if the estimated number of unique values is less than 1 in this
  * number, don't build a hash table to do a hashselect */
 dbl NO_HASH_SELECT_FRACTION = 1000;           /* same here */
+/* maximum number of distinct strings for which we keep large string
+ * heaps free of duplicates (0: don't) */
+BUN GDK_STRING_DEDUP_LIMIT = 0;
 
 /*
  * @+ Monet configuration file
@@ -1169,6 +1172,8 @@ GDKinit(opt *set, int setlen, bool embedded)
 		NO_HASH_SELECT_FRACTION = (dbl) strtoll(p, NULL, 10);
 	if (NO_HASH_SELECT_FRACTION == 0)
 		NO_HASH_SELECT_FRACTION = (dbl) GDK_UNIQUE_ESTIMATE_KEEP_FRACTION;
+	if ((p = GDKgetenv("gdk_string_dedup_limit")) != NULL)
+		GDK_STRING_DEDUP_LIMIT = (BUN) strtoll(p, NULL, 10);
 
 	return GDK_SUCCEED;
 }
@@ -1717,6 +1722,122 @@ THRhighwater(void)
 	return rc;
 }
 
+/*
+ * Run ntasks independent tasks, numbered 0 to ntasks-1, using (at
+ * most) nthreads threads, including the calling thread.  Tasks are
+ * handed out dynamically, so uneven tasks are balanced over the
+ * threads.  After the first failing task no new tasks are started,
+ * and the error message of the failing task is passed on to the
+ * error buffer of the calling thread.
+ * The number of helper threads of all calls together is limited to
+ * GDKnr_threads - 1, so that nested or concurrent calls don't multiply
+ * the number of threads; a call that finds no helpers available runs
+ * all its tasks in the calling thread.
+ */
+static ATOMIC_TYPE GDKparhelpers = ATOMIC_VAR_INIT(0);
+
+struct GDKpartask {
+	gdk_return (*func)(void *, size_t);
+	void *arg;
+	size_t ntasks;
+	ATOMIC_TYPE next;
+	ATOMIC_TYPE failed;
+	char errbuf[GDKMAXERRLEN];
+};
+
+static void
+GDKparworker(void *a)
+{
+	struct GDKpartask *t = a;
+	char errbuf[GDKMAXERRLEN];
+	bool own = GDKerrbuf == NULL;
+	size_t i;
+
+	if (own) {
+		errbuf[0] = 0;
+		GDKsetbuf(errbuf);
+	}
+	while (ATOMIC_GET(&t->failed) == 0 &&
+	       (i = (size_t) ATOMIC_INC(&t->next) - 1) < t->ntasks) {
+		if ((*t->func)(t->arg, i) != GDK_SUCCEED) {
+			ATOMIC_BASE_TYPE expected = 0;
+			if (ATOMIC_CAS(&t->failed, &expected, 1) && own)
+				strcpy_len(t->errbuf, errbuf, sizeof(t->errbuf));
+			break;
+		}
+	}
+	if (own)
+		GDKsetbuf(NULL);
+}
+
+gdk_return
+GDKparallel(gdk_return (*func)(void *, size_t), void *arg, size_t ntasks,
+	    int nthreads, const char *name)
+{
+	struct GDKpartask *t;
+	MT_Id *tids = NULL;
+	int n = 0, nhelpers;
+	ATOMIC_BASE_TYPE busy;
+	gdk_return rc = GDK_SUCCEED;
+
+	if ((t = GDKmalloc(sizeof(*t))) == NULL)
+		return GDK_FAIL;
+	*t = (struct GDKpartask) {
+		.func = func,
+		.arg = arg,
+		.ntasks = ntasks,
+	};
+	ATOMIC_INIT(&t->next, 0);
+	ATOMIC_INIT(&t->failed, 0);
+	if ((size_t) nthreads > ntasks)
+		nthreads = (int) ntasks;
+	/* reserve helper threads */
+	busy = ATOMIC_GET(&GDKparhelpers);
+	do {
+		nhelpers = nthreads - 1;
+		if (nhelpers > GDKnr_threads - 1 - (int) busy)
+			nhelpers = GDKnr_threads - 1 - (int) busy;
+	} while (nhelpers > 0 &&
+		 !ATOMIC_CAS(&GDKparhelpers, &busy, busy + nhelpers));
+	if (nhelpers > 0 &&
+	    (tids = GDKmalloc(nhelpers * sizeof(MT_Id))) != NULL) {
+		for (n = 0; n < nhelpers; n++) {
+			char tname[MT_NAME_LEN];
+			snprintf(tname, sizeof(tname), "%s%d", name, n);
+			/* if we can't start a thread, we just make do
+			 * with fewer */
+			if ((tids[n] = THRcreate(GDKparworker, t,
+						 MT_THR_JOINABLE,
+						 tname)) == 0) {
+				GDKclrerr();
+				break;
+			}
+		}
+	}
+	/* give back the helpers we didn't start */
+	if (nhelpers > n)
+		(void) ATOMIC_SUB(&GDKparhelpers, nhelpers - n);
+	GDKparworker(t);
+	nhelpers = n;		/* the helpers we did start */
+	while (n > 0)
+		MT_join_thread(tids[--n]);
+	GDKfree(tids);
+	if (nhelpers > 0)
+		(void) ATOMIC_SUB(&GDKparhelpers, nhelpers);
+	if (ATOMIC_GET(&t->failed)) {
+		char *buf = GDKerrbuf;
+		if (buf && t->errbuf[0]) {
+			size_t len = strlen(buf);
+			strcpy_len(buf + len, t->errbuf, GDKMAXERRLEN - len);
+		}
+		rc = GDK_FAIL;
+	}
+	ATOMIC_DESTROY(&t->next);
+	ATOMIC_DESTROY(&t->failed);
+	GDKfree(t);
+	return rc;
+}
+
 /*
  * I/O is organized per thread, because users may gain access through
  * the network.  The code below should be improved to gain speed.
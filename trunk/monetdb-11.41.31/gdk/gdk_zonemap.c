@@ -0,0 +1,573 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 1997 - July 2008 CWI, August 2008 - 2021 MonetDB B.V.
+ */
+
+/*
+ * Implementation of zone maps.
+ *
+ * A zone map divides a fixed-size numeric column into blocks of
+ * ZM_BLOCKSIZE consecutive values and records for each block the
+ * smallest and largest non-nil value, and an upper bound on the
+ * number of nils.  BATselect uses the zone map of a persistent column
+ * to skip blocks that cannot contain qualifying values and to accept
+ * blocks of which all values qualify without looking at the data.
+ *
+ * Zone maps are created the first time a range select is done on a
+ * large enough persistent BAT and then kept up to date: appends
+ * extend the zone map and in-place replacements widen the min/max of
+ * the affected block.  Only deletions (which move values around)
+ * destroy the zone map.
+ *
+ * On disk, the zone map is stored in a file with extension .tzonemap.
+ * The file consists of a header of ZMHEADER oids:
+ * - hdata[0] = ZONEMAP_VERSION, with bit 24 set when the file is
+ *   complete; this bit is written last;
+ * - hdata[1] = the number of rows covered, which must be equal to
+ *   BATcount(b) for the file to be usable;
+ * - hdata[2] = the storage type of the column;
+ * followed by the array of block minima, the array of block maxima
+ * (both in the column's type) and the array of nil counts (BUN).
+ * The file is removed as soon as the in-memory copy is changed and
+ * written again when the BAT itself is saved.
+ */
+
+#include "monetdb_config.h"
+#include "gdk.h"
+#include "gdk_private.h"
+
+#define ZONEMAP_VERSION	((oid) 1)
+#define ZMHEADER	3
+
+/* return the storage type for which we can maintain a zone map, or
+ * TYPE_void if we can't */
+static int
+zonemappable(int tpe)
+{
+	if (ATOMtype(tpe) == TYPE_oid)
+		return TYPE_void;
+	switch (ATOMbasetype(tpe)) {
+	case TYPE_bte:
+	case TYPE_sht:
+	case TYPE_int:
+	case TYPE_lng:
+#ifdef HAVE_HGE
+	case TYPE_hge:
+#endif
+	case TYPE_flt:
+	case TYPE_dbl:
+		return ATOMbasetype(tpe);
+	default:
+		return TYPE_void;
+	}
+}
+
+static void
+ZMfree_struct(ZoneMap *zm)
+{
+	if (zm) {
+		GDKfree(zm->mins);
+		GDKfree(zm->maxs);
+		GDKfree(zm->nils);
+		GDKfree(zm);
+	}
+}
+
+/* make sure there is space for nblocks blocks */
+static gdk_return
+ZMresize(ZoneMap *zm, BUN nblocks)
+{
+	if (nblocks <= zm->size)
+		return GDK_SUCCEED;
+	BUN size = zm->size == 0 ? nblocks : MAX(nblocks, zm->size + zm->size / 2);
+	char *mins, *maxs;
+	BUN *nils;
+
+	if ((mins = GDKrealloc(zm->mins, size * zm->width)) == NULL)
+		return GDK_FAIL;
+	zm->mins = mins;
+	if ((maxs = GDKrealloc(zm->maxs, size * zm->width)) == NULL)
+		return GDK_FAIL;
+	zm->maxs = maxs;
+	if ((nils = GDKrealloc(zm->nils, size * sizeof(BUN))) == NULL)
+		return GDK_FAIL;
+	zm->nils = nils;
+	zm->size = size;
+	return GDK_SUCCEED;
+}
+
+static ZoneMap *
+ZMnew(int tpe)
+{
+	ZoneMap *zm;
+
+	if ((zm = GDKzalloc(sizeof(ZoneMap))) == NULL)
+		return NULL;
+	zm->type = tpe;
+	zm->width = (uint16_t) ATOMsize(tpe);
+	return zm;
+}
+
+/* summarize the values with (tail) index [lo, hi) in the appropriate
+ * blocks; a new block starts out empty, i.e. with min > max */
+#define ZMUPDATE(TYPE)							\
+	do {								\
+		const TYPE *restrict src = (const TYPE *) bi->base;	\
+		TYPE *restrict mins = (TYPE *) zm->mins;		\
+		TYPE *restrict maxs = (TYPE *) zm->maxs;		\
+		for (BUN k = first; k < nblocks; k++) {			\
+			mins[k] = GDK_##TYPE##_max;			\
+			maxs[k] = GDK_##TYPE##_min;			\
+			zm->nils[k] = 0;				\
+		}							\
+		for (BUN p = lo; p < hi; p++) {				\
+			const TYPE v = src[p];				\
+			const BUN k = p >> ZM_SHIFT;			\
+			if (is_##TYPE##_nil(v)) {			\
+				zm->nils[k]++;				\
+			} else {					\
+				if (v < mins[k])			\
+					mins[k] = v;			\
+				if (v > maxs[k])			\
+					maxs[k] = v;			\
+			}						\
+		}							\
+	} while (0)
+
+/* update the zone map for the values with index [lo, hi) of the BAT
+ * bi iterates over; if lo == zm->count, the zone map is extended; the
+ * caller holds b->batIdxLock */
+static gdk_return
+ZMupdate(const BATiter *bi, ZoneMap *zm, BUN lo, BUN hi)
+{
+	BUN first, nblocks;
+
+	assert(lo <= hi);
+	assert(hi <= bi->count);
+	if (lo == hi)
+		return GDK_SUCCEED;
+	nblocks = ((hi - 1) >> ZM_SHIFT) + 1;
+	if (ZMresize(zm, nblocks) != GDK_SUCCEED)
+		return GDK_FAIL;
+	/* blocks that we haven't seen yet must be initialized */
+	first = zm->nblocks;
+	if (nblocks < first)
+		nblocks = first;
+	switch (zm->type) {
+	case TYPE_bte:
+		ZMUPDATE(bte);
+		break;
+	case TYPE_sht:
+		ZMUPDATE(sht);
+		break;
+	case TYPE_int:
+		ZMUPDATE(int);
+		break;
+	case TYPE_lng:
+		ZMUPDATE(lng);
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		ZMUPDATE(hge);
+		break;
+#endif
+	case TYPE_flt:
+		ZMUPDATE(flt);
+		break;
+	case TYPE_dbl:
+		ZMUPDATE(dbl);
+		break;
+	default:
+		assert(0);
+		return GDK_FAIL;
+	}
+	zm->nblocks = nblocks;
+	if (hi > zm->count)
+		zm->count = hi;
+	zm->dirty = true;
+	return GDK_SUCCEED;
+}
+
+/* remove the on-disk copy of the zone map (if any) since we're about
+ * to change the in-memory copy */
+static void
+ZMunpersist(BAT *b, ZoneMap *zm)
+{
+	if (zm->ondisk) {
+		GDKunlink(BBPselectfarm(b->batRole, b->ttype, zonemapheap),
+			  BATDIR, BBP_physical(b->batCacheid), "tzonemap");
+		zm->ondisk = false;
+	}
+}
+
+/* write the zone map to disk; the caller holds b->batIdxLock */
+static void
+ZMpersist(BAT *b, ZoneMap *zm, bool dosync)
+{
+	const char *nme = BBP_physical(b->batCacheid);
+	const char *failed = " failed";
+	int farmid, fd;
+	lng t0 = GDKusec();
+
+	if (GDKinmemory(b->theap->farmid) ||
+	    (farmid = BBPselectfarm(b->batRole, b->ttype, zonemapheap)) < 0)
+		return;
+	ZMunpersist(b, zm);
+	if ((fd = GDKfdlocate(farmid, nme, "wb", "tzonemap")) < 0) {
+		GDKclrerr();
+		return;
+	}
+	oid hdata[ZMHEADER] = {
+		ZONEMAP_VERSION,
+		(oid) zm->count,
+		(oid) zm->type,
+	};
+	size_t vsize = zm->nblocks * zm->width;
+	size_t nsize = zm->nblocks * sizeof(BUN);
+	if (write(fd, hdata, sizeof(hdata)) == (ssize_t) sizeof(hdata) &&
+	    write(fd, zm->mins, vsize) == (ssize_t) vsize &&
+	    write(fd, zm->maxs, vsize) == (ssize_t) vsize &&
+	    write(fd, zm->nils, nsize) == (ssize_t) nsize) {
+		if (dosync && !(GDKdebug & NOSYNCMASK)) {
+#if defined(NATIVE_WIN32)
+			_commit(fd);
+#elif defined(HAVE_FDATASYNC)
+			fdatasync(fd);
+#elif defined(HAVE_FSYNC)
+			fsync(fd);
+#endif
+		}
+		/* the file is complete, now set the persisted bit */
+		hdata[0] |= (oid) 1 << 24;
+		if (lseek(fd, 0, SEEK_SET) == 0 &&
+		    write(fd, hdata, SIZEOF_OID) == SIZEOF_OID) {
+			if (dosync && !(GDKdebug & NOSYNCMASK)) {
+#if defined(NATIVE_WIN32)
+				_commit(fd);
+#elif defined(HAVE_FDATASYNC)
+				fdatasync(fd);
+#elif defined(HAVE_FSYNC)
+				fsync(fd);
+#endif
+			}
+			zm->ondisk = true;
+			zm->dirty = false;
+			failed = "";
+		}
+	}
+	close(fd);
+	if (!zm->ondisk)
+		GDKunlink(farmid, BATDIR, nme, "tzonemap");
+	TRC_DEBUG(ACCELERATOR, "ZMpersist(" ALGOBATFMT "): zone map persisted"
+		  " (" LLFMT " usec)%s\n",
+		  ALGOBATPAR(b), GDKusec() - t0, failed);
+}
+
+/* load the zone map from disk if one was found by BBPdiskscan; the
+ * caller holds b->batIdxLock */
+static void
+ZMload(BAT *b)
+{
+	const char *nme = BBP_physical(b->batCacheid);
+	int farmid, fd, tpe;
+	ZoneMap *zm = NULL;
+
+	assert(b->tzonemap == (ZoneMap *) 1);
+	b->tzonemap = NULL;
+	if ((tpe = zonemappable(b->ttype)) == TYPE_void ||
+	    (farmid = BBPselectfarm(b->batRole, b->ttype, zonemapheap)) < 0)
+		return;
+	if ((fd = GDKfdlocate(farmid, nme, "rb", "tzonemap")) >= 0) {
+		struct stat st;
+		oid hdata[ZMHEADER];
+		BUN nblocks = (BATcount(b) + ZM_BLOCKSIZE - 1) >> ZM_SHIFT;
+
+		if (read(fd, hdata, sizeof(hdata)) == (ssize_t) sizeof(hdata) &&
+		    hdata[0] == (((oid) 1 << 24) | ZONEMAP_VERSION) &&
+		    hdata[1] == (oid) BATcount(b) &&
+		    hdata[2] == (oid) tpe &&
+		    fstat(fd, &st) == 0 &&
+		    (zm = ZMnew(tpe)) != NULL &&
+		    st.st_size == (off_t) (sizeof(hdata) + nblocks * (2 * zm->width + sizeof(BUN))) &&
+		    ZMresize(zm, nblocks) == GDK_SUCCEED &&
+		    read(fd, zm->mins, nblocks * zm->width) == (ssize_t) (nblocks * zm->width) &&
+		    read(fd, zm->maxs, nblocks * zm->width) == (ssize_t) (nblocks * zm->width) &&
+		    read(fd, zm->nils, nblocks * sizeof(BUN)) == (ssize_t) (nblocks * sizeof(BUN))) {
+			close(fd);
+			zm->count = BATcount(b);
+			zm->nblocks = nblocks;
+			zm->ondisk = true;
+			b->tzonemap = zm;
+			TRC_DEBUG(ACCELERATOR, "BATcheckzonemap(" ALGOBATFMT "): reusing persisted zone map\n", ALGOBATPAR(b));
+			return;
+		}
+		close(fd);
+		ZMfree_struct(zm);
+		/* unlink unusable file */
+		GDKunlink(farmid, BATDIR, nme, "tzonemap");
+	}
+	GDKclrerr();	/* we're not currently interested in errors */
+}
+
+/* return true if we have a zone map on the tail, even if we need to
+ * read one from disk */
+bool
+BATcheckzonemap(BAT *b)
+{
+	bool ret;
+
+	if (b == NULL)
+		return false;
+	/* we don't need the lock just to read the value b->tzonemap */
+	if (b->tzonemap == (ZoneMap *) 1) {
+		/* but when we want to change it, we need the lock */
+		assert(!GDKinmemory(b->theap->farmid));
+		MT_lock_set(&b->batIdxLock);
+		if (b->tzonemap == (ZoneMap *) 1)
+			ZMload(b);
+		MT_lock_unset(&b->batIdxLock);
+	}
+	ret = b->tzonemap != NULL;
+	return ret;
+}
+
+/* create a zone map for b; b must not be a view */
+gdk_return
+BATzonemap(BAT *b)
+{
+	ZoneMap *zm;
+	int tpe;
+	lng t0 = GDKusec();
+
+	BATcheck(b, GDK_FAIL);
+	assert(!isVIEW(b));
+	if (BATcheckzonemap(b))
+		return GDK_SUCCEED;
+	if ((tpe = zonemappable(b->ttype)) == TYPE_void) {
+		GDKerror("unsupported type %s\n", ATOMname(b->ttype));
+		return GDK_FAIL;
+	}
+	BATiter bi = bat_iterator(b);
+	MT_lock_set(&b->batIdxLock);
+	if (b->tzonemap == NULL) {
+		MT_thread_setalgorithm("create zone map");
+		if ((zm = ZMnew(tpe)) == NULL ||
+		    ZMupdate(&bi, zm, 0, bi.count) != GDK_SUCCEED) {
+			ZMfree_struct(zm);
+			MT_lock_unset(&b->batIdxLock);
+			bat_iterator_end(&bi);
+			return GDK_FAIL;
+		}
+		b->tzonemap = zm;
+		TRC_DEBUG(ACCELERATOR, "BATzonemap(" ALGOBATFMT "): %zu blocks"
+			  " (" LLFMT " usec)\n",
+			  ALGOBATPAR(b), (size_t) zm->nblocks, GDKusec() - t0);
+		/* if the BAT is committed and saved, we can save the
+		 * zone map as well */
+		if ((BBP_status(b->batCacheid) & BBPEXISTING) &&
+		    b->batInserted == bi.count &&
+		    !bi.h->dirty)
+			ZMpersist(b, zm, true);
+	}
+	MT_lock_unset(&b->batIdxLock);
+	bat_iterator_end(&bi);
+	return GDK_SUCCEED;
+}
+
+/* extend the zone map of b (if any) to cover values appended to b */
+void
+ZMappend(BAT *b)
+{
+	ZoneMap *zm;
+
+	if (b->tzonemap == NULL)
+		return;
+	BATiter bi = bat_iterator(b);
+	MT_lock_set(&b->batIdxLock);
+	if ((zm = b->tzonemap) == (ZoneMap *) 1) {
+		/* only happens if the caller didn't load the zone map
+		 * before appending: the persisted one is stale */
+		MT_lock_unset(&b->batIdxLock);
+		bat_iterator_end(&bi);
+		ZMdestroy(b);
+		return;
+	}
+	if (zm != NULL && zm->count < bi.count) {
+		ZMunpersist(b, zm);
+		if (ZMupdate(&bi, zm, zm->count, bi.count) != GDK_SUCCEED) {
+			b->tzonemap = NULL;
+			ZMfree_struct(zm);
+			GDKclrerr();
+		}
+	}
+	MT_lock_unset(&b->batIdxLock);
+	bat_iterator_end(&bi);
+}
+
+/* widen the zone map of b (if any) to include the values at index [p,
+ * p + cnt) which have just been replaced */
+void
+ZMreplace(BAT *b, BUN p, BUN cnt)
+{
+	ZoneMap *zm;
+
+	if (b->tzonemap == NULL)
+		return;
+	BATiter bi = bat_iterator(b);
+	MT_lock_set(&b->batIdxLock);
+	if ((zm = b->tzonemap) == (ZoneMap *) 1) {
+		MT_lock_unset(&b->batIdxLock);
+		bat_iterator_end(&bi);
+		ZMdestroy(b);
+		return;
+	}
+	if (zm != NULL) {
+		/* values beyond the end of the zone map will be
+		 * looked at by ZMappend */
+		if (p + cnt > zm->count)
+			cnt = p < zm->count ? zm->count - p : 0;
+		if (cnt > 0) {
+			ZMunpersist(b, zm);
+			if (ZMupdate(&bi, zm, p, p + cnt) != GDK_SUCCEED) {
+				b->tzonemap = NULL;
+				ZMfree_struct(zm);
+				GDKclrerr();
+			}
+		}
+	}
+	MT_lock_unset(&b->batIdxLock);
+	bat_iterator_end(&bi);
+}
+
+/* classify the blocks of b's zone map with respect to the closed
+ * range [*tl, *th] (or its complement if anti is set, or nil if nilsel
+ * is set); tl and th must have been normalized by BATselect, count is
+ * the number of values of b the caller is going to look at; returns
+ * an array of ZM_SKIP/ZM_ALL/ZM_SCAN values of which the number of
+ * entries is returned in *nblocks, or NULL if there is no zone map;
+ * values beyond the last block must be scanned */
+uint8_t *
+ZMclassify(BAT *b, const void *tl, const void *th, bool anti, bool nilsel, BUN count, BUN *nblocks)
+{
+	ZoneMap *zm;
+	uint8_t *cls = NULL;
+
+	if (!BATcheckzonemap(b))
+		return NULL;
+	MT_lock_set(&b->batIdxLock);
+	if ((zm = b->tzonemap) != NULL &&
+	    (cls = GDKmalloc(zm->nblocks)) != NULL) {
+		*nblocks = zm->nblocks;
+		switch (zm->type) {
+#define ZMCLASSIFY(TYPE)						\
+		do {							\
+			const TYPE vl = *(const TYPE *) tl;		\
+			const TYPE vh = *(const TYPE *) th;		\
+			const TYPE *restrict mins = (const TYPE *) zm->mins; \
+			const TYPE *restrict maxs = (const TYPE *) zm->maxs; \
+			for (BUN k = 0; k < zm->nblocks; k++) {		\
+				const TYPE mn = mins[k], mx = maxs[k];	\
+				if (nilsel)				\
+					cls[k] = zm->nils[k] == 0 ? ZM_SKIP : ZM_SCAN; \
+				else if (mn > mx)			\
+					cls[k] = ZM_SKIP; /* only nils */ \
+				else if (anti)				\
+					cls[k] = vl < mn && mx < vh ? ZM_SKIP : \
+						(mx <= vl || mn >= vh) && zm->nils[k] == 0 ? ZM_ALL : ZM_SCAN; \
+				else					\
+					cls[k] = mx < vl || mn > vh ? ZM_SKIP : \
+						vl <= mn && mx <= vh && zm->nils[k] == 0 ? ZM_ALL : ZM_SCAN; \
+			}						\
+		} while (0)
+		case TYPE_bte:
+			ZMCLASSIFY(bte);
+			break;
+		case TYPE_sht:
+			ZMCLASSIFY(sht);
+			break;
+		case TYPE_int:
+			ZMCLASSIFY(int);
+			break;
+		case TYPE_lng:
+			ZMCLASSIFY(lng);
+			break;
+#ifdef HAVE_HGE
+		case TYPE_hge:
+			ZMCLASSIFY(hge);
+			break;
+#endif
+		case TYPE_flt:
+			ZMCLASSIFY(flt);
+			break;
+		case TYPE_dbl:
+			ZMCLASSIFY(dbl);
+			break;
+		default:
+			assert(0);
+			break;
+		}
+		/* the last block may contain values appended after
+		 * the zone map was last extended */
+		if (zm->nblocks > 0 && count > zm->count)
+			cls[zm->nblocks - 1] = ZM_SCAN;
+	}
+	MT_lock_unset(&b->batIdxLock);
+	return cls;
+}
+
+/* save the zone map if it covers the first size values of b which
+ * have just been saved */
+void
+ZMsave(BAT *b, BUN size, bool dosync)
+{
+	ZoneMap *zm;
+
+	if (b->tzonemap == NULL || b->tzonemap == (ZoneMap *) 1)
+		return;
+	MT_lock_set(&b->batIdxLock);
+	if ((zm = b->tzonemap) != NULL && zm != (ZoneMap *) 1 &&
+	    zm->dirty && zm->count == size)
+		ZMpersist(b, zm, dosync);
+	MT_lock_unset(&b->batIdxLock);
+}
+
+/* free the in-memory copy of the zone map, keeping the persisted copy */
+void
+ZMfree(BAT *b)
+{
+	ZoneMap *zm;
+
+	if (b && b->tzonemap) {
+		MT_lock_set(&b->batIdxLock);
+		if ((zm = b->tzonemap) != NULL && zm != (ZoneMap *) 1) {
+			b->tzonemap = zm->ondisk && !GDKinmemory(b->theap->farmid) ? (ZoneMap *) 1 : NULL;
+			ZMfree_struct(zm);
+		}
+		MT_lock_unset(&b->batIdxLock);
+	}
+}
+
+/* remove the zone map, both from memory and from disk */
+void
+ZMdestroy(BAT *b)
+{
+	ZoneMap *zm;
+
+	if (b && b->tzonemap) {
+		MT_lock_set(&b->batIdxLock);
+		zm = b->tzonemap;
+		b->tzonemap = NULL;
+		MT_lock_unset(&b->batIdxLock);
+		if (zm == (ZoneMap *) 1 || (zm != NULL && zm->ondisk)) {
+			GDKunlink(BBPselectfarm(b->batRole, b->ttype, zonemapheap),
+				  BATDIR,
+				  BBP_physical(b->batCacheid),
+				  "tzonemap");
+		}
+		if (zm != (ZoneMap *) 1)
+			ZMfree_struct(zm);
+	}
+}
@@ -49,12 +49,12 @@ typedef struct FLOWEVENT {
 	lng hotclaim;   /* memory foot print of result variables */
 	lng argclaim;   /* memory foot print of arguments */
 	lng maxclaim;   /* memory foot print of  largest argument, counld be used to indicate result size */
+	int worker;     /* slot of the worker that executed it */
 } *FlowEvent, FlowEventRec;
 
 typedef struct queue {
 	int size;	/* size of queue */
 	int last;	/* last element in the queue */
-	int exitcount;	/* how many threads should exit */
 	FlowEvent *data;
 	MT_Lock l;	/* it's a shared resource, ie we need locks */
 	MT_Sema s;	/* threads wait on empty queues */
@@ -76,33 +76,73 @@ typedef struct DATAFLOW {
 	int *edges;         /* dependency graph */
 	MT_Lock flowlock;   /* lock to protect the above */
 	Queue *done;        /* instructions handled */
+	ATOMIC_TYPE running;	/* instructions currently being executed */
 } *DataFlow, DataFlowRec;
 
+/*
+ * The pending instructions are kept in a deque per worker, plus one
+ * deque for the instructions with which a new flow starts.  A worker
+ * takes the most recently added entry from its own deque (LIFO favors
+ * garbage collection), and when that is empty, takes the oldest
+ * entries of the other deques (work stealing).  When an instruction
+ * is finished, the instructions that become eligible are added to the
+ * deque of the worker that executed it, so that they are likely
+ * executed by the thread that has their input in its caches.
+ * Each deque has its own lock, so workers normally only contend with
+ * the scheduler of the flow they are working on.
+ */
+typedef struct deque {
+	MT_Lock l;
+	int size;	/* allocated size of data (power of 2) */
+	int first;	/* index of the oldest entry */
+	int cnt;	/* number of entries */
+	FlowEvent *data;
+} Deque;
+
+#define DQ_ENTRY(d, i)	((d)->data[((d)->first + (i)) & ((d)->size - 1)])
+
+#define DFLOWshared	THREADS	/* deque for the start of new flows */
+#define DFLOWstealscan	8	/* entries considered when stealing */
+#define DFLOWlocalmax	16	/* local runs before looking at new flows */
+
+typedef struct todo {
+	MT_Sema s;		/* threads wait on empty queues */
+	ATOMIC_TYPE pending;	/* number of queued instructions */
+	ATOMIC_TYPE exitcount;	/* how many threads should exit */
+	ATOMIC_TYPE nslots;	/* highest worker slot in use + 1 */
+	Deque q[THREADS + 1];	/* one per worker, plus DFLOWshared */
+} Todo;
+
 static struct worker {
 	MT_Id id;
 	enum {IDLE, RUNNING, JOINING, EXITED} flag;
 	ATOMIC_PTR_TYPE cntxt; /* client we do work for (NULL -> any) */
 	char *errbuf;		   /* GDKerrbuf so that we can allocate before fork */
 	MT_Sema s;
+	int localrun;		   /* consecutive entries taken from own deque */
+	/* counters, only updated by the worker itself */
+	lng executed;		   /* instructions executed */
+	lng chained;		   /* ... of which directly continued */
+	lng local;			   /* entries taken from own deque */
+	lng shared;			   /* entries taken from the new flows deque */
+	lng stolen;			   /* entries taken from other deques */
+	lng idle;			   /* scans that found nothing */
 } workers[THREADS];
 
-static Queue *todo = 0;	/* pending instructions */
+static Todo *todo = 0;	/* pending instructions */
 
 static ATOMIC_TYPE exiting = ATOMIC_VAR_INIT(0);
 static MT_Lock dataflowLock = MT_LOCK_INITIALIZER(dataflowLock);
 static void stopMALdataflow(void);
+static void todo_destroy(Todo *t);
 
 void
 mal_dataflow_reset(void)
 {
 	stopMALdataflow();
 	memset((char*) workers, 0,  sizeof(workers));
-	if( todo) {
-		GDKfree(todo->data);
-		MT_lock_destroy(&todo->l);
-		MT_sema_destroy(&todo->s);
-		GDKfree(todo);
-	}
+	if( todo)
+		todo_destroy(todo);
 	todo = 0;	/* pending instructions */
 	ATOMIC_SET(&exiting, 0);
 }
@@ -158,149 +198,235 @@ q_destroy(Queue *q)
 	GDKfree(q);
 }
 
-/* keep a simple LIFO queue. It won't be a large one, so shuffles of requeue is possible */
-/* we might actually sort it for better scheduling behavior */
+/* the flow->done queue is a simple FIFO queue */
 static void
-q_enqueue_(Queue *q, FlowEvent d)
+q_enqueue(Queue *q, FlowEvent d)
 {
 	assert(q);
 	assert(d);
+	MT_lock_set(&q->l);
 	if (q->last == q->size) {
 		q->size <<= 1;
 		q->data = (FlowEvent*) GDKrealloc(q->data, sizeof(FlowEvent) * q->size);
 		assert(q->data);
 	}
 	q->data[q->last++] = d;
+	MT_lock_unset(&q->l);
+	MT_sema_up(&q->s);
 }
-static void
-q_enqueue(Queue *q, FlowEvent d)
+
+static FlowEvent
+q_dequeue(Queue *q)
 {
+	FlowEvent r = NULL;
+
 	assert(q);
-	assert(d);
+	MT_sema_down(&q->s);
+	if (ATOMIC_GET(&exiting))
+		return NULL;
 	MT_lock_set(&q->l);
-	q_enqueue_(q, d);
+	assert(q->last > 0);
+	if (q->last > 0) {
+		r = q->data[--q->last];
+		q->data[q->last] = 0;
+	}
 	MT_lock_unset(&q->l);
-	MT_sema_up(&q->s);
+	assert(r);
+	return r;
 }
 
-/*
- * A priority queue over the hot claims of memory may
- * be more effective. It priorizes those instructions
- * that want to use a big recent result
- */
+static Todo *
+todo_create(void)
+{
+	Todo *t = (Todo*)GDKzalloc(sizeof(Todo));
+
+	if (t == NULL)
+		return NULL;
+	for (int i = 0; i <= THREADS; i++) {
+		char name[MT_NAME_LEN];
+		snprintf(name, sizeof(name), "todo%d", i);
+		MT_lock_init(&t->q[i].l, name);
+	}
+	ATOMIC_INIT(&t->pending, 0);
+	ATOMIC_INIT(&t->exitcount, 0);
+	ATOMIC_INIT(&t->nslots, 0);
+	MT_sema_init(&t->s, 0, "todo");
+	return t;
+}
 
 static void
-q_requeue_(Queue *q, FlowEvent d)
+todo_destroy(Todo *t)
 {
-	int i;
-
-	assert(q);
-	assert(d);
-	if (q->last == q->size) {
-		/* enlarge buffer */
-		q->size <<= 1;
-		q->data = (FlowEvent*) GDKrealloc(q->data, sizeof(FlowEvent) * q->size);
-		assert(q->data);
+	assert(t);
+	for (int i = 0; i <= THREADS; i++) {
+		MT_lock_destroy(&t->q[i].l);
+		GDKfree(t->q[i].data);
 	}
-	for (i = q->last; i > 0; i--)
-		q->data[i] = q->data[i - 1];
-	q->data[0] = d;
-	q->last++;
+	ATOMIC_DESTROY(&t->pending);
+	ATOMIC_DESTROY(&t->exitcount);
+	ATOMIC_DESTROY(&t->nslots);
+	MT_sema_destroy(&t->s);
+	GDKfree(t);
 }
+
+/* worker slot i is (or may be) in use */
 static void
-q_requeue(Queue *q, FlowEvent d)
+todo_addslot(int i)
 {
-	assert(q);
+	if ((int) ATOMIC_GET(&todo->nslots) <= i)
+		ATOMIC_SET(&todo->nslots, i + 1);
+}
+
+/* Add an instruction to deque w, either as most recent entry (to be
+ * taken next by its owner), or, when it is requeued because it could
+ * not be run yet, as oldest entry. */
+static void
+dq_enqueue(int w, FlowEvent d, bool requeue)
+{
+	Deque *q = &todo->q[w];
+
 	assert(d);
 	MT_lock_set(&q->l);
-	q_requeue_(q, d);
+	if (q->cnt == q->size) {
+		/* enlarge buffer, keeping the entries in order */
+		int size = q->size ? q->size << 1 : 64;
+		FlowEvent *data = (FlowEvent*) GDKmalloc(sizeof(FlowEvent) * size);
+		assert(data);
+		for (int i = 0; i < q->cnt; i++)
+			data[i] = DQ_ENTRY(q, i);
+		GDKfree(q->data);
+		q->data = data;
+		q->size = size;
+		q->first = 0;
+	}
+	if (requeue) {
+		q->first = (q->first - 1) & (q->size - 1);
+		q->data[q->first] = d;
+	} else {
+		DQ_ENTRY(q, q->cnt) = d;
+	}
+	q->cnt++;
 	MT_lock_unset(&q->l);
-	MT_sema_up(&q->s);
+	(void) ATOMIC_INC(&todo->pending);
+	MT_sema_up(&todo->s);
 }
 
+/* Take an entry from deque w.  A worker working for a specific client
+ * only takes (the oldest) entries of that client.  Otherwise, the
+ * owner takes the most recent entry, whereas thieves take one of the
+ * oldest entries, preferring the flow that currently has the fewest
+ * instructions in execution, so that concurrent queries get a fair
+ * share of the workers. */
 static FlowEvent
-q_dequeue(Queue *q, Client cntxt)
+dq_take(int w, Client cntxt, bool owner)
 {
-	FlowEvent r = NULL, s = NULL;
-	//int i;
+	Deque *q = &todo->q[w];
+	FlowEvent r = NULL;
+	int i, j = -1;
 
-	assert(q);
-	MT_sema_down(&q->s);
-	if (ATOMIC_GET(&exiting))
-		return NULL;
 	MT_lock_set(&q->l);
+	if (q->cnt == 0) {
+		MT_lock_unset(&q->l);
+		return NULL;
+	}
 	if (cntxt) {
-		int i, minpc = -1;
-
-		for (i = q->last - 1; i >= 0; i--) {
-			if (q->data[i]->flow->cntxt == cntxt) {
-				if (q->last > 1024) {
-					/* for long "queues", just grab the first eligible
-					 * entry we encounter */
-					minpc = i;
+		int minpc = -1;
+		for (i = 0; i < q->cnt; i++) {
+			r = DQ_ENTRY(q, i);
+			if (r->flow->cntxt == cntxt && (minpc < 0 || r->pc < minpc)) {
+				minpc = r->pc;
+				j = i;
+				/* for long queues, just grab the first eligible
+				 * entry we encounter */
+				if (q->cnt > 1024)
 					break;
-				}
-				/* for shorter "queues", find the oldest eligible entry */
-				if (minpc < 0) {
-					minpc = i;
-					s = q->data[i];
-				}
-				r = q->data[i];
-				if (s && r && s->pc > r->pc) {
-					minpc = i;
-					s = r;
-				}
 			}
 		}
-		if (minpc >= 0) {
-			r = q->data[minpc];
-			i = minpc;
-			q->last--;
-			memmove(q->data + i, q->data + i + 1, (q->last - i) * sizeof(q->data[0]));
+	} else if (owner) {
+		j = q->cnt - 1;
+	} else {
+		ATOMIC_BASE_TYPE minrun = 0;
+		for (i = 0; i < q->cnt && i < DFLOWstealscan; i++) {
+			ATOMIC_BASE_TYPE run = ATOMIC_GET(&DQ_ENTRY(q, i)->flow->running);
+			if (j < 0 || run < minrun) {
+				minrun = run;
+				j = i;
+			}
 		}
-
-		MT_lock_unset(&q->l);
-		return r;
 	}
-	if (q->exitcount > 0) {
-		q->exitcount--;
+	if (j < 0) {
 		MT_lock_unset(&q->l);
 		return NULL;
 	}
-	assert(q->last > 0);
-	if (q->last > 0) {
-		/* LIFO favors garbage collection */
-		r = q->data[--q->last];
-/*  Line coverage test shows it is an expensive loop that is hardly ever leads to adjustment
-		for(i= q->last-1; r &&  i>=0; i--){
-			s= q->data[i];
-			if( s && s->flow && s->flow->stk &&
-			    r && r->flow && r->flow->stk &&
-			    s->flow->stk->tag < r->flow->stk->tag){
-				q->data[i]= r;
-				r = s;
-			}
-		}
-*/
-		q->data[q->last] = 0;
+	r = DQ_ENTRY(q, j);
+	if (j == 0) {
+		q->first = (q->first + 1) & (q->size - 1);
+	} else {
+		for (i = j + 1; i < q->cnt; i++)
+			DQ_ENTRY(q, i - 1) = DQ_ENTRY(q, i);
 	}
-	/* else: terminating */
-	/* try out random draw *
-	{
-		int i;
-		i = rand() % q->last;
-		r = q->data[i];
-		for (i++; i < q->last; i++)
-			q->data[i - 1] = q->data[i];
-		q->last--; i
-	}
-	 */
-
+	q->cnt--;
 	MT_lock_unset(&q->l);
-	assert(r);
+	(void) ATOMIC_DEC(&todo->pending);
 	return r;
 }
 
+/* Get the next instruction for worker t.  We first look at our own
+ * deque, then at the deque of new flows, and then try to steal from
+ * the other workers.  To make sure new queries are not starved by a
+ * busy one, every so often the deque of new flows is looked at first. */
+static FlowEvent
+dq_dequeue(struct worker *t, Client cntxt)
+{
+	int self = (int) (t - workers);
+	FlowEvent r;
+
+	MT_sema_down(&todo->s);
+	if (ATOMIC_GET(&exiting))
+		return NULL;
+	if (cntxt == NULL) {
+		ATOMIC_BASE_TYPE n = ATOMIC_GET(&todo->exitcount);
+		while (n > 0) {
+			if (ATOMIC_CAS(&todo->exitcount, &n, n - 1))
+				return NULL;
+		}
+	}
+	for (;;) {
+		if (t->localrun >= DFLOWlocalmax) {
+			t->localrun = 0;
+			if ((r = dq_take(DFLOWshared, cntxt, false)) != NULL) {
+				t->shared++;
+				return r;
+			}
+		}
+		if ((r = dq_take(self, cntxt, true)) != NULL) {
+			t->local++;
+			t->localrun++;
+			return r;
+		}
+		t->localrun = 0;
+		if ((r = dq_take(DFLOWshared, cntxt, false)) != NULL) {
+			t->shared++;
+			return r;
+		}
+		int nslots = (int) ATOMIC_GET(&todo->nslots);
+		for (int i = 1; i < nslots; i++) {
+			if ((r = dq_take((self + i) % nslots, cntxt, false)) != NULL) {
+				t->stolen++;
+				return r;
+			}
+		}
+		t->idle++;
+		if (cntxt || ATOMIC_GET(&exiting))
+			return NULL;
+		/* the entry we were woken up for was taken by someone
+		 * else who was woken up for an entry we already passed;
+		 * every down on the semaphore is matched by an entry (or
+		 * an exit request, which we checked), so that entry is
+		 * still there for us: look again */
+	}
+}
+
 /*
  * We simply move an instruction into the front of the queue.
  * Beware, we assume that variables are assigned a value once, otherwise
@@ -348,7 +474,7 @@ DFLOWworker(void *T)
 		if (fnxt == 0) {
 			MT_thread_setworking(NULL);
 			cntxt = ATOMIC_PTR_GET(&t->cntxt);
-			fe = q_dequeue(todo, cntxt);
+			fe = dq_dequeue(t, cntxt);
 			if (fe == NULL) {
 				if (cntxt) {
 					/* we're not done yet with work for the current
@@ -365,8 +491,10 @@ DFLOWworker(void *T)
 			}
 			if (fe->flow->cntxt && fe->flow->cntxt->mythread)
 				MT_thread_setworking(fe->flow->cntxt->mythread->name);
-		} else
+		} else {
 			fe = fnxt;
+			t->chained++;
+		}
 		if (ATOMIC_GET(&exiting)) {
 			break;
 		}
@@ -374,6 +502,7 @@ DFLOWworker(void *T)
 		assert(fe);
 		flow = fe->flow;
 		assert(flow);
+		fe->worker = (int) (t - workers);
 
 		/* whenever we have a (concurrent) error, skip it */
 		if (ATOMIC_PTR_GET(&flow->error)) {
@@ -388,13 +517,16 @@ DFLOWworker(void *T)
 			if( p->fcn != (MALfcn) deblockdataflow){
 				fe->hotclaim = 0;   /* don't assume priority anymore */
 				fe->maxclaim = 0;
-				if (todo->last == 0)
+				if (ATOMIC_GET(&todo->pending) == 0)
 					MT_sleep_ms(DELAYUNIT);
-				q_requeue(todo, fe);
+				dq_enqueue(fe->worker, fe, true);
 				continue;
 			}
 		}
+		(void) ATOMIC_INC(&flow->running);
 		error = runMALsequence(flow->cntxt, flow->mb, fe->pc, fe->pc + 1, flow->stk, 0, 0);
+		(void) ATOMIC_DEC(&flow->running);
+		t->executed++;
 		/* release the memory claim */
 		MALadmission_release(flow->cntxt, flow->mb, flow->stk, p,  claim);
 		/* update the numa information. keep the thread-id producing the value */
@@ -451,11 +583,7 @@ DFLOWworker(void *T)
 
 		q_enqueue(flow->done, fe);
         if ( fnxt == 0 && malProfileMode) {
-            int last;
-            MT_lock_set(&todo->l);
-            last = todo->last;
-            MT_lock_unset(&todo->l);
-            if (last == 0)
+            if (ATOMIC_GET(&todo->pending) == 0)
                 profilerHeartbeatEvent("wait");
         }
 	}
@@ -486,7 +614,7 @@ DFLOWinitialize(void)
 		MT_lock_unset(&mal_contextLock);
 		return 0;
 	}
-	todo = q_create(2048, "todo");
+	todo = todo_create();
 	if (todo == NULL) {
 		MT_lock_unset(&mal_contextLock);
 		return -1;
@@ -518,13 +646,15 @@ DFLOWinitialize(void)
 			GDKfree(workers[i].errbuf);
 			workers[i].errbuf = NULL;
 			workers[i].flag = IDLE;
-		} else
+		} else {
+			todo_addslot(i);
 			created++;
+		}
 	}
 	MT_lock_unset(&dataflowLock);
 	if (created == 0) {
 		/* no threads created */
-		q_destroy(todo);
+		todo_destroy(todo);
 		todo = NULL;
 		MT_lock_unset(&mal_contextLock);
 		return -1;
@@ -700,14 +830,14 @@ DFLOWscheduler(DataFlow flow, struct worker *w)
 			}
 			for (j = p->retc; j < p->argc; j++)
 				fe[i].argclaim = getMemoryClaim(fe[0].flow->mb, fe[0].flow->stk, p, j, FALSE);
-			q_enqueue(todo, flow->status + i);
+			dq_enqueue(DFLOWshared, flow->status + i, false);
 			flow->status[i].state = DFLOWrunning;
 		}
 	MT_lock_unset(&flow->flowlock);
 	MT_sema_up(&w->s);
 
 	while (actions != tasks ) {
-		f = q_dequeue(flow->done, NULL);
+		f = q_dequeue(flow->done);
 		if (ATOMIC_GET(&exiting))
 			break;
 		if (f == NULL)
@@ -727,7 +857,9 @@ DFLOWscheduler(DataFlow flow, struct worker *w)
 				if (flow->status[i].blocks == 1 ) {
 					flow->status[i].state = DFLOWrunning;
 					flow->status[i].blocks--;
-					q_enqueue(todo, flow->status + i);
+					/* keep the follow-up work with the worker
+					 * that produced its input */
+					dq_enqueue(f->worker, flow->status + i, false);
 				} else {
 					flow->status[i].blocks--;
 				}
@@ -848,6 +980,7 @@ runMALdataflow(Client cntxt, MalBlkPtr mb, int startpc, int stoppc, MalStkPtr st
 				MT_lock_unset(&dataflowLock);
 				return MAL_SUCCEED;
 			}
+			todo_addslot(i);
 			break;
 		}
 	}
@@ -901,6 +1034,7 @@ runMALdataflow(Client cntxt, MalBlkPtr mb, int startpc, int stoppc, MalStkPtr st
 	}
 	MT_lock_init(&flow->flowlock, "flow->flowlock");
 	ATOMIC_PTR_INIT(&flow->error, NULL);
+	ATOMIC_INIT(&flow->running, 0);
 	msg = DFLOWinitBlk(flow, mb, size);
 
 	if (msg == MAL_SUCCEED)
@@ -912,12 +1046,11 @@ runMALdataflow(Client cntxt, MalBlkPtr mb, int startpc, int stoppc, MalStkPtr st
 	q_destroy(flow->done);
 	MT_lock_destroy(&flow->flowlock);
 	ATOMIC_PTR_DESTROY(&flow->error);
+	ATOMIC_DESTROY(&flow->running);
 	GDKfree(flow);
 
 	/* we created one worker, now tell one worker to exit again */
-	MT_lock_set(&todo->l);
-	todo->exitcount++;
-	MT_lock_unset(&todo->l);
+	(void) ATOMIC_INC(&todo->exitcount);
 	MT_sema_up(&todo->s);
 
 	return msg;
@@ -934,6 +1067,32 @@ deblockdataflow( Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
     return MAL_SUCCEED;
 }
 
+/* Collect the scheduling counters of the worker slots that have been
+ * used, returning the number of entries filled in. */
+int
+DFLOWstatistics(DFLOWstatsRec *stats, int max)
+{
+	int i, n = 0, nslots;
+
+	MT_lock_set(&dataflowLock);
+	nslots = todo ? (int) ATOMIC_GET(&todo->nslots) : 0;
+	for (i = 0; i < nslots && n < max; i++) {
+		stats[n++] = (DFLOWstatsRec) {
+			.worker = i,
+			.running = workers[i].flag == RUNNING,
+			.specific = ATOMIC_PTR_GET(&workers[i].cntxt) != NULL,
+			.executed = workers[i].executed,
+			.chained = workers[i].chained,
+			.local = workers[i].local,
+			.shared = workers[i].shared,
+			.stolen = workers[i].stolen,
+			.idle = workers[i].idle,
+		};
+	}
+	MT_lock_unset(&dataflowLock);
+	return n;
+}
+
 static void
 stopMALdataflow(void)
 {
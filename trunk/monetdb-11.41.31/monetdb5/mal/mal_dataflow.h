@@ -15,4 +15,19 @@
 mal_export str runMALdataflow(Client cntxt, MalBlkPtr mb, int startpc, int stoppc, MalStkPtr stk);
 mal_export str deblockdataflow(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci);
 
+/* scheduling counters of a dataflow worker (slot) */
+typedef struct {
+	int worker;			/* worker slot */
+	bool running;		/* whether a thread is active in the slot */
+	bool specific;		/* whether it works for a specific client */
+	lng executed;		/* instructions executed */
+	lng chained;		/* ... directly continuing the previous one */
+	lng local;			/* instructions taken from its own deque */
+	lng shared;			/* instructions taken from the new flows deque */
+	lng stolen;			/* instructions taken from other workers */
+	lng idle;			/* scans of the deques that found nothing */
+} DFLOWstatsRec;
+
+mal_export int DFLOWstatistics(DFLOWstatsRec *stats, int max);
+
 #endif /*  _MAL_DATAFLOW_H*/
@@ -28,6 +28,9 @@
 
 #include <wchar.h>
 #include <wctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #ifdef HAVE_LIBPCRE
 #include <pcre.h>
@@ -50,7 +53,8 @@ struct RE {
 	char *k;
 	uint32_t *w;
 	bool search:1,
-		atend:1;
+		atend:1,
+		ascii:1;	/* case ignoring pattern is ASCII, k is lower case */
 	size_t len;
 	struct RE *n;
 };
@@ -314,6 +318,216 @@ mywstrcasestr(const char *restrict haystack, const uint32_t *restrict wneedle, b
 	return NULL;
 }
 
+/* For ASCII strings and patterns, case insensitive matching can be
+ * done byte for byte, without converting to code points.  The
+ * patterns are then stored in lower case.  A non-ASCII character may
+ * still be equal to an ASCII one when ignoring case (e.g. KELVIN SIGN
+ * and k), so this can only be used if the string is ASCII as well. */
+
+static inline unsigned char
+ascii_lower(unsigned char c)
+{
+	return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+}
+
+static inline bool
+like_isascii(const char *s, size_t len)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	__m128i acc = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16)
+		acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *) (s + i)));
+	if (_mm_movemask_epi8(acc) != 0)
+		return false;
+#endif
+	for (; i < len; i++)
+		if ((unsigned char) s[i] & 0x80)
+			return false;
+	return true;
+}
+
+static inline bool
+like_memeq(const char *restrict s, const char *restrict n, size_t nlen, bool caseignore)
+{
+	if (!caseignore)
+		return memcmp(s, n, nlen) == 0;
+	for (size_t i = 0; i < nlen; i++)
+		if (ascii_lower((unsigned char) s[i]) != (unsigned char) n[i])
+			return false;
+	return true;
+}
+
+/* Find needle n of length nlen > 0 in s of length slen.  If
+ * caseignore, n must be lower case ASCII.  With SSE2 we compare the
+ * first and last character of the needle with 16 positions of s at a
+ * time and only compare the whole needle where both are equal. */
+static const char *
+like_strstr(const char *s, size_t slen, const char *n, size_t nlen, bool caseignore)
+{
+	const unsigned char f = (unsigned char) n[0], l = (unsigned char) n[nlen - 1];
+	size_t i = 0;
+
+	if (nlen > slen)
+		return NULL;
+#ifdef __SSE2__
+	/* or'ing 0x20 into a byte turns an upper case letter into lower
+	 * case and leaves a lower case letter as is */
+	const __m128i vf = _mm_set1_epi8((char) f), vl = _mm_set1_epi8((char) l);
+	const __m128i mf = _mm_set1_epi8(caseignore && f >= 'a' && f <= 'z' ? 0x20 : 0);
+	const __m128i ml = _mm_set1_epi8(caseignore && l >= 'a' && l <= 'z' ? 0x20 : 0);
+
+	for (; i + nlen - 1 + 16 <= slen; i += 16) {
+		__m128i xf = _mm_or_si128(_mm_loadu_si128((const __m128i *) (s + i)), mf);
+		__m128i xl = _mm_or_si128(_mm_loadu_si128((const __m128i *) (s + i + nlen - 1)), ml);
+		uint32_t bits = (uint32_t) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(xf, vf), _mm_cmpeq_epi8(xl, vl)));
+		while (bits) {
+			const char *p = s + i + candmask_lobit(bits);
+			if (like_memeq(p, n, nlen, caseignore))
+				return p;
+			bits &= bits - 1;
+		}
+	}
+#endif
+	for (; i + nlen <= slen; i++) {
+		if ((caseignore ? ascii_lower((unsigned char) s[i]) : (unsigned char) s[i]) == f &&
+			like_memeq(s + i, n, nlen, caseignore))
+			return s + i;
+	}
+	return NULL;
+}
+
+/* Extract the longest literal from a LIKE pattern.  Every literal of
+ * a pattern must occur in a matching string, so strings without it
+ * can be skipped without running the matcher.  If there is no
+ * suitable literal, *needle is set to NULL. */
+static str
+like_needle(char **needle, size_t *nlen, const char *pat, unsigned char esc, bool caseignore)
+{
+	const char *best = NULL, *seg = NULL;
+	size_t bestlen = 0, seglen = 0;
+	bool escaped = false;
+
+	*needle = NULL;
+	*nlen = 0;
+	if (esc == '%' || esc == '_')
+		return MAL_SUCCEED;
+	for (const char *p = pat; ; p++) {
+		if (!escaped && esc && (unsigned char) *p == esc) {
+			escaped = true;
+			continue;
+		}
+		if (*p == 0 || (!escaped && (*p == '%' || *p == '_'))) {
+			if (seglen > bestlen) {
+				best = seg;
+				bestlen = seglen;
+			}
+			if (*p == 0)
+				break;
+			seg = NULL;
+			seglen = 0;
+		} else {
+			if (caseignore && (unsigned char) *p & 0x80)
+				return MAL_SUCCEED;
+			if (seg == NULL)
+				seg = p;
+			seglen++;
+		}
+		escaped = false;
+	}
+	if (best == NULL)
+		return MAL_SUCCEED;
+	if ((*needle = GDKmalloc(bestlen + 1)) == NULL)
+		throw(MAL, "pcre.like_needle", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	/* copy the segment without its escape characters */
+	escaped = false;
+	for (size_t i = 0; i < bestlen; best++) {
+		if (!escaped && esc && (unsigned char) *best == esc) {
+			escaped = true;
+			continue;
+		}
+		(*needle)[i++] = caseignore ? ascii_lower((unsigned char) *best) : *best;
+		escaped = false;
+	}
+	(*needle)[bestlen] = 0;
+	*nlen = bestlen;
+	return MAL_SUCCEED;
+}
+
+/* Collect the literals of at least three characters of a LIKE pattern
+ * in *lits, each terminated by a NUL byte, followed by an empty
+ * string.  This is the form in which BATngramselect wants them.  If
+ * caseignore, the literals are in lower case and literals with
+ * non-ASCII characters are left out. */
+static str
+like_literals(char **lits, const char *pat, unsigned char esc, bool caseignore)
+{
+	char *d, *seg;
+	bool escaped = false, ascii = true;
+
+	if ((*lits = d = seg = GDKmalloc(strlen(pat) + 2)) == NULL)
+		throw(MAL, "pcre.like_literals", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	if (esc == '%' || esc == '_') {
+		*d = 0;
+		return MAL_SUCCEED;
+	}
+	for (const char *p = pat; ; p++) {
+		if (!escaped && esc && (unsigned char) *p == esc) {
+			escaped = true;
+			continue;
+		}
+		if (*p == 0 || (!escaped && (*p == '%' || *p == '_'))) {
+			if (d - seg >= 3 && (ascii || !caseignore)) {
+				*d++ = 0;
+				seg = d;
+			} else {
+				d = seg;
+			}
+			ascii = true;
+			if (*p == 0)
+				break;
+		} else {
+			ascii &= ((unsigned char) *p & 0x80) == 0;
+			*d++ = caseignore ? (char) ascii_lower((unsigned char) *p) : *p;
+		}
+		escaped = false;
+	}
+	*d = 0;
+	return MAL_SUCCEED;
+}
+
+/* use the trigram index of b (if it has one) to find the candidates
+ * that may match pattern pat; *cand is NULL if there is no index */
+static str
+like_ngramselect(BAT **cand, BAT *b, BAT *s, const char *pat, unsigned char esc, bool caseignore)
+{
+	char *lits;
+	str msg;
+
+	*cand = NULL;
+	if ((msg = like_literals(&lits, pat, esc, caseignore)) != MAL_SUCCEED)
+		return msg;
+	if (*lits && BATngramselect(cand, b, s, lits, caseignore) != GDK_SUCCEED)
+		msg = createException(MAL, "algebra.likeselect", GDK_EXCEPTION);
+	GDKfree(lits);
+	return msg;
+}
+
+/* whether s may match a pattern with the given needle */
+static inline bool
+like_maymatch(const char *s, const char *needle, size_t nlen, bool caseignore)
+{
+	size_t len;
+
+	if (needle == NULL)
+		return true;
+	len = strlen(s);
+	if (caseignore && !like_isascii(s, len))
+		return true;
+	return like_strstr(s, len, needle, nlen, caseignore) != NULL;
+}
+
 /* returns true if the pattern does not contain unescaped `_' (single
  * character match) and ends with unescaped `%' (any sequence
  * match) */
@@ -366,11 +580,38 @@ is_strcmpable(const char *pat, const char *esc)
 	return strlen(esc) == 0 || strNil(esc) || strstr(pat, esc) == NULL;
 }
 
+static inline bool
+re_match_ascii(const char *restrict s, size_t slen, const struct RE *restrict pattern)
+{
+	const struct RE *r;
+	const char *e = s + slen;
+
+	for (r = pattern; r; r = r->n) {
+		size_t l = (size_t) (e - s);
+		if (*r->k == 0 && (r->search || l == 0))
+			return true;
+		if (l == 0 ||
+			(r->search
+			 ? (r->atend
+				? l < r->len || !like_memeq(e - r->len, r->k, r->len, true)
+				: (s = like_strstr(s, l, r->k, r->len, true)) == NULL)
+			 : (r->atend
+				? l != r->len || !like_memeq(s, r->k, r->len, true)
+				: l < r->len || !like_memeq(s, r->k, r->len, true))))
+			return false;
+		s += r->len;
+	}
+	return true;
+}
+
 static inline bool
 re_match_ignore(const char *restrict s, const struct RE *restrict pattern)
 {
 	const struct RE *r;
+	size_t l;
 
+	if (pattern->ascii && like_isascii(s, l = strlen(s)))
+		return re_match_ascii(s, l, pattern);
 	for (r = pattern; r; r = r->n) {
 		if (*r->w == 0 && (r->search || *s == 0))
 			return true;
@@ -426,7 +667,9 @@ re_destroy(struct RE *p)
  * flag, the w (if true) or the k (if false) field is used.  These
  * fields in the first structure are allocated, whereas in all
  * subsequent structures the fields point into the allocated buffer of
- * the first. */
+ * the first.  The pattern is compacted in place (escapes and runs of %
+ * are removed), so the subsequent structures point at the compacted
+ * positions. */
 static struct RE *
 re_create(const char *pat, bool caseignore, uint32_t esc)
 {
@@ -466,7 +709,7 @@ re_create(const char *pat, bool caseignore, uint32_t esc)
 					n = n->n = GDKmalloc(sizeof(struct RE));
 					if (n == NULL)
 						goto bailout;
-					*n = (struct RE) {.search = true, .atend = true, .w = wp + 1};
+					*n = (struct RE) {.search = true, .atend = true, .w = wq + 1};
 				}
 				*wq++ = 0;
 			} else {
@@ -476,6 +719,19 @@ re_create(const char *pat, bool caseignore, uint32_t esc)
 			wp++;
 		}
 		*wq = 0;
+		/* keep a lower case copy of an ASCII pattern */
+		for (wp = r->w; wp < wq && *wp < 0x80; wp++)
+			;
+		if (wp == wq) {
+			char *k = GDKmalloc(wq - r->w + 1);
+			if (k == NULL)
+				goto bailout;
+			for (wp = r->w; wp <= wq; wp++)
+				k[wp - r->w] = (char) ascii_lower((unsigned char) *wp);
+			for (n = r; n; n = n->n)
+				n->k = k + (n->w - r->w);
+			r->ascii = true;
+		}
 	} else {
 		char *p, *q;
 		if ((p = GDKstrdup(pat)) == NULL) {
@@ -499,7 +755,7 @@ re_create(const char *pat, bool caseignore, uint32_t esc)
 					n = n->n = GDKmalloc(sizeof(struct RE));
 					if (n == NULL)
 						goto bailout;
-					*n = (struct RE) {.search = true, .atend = true, .k = p + 1};
+					*n = (struct RE) {.search = true, .atend = true, .k = q + 1};
 				}
 				*q++ = 0;
 			} else {
@@ -1582,6 +1838,8 @@ BATPCRElike_imp(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci, const s
 #endif
 	struct RE *re_simple = NULL;
 	uint32_t *wpat = NULL;
+	char *needle = NULL;
+	size_t nlen = 0;
 	BATiter bi = (BATiter) {0}, pi;
 
 	(void) cntxt;
@@ -1682,12 +1940,18 @@ BATPCRElike_imp(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci, const s
 				ret[p] = bit_nil;
 			has_nil = true;
 		} else {
-			if ((msg = pcre_like_build(&re, &ex, ppat, isensitive, q)) != MAL_SUCCEED) {
+			if ((msg = pcre_like_build(&re, &ex, ppat, isensitive, q)) != MAL_SUCCEED ||
+				(msg = like_needle(&needle, &nlen, pat, (unsigned char) **esc, isensitive)) != MAL_SUCCEED) {
 				bat_iterator_end(&bi);
 				goto bailout;
 			}
 			for (BUN p = 0; p < q; p++) {
 				const str s = BUNtail(bi, p);
+				if (*s != '\200' && !like_maymatch(s, needle, nlen, isensitive)) {
+					/* doesn't contain the needle, so no match */
+					ret[p] = anti;
+					continue;
+				}
 				if ((msg = pcre_like_apply(&(ret[p]), s, re, ex, ppat, anti)) != MAL_SUCCEED) {
 					bat_iterator_end(&bi);
 					goto bailout;
@@ -1700,6 +1964,7 @@ BATPCRElike_imp(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci, const s
 
 bailout:
 	GDKfree(ppat);
+	GDKfree(needle);
 	re_like_clean(&re_simple, &wpat);
 	pcre_clean(&re, &ex);
 	if (bn && !msg) {
@@ -1769,7 +2034,7 @@ BATPCREnotlike(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 #endif
 
 static str
-pcre_likeselect(BAT *bn, BAT *b, BAT *s, struct canditer *ci, BUN p, BUN q, BUN *rcnt, const char *pat, bool caseignore, bool anti)
+pcre_likeselect(BAT *bn, BAT *b, BAT *s, struct canditer *ci, BUN p, BUN q, BUN *rcnt, const char *pat, const char *needle, size_t nlen, bool caseignore, bool anti)
 {
 #ifdef HAVE_LIBPCRE
 	pcre *re = NULL;
@@ -1786,10 +2051,11 @@ pcre_likeselect(BAT *bn, BAT *b, BAT *s, struct canditer *ci, BUN p, BUN q, BUN
 	if ((msg = pcre_like_build(&re, &ex, pat, caseignore, ci->ncand)) != MAL_SUCCEED)
 		goto bailout;
 
+	/* only run the matcher on strings that contain the needle */
 	if (anti)
-		pcrescanloop(v && *v != '\200' && !PCRE_LIKESELECT_BODY);
+		pcrescanloop(v && *v != '\200' && !(like_maymatch(v, needle, nlen, caseignore) && PCRE_LIKESELECT_BODY));
 	else
-		pcrescanloop(v && *v != '\200' && PCRE_LIKESELECT_BODY);
+		pcrescanloop(v && *v != '\200' && like_maymatch(v, needle, nlen, caseignore) && PCRE_LIKESELECT_BODY);
 
 bailout:
 	bat_iterator_end(&bi);
@@ -1874,7 +2140,19 @@ PCRElikeselect(bat *ret, const bat *bid, const bat *sid, const str *pat, const s
 	} else {
 		BUN p = 0, q = 0, rcnt = 0;
 		struct canditer ci;
+		BAT *c;
 
+		/* only look at the values the trigram index (if any)
+		 * says may match */
+		if (!*anti) {
+			if ((msg = like_ngramselect(&c, b, s, *pat, (unsigned char) **esc, (bool) *caseignore)) != MAL_SUCCEED)
+				goto bailout;
+			if (c) {
+				if (s)
+					BBPunfix(s->batCacheid);
+				s = c;
+			}
+		}
 		canditer_init(&ci, b, s);
 		if (!(bn = COLnew(0, TYPE_oid, ci.ncand, TRANSIENT))) {
 			msg = createException(MAL, "algebra.likeselect", SQLSTATE(HY013) MAL_MALLOC_FAIL);
@@ -1899,7 +2177,12 @@ PCRElikeselect(bat *ret, const bat *bid, const bat *sid, const str *pat, const s
 		if (use_re) {
 			msg = re_likeselect(bn, b, s, &ci, p, q, &rcnt, *pat, (bool) *caseignore, (bool) *anti, use_strcmp, (unsigned char) **esc);
 		} else {
-			msg = pcre_likeselect(bn, b, s, &ci, p, q, &rcnt, ppat, (bool) *caseignore, (bool) *anti);
+			char *needle;
+			size_t nlen;
+			if ((msg = like_needle(&needle, &nlen, *pat, (unsigned char) **esc, (bool) *caseignore)) != MAL_SUCCEED)
+				goto bailout;
+			msg = pcre_likeselect(bn, b, s, &ci, p, q, &rcnt, ppat, needle, nlen, (bool) *caseignore, (bool) *anti);
+			GDKfree(needle);
 		}
 		if (!msg) { /* set some properties */
 			BATsetcount(bn, rcnt);
@@ -12,6 +12,7 @@
 #include "mal_authorize.h"
 #include "mal_client.h"
 #include "mal_runtime.h"
+#include "mal_dataflow.h"
 #include "gdk_time.h"
 
 /* (c) M.L. Kersten
@@ -372,6 +373,53 @@ SYSMONstop(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	return set ? MAL_SUCCEED : createException(MAL, "SYSMONstop", SQLSTATE(42000) "Tag " LLFMT " unknown", tag);
 }
 
+static str
+SYSMONdataflow(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	BAT *b[9];
+	int tpe[9] = {TYPE_int, TYPE_bit, TYPE_bit, TYPE_lng, TYPE_lng, TYPE_lng, TYPE_lng, TYPE_lng, TYPE_lng};
+	DFLOWstatsRec *stats;
+	int i, j, n;
+	str msg = MAL_SUCCEED;
+
+	(void) cntxt;
+	(void) mb;
+	if ((stats = GDKmalloc(THREADS * sizeof(DFLOWstatsRec))) == NULL)
+		throw(MAL, "SYSMONdataflow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	n = DFLOWstatistics(stats, THREADS);
+	for (j = 0; j < 9; j++) {
+		if ((b[j] = COLnew(0, tpe[j], n, TRANSIENT)) == NULL) {
+			while (j > 0)
+				BBPreclaim(b[--j]);
+			GDKfree(stats);
+			throw(MAL, "SYSMONdataflow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		}
+	}
+	for (i = 0; i < n; i++) {
+		bit running = stats[i].running, specific = stats[i].specific;
+		if (BUNappend(b[0], &stats[i].worker, false) != GDK_SUCCEED ||
+			BUNappend(b[1], &running, false) != GDK_SUCCEED ||
+			BUNappend(b[2], &specific, false) != GDK_SUCCEED ||
+			BUNappend(b[3], &stats[i].executed, false) != GDK_SUCCEED ||
+			BUNappend(b[4], &stats[i].chained, false) != GDK_SUCCEED ||
+			BUNappend(b[5], &stats[i].local, false) != GDK_SUCCEED ||
+			BUNappend(b[6], &stats[i].shared, false) != GDK_SUCCEED ||
+			BUNappend(b[7], &stats[i].stolen, false) != GDK_SUCCEED ||
+			BUNappend(b[8], &stats[i].idle, false) != GDK_SUCCEED) {
+			msg = createException(MAL, "SYSMONdataflow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			break;
+		}
+	}
+	GDKfree(stats);
+	for (j = 0; j < 9; j++) {
+		if (msg == MAL_SUCCEED)
+			BBPkeepref(*getArgReference_bat(stk, pci, j) = b[j]->batCacheid);
+		else
+			BBPunfix(b[j]->batCacheid);
+	}
+	return msg;
+}
+
 #include "mel.h"
 mel_func sysmon_init_funcs[] = {
  pattern("sysmon", "pause", SYSMONpause, false, "Suspend a running query", args(0,1, arg("id",sht))),
@@ -384,6 +432,7 @@ mel_func sysmon_init_funcs[] = {
  pattern("sysmon", "stop", SYSMONstop, false, "Stop a single query a.s.a.p.", args(0,1, arg("id",int))),
  pattern("sysmon", "stop", SYSMONstop, false, "Stop a single query a.s.a.p.", args(0,1, arg("id",lng))),
  pattern("sysmon", "queue", SYSMONqueue, false, "A queue of queries that are currently being executed or recently finished", args(9,9, batarg("tag",lng),batarg("sessionid",int),batarg("user",str),batarg("started",timestamp),batarg("status",str),batarg("query",str),batarg("finished",timestamp),batarg("workers",int),batarg("memory",int))),
+ pattern("sysmon", "dataflow", SYSMONdataflow, false, "Scheduling counters of the dataflow workers", args(9,9, batarg("worker",int),batarg("running",bit),batarg("specific",bit),batarg("executed",lng),batarg("chained",lng),batarg("local",lng),batarg("shared",lng),batarg("stolen",lng),batarg("idle",lng))),
  pattern("sysmon", "user_statistics", SYSMONstatistics, false, "", args(7,7, batarg("user",str),batarg("querycount",lng),batarg("totalticks",lng),batarg("started",timestamp),batarg("finished",timestamp),batarg("maxticks",lng),batarg("maxquery",str))),
  { .imp=NULL }
 };
@@ -41,6 +41,9 @@
 
 #include <string.h>
 #include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define MAXWORKERS	64
 #define MAXBUFFERS 2
@@ -223,6 +226,64 @@ TABLETcollect_parts(BAT **bats, Tablet *as, BUN offset)
 	return MAL_SUCCEED;
 }
 
+/*
+ * Most of the input of a COPY INTO consists of bytes that need no
+ * attention when looking for field and record boundaries.  The
+ * function tablet_scan skips over those.  It returns a pointer to the
+ * first byte at or after s that is NUL, equal to one of c1 to c4, or,
+ * if high is set, has its high bit set.  If end is not NULL, the scan
+ * stops there and end is returned if nothing was found.
+ *
+ * With SSE2 (always available on x86-64) the input is inspected 16
+ * bytes at a time.  The loads are aligned, so that we never read
+ * across a page boundary, even though we may read beyond the end of
+ * the string.
+ */
+static inline char *
+tablet_scan(const char *s, const char *end, char c1, char c2, char c3, char c4, bool high)
+{
+#ifdef __SSE2__
+	const __m128i z = _mm_setzero_si128();
+	const __m128i v1 = _mm_set1_epi8(c1), v2 = _mm_set1_epi8(c2);
+	const __m128i v3 = _mm_set1_epi8(c3), v4 = _mm_set1_epi8(c4);
+	unsigned int off = (unsigned int) ((uintptr_t) s & 15);
+	const __m128i *p = (const __m128i *) (s - off);
+	uint32_t mask = ~(uint32_t) 0 << off;
+
+	for (;;) {
+		__m128i x = _mm_load_si128(p);
+		__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, z),
+						      _mm_cmpeq_epi8(x, v1)),
+					 _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, v2),
+								   _mm_cmpeq_epi8(x, v3)),
+						      _mm_cmpeq_epi8(x, v4)));
+		uint32_t bits = (uint32_t) _mm_movemask_epi8(m);
+		if (high)
+			bits |= (uint32_t) _mm_movemask_epi8(x);
+		bits &= mask;
+		if (bits) {
+			s = (const char *) p + candmask_lobit(bits);
+			break;
+		}
+		p++;
+		mask = ~(uint32_t) 0;
+		if (end && (const char *) p >= end) {
+			s = end;
+			break;
+		}
+	}
+	if (end && s > end)
+		s = end;
+#else
+	for (; end == NULL || s < end; s++) {
+		if (*s == 0 || *s == c1 || *s == c2 || *s == c3 || *s == c4 ||
+			(high && (*s & 0x80) != 0))
+			break;
+	}
+#endif
+	return (char *) s;
+}
+
 // the starting quote character has already been skipped
 
 static char *
@@ -230,6 +291,12 @@ tablet_skip_string(char *s, char quote, bool escape)
 {
 	size_t i = 0, j = 0;
 	while (s[i]) {
+		if (i == j) {
+			/* nothing removed yet, so we can skip ahead */
+			i = j = tablet_scan(s + i, NULL, quote, escape ? '\\' : quote, quote, quote, false) - s;
+			if (s[i] == 0)
+				break;
+		}
 		if (escape && s[i] == '\\' && s[i + 1] != '\0')
 			s[j++] = s[i++];
 		else if (s[i] == quote) {
@@ -534,6 +601,152 @@ output_file_ordered(Tablet *as, BAT *order, stream *fd)
 	return res;
 }
 
+/*
+ * Large dense results are formatted in parallel.  The rows are cut
+ * into blocks which GDKparallel tasks format into private buffers, one
+ * block per thread in each round.  One extra task per round writes
+ * the blocks of the previous round to the stream, so that writing
+ * (and compressing, if the stream does that) overlaps with formatting
+ * the next rows, while the rows still come out in order.
+ */
+#define OUTPUT_BLOCK	((BUN) 1 << 16)	/* rows per block */
+
+struct outblock {
+	BUN lo, hi;					/* rows to format */
+	char *buf, *localbuf;
+	size_t len, locallen, fill;
+	bool bad;
+};
+
+struct output {
+	Tablet *as;
+	stream *fd;
+	int nblocks;
+	struct outblock *cur;		/* blocks being formatted */
+	struct outblock *prev;		/* blocks being written */
+	bool bad;
+};
+
+static int
+output_blocks(stream *fd, struct outblock *blk, int nblocks)
+{
+	for (int i = 0; i < nblocks; i++) {
+		if (blk[i].fill > 0 &&
+			mnstr_write(fd, blk[i].buf, 1, blk[i].fill) != (ssize_t) blk[i].fill)
+			return TABLET_error(fd);
+		blk[i].fill = 0;
+	}
+	return 0;
+}
+
+static gdk_return
+output_block(void *arg, size_t t)
+{
+	struct output *out = arg;
+	struct outblock *blk;
+	Column *fmt = out->as->format;
+	BUN nr_attrs = out->as->nr_attrs;
+
+	if (t == 0) {
+		if (out->prev && output_blocks(out->fd, out->prev, out->nblocks) < 0)
+			out->bad = true;
+		return GDK_SUCCEED;
+	}
+	blk = &out->cur[t - 1];
+	blk->fill = 0;
+	for (BUN r = blk->lo; r < blk->hi; r++) {
+		for (BUN i = 0; i < nr_attrs; i++) {
+			Column *f = fmt + i;
+			const char *p = NULL;
+			size_t l = 0;
+
+			if (f->c) {
+				/* BUNtail on a void or msk column writes its
+				 * result into the iterator, which the other
+				 * blocks are using as well, so use a copy */
+				BATiter ci = f->ci;
+				p = BUNtail(ci, f->p + r);
+				if (!p || ATOMcmp(f->adt, ATOMnilptr(f->adt), p) == 0) {
+					p = f->nullstr;
+					l = strlen(p);
+				} else {
+					ssize_t sl = f->tostr(f->extra, &blk->localbuf, &blk->locallen, f->adt, p);
+					if (sl < 0) {
+						blk->bad = true;
+						return GDK_SUCCEED;
+					}
+					p = blk->localbuf;
+					l = (size_t) sl;
+				}
+			}
+			if (blk->fill + l + f->seplen >= blk->len) {
+				/* extend the buffer */
+				size_t len = (blk->fill + l + f->seplen) * 2;
+				char *nbuf = GDKrealloc(blk->buf, len);
+				if (nbuf == NULL) {
+					blk->bad = true;
+					return GDK_SUCCEED;
+				}
+				blk->buf = nbuf;
+				blk->len = len;
+			}
+			if (l > 0)
+				memcpy(blk->buf + blk->fill, p, l);
+			blk->fill += l;
+			memcpy(blk->buf + blk->fill, f->sep, f->seplen);
+			blk->fill += f->seplen;
+		}
+	}
+	return GDK_SUCCEED;
+}
+
+static int
+output_file_parallel(Tablet *as, stream *fd, int nthreads)
+{
+	struct outblock *blocks;
+	struct output out = {
+		.as = as,
+		.fd = fd,
+		.nblocks = nthreads,
+	};
+	BUN r = 0;
+	int res = 0;
+
+	blocks = GDKzalloc(2 * nthreads * sizeof(struct outblock));
+	if (blocks == NULL)
+		return -1;
+	for (int i = 0; i < 2 * nthreads; i++) {
+		blocks[i].len = blocks[i].locallen = BUFSIZ;
+		blocks[i].buf = GDKmalloc(BUFSIZ);
+		blocks[i].localbuf = GDKmalloc(BUFSIZ);
+		if (blocks[i].buf == NULL || blocks[i].localbuf == NULL)
+			res = -1;
+	}
+	out.cur = blocks;
+	while (res == 0 && r < as->nr) {
+		for (int i = 0; i < nthreads; i++) {
+			out.cur[i].lo = r;
+			r = r + OUTPUT_BLOCK < as->nr ? r + OUTPUT_BLOCK : as->nr;
+			out.cur[i].hi = r;
+		}
+		if (GDKparallel(output_block, &out, (size_t) nthreads + 1, nthreads + 1, "copyout") != GDK_SUCCEED || out.bad)
+			res = -1;
+		for (int i = 0; i < nthreads; i++)
+			if (out.cur[i].bad)
+				res = -1;
+		out.prev = out.cur;
+		out.cur = out.cur == blocks ? blocks + nthreads : blocks;
+	}
+	if (res == 0 && out.prev)
+		res = output_blocks(fd, out.prev, nthreads);
+	for (int i = 0; i < 2 * nthreads; i++) {
+		GDKfree(blocks[i].buf);
+		GDKfree(blocks[i].localbuf);
+	}
+	GDKfree(blocks);
+	return res;
+}
+
 int
 TABLEToutput_file(Tablet *as, BAT *order, stream *s)
 {
@@ -551,7 +764,13 @@ TABLEToutput_file(Tablet *as, BAT *order, stream *s)
 
 	base = check_BATs(as);
 	if (!is_oid_nil(base)) {
-		if (order->hseqbase == base)
+		int nthreads = GDKnr_threads < MAXWORKERS ? GDKnr_threads : MAXWORKERS;
+
+		if (order->hseqbase == base && nthreads > 1 && as->nr >= 2 * OUTPUT_BLOCK) {
+			if ((size_t) nthreads > as->nr / OUTPUT_BLOCK)
+				nthreads = (int) (as->nr / OUTPUT_BLOCK);
+			ret = output_file_parallel(as, s, nthreads);
+		} else if (order->hseqbase == base)
 			ret = output_file_dense(as, s);
 		else
 			ret = output_file_ordered(as, order, s);
@@ -937,7 +1156,22 @@ SQLworker_column(READERtask *task, int col)
 	MT_lock_unset(&mal_copyLock);
 
 	for (i = 0; i < task->top[task->cur]; i++) {
-		if (!fmt[col].skip && SQLinsert_val(task, col, i) < 0) {
+		if (fmt[col].skip)
+			continue;
+		if (fmt[col].batfrstr) {
+			/* convert as many values as possible in one go,
+			 * there is room as the BAT was extended above */
+			BAT *b = fmt[col].c;
+			BUN n = fmt[col].batfrstr(&fmt[col], fmt[col].adt, task->fields[col] + i, (BUN) (task->top[task->cur] - i), Tloc(b, BATcount(b)));
+			if (n > 0) {
+				b->batCount += n;
+				b->theap->free += n * b->twidth;
+				i += (int) n;
+				if (i == task->top[task->cur])
+					break;
+			}
+		}
+		if (SQLinsert_val(task, col, i) < 0) {
 			BATsetcount(fmt[col].c, BATcount(fmt[col].c));
 			return -1;
 		}
@@ -993,7 +1227,7 @@ SQLload_parse_row(READERtask *task, int idx)
 			}
 
 			/* eat away the column separator */
-			for (; *row; row++)
+			for (; *(row = tablet_scan(row, NULL, '\\', ch, ch, ch, false)); row++)
 				if (*row == '\\') {
 					if (row[1])
 						row++;
@@ -1028,7 +1262,7 @@ SQLload_parse_row(READERtask *task, int idx)
 			task->fields[i][idx] = row;
 
 			/* eat away the column separator */
-			for (; *row; row++)
+			for (; *(row = tablet_scan(row, NULL, '\\', ch, ch, ch, false)); row++)
 				if (*row == '\\') {
 					if (row[1])
 						row++;
@@ -1235,6 +1469,232 @@ mkdfa(const unsigned char *sep, size_t seplen)
 #define likely(expr)	(expr)
 #endif
 
+/*
+ * Splitting a large buffer into records is done in parallel.  The
+ * buffer is cut into chunks that are scanned concurrently.  Whether a
+ * record separator found in a chunk really ends a record depends on
+ * whether it is inside a quoted field, which in turn depends on what
+ * came before the chunk.  Since the quote state only flips on each
+ * (unescaped) quote character, each chunk records the candidate
+ * separators together with the parity of the number of quotes seen in
+ * the chunk before it.  Once all chunks are done, the quote state at
+ * the start of each chunk is known, and the candidates that are real
+ * record separators can be picked out.  Whether the first character
+ * of a chunk is escaped is determined by the number of backslashes
+ * just before it.
+ *
+ * This only works for single character record separators and when no
+ * lines need to be skipped.  Any problem with the input (invalid
+ * UTF-8, embedded NUL bytes) makes us fall back to the serial scan,
+ * which also reports the error.
+ */
+
+#define SPLIT_CHUNK_MIN	((size_t) 1 << 16)
+
+struct splitsep {
+	uint32_t off;		/* offset of separator in chunk */
+	uint32_t nl;		/* newlines in chunk up to and including it */
+	bool par;		/* parity of quotes in chunk before it */
+};
+
+struct splitchunk {
+	char *start, *end;	/* the chunk */
+	struct splitsep *seps;	/* candidate record separators */
+	size_t nseps, maxseps;
+	lng nl;			/* number of newlines in the chunk */
+	bool par;		/* parity of the number of quotes in the chunk */
+	bool bad;		/* problem with input, fall back to serial scan */
+};
+
+struct split {
+	const char *s;		/* start of the buffer */
+	char quote, rsep;
+	bool escape;
+	struct splitchunk *chunks;
+};
+
+static gdk_return
+SQLsplit_chunk(void *arg, size_t c)
+{
+	struct split *sp = arg;
+	struct splitchunk *ch = &sp->chunks[c];
+	const char *e = ch->start;
+	char quote = sp->quote, rsep = sp->rsep;
+	bool bs = false, par = false;
+	int nutf = 0, m = 0;
+	uint32_t nl = 0;
+
+	if (sp->escape) {
+		/* an odd number of backslashes escapes the first byte */
+		for (const char *p = e; p > sp->s && p[-1] == '\\'; p--)
+			bs = !bs;
+	}
+	for (; e < ch->end; e++) {
+		if (nutf == 0 && !bs) {
+			/* skip to the next byte that needs attention */
+			e = tablet_scan(e, ch->end, '\n', quote, rsep, sp->escape ? '\\' : '\n', true);
+			if (e == ch->end)
+				break;
+		}
+		/* check for correctly encoded UTF-8 (see SQLproducer) */
+		if (nutf > 0) {
+			if (unlikely((*e & 0xC0) != 0x80))
+				goto bad;
+			if (unlikely(m != 0 && (*e & m) == 0))
+				goto bad;
+			m = 0;
+			nutf--;
+		} else if ((*e & 0x80) != 0) {
+			if ((*e & 0xE0) == 0xC0) {
+				nutf = 1;
+				if (unlikely((e[0] & 0x1E) == 0))
+					goto bad;
+			} else if ((*e & 0xF0) == 0xE0) {
+				nutf = 2;
+				if ((e[0] & 0x0F) == 0)
+					m = 0x20;
+			} else if (likely((*e & 0xF8) == 0xF0)) {
+				nutf = 3;
+				if ((e[0] & 0x07) == 0)
+					m = 0x30;
+			} else {
+				goto bad;
+			}
+		} else if (*e == '\n') {
+			nl++;
+		} else if (unlikely(*e == 0)) {
+			goto bad;
+		}
+		if (bs) {
+			bs = false;
+		} else if (sp->escape && *e == '\\') {
+			bs = true;
+		} else if (*e == quote) {
+			par = !par;
+		} else if (*e == rsep) {
+			if (ch->nseps == ch->maxseps) {
+				size_t n = ch->maxseps * 2;
+				struct splitsep *seps = GDKrealloc(ch->seps, n * sizeof(struct splitsep));
+				if (seps == NULL)
+					goto bad;
+				ch->seps = seps;
+				ch->maxseps = n;
+			}
+			ch->seps[ch->nseps++] = (struct splitsep) {
+				.off = (uint32_t) (e - ch->start),
+				.nl = nl,
+				.par = par,
+			};
+		}
+	}
+	/* a multi-byte character may only continue into the next
+	 * chunk at the end of the buffer (where it is incomplete) */
+	ch->bad = nutf > 0 && *ch->end != 0;
+	ch->nl = nl;
+	ch->par = par;
+	return GDK_SUCCEED;
+
+  bad:
+	ch->bad = true;
+	return GDK_SUCCEED;
+}
+
+/* Split the input buffer [*sp, end) into records in parallel, with the
+ * same effect on the state of SQLproducer as the serial scan.  Returns
+ * false if the buffer could not be split in parallel and nothing was
+ * changed. */
+static bool
+SQLsplit_parallel(READERtask *task, int cur, char **sp, char **ep, char **basep, char *end, BUN *cnt, lng *rowno, lng *lineno, lng *startlineno, size_t *partial)
+{
+	size_t len = end - *sp;
+	int nchunks = GDKnr_threads;
+	struct splitchunk chunks[MAXWORKERS];
+	struct split split = {
+		.s = *sp,
+		.quote = task->quote,
+		.rsep = *task->rsep,
+		.escape = task->escape,
+		.chunks = chunks,
+	};
+	char *s = *sp, *e, *base = *basep;
+	bool par = false, ok = true;
+	lng nl;
+	int c;
+
+	if (nchunks > MAXWORKERS)
+		nchunks = MAXWORKERS;
+	if ((size_t) nchunks > len / SPLIT_CHUNK_MIN)
+		nchunks = (int) (len / SPLIT_CHUNK_MIN);
+	if (nchunks < 2 || len / nchunks >= (size_t) UINT32_MAX)
+		return false;
+
+	for (c = 0; c < nchunks; c++) {
+		char *p = s + len / nchunks * c;
+		/* don't start a chunk in the middle of a character */
+		while (c > 0 && p < end && (*p & 0xC0) == 0x80)
+			p++;
+		chunks[c] = (struct splitchunk) {
+			.start = p,
+			.end = end,
+			.maxseps = len / nchunks / 32 + 16,
+		};
+		if (c > 0)
+			chunks[c - 1].end = p;
+		chunks[c].seps = GDKmalloc(chunks[c].maxseps * sizeof(struct splitsep));
+		if (chunks[c].seps == NULL)
+			ok = false;
+	}
+	if (ok)
+		ok = GDKparallel(SQLsplit_chunk, &split, (size_t) nchunks, nchunks, "copysplit") == GDK_SUCCEED;
+	for (c = 0; ok && c < nchunks; c++)
+		ok = !chunks[c].bad;
+	if (!ok) {
+		GDKclrerr();
+		for (c = 0; c < nchunks; c++)
+			GDKfree(chunks[c].seps);
+		return false;
+	}
+
+	/* pick out the real record separators, and treat them like the
+	 * serial scan does */
+	e = s;
+	nl = *lineno;
+	for (c = 0; c < nchunks; c++) {
+		struct splitchunk *ch = &chunks[c];
+		for (size_t k = 0; k < ch->nseps; k++) {
+			if (ch->seps[k].par != par)
+				continue;	/* inside a quoted field */
+			e = ch->start + ch->seps[k].off;
+			*lineno = nl + ch->seps[k].nl;
+			(*rowno)++;
+			task->startlineno[cur][task->top[cur]] = *startlineno;
+			task->rows[cur][task->top[cur]++] = s;
+			*startlineno = *lineno;
+			(*cnt)++;
+			*e = 0;
+			s = ++e;
+			task->b->pos += (size_t) (e - base);
+			base = e;
+			if (task->top[cur] == task->limit || *cnt == task->maxrow)
+				goto done;
+		}
+		nl += ch->nl;
+		par ^= ch->par;
+	}
+	/* what is left is an incomplete record, saved for the next
+	 * round */
+	e = end;
+	*lineno = nl;
+	*partial = e - s;
+  done:
+	for (c = 0; c < nchunks; c++)
+		GDKfree(chunks[c].seps);
+	*sp = s;
+	*ep = e;
+	*basep = base;
+	return true;
+}
+
 static void
 SQLproducer(void *p)
 {
@@ -1333,6 +1793,11 @@ SQLproducer(void *p)
 			ateof[cur] = true;
 			goto reportlackofinput;
 		}
+		if (!consoleinput && task->skip == 0 && rseplen == 1 &&
+			cnt < task->maxrow &&
+			SQLsplit_parallel(task, cur, &s, &e, &base, end, &cnt, &rowno, &lineno, &startlineno, &partial)) {
+			/* done in parallel */
+		} else
 		for (e = s; *e && e < end && cnt < task->maxrow;) {
 			/* tokenize the record completely
 			 *
@@ -42,6 +42,9 @@ typedef struct Column_t {
 	int scale, precision;
 	ssize_t (*tostr)(void *extra, char **buf, size_t *len, int type, const void *a);
 	void *(*frstr)(struct Column_t *fmt, int type, const char *s);
+	/* optional: convert a run of values into dst, returns how many
+	 * were converted; the first one not converted goes through frstr */
+	BUN (*batfrstr)(struct Column_t *fmt, int type, char *const *s, BUN n, void *dst);
 	void *extra;
 	void *data;
 	int skip;					/* only skip to the next field */
@@ -0,0 +1,113 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 1997 - July 2008 CWI, August 2008 - 2021 MonetDB B.V.
+ */
+
+/*
+ * Vectorized execution support
+ * The vectorize optimizer turns chains of selections, projections and
+ * calculations that end in a (scalar) aggregate into a loop over
+ * cache-sized partitions of the underlying table.  Within the loop
+ * each aggregate is computed over the partition, and the partial
+ * result is combined with the result of the previous partitions.
+ * This module provides the runtime support for those loops: the
+ * number of partitions to use, and the combination of the partial
+ * aggregates.  The combination functions ignore nil values, as the
+ * aggregates they combine already do.
+ */
+
+#include "monetdb_config.h"
+#include "mal.h"
+#include "mal_interpreter.h"
+#include "mal_exception.h"
+
+/* the number of partitions of b such that each contains about size
+ * elements, but at least one */
+static str
+VECTORparts(int *ret, const bat *bid, const lng *size)
+{
+	BAT *b;
+	BUN cnt;
+
+	if (is_lng_nil(*size) || *size <= 0)
+		throw(MAL, "vector.parts", ILLEGAL_ARGUMENT);
+	if ((b = BBPquickdesc(*bid)) == NULL)
+		throw(MAL, "vector.parts", RUNTIME_OBJECT_MISSING);
+	cnt = BATcount(b);
+	cnt = (cnt + (BUN) *size - 1) / (BUN) *size;
+	*ret = cnt == 0 ? 1 : cnt > (BUN) GDK_int_max ? GDK_int_max : (int) cnt;
+	return MAL_SUCCEED;
+}
+
+/* combine two partial sums */
+static str
+VECTORsum(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	ValPtr ret = &stk->stk[getArg(pci, 0)];
+	const ValRecord *acc = &stk->stk[getArg(pci, 1)];
+	const ValRecord *val = &stk->stk[getArg(pci, 2)];
+
+	(void) cntxt;
+	(void) mb;
+	if (VALisnil(val)) {
+		if (ret != acc)
+			*ret = *acc;
+	} else if (VALisnil(acc)) {
+		*ret = *val;
+	} else if (VARcalcadd(ret, acc, val, true) != GDK_SUCCEED) {
+		throw(MAL, "vector.sum", GDK_EXCEPTION);
+	}
+	return MAL_SUCCEED;
+}
+
+/* combine two partial minima (cmp < 0) or maxima (cmp > 0) */
+static str
+VECTORminmax(MalStkPtr stk, InstrPtr pci, int cmp)
+{
+	ValPtr ret = &stk->stk[getArg(pci, 0)];
+	const ValRecord *acc = &stk->stk[getArg(pci, 1)];
+	const ValRecord *val = &stk->stk[getArg(pci, 2)];
+
+	assert(!ATOMextern(val->vtype));
+	if (!VALisnil(val) &&
+		(VALisnil(acc) || VALcmp(val, acc) * cmp > 0))
+		*ret = *val;
+	else if (ret != acc)
+		*ret = *acc;
+	return MAL_SUCCEED;
+}
+
+static str
+VECTORmin(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	(void) cntxt;
+	(void) mb;
+	return VECTORminmax(stk, pci, -1);
+}
+
+static str
+VECTORmax(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	(void) cntxt;
+	(void) mb;
+	return VECTORminmax(stk, pci, 1);
+}
+
+#include "mel.h"
+mel_func vector_init_funcs[] = {
+ command("vector", "parts", VECTORparts, false, "The number of partitions of b needed to process it in vectors of the given size.", args(1,3, arg("",int),batargany("b",1),arg("size",lng))),
+ pattern("vector", "sum", VECTORsum, false, "Add the partial sum val to acc, ignoring nils.", args(1,3, argany("",1),argany("acc",1),argany("val",1))),
+ pattern("vector", "min", VECTORmin, false, "The smallest of acc and the partial minimum val, ignoring nils.", args(1,3, argany("",1),argany("acc",1),argany("val",1))),
+ pattern("vector", "max", VECTORmax, false, "The largest of acc and the partial maximum val, ignoring nils.", args(1,3, argany("",1),argany("acc",1),argany("val",1))),
+ { .imp=NULL }
+};
+#include "mal_import.h"
+#ifdef _MSC_VER
+#undef read
+#pragma section(".CRT$XCU",read)
+#endif
+LIB_STARTUP_FUNC(init_vector_mal)
+{ mal_module("vector", NULL, vector_init_funcs); }
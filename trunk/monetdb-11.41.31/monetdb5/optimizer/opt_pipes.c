@@ -265,6 +265,47 @@ static struct PIPELINES {
 	 "optimizer.garbageCollector();"
 	 "optimizer.profiler();",
 	 "stable", NULL, 1},
+/* The vectorized pipe line is identical to the sequential pipeline,
+ * except that chains of operators over large tables that end in a
+ * scalar aggregate are executed a vector (partition) at a time, which
+ * reduces memory traffic and the footprint of intermediates.
+ *
+ * NOTE:
+ * If you change the vectorized pipe, please also update the man page
+ * (see tools/mserver/mserver5.1) accordingly!
+ */
+	{"vectorized_pipe",
+	 "optimizer.inline();"
+	 "optimizer.remap();"
+	 "optimizer.costModel();"
+	 "optimizer.coercions();"
+	 "optimizer.aliases();"
+	 "optimizer.evaluate();"
+	 "optimizer.emptybind();"
+	 "optimizer.deadcode();"
+	 "optimizer.pushselect();"
+	 "optimizer.aliases();"
+	 "optimizer.mergetable();"
+	 "optimizer.bincopyfrom();"
+	 "optimizer.aliases();"
+	 "optimizer.constants();"
+	 "optimizer.commonTerms();"
+	 "optimizer.projectionpath();"
+	 "optimizer.deadcode();"
+	 "optimizer.reorder();"
+	 "optimizer.matpack();"
+	 "optimizer.vectorize();"
+	 "optimizer.querylog();"
+	 "optimizer.multiplex();"
+	 "optimizer.generator();"
+	 "optimizer.candidates();"
+	 //"optimizer.mask();"
+	 "optimizer.deadcode();"
+	 "optimizer.postfix();"
+	 "optimizer.wlc();"
+	 "optimizer.garbageCollector();"
+	 "optimizer.profiler();",
+	 "stable", NULL, 1},
 /* Experimental pipelines stressing various components under
  * development.  Do not use any of these pipelines in production
  * settings!
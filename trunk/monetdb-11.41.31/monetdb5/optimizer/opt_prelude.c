@@ -213,6 +213,7 @@ const char *packIncrementRef;
 const char *packRef;
 const char *parametersRef;
 const char *partitionRef;
+const char *partsRef;
 const char *passRef;
 const char *pcreRef;
 const char *percent_rankRef;
@@ -520,6 +521,7 @@ void optimizerInit(void)
 	packRef = putName("pack");
 	parametersRef = putName("parameters");
 	partitionRef = putName("partition");
+	partsRef = putName("parts");
 	passRef = putName("pass");
 	pcreRef = putName("pcre");
 	percent_rankRef = putName("percent_rank");
@@ -211,6 +211,7 @@ mal_export  const char *packIncrementRef;
 mal_export  const char *packRef;
 mal_export  const char *parametersRef;
 mal_export  const char *partitionRef;
+mal_export  const char *partsRef;
 mal_export  const char *passRef;
 mal_export  const char *pcreRef;
 mal_export  const char *percent_rankRef;
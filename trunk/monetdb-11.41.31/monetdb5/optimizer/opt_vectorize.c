@@ -0,0 +1,391 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 1997 - July 2008 CWI, August 2008 - 2021 MonetDB B.V.
+ */
+
+/*
+ * Vectorized execution
+ * A chain of selections, projections and calculations over the columns
+ * of a table that ends in a scalar aggregate materializes all its
+ * intermediates in full, even though only the aggregate is needed.
+ * The vectorize optimizer replaces such chains by a loop over
+ * partitions of the table of about VECTORSIZE rows, such that the
+ * intermediates of an iteration fit in the CPU caches:
+ *
+ *	n := vector.parts(tid, VECTORSIZE);
+ *	s := nil:hge;
+ *	barrier part := 0;
+ *		tid' := sql.tid(mvc, "sys", "t", part, n);
+ *		col' := sql.bind(mvc, "sys", "t", "c", 0, part, n);
+ *		... the chain over tid' and col' ...
+ *		x := aggr.sum(y');
+ *		s := vector.sum(s, x);
+ *	redo part := iterator.next(1, n);
+ *	exit part;
+ *
+ * The partitions are the same as those used by mitosis, so the
+ * partitioned columns and candidate lists are aligned.  All aggregates
+ * over the same table are computed in a single loop, as long as their
+ * results are not needed before the last of them.  The original chain
+ * is left in place for other uses; the deadcode optimizer removes what
+ * is no longer needed.
+ */
+#include "monetdb_config.h"
+#include "opt_vectorize.h"
+#include "mal_builder.h"
+
+#define VECTORSIZE	(64 * 1024)	/* rows per vector */
+#define MAXVECTORTABLES	16		/* tables considered per plan */
+
+/* is p a source, i.e. an unpartitioned bind of a column or of the
+ * candidates of a table? */
+static bool
+isVectorSource(MalBlkPtr mb, InstrPtr p)
+{
+	if (getModuleId(p) != sqlRef || p->retc != 1)
+		return false;
+	if (getFunctionId(p) == tidRef)
+		return p->argc == 4;
+	return getFunctionId(p) == bindRef && p->argc == 6 &&
+		isVarConstant(mb, getArg(p, 5)) &&
+		getVarConstant(mb, getArg(p, 5)).val.ival == 0;
+}
+
+/* the table over which (the result of) p is vectorizable, or -1 */
+static int
+vectorTable(MalBlkPtr mb, InstrPtr p, const int *tab, const bool *aggr)
+{
+	int j, t = -1;
+
+	if (p->retc != 1 || p->barrier || !isaBatType(getArgType(mb, p, 0)))
+		return -1;
+	if (!(getModuleId(p) == batcalcRef ||
+		  (getModuleId(p) == algebraRef &&
+		   (getFunctionId(p) == selectRef ||
+			getFunctionId(p) == thetaselectRef ||
+			(getFunctionId(p) == projectionRef && p->argc == 3)))))
+		return -1;
+	for (j = p->retc; j < p->argc; j++) {
+		int a = getArg(p, j);
+		if (!isaBatType(getArgType(mb, p, j))) {
+			/* scalars must be known before the loop starts */
+			if (aggr[a])
+				return -1;
+		} else if (!isVarConstant(mb, a)) {
+			if (tab[a] < 0 || (t >= 0 && tab[a] != t))
+				return -1;
+			t = tab[a];
+		}
+	}
+	return t;
+}
+
+/* the combination function for the partial results of aggregate p, or
+ * NULL if p is not an aggregate that can be vectorized */
+static const char *
+vectorAggregate(MalBlkPtr mb, InstrPtr p, const int *tab, const bool *aggr)
+{
+	int tpe;
+
+	if (getModuleId(p) != aggrRef || p->retc != 1 || p->barrier ||
+		p->argc < 2 || !isaBatType(getArgType(mb, p, 1)) ||
+		isVarConstant(mb, getArg(p, 1)) || tab[getArg(p, 1)] < 0)
+		return NULL;
+	tpe = getArgType(mb, p, 0);
+	if (isaBatType(tpe))
+		return NULL;
+	if (getFunctionId(p) == countRef) {
+		if (p->argc == 3 && !isaBatType(getArgType(mb, p, 2)) &&
+			!aggr[getArg(p, 2)])
+			return sumRef;
+		return p->argc == 2 ? sumRef : NULL;
+	}
+	if (p->argc != 2)
+		return NULL;
+	if (getFunctionId(p) == sumRef)
+		return sumRef;
+	if (ATOMextern(tpe))
+		return NULL;
+	if (getFunctionId(p) == minRef)
+		return minRef;
+	if (getFunctionId(p) == maxRef)
+		return maxRef;
+	return NULL;
+}
+
+str
+OPTvectorizeImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	int i, j, limit, slimit, vtop, actions = 0;
+	int ntab = 0, ngrp = 0;
+	InstrPtr p, q, *old = mb->stmt;
+	const char *sname[MAXVECTORTABLES], *tname[MAXVECTORTABLES];
+	int open[MAXVECTORTABLES];
+	int *tab = NULL;		/* per variable: table it is vectorizable over */
+	int *def = NULL;		/* per variable: pc of its definition */
+	int *map = NULL;		/* per variable: its partitioned version */
+	bool *aggr = NULL;		/* per variable: result of vectorized aggregate */
+	int *agrp = NULL;		/* per variable: group of that aggregate */
+	int *grp = NULL;		/* per pc: group of vectorized aggregate */
+	const char **comb = NULL;	/* per pc: combination of the aggregate */
+	char *need = NULL;		/* per pc: needed inside the loop */
+	int *gtab = NULL, *glast = NULL;	/* per group: table and last pc */
+	char buf[256];
+	lng usec = GDKusec();
+	str msg = MAL_SUCCEED;
+
+	(void) stk;
+	(void) pci;
+
+	if (mb->inlineProp)
+		return MAL_SUCCEED;
+	limit = mb->stop;
+	slimit = mb->ssize;
+	vtop = mb->vtop;
+
+	/* only consider straight-line read-only plans */
+	for (i = 0; i < limit; i++) {
+		p = old[i];
+		if (p->barrier || isUpdateInstruction(p))
+			goto bailout;
+	}
+
+	tab = GDKmalloc(vtop * sizeof(int));
+	def = GDKmalloc(vtop * sizeof(int));
+	map = GDKzalloc(vtop * sizeof(int));
+	aggr = GDKzalloc(vtop * sizeof(bool));
+	agrp = GDKmalloc(vtop * sizeof(int));
+	grp = GDKmalloc(limit * sizeof(int));
+	comb = GDKzalloc(limit * sizeof(const char *));
+	need = GDKzalloc(limit);
+	gtab = GDKmalloc(limit * sizeof(int));
+	glast = GDKmalloc(limit * sizeof(int));
+	if (tab == NULL || def == NULL || map == NULL || aggr == NULL ||
+		agrp == NULL || grp == NULL || comb == NULL || need == NULL ||
+		gtab == NULL || glast == NULL) {
+		msg = createException(MAL, "optimizer.vectorize", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto bailout;
+	}
+	for (i = 0; i < vtop; i++)
+		tab[i] = -1;
+
+	/* find the aggregates that can be vectorized and group them per
+	 * table */
+	for (i = 0; i < limit; i++) {
+		int t;
+
+		p = old[i];
+		grp[i] = -1;
+		/* close the groups whose result is needed here */
+		for (j = p->retc; j < p->argc; j++) {
+			int a = getArg(p, j);
+			if (aggr[a] && open[gtab[agrp[a]]] == agrp[a])
+				open[gtab[agrp[a]]] = -1;
+		}
+		if (isVectorSource(mb, p)) {
+			const char *s, *n;
+			if (getRowCnt(mb, getArg(p, 0)) < 2 * VECTORSIZE ||
+				!isVarConstant(mb, getArg(p, 2)) ||
+				!isVarConstant(mb, getArg(p, 3)))
+				continue;
+			s = getVarConstant(mb, getArg(p, 2)).val.sval;
+			n = getVarConstant(mb, getArg(p, 3)).val.sval;
+			for (t = 0; t < ntab; t++)
+				if (strcmp(s, sname[t]) == 0 && strcmp(n, tname[t]) == 0)
+					break;
+			if (t == ntab) {
+				if (ntab == MAXVECTORTABLES)
+					continue;
+				sname[t] = s;
+				tname[t] = n;
+				open[t] = -1;
+				ntab++;
+			}
+			tab[getArg(p, 0)] = t;
+			def[getArg(p, 0)] = i;
+		} else if ((t = vectorTable(mb, p, tab, aggr)) >= 0) {
+			tab[getArg(p, 0)] = t;
+			def[getArg(p, 0)] = i;
+		} else if ((comb[i] = vectorAggregate(mb, p, tab, aggr)) != NULL) {
+			t = tab[getArg(p, 1)];
+			if (open[t] < 0) {
+				open[t] = ngrp;
+				gtab[ngrp] = t;
+				ngrp++;
+			}
+			grp[i] = open[t];
+			glast[open[t]] = i;
+			aggr[getArg(p, 0)] = true;
+			agrp[getArg(p, 0)] = open[t];
+		}
+	}
+	if (ngrp == 0)
+		goto bailout;
+
+	if (newMalBlkStmt(mb, mb->ssize + ngrp * 16) < 0) {
+		msg = createException(MAL, "optimizer.vectorize", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto bailout;
+	}
+
+	for (i = 0; i < limit; i++) {
+		int g = grp[i], part, nparts, src = -1;
+
+		p = old[i];
+		if (g < 0) {
+			pushInstruction(mb, p);
+			continue;
+		}
+		if (glast[g] != i)
+			continue;	/* emitted with the last one of the group */
+
+		/* mark the instructions needed to compute the aggregates */
+		memset(need, 0, limit);
+		for (j = 0; j <= i; j++)
+			if (grp[j] == g)
+				need[def[getArg(old[j], 1)]] = 1;
+		for (j = i; j >= 0; j--) {
+			if (!need[j])
+				continue;
+			q = old[j];
+			for (int k = q->retc; k < q->argc; k++) {
+				int a = getArg(q, k);
+				if (isaBatType(getVarType(mb, a)) && !isVarConstant(mb, a) &&
+					tab[a] >= 0)
+					need[def[a]] = 1;
+			}
+			if (isVectorSource(mb, q) &&
+				(src < 0 || getFunctionId(q) == tidRef))
+				src = getArg(q, 0);
+		}
+		assert(src >= 0);
+
+		/* the loop header */
+		q = newFcnCall(mb, vectorRef, partsRef);
+		setVarType(mb, getArg(q, 0), TYPE_int);
+		nparts = getArg(q, 0);
+		q = pushArgument(mb, q, src);
+		q = pushLng(mb, q, VECTORSIZE);
+		for (j = 0; j <= i; j++) {
+			if (grp[j] != g)
+				continue;
+			q = newAssignment(mb);
+			getArg(q, 0) = getArg(old[j], 0);
+			if (getFunctionId(old[j]) == countRef)
+				q = pushZero(mb, q, getVarType(mb, getArg(q, 0)));
+			else
+				q = pushNil(mb, q, getVarType(mb, getArg(q, 0)));
+		}
+		q = newAssignment(mb);
+		q->barrier = BARRIERsymbol;
+		setVarType(mb, getArg(q, 0), TYPE_int);
+		part = getArg(q, 0);
+		q = pushInt(mb, q, 0);
+
+		/* the partitioned chain */
+		for (j = 0; j < i; j++) {
+			if (!need[j])
+				continue;
+			q = copyInstruction(old[j]);
+			if (q == NULL) {
+				msg = createException(MAL, "optimizer.vectorize", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+				break;
+			}
+			for (int k = q->retc; k < q->argc; k++)
+				if (map[getArg(q, k)])
+					getArg(q, k) = map[getArg(q, k)];
+			if (isVectorSource(mb, q)) {
+				q = pushArgument(mb, q, part);
+				q = pushArgument(mb, q, nparts);
+			}
+			map[getArg(q, 0)] = newTmpVariable(mb, getArgType(mb, q, 0));
+			getArg(q, 0) = map[getArg(q, 0)];
+			q->typechk = TYPE_UNKNOWN;
+			pushInstruction(mb, q);
+		}
+		if (msg)
+			break;
+
+		/* the partial aggregates and their combination */
+		for (j = 0; j <= i; j++) {
+			int res;
+
+			if (grp[j] != g)
+				continue;
+			res = getArg(old[j], 0);
+			q = copyInstruction(old[j]);
+			if (q == NULL) {
+				msg = createException(MAL, "optimizer.vectorize", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+				break;
+			}
+			getArg(q, 1) = map[getArg(q, 1)];
+			getArg(q, 0) = newTmpVariable(mb, getVarType(mb, res));
+			q->typechk = TYPE_UNKNOWN;
+			pushInstruction(mb, q);
+			p = newFcnCall(mb, vectorRef, comb[j]);
+			getArg(p, 0) = res;
+			p = pushArgument(mb, p, res);
+			p = pushArgument(mb, p, getArg(q, 0));
+			actions++;
+		}
+		if (msg)
+			break;
+
+		/* the loop trailer */
+		q = newFcnCall(mb, iteratorRef, nextRef);
+		q->barrier = REDOsymbol;
+		getArg(q, 0) = part;
+		q = pushInt(mb, q, 1);
+		q = pushArgument(mb, q, nparts);
+		q = newAssignment(mb);
+		q->barrier = EXITsymbol;
+		getArg(q, 0) = part;
+
+		/* the variables are local to this loop */
+		for (j = 0; j < vtop; j++)
+			map[j] = 0;
+	}
+	if (msg) {
+		/* the plan is discarded, but should own all instructions */
+		for (; i < limit; i++)
+			if (grp[i] < 0)
+				pushInstruction(mb, old[i]);
+	}
+	for (i = 0; i < limit; i++)
+		if (grp[i] >= 0)
+			freeInstruction(old[i]);
+	for (i = limit; i < slimit; i++)
+		if (old[i])
+			freeInstruction(old[i]);
+	GDKfree(old);
+
+	/* Defense line against incorrect plans */
+	if (msg == MAL_SUCCEED && actions > 0) {
+		msg = chkTypes(cntxt->usermodule, mb, FALSE);
+		if (!msg)
+			msg = chkFlow(mb);
+		if (!msg)
+			msg = chkDeclarations(mb);
+	}
+
+  bailout:
+	GDKfree(tab);
+	GDKfree(def);
+	GDKfree(map);
+	GDKfree(aggr);
+	GDKfree(agrp);
+	GDKfree(grp);
+	GDKfree(comb);
+	GDKfree(need);
+	GDKfree(gtab);
+	GDKfree(glast);
+	/* keep all actions taken as a post block comment */
+	usec = GDKusec() - usec;
+	snprintf(buf, 256, "%-20s actions=%2d time=" LLFMT " usec", "vectorize", actions, usec);
+	newComment(mb, buf);
+	if (actions > 0)
+		addtoMalBlkHistory(mb);
+	return msg;
+}
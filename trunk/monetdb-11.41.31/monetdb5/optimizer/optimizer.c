@@ -94,6 +94,7 @@ static mel_func optimizer_init_funcs[] = {
  optwrapper_pattern("commonTerms", "Common sub-expression optimizer"),
  optwrapper_pattern("candidates", "Mark candidate list variables"),
  optwrapper_pattern("volcano", "Simulate volcano style execution"),
+ optwrapper_pattern("vectorize", "Execute aggregation chains over cache-sized vectors"),
  optwrapper_pattern("constants", "Duplicate constant removal optimizer"),
  optwrapper_pattern("profiler", "Collect properties for the profiler"),
  optwrapper_pattern("costModel", "Estimate the cost of a relational expression"),
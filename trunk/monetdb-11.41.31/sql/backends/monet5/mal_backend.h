@@ -52,7 +52,9 @@ typedef struct backend {
 	lng 	reloptimizer;	/* timer for optimizer phase */
 
 	bool sizeheader:1,	/* print size header in result set */
+		 binary_results:1,	/* send result sets in binary chunks */
 		 no_mitosis:1,	/* run query without mitosis */
+		 cacheplan:1,	/* the optimized plan may be shared, so don't depend on the data */
 		 console:1,
 		 silent:1; /* on some occasions we don't want to output the result set or the number of affected rows */
 	cq 	*q;		/* pointer to the cached query */
@@ -5844,6 +5844,7 @@ rel2bin_output(backend *be, sql_rel *rel, list *refs)
 	node *n;
 	const char *tsep, *rsep, *ssep, *ns;
 	const char *fn   = NULL;
+	const char *fmt = "csv";
 	int onclient = 0;
 	stmt *s = NULL, *fns = NULL, *res = NULL;
 	list *slist = sa_list(sql->sa);
@@ -5866,8 +5867,10 @@ rel2bin_output(backend *be, sql_rel *rel, list *refs)
 		fn = E_ATOM_STRING(n->next->next->next->next->data);
 		fns = stmt_atom_string(be, sa_strdup(sql->sa, fn));
 		onclient = E_ATOM_INT(n->next->next->next->next->next->data);
+		if (n->next->next->next->next->next->next)
+			fmt = sa_strdup(sql->sa, E_ATOM_STRING(n->next->next->next->next->next->next->data));
 	}
-	list_append(slist, stmt_export(be, s, tsep, rsep, ssep, ns, onclient, fns));
+	list_append(slist, stmt_export(be, s, tsep, rsep, ssep, ns, onclient, fns, fmt));
 	if (s->type == st_list && ((stmt*)s->op4.lval->h->data)->nrcols != 0) {
 		res = stmt_aggr(be, s->op4.lval->h->data, NULL, NULL, sql_bind_func(sql, "sys", "count", sql_bind_localtype("void"), NULL, F_AGGR), 1, 0, 1);
 	} else {
@@ -163,6 +163,7 @@ sqlcleanup(backend *be, int err)
 		be->mvc->session->status = err;
 	be->mvc->label = 0;
 	be->no_mitosis = 0;
+	be->cacheplan = 0;
 	scanner_query_processed(&(be->mvc->scanner));
 	return err;
 }
@@ -2552,8 +2553,6 @@ mvc_export_table_wrap( Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	char buf[80];
 	ssize_t sz;
 
-	(void) format;
-
 	if ((msg = getBackendContext(cntxt, &be)) != NULL)
 		return msg;
 	m = be->mvc;
@@ -2618,6 +2617,22 @@ mvc_export_table_wrap( Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	if ( msg )
 		goto wrapup_result_set1;
 
+	if (strcmp(format, "arrow") == 0) {
+		size_t fnlen = strlen(filename);
+
+		if ((s = open_wstream(filename)) == NULL || mnstr_errnr(s)) {
+			msg=  createException(IO, "streams.open", SQLSTATE(42000) "%s", mnstr_peek_error(NULL));
+			close_stream(s);
+			goto wrapup_result_set1;
+		}
+		/* the stream format for .arrows files, else the file format */
+		msg = mvc_export_arrow(be, s, res, fnlen < 7 || strcmp(filename + fnlen - 7, ".arrows") != 0);
+		if (msg == MAL_SUCCEED && mnstr_flush(s, MNSTR_FLUSH_DATA) != 0)
+			msg = createException(IO, "sql.export_table", SQLSTATE(42000) "Failed to write: %s", mnstr_peek_error(s));
+		close_stream(s);
+		goto wrapup_result_set1;
+	}
+
 	/* now select the file channel */
 	if ((tostdout = strcmp(filename,"stdout") == 0)) {
 		s = cntxt->fdout;
@@ -5131,6 +5146,7 @@ static mel_func sql_init_funcs[] = {
  //pattern("sql", "single", CMDBATsingle, false, "", args(1,2, batargany("",2),argany("x",2))),
  pattern("sql", "importTable", mvc_bin_import_table_wrap, true, "Import a table from the files (fname)", args(1,6, batvarargany("",0),arg("sname",str),arg("tname",str),arg("onclient",int),arg("bswap",bit),vararg("fname",str))),
  pattern("sql", "importColumn", mvc_bin_import_column_wrap, false, "Import a column from the given file", args(2, 7, batargany("", 0),arg("", oid), arg("method",str),arg("bswap",bit),arg("path",str),arg("onclient",int),arg("nrows",oid))),
+ pattern("sql", "importArrow", mvc_arrow_import_wrap, true, "Import the columns of a table from the given Arrow IPC file", args(1,6, batvarargany("",0),arg("sname",str),arg("tname",str),arg("path",str),arg("onclient",int),vararg("fieldnr",int))),
  command("aggr", "not_unique", not_unique, false, "check if the tail sorted bat b doesn't have unique tail values", args(1,2, arg("",bit),batarg("b",oid))),
  command("sql", "optimizers", getPipeCatalog, false, "", args(3,3, batarg("",str),batarg("",str),batarg("",str))),
  pattern("sql", "optimizer_updates", SQLoptimizersUpdate, false, "", noargs),
@@ -17,6 +17,7 @@
 #include "mal_interpreter.h"
 #include "copybinary.h"
 #include "copybinary_support.h"
+#include "mutils.h"
 
 #define bailout(...) do { \
 		msg = createException(MAL, "sql.importColumn", SQLSTATE(42000) __VA_ARGS__); \
@@ -440,6 +441,98 @@ end:
 	return msg;
 }
 
+// Mapped text files are split into chunks that each end in a \0 and the
+// chunks are turned into string BATs in parallel. The chunk BATs are then
+// concatenated in order, which for large string heaps means appending the
+// heaps wholesale rather than re-inserting the strings one by one.
+#define TEXT_CHUNK_MIN ((size_t) 8 << 20)
+
+struct textchunk {
+	char *start;
+	char *end;
+	BAT *bat;
+	str msg;
+};
+
+static gdk_return
+load_text_chunk(void *arg, size_t i)
+{
+	struct textchunk *ch = (struct textchunk *) arg + i;
+	char *start, *end;
+
+	for (start = ch->start; (end = memchr(start, '\0', ch->end - start)) != NULL; start = end + 1) {
+		ch->msg = append_text(ch->bat, start);
+		if (ch->msg != MAL_SUCCEED)
+			break;
+	}
+	return GDK_SUCCEED;
+}
+
+static str
+load_mapped_text(BAT **batp, int gdk_type, char *start, char *end)
+{
+	str msg = MAL_SUCCEED;
+	size_t len = end - start;
+	size_t nchunks = (size_t) GDKnr_threads;
+	struct textchunk *chunks;
+	BAT *bat;
+
+	if (end[-1] != '\0')
+		return createException(MAL, "sql.importColumn", SQLSTATE(42000) "unterminated string at end");
+
+	if (nchunks > len / TEXT_CHUNK_MIN)
+		nchunks = len / TEXT_CHUNK_MIN;
+	if (nchunks == 0)
+		nchunks = 1;
+	chunks = GDKzalloc(nchunks * sizeof(struct textchunk));
+	if (chunks == NULL)
+		return createException(SQL, "sql.importColumn", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	for (size_t c = 0; c < nchunks; c++) {
+		char *p = c == 0 ? start : chunks[c - 1].end;
+		char *q = c == nchunks - 1 ? end : start + len / nchunks * (c + 1);
+		// end each chunk just after a \0 so no string straddles two chunks
+		if (q < p)
+			q = p;
+		if (q < end) {
+			q = memchr(q, '\0', end - q);
+			q = q ? q + 1 : end;
+		}
+		chunks[c].start = p;
+		chunks[c].end = q;
+		// the BATs are created here since they belong to this thread
+		chunks[c].bat = COLnew(0, gdk_type, 0, TRANSIENT);
+		if (chunks[c].bat == NULL && msg == MAL_SUCCEED)
+			msg = createException(SQL, "sql.importColumn", GDK_EXCEPTION);
+	}
+	if (msg == MAL_SUCCEED) {
+		if (nchunks == 1)
+			(void) load_text_chunk(chunks, 0);
+		else if (GDKparallel(load_text_chunk, chunks, nchunks, (int) nchunks, "copytext") != GDK_SUCCEED)
+			msg = createException(SQL, "sql.importColumn", GDK_EXCEPTION);
+	}
+
+	bat = chunks[0].bat;
+	for (size_t c = 0; c < nchunks; c++) {
+		if (msg == MAL_SUCCEED && chunks[c].msg != MAL_SUCCEED) {
+			msg = chunks[c].msg;
+			chunks[c].msg = MAL_SUCCEED;
+		}
+		freeException(chunks[c].msg);
+		if (c > 0 && chunks[c].bat != NULL) {
+			if (msg == MAL_SUCCEED && BATappend(bat, chunks[c].bat, NULL, false) != GDK_SUCCEED)
+				msg = createException(SQL, "sql.importColumn", GDK_EXCEPTION);
+			BBPreclaim(chunks[c].bat);
+		}
+	}
+	GDKfree(chunks);
+	if (msg != MAL_SUCCEED) {
+		BBPreclaim(bat);
+		bat = NULL;
+	}
+	*batp = bat;
+	return msg;
+}
+
 
 // Dispatcher table for imports. We dispatch on a string value instead of for
 // example the underlying gdktype so we have freedom to some day implement for
@@ -450,7 +543,8 @@ end:
 
 // A 'loader' has complete freedom. It is handed a BAT and a stream and it can
 // then do whatever it wants. We use it to read strings and json and other
-// variable-width data.
+// variable-width data. Such an entry may also have a 'mapped_loader' which is
+// used instead when the data is in a local file that can be mapped into memory.
 //
 // If an entry has has 'convert_in_place' this means the external and internal
 // forms have the same size and are probably identical. In this case, the data
@@ -472,6 +566,7 @@ static struct type_rec {
 	char *method;
 	char *gdk_type;
 	str (*loader)(BAT *bat, stream *s, int *eof_reached);
+	str (*mapped_loader)(BAT **batp, int gdk_type, char *start, char *end);
 	str (*convert_fixed_width)(void *dst_start, void *dst_end, void *src_start, void *src_end, bool byteswap);
 	size_t record_size;
 	str (*convert_in_place)(void *start, void *end, bool byteswap);
@@ -488,9 +583,9 @@ static struct type_rec {
 	{ "hge", "hge", .convert_in_place=convert_hge, },
 #endif
 	//
-	{ "str", "str", .loader=load_zero_terminated_text },
-	{ "url", "url", .loader=load_zero_terminated_text },
-	{ "json", "json", .loader=load_zero_terminated_text },
+	{ "str", "str", .loader=load_zero_terminated_text, .mapped_loader=load_mapped_text },
+	{ "url", "url", .loader=load_zero_terminated_text, .mapped_loader=load_mapped_text },
+	{ "json", "json", .loader=load_zero_terminated_text, .mapped_loader=load_mapped_text },
 	{ "uuid", "uuid", .convert_in_place=convert_uuid, },
 	//
 	{ "date", "date", .convert_fixed_width=convert_date, .record_size=sizeof(copy_binary_date), },
@@ -544,6 +639,99 @@ load_column(struct type_rec *rec, const char *name, BAT *bat, stream *s, bool by
 }
 
 
+// Local files with fixed width values are mapped into memory instead of
+// read through a stream: if the file has the native layout of the column,
+// the mapping becomes the BAT's heap and nothing is copied until the data is
+// appended to the table, otherwise the values are converted straight from
+// the mapping into a heap that is allocated at its final size. Text files
+// are mapped as well and handed to the 'mapped_loader'.
+static bool
+can_map_column(struct type_rec *rec, const char *path, size_t *size)
+{
+	struct stat st;
+	const char *ext = strrchr(path, '.');
+
+	if (rec->convert_in_place == NULL && rec->convert_fixed_width == NULL && rec->mapped_loader == NULL)
+		return false;
+	// these are decompressed by open_rstream()
+	if (ext && (strcmp(ext, ".gz") == 0 || strcmp(ext, ".bz2") == 0 ||
+				strcmp(ext, ".xz") == 0 || strcmp(ext, ".lz4") == 0))
+		return false;
+	if (MT_stat(path, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+		return false;
+	*size = (size_t) st.st_size;
+	return true;
+}
+
+static str
+load_mapped_column(struct type_rec *rec, const char *path, size_t size, BAT **batp, bool byteswap, BUN rows_estimate)
+{
+	str msg = MAL_SUCCEED;
+	BAT *bat = NULL;
+	int gdk_type = ATOMindex(rec->gdk_type);
+	size_t record_size;
+	BUN n;
+
+	if (rec->mapped_loader != NULL) {
+		// private, since the text is validated and converted in place
+		char *src = GDKmmap(path, MMAP_READ | MMAP_COPY, size);
+		if (src == NULL)
+			bailout("%s", GDK_EXCEPTION);
+		msg = rec->mapped_loader(&bat, gdk_type, src, src + size);
+		GDKmunmap(src, size);
+		if (msg == MAL_SUCCEED && rows_estimate != 0 && rows_estimate != BATcount(bat))
+			bailout(
+				"inconsistent row count in %s: expected "BUNFMT", got "BUNFMT,
+				path,
+				rows_estimate, BATcount(bat));
+		goto end;
+	}
+
+	record_size = rec->convert_in_place ? (size_t) ATOMsize(gdk_type) : rec->record_size;
+	n = (BUN) (size / record_size);
+	if (size % record_size != 0)
+		bailout("final item incomplete: %d bytes instead of %d", (int) (size % record_size), (int) record_size);
+	if (rows_estimate != 0 && rows_estimate != n)
+		bailout(
+			"inconsistent row count in %s: expected "BUNFMT", got "BUNFMT,
+			path,
+			rows_estimate, n);
+
+	if (rec->convert_in_place != NULL) {
+		bat = BATattach_mmap(gdk_type, path);
+		if (bat == NULL)
+			bailout("%s", GDK_EXCEPTION);
+		// on little-endian machines this typically doesn't touch the data
+		msg = rec->convert_in_place(Tloc(bat, 0), Tloc(bat, n), byteswap);
+	} else {
+		char *src;
+
+		bat = COLnew(0, gdk_type, n, TRANSIENT);
+		if (bat == NULL)
+			bailout("%s", GDK_EXCEPTION);
+		// private, since byte swapping is done in the source
+		src = GDKmmap(path, MMAP_READ | MMAP_COPY, size);
+		if (src == NULL)
+			bailout("%s", GDK_EXCEPTION);
+		msg = rec->convert_fixed_width(Tloc(bat, 0), Tloc(bat, n), src, src + size, byteswap);
+		GDKmunmap(src, size);
+		BATsetcount(bat, n);
+		bat->tseqbase = oid_nil;
+		bat->tnonil = false;
+		bat->tnil = false;
+		bat->tsorted = bat->trevsorted = bat->tkey = n <= 1;
+	}
+
+end:
+	if (msg != MAL_SUCCEED && bat != NULL) {
+		BBPreclaim(bat);
+		bat = NULL;
+	}
+	*batp = bat;
+	return msg;
+}
+
+
 static str
 start_mapi_file_upload(backend *be, str path, stream **s)
 {
@@ -639,6 +827,12 @@ importColumn(backend *be, bat *ret, BUN *retcnt, str method, bool byteswap, str
 	gdk_type = ATOMindex(rec->gdk_type);
 	if (gdk_type < 0)
 		bailout("cannot load %s as %s: unknown atom type %s", path, method, rec->gdk_type);
+	size_t size;
+	if (!onclient && can_map_column(rec, path, &size)) {
+		msg = load_mapped_column(rec, path, size, &bat, byteswap, nrows);
+		eof_reached = 1;
+		goto end;
+	}
 	bat = COLnew(0, gdk_type, nrows, PERSISTENT);
 	if (bat == NULL)
 		bailout("%s", GDK_EXCEPTION);
@@ -729,3 +923,957 @@ mvc_bin_import_table_wrap(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pc
 
 	return createException(MAL, "mvc_bin_import_table_wrap", "MAL operator sql.importTable should have been replaced with sql.importColumn");
 }
+
+
+/*
+ * Implementation of COPY ARROW INTO
+ *
+ * The file is read sequentially as an Arrow IPC stream: the file
+ * format is the stream format preceded by a magic string and
+ * followed by a footer, which we don't need.  Each message consists
+ * of a flatbuffer with the metadata followed by a body with the
+ * buffers.  Fixed width values whose representation is the same in
+ * Arrow and GDK are copied with memcpy, everything else is converted
+ * value by value.
+ */
+
+#define abailout(...) do { \
+		msg = createException(MAL, "sql.importArrow", SQLSTATE(42000) __VA_ARGS__); \
+		goto end; \
+	} while (0)
+
+/* Arrow Type union tags */
+#define ARROW_Null		1
+#define ARROW_Int		2
+#define ARROW_FloatingPoint	3
+#define ARROW_Utf8		5
+#define ARROW_Bool		6
+#define ARROW_Decimal		7
+#define ARROW_Date		8
+#define ARROW_Time		9
+#define ARROW_Timestamp		10
+#define ARROW_Interval		11
+#define ARROW_Duration		18
+#define ARROW_LargeUtf8		20
+
+#ifdef HAVE_HGE
+typedef hge arrow_int;
+#define ARROW_INT_MAX	GDK_hge_max
+#else
+typedef lng arrow_int;
+#define ARROW_INT_MAX	GDK_lng_max
+#endif
+
+/* flatbuffer access, all positions are checked against the buffer
+ * length; position 0 (the root offset) doubles as "absent" */
+typedef struct {
+	const uint8_t *buf;
+	size_t len;
+} fbreader;
+
+static inline uint32_t
+fb_u32(const fbreader *fb, size_t pos)
+{
+	uint32_t v;
+	memcpy(&v, fb->buf + pos, 4);
+	return v;
+}
+
+/* position of field id of the table at tab, or 0 if absent */
+static size_t
+fb_field(const fbreader *fb, size_t tab, int id, size_t size)
+{
+	int32_t soff;
+	size_t vt;
+	uint16_t vtsize, off;
+
+	if (tab == 0 || fb->len < 4 || tab > fb->len - 4)
+		return 0;
+	/* the vtable is at tab - soff, which must be inside the
+	 * buffer; compare without wrapping around */
+	memcpy(&soff, fb->buf + tab, 4);
+	if (soff >= 0) {
+		if ((size_t) soff > tab)
+			return 0;
+		vt = tab - (size_t) soff;
+	} else {
+		if ((size_t) -(int64_t) soff > fb->len - tab)
+			return 0;
+		vt = tab + (size_t) -(int64_t) soff;
+	}
+	if (vt > fb->len - 4)
+		return 0;
+	memcpy(&vtsize, fb->buf + vt, 2);
+	if ((size_t) 4 + 2 * id + 2 > vtsize || vtsize > fb->len - vt)
+		return 0;
+	memcpy(&off, fb->buf + vt + 4 + 2 * id, 2);
+	if (off == 0 || off + size > fb->len - tab)
+		return 0;
+	return tab + off;
+}
+
+static lng
+fb_scalar(const fbreader *fb, size_t tab, int id, size_t size, lng dflt)
+{
+	size_t pos = fb_field(fb, tab, id, size);
+
+	if (pos == 0)
+		return dflt;
+	switch (size) {
+	case 1: return (int8_t) fb->buf[pos];
+	case 2: { int16_t v; memcpy(&v, fb->buf + pos, 2); return v; }
+	case 4: { int32_t v; memcpy(&v, fb->buf + pos, 4); return v; }
+	default: { int64_t v; memcpy(&v, fb->buf + pos, 8); return v; }
+	}
+}
+
+/* position of the object referred to by field id, or 0 */
+static size_t
+fb_deref(const fbreader *fb, size_t tab, int id)
+{
+	size_t pos = fb_field(fb, tab, id, 4);
+
+	if (pos == 0 || pos + fb_u32(fb, pos) + 4 > fb->len)
+		return 0;
+	return pos + fb_u32(fb, pos);
+}
+
+/* the elements of the vector at field id, with their number in *n */
+static size_t
+fb_vector(const fbreader *fb, size_t tab, int id, size_t elsize, size_t *n)
+{
+	size_t pos = fb_deref(fb, tab, id);
+
+	*n = 0;
+	if (pos == 0)
+		return 0;
+	*n = fb_u32(fb, pos);
+	if (*n > (fb->len - pos - 4) / elsize) {
+		*n = 0;
+		return 0;
+	}
+	return pos + 4;
+}
+
+struct arrowfield {
+	char name[64];
+	int type;
+	int bitwidth;		/* Int, Decimal, Time */
+	bool is_signed;		/* Int */
+	int precision, scale;	/* Decimal */
+	int unit;		/* FloatingPoint, Date, Time, Timestamp, Interval, Duration */
+};
+
+static const char *
+arrow_type_name(const struct arrowfield *f)
+{
+	switch (f->type) {
+	case ARROW_Null: return "Null";
+	case ARROW_Int: return "Int";
+	case ARROW_FloatingPoint: return "FloatingPoint";
+	case ARROW_Utf8: return "Utf8";
+	case ARROW_LargeUtf8: return "LargeUtf8";
+	case ARROW_Bool: return "Bool";
+	case ARROW_Decimal: return "Decimal";
+	case ARROW_Date: return "Date";
+	case ARROW_Time: return "Time";
+	case ARROW_Timestamp: return "Timestamp";
+	case ARROW_Interval: return "Interval";
+	case ARROW_Duration: return "Duration";
+	default: return "unsupported";
+	}
+}
+
+static str
+arrow_parse_schema(const fbreader *fb, size_t sch, struct arrowfield **fieldsp, size_t *nfields)
+{
+	str msg = MAL_SUCCEED;
+	struct arrowfield *fields = NULL;
+	size_t n, vec;
+
+	if (fb_scalar(fb, sch, 0, 2, 0) != 0)
+		abailout("COPY ARROW INTO: big-endian files are not supported");
+	vec = fb_vector(fb, sch, 1, 4, &n);
+	if (n == 0)
+		abailout("COPY ARROW INTO: schema has no fields");
+	if ((fields = GDKzalloc(n * sizeof(*fields))) == NULL) {
+		msg = createException(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto end;
+	}
+	for (size_t i = 0; i < n; i++) {
+		struct arrowfield *f = &fields[i];
+		size_t fld = vec + 4 * i, name, typ, nchildren;
+
+		fld += fb_u32(fb, fld);
+		if (fld >= fb->len)
+			abailout("COPY ARROW INTO: corrupt schema");
+		if ((name = fb_deref(fb, fld, 0)) != 0) {
+			size_t len = fb_u32(fb, name);
+			if (len >= sizeof(f->name))
+				len = sizeof(f->name) - 1;
+			if (name + 4 + len <= fb->len)
+				memcpy(f->name, fb->buf + name + 4, len);
+		}
+		f->type = (uint8_t) fb_scalar(fb, fld, 2, 1, 0);
+		typ = fb_deref(fb, fld, 3);
+		if (fb_deref(fb, fld, 4) != 0)
+			abailout("COPY ARROW INTO: field %s: dictionary encoding is not supported", f->name);
+		fb_vector(fb, fld, 5, 4, &nchildren);
+		if (nchildren > 0)
+			abailout("COPY ARROW INTO: field %s: nested types are not supported", f->name);
+		switch (f->type) {
+		case ARROW_Int:
+			f->bitwidth = (int) fb_scalar(fb, typ, 0, 4, 0);
+			f->is_signed = fb_scalar(fb, typ, 1, 1, 0) != 0;
+			if (f->bitwidth != 8 && f->bitwidth != 16 && f->bitwidth != 32 && f->bitwidth != 64)
+				abailout("COPY ARROW INTO: field %s: unsupported integer width %d", f->name, f->bitwidth);
+			break;
+		case ARROW_FloatingPoint:
+			f->unit = (int) fb_scalar(fb, typ, 0, 2, 0);
+			if (f->unit != 1 && f->unit != 2)
+				abailout("COPY ARROW INTO: field %s: half precision floating point is not supported", f->name);
+			break;
+		case ARROW_Decimal:
+			f->precision = (int) fb_scalar(fb, typ, 0, 4, 0);
+			f->scale = (int) fb_scalar(fb, typ, 1, 4, 0);
+			f->bitwidth = (int) fb_scalar(fb, typ, 2, 4, 128);
+			if (f->bitwidth != 128)
+				abailout("COPY ARROW INTO: field %s: unsupported decimal width %d", f->name, f->bitwidth);
+			if (f->scale < 0 || f->scale > 38)
+				abailout("COPY ARROW INTO: field %s: unsupported decimal scale %d", f->name, f->scale);
+			break;
+		case ARROW_Date:
+			f->unit = (int) fb_scalar(fb, typ, 0, 2, 1);	/* MILLISECOND */
+			break;
+		case ARROW_Time:
+			f->unit = (int) fb_scalar(fb, typ, 0, 2, 1);	/* MILLISECOND */
+			f->bitwidth = (int) fb_scalar(fb, typ, 1, 4, 32);
+			if (f->bitwidth != (f->unit <= 1 ? 32 : 64))
+				abailout("COPY ARROW INTO: field %s: invalid time width", f->name);
+			break;
+		case ARROW_Timestamp:
+		case ARROW_Duration:
+			f->unit = (int) fb_scalar(fb, typ, 0, 2, f->type == ARROW_Duration ? 1 : 0);
+			break;
+		case ARROW_Interval:
+			f->unit = (int) fb_scalar(fb, typ, 0, 2, 0);
+			if (f->unit != 0)
+				abailout("COPY ARROW INTO: field %s: only YEAR_MONTH intervals are supported", f->name);
+			break;
+		case ARROW_Null:
+		case ARROW_Utf8:
+		case ARROW_LargeUtf8:
+		case ARROW_Bool:
+			break;
+		default:
+			abailout("COPY ARROW INTO: field %s: type %d is not supported", f->name, f->type);
+		}
+		if (f->unit < 0 || f->unit > 3)
+			abailout("COPY ARROW INTO: field %s: invalid unit %d", f->name, f->unit);
+	}
+	*fieldsp = fields;
+	*nfields = n;
+	return MAL_SUCCEED;
+  end:
+	GDKfree(fields);
+	return msg;
+}
+
+static bool
+arrow_compatible(const struct arrowfield *f, sql_column *c)
+{
+	switch (f->type) {
+	case ARROW_Null:
+		return true;
+	case ARROW_Int:
+		return c->type.type->eclass == EC_NUM || c->type.type->eclass == EC_DEC;
+	case ARROW_Decimal:
+		return c->type.type->eclass == EC_DEC ? f->scale <= (int) c->type.scale :
+			c->type.type->eclass == EC_NUM && f->scale == 0;
+	case ARROW_Bool:
+		return c->type.type->eclass == EC_BIT;
+	case ARROW_FloatingPoint:
+		return c->type.type->eclass == EC_FLT;
+	case ARROW_Utf8:
+	case ARROW_LargeUtf8:
+		return EC_VARCHAR(c->type.type->eclass);
+	case ARROW_Date:
+		return c->type.type->eclass == EC_DATE;
+	case ARROW_Time:
+		return c->type.type->eclass == EC_TIME || c->type.type->eclass == EC_TIME_TZ;
+	case ARROW_Timestamp:
+		return c->type.type->eclass == EC_TIMESTAMP || c->type.type->eclass == EC_TIMESTAMP_TZ;
+	case ARROW_Interval:
+		return c->type.type->eclass == EC_MONTH;
+	case ARROW_Duration:
+		return c->type.type->eclass == EC_SEC;
+	default:
+		return false;
+	}
+}
+
+/* convert a value of the given unit (SECOND, MILLISECOND,
+ * MICROSECOND, NANOSECOND) to the unit tounit */
+static inline bool
+arrow_convert_unit(lng v, int unit, int tounit, lng *res)
+{
+	static const lng factor[] = {1, 1000, 1000000, 1000000000};
+
+	if (unit < tounit) {
+		lng m = factor[tounit - unit];
+		if (v > GDK_lng_max / m || v < -GDK_lng_max / m)
+			return false;
+		*res = v * m;
+	} else {
+		lng d = factor[unit - tounit];
+		*res = v / d - (v % d < 0);	/* round down */
+	}
+	return true;
+}
+
+/* read value i of a field with integer semantics */
+static inline bool
+arrow_get_int(const struct arrowfield *f, const uint8_t *data, BUN i, arrow_int *v)
+{
+	switch (f->type) {
+	case ARROW_Int:
+		switch (f->bitwidth) {
+		case 8:
+			*v = f->is_signed ? (arrow_int) ((const int8_t *) data)[i] : (arrow_int) data[i];
+			return true;
+		case 16:
+			*v = f->is_signed ? (arrow_int) ((const int16_t *) data)[i] : (arrow_int) ((const uint16_t *) data)[i];
+			return true;
+		case 32:
+			*v = f->is_signed ? (arrow_int) ((const int32_t *) data)[i] : (arrow_int) ((const uint32_t *) data)[i];
+			return true;
+		default:
+			if (f->is_signed) {
+				*v = ((const int64_t *) data)[i];
+			} else {
+				uint64_t u = ((const uint64_t *) data)[i];
+#ifndef HAVE_HGE
+				if (u > (uint64_t) GDK_lng_max)
+					return false;
+#endif
+				*v = (arrow_int) u;
+			}
+			return true;
+		}
+	case ARROW_Decimal: {
+		const lng *p = (const lng *) data + 2 * i;
+#ifdef HAVE_HGE
+		*v = ((hge) p[1] << 64) | (hge) (uint64_t) p[0];
+		return *v != GDK_hge_min;
+#else
+		*v = p[0];
+		return p[1] == (p[0] < 0 ? -1 : 0) && *v != GDK_lng_min;
+#endif
+	}
+	case ARROW_Interval:
+		*v = ((const int32_t *) data)[i];
+		return true;
+	case ARROW_Duration:
+	case ARROW_Timestamp:
+	case ARROW_Time: {
+		lng l = f->bitwidth == 32 ? (lng) ((const int32_t *) data)[i] : ((const int64_t *) data)[i];
+		int tounit = f->type == ARROW_Duration ? 1 : 2;	/* ms resp. usec */
+		if (!arrow_convert_unit(l, f->unit, tounit, &l))
+			return false;
+		*v = l;
+		return true;
+	}
+	case ARROW_Date:
+		if (f->unit == 0) {	/* DAY */
+			*v = ((const int32_t *) data)[i];
+		} else {		/* MILLISECOND */
+			lng ms = ((const int64_t *) data)[i];
+			*v = ms / 86400000 - (ms % 86400000 < 0);
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* the date days days after 1970-01-01; date_add_day walks month by
+ * month, which is too slow for bulk loads, so we use the direct
+ * conversion from http://howardhinnant.github.io/date_algorithms.html */
+static inline date
+arrow_date(lng days)
+{
+	lng z = days + 719468;
+	lng era = (z >= 0 ? z : z - 146096) / 146097;
+	lng doe = z - era * 146097;
+	lng yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	lng doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	lng mp = (5 * doy + 2) / 153;
+	int m = (int) (mp < 10 ? mp + 3 : mp - 9);
+	lng y = yoe + era * 400 + (m <= 2);
+
+	if (y < GDK_int_min || y > GDK_int_max)
+		return date_nil;
+	return date_create((int) y, m, (int) (doy - (153 * mp + 2) / 5 + 1));
+}
+
+static arrow_int
+arrow_pow10(int n)
+{
+	arrow_int r = 1;
+
+	while (n-- > 0)
+		r *= 10;
+	return r;
+}
+
+/* append n values of field f to b, the target of column c */
+static str
+arrow_load_field(BAT *b, sql_column *c, const struct arrowfield *f, BUN n,
+				 const uint8_t *valid, const uint8_t *data, const uint8_t *offsets)
+{
+	str msg = MAL_SUCCEED;
+	int tt = ATOMstorage(b->ttype);
+	BUN cnt = BATcount(b), i;
+	void *dst;
+
+#define ISVALID(i)	(valid == NULL || (valid[(i) / 8] >> ((i) % 8)) & 1)
+
+	if (BATcapacity(b) < cnt + n && BATextend(b, cnt + n) != GDK_SUCCEED)
+		abailout("%s", GDK_EXCEPTION);
+
+	if (f->type == ARROW_Null && ATOMvarsized(b->ttype)) {
+		for (i = 0; i < n; i++) {
+			if (BUNappend(b, ATOMnilptr(b->ttype), false) != GDK_SUCCEED)
+				abailout("%s", GDK_EXCEPTION);
+		}
+		return MAL_SUCCEED;
+	}
+	if (f->type == ARROW_Utf8 || f->type == ARROW_LargeUtf8) {
+		size_t cap = 0;
+		char *buf = NULL;
+
+		for (i = 0; i < n; i++) {
+			const char *v = str_nil;
+			if (ISVALID(i)) {
+				size_t lo, hi, len;
+				if (f->type == ARROW_Utf8) {
+					lo = (size_t) ((const uint32_t *) offsets)[i];
+					hi = (size_t) ((const uint32_t *) offsets)[i + 1];
+				} else {
+					lo = (size_t) ((const uint64_t *) offsets)[i];
+					hi = (size_t) ((const uint64_t *) offsets)[i + 1];
+				}
+				len = hi - lo;
+				if (len + 1 > cap) {
+					char *nbuf;
+					cap = len + 1 > 1024 ? len + 1 : 1024;
+					if ((nbuf = GDKrealloc(buf, cap)) == NULL) {
+						GDKfree(buf);
+						msg = createException(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+						goto end;
+					}
+					buf = nbuf;
+				}
+				memcpy(buf, data + lo, len);
+				buf[len] = 0;
+				if (strlen(buf) != len || !checkUTF8(buf) || strNil(buf)) {
+					GDKfree(buf);
+					abailout("COPY ARROW INTO: field %s: malformed utf-8 string", f->name);
+				}
+				if (c->type.digits > 0 && c->type.type->eclass != EC_STRING &&
+					UTF8_strlen(buf) > (int) c->type.digits) {
+					GDKfree(buf);
+					abailout("COPY ARROW INTO: field %s: value too long for type (var)char(%u)", f->name, c->type.digits);
+				}
+				v = buf;
+			}
+			if (BUNappend(b, v, false) != GDK_SUCCEED) {
+				GDKfree(buf);
+				abailout("%s", GDK_EXCEPTION);
+			}
+		}
+		GDKfree(buf);
+		return MAL_SUCCEED;
+	}
+
+	dst = Tloc(b, cnt);
+	if (f->type == ARROW_Null) {
+		const void *nil = ATOMnilptr(b->ttype);
+		size_t sz = ATOMsize(b->ttype);
+		for (i = 0; i < n; i++)
+			memcpy((char *) dst + i * sz, nil, sz);
+	} else if (f->type == ARROW_Bool) {
+		for (i = 0; i < n; i++)
+			((bit *) dst)[i] = ISVALID(i) ? (data[i / 8] >> (i % 8)) & 1 : bit_nil;
+	} else if (f->type == ARROW_FloatingPoint) {
+		if (tt == TYPE_dbl && f->unit == 2) {
+			memcpy(dst, data, n * sizeof(dbl));
+		} else {
+			for (i = 0; i < n; i++) {
+				dbl v = f->unit == 1 ? (dbl) ((const flt *) data)[i] : ((const dbl *) data)[i];
+				if (tt == TYPE_flt) {
+					if (isfinite(v) && (v > GDK_flt_max || v < -GDK_flt_max))
+						abailout("COPY ARROW INTO: field %s: value out of range", f->name);
+					((flt *) dst)[i] = (flt) v;
+				} else {
+					((dbl *) dst)[i] = v;
+				}
+			}
+		}
+		for (i = 0; i < n; i++) {
+			if (!ISVALID(i)) {
+				if (tt == TYPE_flt)
+					((flt *) dst)[i] = flt_nil;
+				else
+					((dbl *) dst)[i] = dbl_nil;
+			} else if (tt == TYPE_flt ? !isfinite(((flt *) dst)[i]) : !isfinite(((dbl *) dst)[i])) {
+				abailout("COPY ARROW INTO: field %s: infinite or NaN values are not supported", f->name);
+			}
+		}
+	} else if (f->type == ARROW_Int && f->is_signed && f->bitwidth == 8 * ATOMsize(tt) &&
+			   c->type.type->eclass == EC_NUM) {
+		/* same representation: copy, then set the nils and check
+		 * that no valid value collides with nil */
+		memcpy(dst, data, n * ATOMsize(tt));
+		switch (tt) {
+#define ARROW_FIXNILS(TYPE)												\
+		case TYPE_##TYPE:												\
+			for (i = 0; i < n; i++) {									\
+				if (!ISVALID(i))										\
+					((TYPE *) dst)[i] = TYPE##_nil;						\
+				else if (is_##TYPE##_nil(((TYPE *) dst)[i]))			\
+					abailout("COPY ARROW INTO: field %s: value out of range", f->name); \
+			}															\
+			break
+		ARROW_FIXNILS(bte);
+		ARROW_FIXNILS(sht);
+		ARROW_FIXNILS(int);
+		ARROW_FIXNILS(lng);
+		default:
+			assert(0);
+		}
+	} else {
+		int ec = c->type.type->eclass;
+		arrow_int mul = 1, max = ARROW_INT_MAX;
+
+		if (ec == EC_DEC) {
+			/* scale up to the column's scale, and check the
+			 * number of digits */
+			mul = arrow_pow10((int) c->type.scale - (f->type == ARROW_Decimal ? f->scale : 0));
+			if (c->type.digits < 38)
+				max = arrow_pow10((int) c->type.digits) - 1;
+		}
+		for (i = 0; i < n; i++) {
+			arrow_int v = 0;
+			bool nil = !ISVALID(i);
+
+			if (!nil) {
+				if (!arrow_get_int(f, data, i, &v))
+					abailout("COPY ARROW INTO: field %s: value out of range", f->name);
+				if (mul != 1) {
+					if (v > max / mul || v < -max / mul)
+						abailout("COPY ARROW INTO: field %s: value out of range", f->name);
+					v *= mul;
+				} else if (v > max || v < -max) {
+					abailout("COPY ARROW INTO: field %s: value out of range", f->name);
+				}
+			}
+			switch (ec) {
+			case EC_DATE: {
+				date d = date_nil;
+				if (!nil && (v > GDK_int_max || v < -GDK_int_max ||
+							 is_date_nil(d = arrow_date((lng) v))))
+					abailout("COPY ARROW INTO: field %s: date out of range", f->name);
+				((date *) dst)[i] = d;
+				continue;
+			}
+			case EC_TIME:
+			case EC_TIME_TZ:
+				if (!nil && (v < 0 || v >= DAY_USEC))
+					abailout("COPY ARROW INTO: field %s: time out of range", f->name);
+				((daytime *) dst)[i] = nil ? daytime_nil : (daytime) v;
+				continue;
+			case EC_TIMESTAMP:
+			case EC_TIMESTAMP_TZ: {
+				timestamp ts = timestamp_nil;
+				if (!nil) {
+					lng us = (lng) v, days = us / DAY_USEC - (us % DAY_USEC < 0);
+					date d = arrow_date(days);
+					if (is_date_nil(d))
+						abailout("COPY ARROW INTO: field %s: timestamp out of range", f->name);
+					ts = timestamp_create(d, us - days * DAY_USEC);
+				}
+				((timestamp *) dst)[i] = ts;
+				continue;
+			}
+			default:
+				break;
+			}
+			switch (tt) {
+#define ARROW_STORE(TYPE)												\
+			case TYPE_##TYPE:											\
+				if (nil)												\
+					((TYPE *) dst)[i] = TYPE##_nil;						\
+				else if (v > GDK_##TYPE##_max || v < -GDK_##TYPE##_max)	\
+					abailout("COPY ARROW INTO: field %s: value out of range", f->name); \
+				else													\
+					((TYPE *) dst)[i] = (TYPE) v;						\
+				break
+			ARROW_STORE(bte);
+			ARROW_STORE(sht);
+			ARROW_STORE(int);
+			ARROW_STORE(lng);
+#ifdef HAVE_HGE
+			ARROW_STORE(hge);
+#endif
+			default:
+				abailout("COPY ARROW INTO: field %s: unsupported target type", f->name);
+			}
+		}
+	}
+	BATsetcount(b, cnt + n);
+	b->tnonil = false;
+	b->tnil = false;
+	b->tsorted = b->trevsorted = false;
+	b->tkey = false;
+	b->tnosorted = b->tnorevsorted = 0;
+	b->tnokey[0] = b->tnokey[1] = 0;
+  end:
+	return msg;
+}
+
+/* read exactly n bytes: returns 1 on success, 0 at end of file
+ * before the first byte, and -1 on error or a truncated read */
+static int
+arrow_read(stream *s, void *buf, size_t n)
+{
+	size_t done = 0;
+
+	while (done < n) {
+		ssize_t r = mnstr_read(s, (char *) buf + done, 1, n - done);
+		if (r < 0)
+			return -1;
+		if (r == 0)
+			return done == 0 ? 0 : -1;
+		done += (size_t) r;
+	}
+	return 1;
+}
+
+static int
+arrow_nbuffers(const struct arrowfield *f)
+{
+	return f->type == ARROW_Null ? 0 : f->type == ARROW_Utf8 || f->type == ARROW_LargeUtf8 ? 3 : 2;
+}
+
+/* load one record batch into the BATs */
+static str
+arrow_load_batch(const fbreader *fb, size_t rb, const uint8_t *body, lng bodylen,
+				 struct arrowfield *fields, size_t nfields, BAT **bats, sql_column **cols,
+				 const int *fieldnrs, int ncols)
+{
+	str msg = MAL_SUCCEED;
+	lng length = fb_scalar(fb, rb, 0, 8, 0);
+	size_t nnodes, nbufs, nodes, bufs, b = 0;
+
+	if (fb_deref(fb, rb, 3) != 0)
+		abailout("COPY ARROW INTO: compressed record batches are not supported");
+	nodes = fb_vector(fb, rb, 1, 16, &nnodes);
+	bufs = fb_vector(fb, rb, 2, 16, &nbufs);
+	if (length < 0 || (BUN) length >= BUN_MAX || nnodes != nfields)
+		abailout("COPY ARROW INTO: corrupt record batch");
+	for (size_t k = 0; k < nfields; k++) {
+		struct arrowfield *f = &fields[k];
+		const uint8_t *buf[3] = {NULL, NULL, NULL};
+		lng node[2], ref[2];
+		BUN n = (BUN) length;
+		int i;
+
+		memcpy(node, fb->buf + nodes + 16 * k, 16);
+		if (node[0] != length)
+			abailout("COPY ARROW INTO: field %s: corrupt record batch", f->name);
+		if (b + arrow_nbuffers(f) > nbufs)
+			abailout("COPY ARROW INTO: field %s: corrupt record batch", f->name);
+		for (i = 0; i < arrow_nbuffers(f); i++, b++) {
+			/* the buffer holds length + extra values of width
+			 * bytes, or a bit per row if width is 0 */
+			lng width = i == 0 || f->type == ARROW_Bool ? 0 :
+				i == 1 && f->type == ARROW_Utf8 ? 4 :
+				i == 1 && f->type == ARROW_LargeUtf8 ? 8 :
+				i == 2 ? -1 :
+				f->type == ARROW_Decimal ? 16 :
+				f->type == ARROW_Interval || f->type == ARROW_Date ? (f->unit == 0 ? 4 : 8) :
+				f->type == ARROW_Time || f->type == ARROW_Int ? f->bitwidth / 8 :
+				f->type == ARROW_FloatingPoint ? (f->unit == 1 ? 4 : 8) :
+				8;
+			lng extra = i == 1 && (f->type == ARROW_Utf8 || f->type == ARROW_LargeUtf8);
+			lng need;
+
+			/* a buffer cannot be larger than the body, so
+			 * check the length before computing sizes */
+			if (width < 0)
+				need = 0;
+			else if (width == 0)
+				need = i == 0 && node[1] == 0 ? 0 : length / 8 + (length % 8 != 0);
+			else if (length > bodylen / width - extra)
+				abailout("COPY ARROW INTO: field %s: corrupt record batch", f->name);
+			else
+				need = (length + extra) * width;
+			memcpy(ref, fb->buf + bufs + 16 * b, 16);
+			if (ref[0] < 0 || ref[1] < need || ref[0] > bodylen || ref[1] > bodylen - ref[0])
+				abailout("COPY ARROW INTO: field %s: corrupt record batch", f->name);
+			if (ref[1] > 0 && i > 0 && ref[0] % 8 != 0)
+				abailout("COPY ARROW INTO: field %s: misaligned buffer", f->name);
+			if (need > 0)
+				buf[i] = body + ref[0];
+			else if (i == 2)
+				buf[i] = body + ref[0], need = ref[1];
+			if (i == 2) {
+				/* check the string offsets */
+				for (BUN j = 0; j < n; j++) {
+					uint64_t lo, hi;
+					if (f->type == ARROW_Utf8) {
+						lo = ((const uint32_t *) buf[1])[j];
+						hi = ((const uint32_t *) buf[1])[j + 1];
+					} else {
+						lo = ((const uint64_t *) buf[1])[j];
+						hi = ((const uint64_t *) buf[1])[j + 1];
+					}
+					if (lo > hi || hi > (uint64_t) need)
+						abailout("COPY ARROW INTO: field %s: corrupt string offsets", f->name);
+				}
+			}
+		}
+		if (f->type == ARROW_Utf8 || f->type == ARROW_LargeUtf8) {
+			/* offsets come before the data */
+			const uint8_t *offsets = buf[1];
+			buf[1] = buf[2];
+			buf[2] = offsets;
+		}
+		for (i = 0; i < ncols; i++) {
+			if (fieldnrs[i] == (int) k &&
+				(msg = arrow_load_field(bats[i], cols[i], f, n, node[1] ? buf[0] : NULL, buf[1], buf[2])) != MAL_SUCCEED)
+				goto end;
+		}
+	}
+  end:
+	return msg;
+}
+
+static str
+importArrow(backend *be, bat *rets, const int *types, int ncols, const char *sname, const char *tname, const char *path, int onclient, const int *fieldnrs)
+{
+	str msg = MAL_SUCCEED;
+	BAT **bats = NULL;
+	sql_column **cols = NULL;
+	struct arrowfield *fields = NULL;
+	size_t nfields = 0;
+	stream *s = NULL, *stream_to_close = NULL;
+	bool do_finish_mapi = false, eof_reached = false;
+	uint8_t *meta = NULL, *body = NULL;
+	int32_t prefix;
+	int i, r, nmapped = 0;
+	BUN total = 0;
+	sql_table *t;
+
+#ifdef WORDS_BIGENDIAN
+	abailout("COPY ARROW INTO: not supported on big-endian machines");
+#endif
+	if ((t = mvc_bind_table(be->mvc, mvc_bind_schema(be->mvc, sname), tname)) == NULL)
+		abailout("COPY ARROW INTO: no such table %s.%s", sname, tname);
+	if (ol_length(t->columns) != ncols)
+		abailout("COPY ARROW INTO: table %s has changed", tname);
+	if ((bats = GDKzalloc(ncols * sizeof(BAT *))) == NULL ||
+		(cols = GDKzalloc(ncols * sizeof(sql_column *))) == NULL) {
+		msg = createException(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto end;
+	}
+	i = 0;
+	for (node *n = ol_first_node(t->columns); n; n = n->next, i++) {
+		cols[i] = n->data;
+		if (fieldnrs[i] >= 0)
+			nmapped++;
+		if ((bats[i] = COLnew(0, types[i], 0, TRANSIENT)) == NULL)
+			abailout("%s", GDK_EXCEPTION);
+	}
+
+	// Open the input stream
+	if (onclient) {
+		do_finish_mapi = true;
+		msg = start_mapi_file_upload(be, (str) path, &s);
+		if (msg != MAL_SUCCEED)
+			goto end;
+	} else {
+		s = stream_to_close = open_rstream(path);
+		if (s == NULL)
+			abailout("Couldn't open '%s' on server: %s", path, mnstr_peek_error(NULL));
+	}
+
+	// The file format starts with a magic string, the stream format
+	// doesn't
+	if ((r = arrow_read(s, &prefix, 4)) <= 0)
+		abailout("COPY ARROW INTO: %s: empty or unreadable file", path);
+	if (memcmp(&prefix, "ARRO", 4) == 0) {
+		char magic[4];
+		if (arrow_read(s, magic, 4) <= 0 || memcmp(magic, "W1\0\0", 4) != 0)
+			abailout("COPY ARROW INTO: %s: not an Arrow file", path);
+		if ((r = arrow_read(s, &prefix, 4)) <= 0)
+			abailout("COPY ARROW INTO: %s: truncated file", path);
+	}
+
+	for (;;) {
+		fbreader fb;
+		size_t msgtab, header;
+		int type;
+		lng bodylen;
+
+		// A message starts with a continuation marker followed by
+		// the metadata length, or in the legacy format with just the
+		// length; a length of 0 marks the end of the stream
+		if (prefix == -1 && arrow_read(s, &prefix, 4) <= 0)
+			abailout("COPY ARROW INTO: %s: truncated file", path);
+		if (prefix == 0)
+			break;
+		if (prefix < 8 || prefix % 8 != 0)
+			abailout("COPY ARROW INTO: %s: not an Arrow file", path);
+		GDKfree(meta);
+		if ((meta = GDKmalloc(prefix)) == NULL) {
+			msg = createException(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			goto end;
+		}
+		if (arrow_read(s, meta, prefix) <= 0)
+			abailout("COPY ARROW INTO: %s: truncated file", path);
+		fb = (fbreader) {.buf = meta, .len = (size_t) prefix};
+		msgtab = fb_u32(&fb, 0);
+		type = (uint8_t) fb_scalar(&fb, msgtab, 1, 1, 0);
+		header = fb_deref(&fb, msgtab, 2);
+		bodylen = fb_scalar(&fb, msgtab, 3, 8, 0);
+		if (fb_scalar(&fb, msgtab, 0, 2, 0) < 3 || header == 0 || bodylen < 0 || (ulng) bodylen > (ulng) GDK_lng_max / 2)
+			abailout("COPY ARROW INTO: %s: unsupported or corrupt message", path);
+		GDKfree(body);
+		if ((body = GDKmalloc(bodylen > 0 ? (size_t) bodylen : 1)) == NULL) {
+			msg = createException(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			goto end;
+		}
+		if (bodylen > 0 && arrow_read(s, body, (size_t) bodylen) <= 0)
+			abailout("COPY ARROW INTO: %s: truncated file", path);
+
+		switch (type) {
+		case 1:		/* Schema */
+			if (fields != NULL)
+				abailout("COPY ARROW INTO: %s: more than one schema", path);
+			if ((msg = arrow_parse_schema(&fb, header, &fields, &nfields)) != MAL_SUCCEED)
+				goto end;
+			if (nfields != (size_t) nmapped)
+				abailout("COPY ARROW INTO: %s has %zu fields, %d columns are loaded", path, nfields, nmapped);
+			for (i = 0; i < ncols; i++) {
+				if (fieldnrs[i] >= 0 && !arrow_compatible(&fields[fieldnrs[i]], cols[i]))
+					abailout("COPY ARROW INTO: cannot load field %s of type %s into column %s of type %s",
+							 fields[fieldnrs[i]].name, arrow_type_name(&fields[fieldnrs[i]]),
+							 cols[i]->base.name, cols[i]->type.type->base.name);
+			}
+			break;
+		case 2:		/* DictionaryBatch */
+			abailout("COPY ARROW INTO: dictionary encoding is not supported");
+		case 3:		/* RecordBatch */
+			if (fields == NULL)
+				abailout("COPY ARROW INTO: %s: record batch before schema", path);
+			if ((msg = arrow_load_batch(&fb, header, body, bodylen, fields, nfields, bats, cols, fieldnrs, ncols)) != MAL_SUCCEED)
+				goto end;
+			total += (BUN) fb_scalar(&fb, header, 0, 8, 0);
+			break;
+		default:
+			abailout("COPY ARROW INTO: %s: unsupported message type %d", path, type);
+		}
+
+		if ((r = arrow_read(s, &prefix, 4)) < 0)
+			abailout("COPY ARROW INTO: %s: truncated file", path);
+		if (r == 0) {
+			/* the end of stream marker is optional */
+			eof_reached = true;
+			break;
+		}
+	}
+	if (fields == NULL)
+		abailout("COPY ARROW INTO: %s: no schema", path);
+
+	// Columns that are not loaded are filled with nils
+	for (i = 0; i < ncols; i++) {
+		if (fieldnrs[i] < 0) {
+			BAT *b = BATconstant(0, types[i], ATOMnilptr(types[i]), total, TRANSIENT);
+			if (b == NULL)
+				abailout("%s", GDK_EXCEPTION);
+			BBPunfix(bats[i]->batCacheid);
+			bats[i] = b;
+		}
+	}
+
+end:
+	if (do_finish_mapi) {
+		str msg1 = finish_mapi_file_upload(be, eof_reached);
+		if (msg == MAL_SUCCEED)
+			msg = msg1;
+		else
+			freeException(msg1);
+	}
+	if (stream_to_close)
+		close_stream(stream_to_close);
+	GDKfree(meta);
+	GDKfree(body);
+	GDKfree(fields);
+	GDKfree(cols);
+	if (bats) {
+		for (i = 0; i < ncols; i++) {
+			if (bats[i] == NULL)
+				continue;
+			if (msg == MAL_SUCCEED) {
+				rets[i] = bats[i]->batCacheid;
+				BBPkeepref(rets[i]);
+			} else {
+				BBPunfix(bats[i]->batCacheid);
+			}
+		}
+		GDKfree(bats);
+	}
+	return msg;
+}
+
+str
+mvc_arrow_import_wrap(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	// Entry point for sql.importArrow.
+	// Does the argument/return handling, the work is done by importArrow.
+	int ncols = pci->retc;
+	bat *rets = NULL;
+	int *types = NULL, *fieldnrs = NULL;
+	str msg = MAL_SUCCEED;
+
+	assert(pci->argc == 2 * pci->retc + 4);
+	const char *sname = *getArgReference_str(stk, pci, ncols);
+	const char *tname = *getArgReference_str(stk, pci, ncols + 1);
+	const char *path = *getArgReference_str(stk, pci, ncols + 2);
+	int onclient = *getArgReference_int(stk, pci, ncols + 3);
+
+	if (onclient && !cntxt->filetrans)
+		throw(MAL, "sql.importArrow", SQLSTATE(42000) "Cannot transfer files from client");
+	if ((types = GDKmalloc(ncols * sizeof(int))) == NULL ||
+		(fieldnrs = GDKmalloc(ncols * sizeof(int))) == NULL) {
+		GDKfree(types);
+		throw(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	for (int i = 0; i < ncols; i++) {
+		types[i] = getBatType(getArgType(mb, pci, i));
+		fieldnrs[i] = *getArgReference_int(stk, pci, ncols + 4 + i);
+	}
+	rets = (bat *) GDKzalloc(ncols * sizeof(bat));
+	if (rets == NULL) {
+		msg = createException(MAL, "sql.importArrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	} else if ((msg = importArrow(cntxt->sqlcontext, rets, types, ncols, sname, tname, path, onclient, fieldnrs)) == MAL_SUCCEED) {
+		for (int i = 0; i < ncols; i++)
+			*getArgReference_bat(stk, pci, i) = rets[i];
+	}
+	GDKfree(rets);
+	GDKfree(types);
+	GDKfree(fieldnrs);
+	return msg;
+}
@@ -765,7 +765,10 @@ drop_index(Client cntxt, mvc *sql, char *sname, char *iname)
 		sql_kc *ic = i->columns->h->data;
 		BAT *b = mvc_bind(sql, s->base.name, ic->c->t->base.name, ic->c->base.name, 0);
 		if (b) {
-			IMPSdestroy(b);
+			if (ATOMstorage(b->ttype) == TYPE_str)
+				NGRAMdestroy(b);
+			else
+				IMPSdestroy(b);
 			BBPunfix(b->batCacheid);
 		}
 	}
@@ -1277,7 +1280,12 @@ alter_table(Client cntxt, mvc *sql, char *sname, sql_table *t)
 				BAT *b = mvc_bind(sql, nt->s->base.name, nt->base.name, ic->c->base.name, 0);
 				if (b == NULL)
 					throw(SQL,"sql.alter_table",SQLSTATE(HY005) "Cannot access imprints index %s_%s_%s", s->base.name, t->base.name, i->base.name);
-				r = BATimprints(b);
+				/* on string columns, the imprints index is
+				 * a trigram index */
+				if (ATOMstorage(b->ttype) == TYPE_str)
+					r = BATngramidx(b);
+				else
+					r = BATimprints(b);
 				BBPunfix(b->batCacheid);
 				if (r != GDK_SUCCEED)
 					throw(SQL, "sql.alter_table", GDK_EXCEPTION);
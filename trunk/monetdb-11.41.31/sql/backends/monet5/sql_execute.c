@@ -688,8 +688,12 @@ SQLengineIntern(Client c, backend *be)
 		msg = SQLrun(c,m);
 
 cleanup_engine:
-	if (m->emode != m_deallocate && m->emode != m_prepare && m->type == Q_SCHEMA && m->qc != NULL)
-		qc_clean(m->qc);
+	if (m->emode != m_deallocate && m->emode != m_prepare && m->type == Q_SCHEMA) {
+		/* shared plans stay valid only for the unchanged catalog */
+		m->session->tr->schema_changed = 1;
+		if (m->qc != NULL)
+			qc_clean(m->qc);
+	}
 	if (msg) {
 		/* don't print exception decoration, just the message */
 /*
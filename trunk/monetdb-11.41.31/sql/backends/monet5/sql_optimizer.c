@@ -242,7 +242,8 @@ SQLoptimizeQuery(Client c, MalBlkPtr mb)
 		free_pipe = true;
 	}
 
-	msg = addOptimizers(c, mb, pipe, FALSE);
+	/* a shared plan will be reused later on, just like a prepared one */
+	msg = addOptimizers(c, mb, pipe, be->cacheplan);
 	if (free_pipe)
 		GDKfree(pipe);
 	if (msg)
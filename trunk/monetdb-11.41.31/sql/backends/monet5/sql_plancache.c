@@ -0,0 +1,552 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 1997 - July 2008 CWI, August 2008 - 2021 MonetDB B.V.
+ */
+
+/*
+ * Shared plan cache
+ * Plain queries are parsed, optimized and compiled into MAL by every
+ * session on its own, which for short point lookups dominates their
+ * latency.  The optimized MAL of such queries is therefore also kept
+ * in a cache that is shared by all sessions.  A session that issues
+ * the same query text under the same conditions copies the cached
+ * instructions into its query wrapper instead of compiling them.
+ *
+ * A plan is only valid for the catalog it was compiled against.  The
+ * store bumps its schema version whenever a transaction that executed
+ * DDL commits, and each session records the version at the start of
+ * its transaction; all sessions with the same version see the same
+ * committed catalog.  A session with uncommitted DDL bypasses the
+ * cache altogether.  Privileges are checked during compilation, hence
+ * the user and role are part of the key, just like the other session
+ * properties that influence the plan.
+ *
+ * Plans that depend on session local objects (temporary tables,
+ * variables, compiled SQL functions) are not shared.  Neither may a
+ * plan depend on the data itself, so the query is optimized like a
+ * prepared statement, i.e. binds of empty deltas are not turned into
+ * emptybinds (which the emptybind optimizer would remove).  Since that
+ * holds for every query of a session that may use the cache, the cache
+ * is off unless sql_plan_cache is set to the number of plans to keep.
+ *
+ * Queries that only differ in their constants would each get a plan of
+ * their own.  Therefore the parser collects the literals that are
+ * compared against a column or another expression, and these are turned
+ * into parameters A0, A1, ... of the query wrapper.  The cache key is the
+ * query text with those literals replaced by '?' followed by the types of
+ * the parameters.  The parameters get their values just before the plan is
+ * executed, as if they were constants.  The relational optimizer prunes
+ * the partitions of merge tables using the constants of the query, hence
+ * such queries are compiled with their literals after all, just like
+ * queries that fail to compile once their literals became parameters
+ * (e.g. when a GROUP BY expression contains one).
+ */
+#include "monetdb_config.h"
+#include "sql_plancache.h"
+#include "sql_optimizer.h"
+#include "sql_string.h"
+#include "rel_rel.h"
+#include "mal_instruction.h"
+#include "mal_session.h"
+#include "opt_prelude.h"
+
+typedef struct plan {
+	struct plan *next;
+	char *query;		/* cleaned query text */
+	BUN hash;
+	sqlid user_id, role_id, schema_id;
+	int timezone;
+	char *pipe;			/* optimizer pipeline */
+	ulng version;		/* store schema version of the catalog used */
+	int basevtop;		/* variables of the query wrapper before the query */
+	lng used;			/* tick of the last use */
+	MalBlkPtr mb;
+} plan;
+
+static MT_Lock plancache_lock = MT_LOCK_INITIALIZER(plancache_lock);
+static struct plancache {
+	plan *first;
+	int nr, max;
+	lng tick;
+} plancache;
+
+static void
+plan_destroy(plan *p)
+{
+	freeMalBlk(p->mb);
+	GDKfree(p->query);
+	GDKfree(p->pipe);
+	GDKfree(p);
+}
+
+void
+SQLplanCacheInit(int size)
+{
+	MT_lock_set(&plancache_lock);
+	plancache.max = size < 0 ? 0 : size;
+	MT_lock_unset(&plancache_lock);
+}
+
+void
+SQLplanCacheExit(void)
+{
+	MT_lock_set(&plancache_lock);
+	while (plancache.first) {
+		plan *p = plancache.first;
+		plancache.first = p->next;
+		plan_destroy(p);
+	}
+	plancache.nr = 0;
+	MT_lock_unset(&plancache_lock);
+}
+
+bool
+SQLplanCacheEnabled(void)
+{
+	return plancache.max > 0;
+}
+
+static const char *
+plan_pipe(Client c, mvc *m)
+{
+	const char *pipe = getSQLoptimizer(m);
+
+	/* same choice as SQLoptimizeQuery */
+	if (strcmp(pipe, "default_pipe") == 0 && strcmp(c->optimizer, "default_pipe") != 0)
+		pipe = c->optimizer;
+	return pipe;
+}
+
+/* the session may use (and contribute) shared plans */
+static bool
+plan_session_ok(mvc *m)
+{
+	if (plancache.max == 0 ||
+	    m->emode != m_normal ||
+	    m->emod != mod_none ||
+	    (m->params != NULL && m->literals == NULL) ||
+	    m->session->schema == NULL)
+		return false;
+	for (sql_trans *tr = m->session->tr; tr; tr = tr->parent)
+		if (tr->schema_changed)
+			return false;
+	return true;
+}
+
+static bool
+plan_match(plan *p, Client c, mvc *m, const char *query, BUN hash)
+{
+	return p->hash == hash &&
+		p->version == m->session->schema_version &&
+		p->user_id == m->user_id &&
+		p->role_id == m->role_id &&
+		p->schema_id == m->session->schema->base.id &&
+		p->timezone == m->timezone &&
+		strcmp(p->query, query) == 0 &&
+		strcmp(p->pipe, plan_pipe(c, m)) == 0;
+}
+
+/* give the parameters of the plan the values of the literals */
+static bool
+plan_bind(mvc *m, MalBlkPtr mb)
+{
+	char name[IDLENGTH];
+	int i = 0;
+
+	for (node *n = m->literals->h; n; n = n->next, i++) {
+		AtomNode *an = n->data;
+		int v;
+
+		snprintf(name, sizeof(name), "A%d", i);
+		if ((v = findVariable(mb, name)) < 0)
+			continue;	/* optimized away */
+		assert(getVarType(mb, v) == an->a->data.vtype);
+		VALclear(&getVarConstant(mb, v));
+		if (VALcopy(&getVarConstant(mb, v), &an->a->data) == NULL)
+			return false;
+		setVarConstant(mb, v);
+	}
+	return true;
+}
+
+/* the plan was compiled for the literals of another query */
+static bool
+plan_literals(Client c, mvc *m, MalBlkPtr mb)
+{
+	InstrPtr q = getInstrPtr(mb, 1);
+	const char *query = c->query;
+	char *escaped;
+
+	if (!plan_bind(m, mb))
+		return false;
+	if (getModuleId(q) != querylogRef || getFunctionId(q) != defineRef)
+		return true;
+	/* keep the actual query around for monitoring */
+	while (*query && isspace((unsigned char) *query))
+		query++;
+	if ((escaped = sql_escape_str(m->ta, (char *) query)) == NULL ||
+	    (escaped = GDKstrdup(escaped)) == NULL)
+		return false;
+	VALclear(&getVarConstant(mb, getArg(q, 1)));
+	VALset(&getVarConstant(mb, getArg(q, 1)), TYPE_str, escaped);
+	return true;
+}
+
+bool
+SQLplanCacheFind(Client c, backend *be, const char *query)
+{
+	mvc *m = be->mvc;
+	MalBlkPtr mb = c->curprg->def;
+	BUN hash;
+	plan *p;
+	int i;
+
+	if (!plan_session_ok(m) || mb->stop != 1)
+		return false;
+	hash = strHash(query);
+	MT_lock_set(&plancache_lock);
+	for (p = plancache.first; p; p = p->next)
+		if (plan_match(p, c, m, query, hash))
+			break;
+	if (p == NULL || p->basevtop != mb->vtop ||
+	    resizeMalBlk(mb, MAX(p->mb->ssize, p->mb->vsize)) < 0) {
+		MT_lock_unset(&plancache_lock);
+		return false;
+	}
+	for (i = p->basevtop; i < p->mb->vtop; i++) {
+		ValRecord v;
+
+		if (!VALcopy(&v, &p->mb->var[i].value))
+			break;
+		mb->var[i] = p->mb->var[i];
+		mb->var[i].value = v;
+		mb->vtop = i + 1;
+	}
+	if (i == p->mb->vtop) {
+		for (i = 1; i < p->mb->stop; i++) {
+			if ((mb->stmt[i] = copyInstruction(p->mb->stmt[i])) == NULL)
+				break;
+			mb->stop = i + 1;
+		}
+	}
+	if (mb->vtop != p->mb->vtop || mb->stop != p->mb->stop) {
+		/* out of memory, go and compile the query after all */
+		MT_lock_unset(&plancache_lock);
+		MSresetInstructions(mb, 1);
+		freeVariables(c, mb, NULL, p->basevtop, be->vid);
+		return false;
+	}
+	mb->vid = p->mb->vid;
+	mb->maxarg = p->mb->maxarg;
+	mb->optimize = 0;
+	p->used = ++plancache.tick;
+	MT_lock_unset(&plancache_lock);
+	if (m->literals && !plan_literals(c, m, mb)) {
+		MSresetInstructions(mb, 1);
+		freeVariables(c, mb, NULL, p->basevtop, be->vid);
+		return false;
+	}
+	m->type = Q_TABLE;
+	be->reloptimizer = 0;
+	return true;
+}
+
+/* will the plan of the query be offered to the cache once optimized? */
+bool
+SQLplanCacheWanted(backend *be)
+{
+	return be->mvc->type == Q_TABLE && plan_session_ok(be->mvc);
+}
+
+/* is the MAL function called compiled in the session's own module? */
+static bool
+plan_private_call(Client c, InstrPtr p)
+{
+	for (Symbol s = findSymbolInModule(c->usermodule, getFunctionId(p)); s; s = s->peer)
+		if (s->def == p->blk)
+			return true;
+	return false;
+}
+
+/* can the optimized plan be used by other sessions? */
+static bool
+plan_shareable(Client c, MalBlkPtr mb)
+{
+	for (int i = 1; i < mb->stop; i++) {
+		InstrPtr p = getInstrPtr(mb, i);
+
+		if (p->blk != NULL && plan_private_call(c, p))
+			return false;
+		if (getModuleId(p) != sqlRef)
+			continue;
+		if (getFunctionId(p) == emptybindRef ||
+		    getFunctionId(p) == emptybindidxRef ||
+		    getFunctionId(p) == getVariableRef ||
+		    getFunctionId(p) == setVariableRef)
+			return false;
+		if (getFunctionId(p) == bindRef ||
+		    getFunctionId(p) == bindidxRef ||
+		    getFunctionId(p) == tidRef) {
+			int a = getArg(p, p->retc + 1);
+
+			if (isVarConstant(mb, a) &&
+			    getVarConstant(mb, a).vtype == TYPE_str &&
+			    strcmp(getVarConstant(mb, a).val.sval, "tmp") == 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+void
+SQLplanCacheAdd(Client c, backend *be, const char *query, int basevtop)
+{
+	mvc *m = be->mvc;
+	MalBlkPtr mb = c->curprg->def;
+	BUN hash;
+	plan *p, *n, **victim = NULL;
+
+	if (!be->cacheplan || !SQLplanCacheWanted(be) || !plan_shareable(c, mb))
+		return;
+	if ((n = GDKmalloc(sizeof(plan))) == NULL)
+		return;
+	hash = strHash(query);
+	*n = (plan) {
+		.query = GDKstrdup(query),
+		.hash = hash,
+		.user_id = m->user_id,
+		.role_id = m->role_id,
+		.schema_id = m->session->schema->base.id,
+		.timezone = m->timezone,
+		.pipe = GDKstrdup(plan_pipe(c, m)),
+		.version = m->session->schema_version,
+		.basevtop = basevtop,
+		.mb = copyMalBlk(mb),
+	};
+	if (n->query == NULL || n->pipe == NULL || n->mb == NULL) {
+		if (n->mb)
+			freeMalBlk(n->mb);
+		GDKfree(n->query);
+		GDKfree(n->pipe);
+		GDKfree(n);
+		return;
+	}
+
+	MT_lock_set(&plancache_lock);
+	for (p = plancache.first; p; p = p->next) {
+		if (plan_match(p, c, m, query, hash)) {
+			/* another session was first */
+			MT_lock_unset(&plancache_lock);
+			plan_destroy(n);
+			return;
+		}
+	}
+	if (plancache.nr >= plancache.max) {
+		/* evict plans for an older catalog first, then the least recently used */
+		for (plan **pp = &plancache.first; *pp; pp = &(*pp)->next) {
+			if (victim == NULL ||
+			    ((*pp)->version < (*victim)->version) ||
+			    ((*pp)->version == (*victim)->version && (*pp)->used < (*victim)->used))
+				victim = pp;
+		}
+		if (victim) {
+			p = *victim;
+			*victim = p->next;
+			plancache.nr--;
+			plan_destroy(p);
+		}
+	}
+	n->used = ++plancache.tick;
+	n->next = plancache.first;
+	plancache.first = n;
+	plancache.nr++;
+	MT_lock_unset(&plancache_lock);
+}
+
+/* the type of the parameter that replaces a literal */
+static bool
+plan_param_type(sql_subtype *t, atom *a)
+{
+	if (a->isnull)
+		return false;
+	switch (a->tpe.type->eclass) {
+	case EC_NUM:
+		/* the digits of an integer literal depend on its value */
+		sql_init_subtype(t, a->tpe.type, a->tpe.type->digits, 0);
+		return true;
+	case EC_CHAR:
+	case EC_STRING:
+		return sql_find_subtype(t, "varchar", 0, 0);
+	case EC_DEC:
+	case EC_FLT:
+	case EC_TIME:
+	case EC_TIME_TZ:
+	case EC_DATE:
+	case EC_TIMESTAMP:
+	case EC_TIMESTAMP_TZ:
+		*t = a->tpe;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static int
+literal_cmp(const void *p1, const void *p2)
+{
+	const AtomNode *a1 = *(AtomNode * const *) p1;
+	const AtomNode *a2 = *(AtomNode * const *) p2;
+
+	return (a1->start > a2->start) - (a1->start < a2->start);
+}
+
+/* only plain queries end up in the cache */
+static bool
+plan_query(symbol *s)
+{
+	switch (s->token) {
+	case SQL_SELECT:
+		return ((SelectNode *) s)->into == NULL;
+	case SQL_JOIN:
+	case SQL_CROSS:
+	case SQL_UNION:
+	case SQL_EXCEPT:
+	case SQL_INTERSECT:
+	case SQL_VALUES:
+		return true;
+	default:
+		return false;
+	}
+}
+
+const char *
+SQLplanCacheParameterize(backend *be, const char *query)
+{
+	mvc *m = be->mvc;
+	const char *text = QUERY(m->scanner);
+	list *literals = m->literals;
+	AtomNode **lits;
+	sql_subtype *types;
+	char *key, *k;
+	int i, n = 0, cnt, end = 0;
+
+	m->literals = NULL;
+	if (literals == NULL || !plan_query(m->sym) || m->params != NULL || !plan_session_ok(m))
+		return query;
+	cnt = list_length(literals);
+	lits = SA_NEW_ARRAY(m->ta, AtomNode *, cnt);
+	types = SA_NEW_ARRAY(m->ta, sql_subtype, cnt);
+	key = SA_NEW_ARRAY(m->ta, char, strlen(text) + 1);
+	if (lits == NULL || types == NULL || key == NULL)
+		return query;
+	for (node *nd = literals->h; nd; nd = nd->next)
+		lits[n++] = nd->data;
+	qsort(lits, n, sizeof(AtomNode *), literal_cmp);
+
+	/* replace the literals in the query text by '?' */
+	k = key;
+	for (i = cnt = 0; i < n; i++) {
+		AtomNode *an = lits[i];
+
+		if (an->start < end || !plan_param_type(&types[cnt], an->a))
+			continue;
+		memcpy(k, text + end, an->start - end);
+		k += an->start - end;
+		*k++ = '?';
+		end = an->end;
+		lits[cnt++] = an;
+	}
+	if (cnt == 0)
+		return query;
+	strcpy(k, text + end);
+	if ((key = query_cleaned(m->ta, key)) == NULL ||
+	    (k = SA_NEW_ARRAY(m->sa, char, strlen(key) + cnt * (IDLENGTH + 24) + 1)) == NULL ||
+	    (m->literals = sa_list(m->sa)) == NULL)
+		return query;
+
+	/* the types of the parameters are part of the key */
+	query = k;
+	k = stpcpy(k, key);
+	for (i = 0; i < cnt; i++) {
+		AtomNode *an = lits[i];
+
+		k += sprintf(k, "\001%s(%u,%u)", types[i].type->base.name, types[i].digits, types[i].scale);
+		sql_add_param(m, NULL, &types[i]);
+		an->s.token = SQL_PARAMETER;
+		an->s.type = type_int;
+		an->s.data.i_val = i;
+		list_append(m->literals, an);
+	}
+	return query;
+}
+
+static sql_rel *
+plan_partitioned(visitor *v, sql_rel *rel)
+{
+	if (is_basetable(rel->op) && rel->l) {
+		sql_table *t = rel->l;
+
+		if (isMergeTable(t) || (t->s && t->s->parts && partition_find_part(v->sql->session->tr, t, NULL)))
+			v->changes++;
+	}
+	return rel;
+}
+
+sql_rel *
+SQLplanCacheRelation(backend *be, symbol *sym)
+{
+	mvc *m = be->mvc;
+	sql_rel *r = sql_symbol2relation(be, sym);
+	visitor v = { .sql = m };
+
+	if (m->literals == NULL)
+		return r;
+	if (r)
+		r = rel_visitor_topdown(&v, r, &plan_partitioned);
+	if (r == NULL || v.changes) {
+		/* compile the query with its literals after all */
+		for (node *n = m->literals->h; n; n = n->next) {
+			AtomNode *an = n->data;
+
+			an->s.token = SQL_ATOM;
+			an->s.type = type_symbol;
+			an->s.data.sym = NULL;
+		}
+		m->literals = NULL;
+		m->params = NULL;
+		m->errstr[0] = '\0';
+		m->session->status = 0;
+		r = sql_symbol2relation(be, sym);
+	}
+	return r;
+}
+
+int
+SQLplanCacheDeclare(backend *be, MalBlkPtr mb)
+{
+	char name[IDLENGTH];
+	int i = 0;
+
+	for (node *n = be->mvc->params->h; n; n = n->next, i++) {
+		sql_arg *a = n->data;
+		int v;
+
+		snprintf(name, sizeof(name), "A%d", i);
+		if ((v = newVariable(mb, name, strlen(name), a->type.type->localtype)) < 0) {
+			sql_error(be->mvc, 003, SQLSTATE(42000) "Internal error while compiling statement: variable id too long");
+			return -1;
+		}
+		setVarInit(mb, v);
+	}
+	return 0;
+}
+
+void
+SQLplanCacheBind(backend *be, MalBlkPtr mb)
+{
+	if (!plan_bind(be->mvc, mb))
+		mb->errors = createException(SQL, "SQLparser", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+}
@@ -0,0 +1,26 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 1997 - July 2008 CWI, August 2008 - 2021 MonetDB B.V.
+ */
+
+#ifndef _SQL_PLANCACHE_H_
+#define _SQL_PLANCACHE_H_
+#include "sql.h"
+
+extern void SQLplanCacheInit(int size);
+extern void SQLplanCacheExit(void);
+extern bool SQLplanCacheEnabled(void);
+extern bool SQLplanCacheFind(Client c, backend *be, const char *query);
+extern bool SQLplanCacheWanted(backend *be);
+extern void SQLplanCacheAdd(Client c, backend *be, const char *query, int basevtop);
+
+/* literals of plain queries as parameters of the cached plans */
+extern const char *SQLplanCacheParameterize(backend *be, const char *query);
+extern sql_rel *SQLplanCacheRelation(backend *be, symbol *sym);
+extern int SQLplanCacheDeclare(backend *be, MalBlkPtr mb);
+extern void SQLplanCacheBind(backend *be, MalBlkPtr mb);
+
+#endif /* _SQL_PLANCACHE_H_ */
@@ -14,6 +14,7 @@
 #include "sql_result.h"
 #include "str.h"
 #include "tablet.h"
+#include "mapi_prompt.h"
 #include "gdk_time.h"
 #include "bat/res_table.h"
 #include "bat/bat_storage.h"
@@ -586,6 +587,199 @@ sec_frstr(Column *c, int type, const char *s)
 	return (void *) r;
 }
 
+/*
+ * Bulk loads mostly consist of plainly formatted values.  For those
+ * the conversion functions below convert a whole run of values of a
+ * column at once, straight into the destination array, avoiding the
+ * generic per-value conversion.  A run ends at the first value that
+ * is not in the plain format (white space, decimal points, exponents,
+ * NULL, overflow, etc.).  That value is then converted by the frstr
+ * function of the column, which also deals with any errors.
+ */
+
+#define isdig(c)	((unsigned char) ((c) - '0') < 10)
+
+/* parse [-+]?[0-9]+ with an absolute value of at most max */
+static inline bool
+plain_lng(const char *p, lng max, lng *v)
+{
+	bool neg = false;
+	lng res = 0;
+
+	if (*p == '-') {
+		neg = true;
+		p++;
+	} else if (*p == '+') {
+		p++;
+	}
+	if (!isdig(*p))
+		return false;
+	do {
+		int d = *p++ - '0';
+		if (res > (max - d) / 10)
+			return false;
+		res = res * 10 + d;
+	} while (isdig(*p));
+	if (*p)
+		return false;
+	*v = neg ? -res : res;
+	return true;
+}
+
+#define NUM_BATFRSTR(TYPE, MAX)						\
+	do {								\
+		TYPE *d = dst;						\
+		for (k = 0; k < n; k++) {				\
+			if (s[k] == NULL || !plain_lng(s[k], MAX, &v))	\
+				break;					\
+			d[k] = (TYPE) v;				\
+		}							\
+	} while (0)
+
+static BUN
+num_batfrstr(Column *c, int type, char *const *s, BUN n, void *dst)
+{
+	BUN k = 0;
+	lng v;
+
+	(void) c;
+	switch (type) {
+	case TYPE_bte:
+		NUM_BATFRSTR(bte, GDK_bte_max);
+		break;
+	case TYPE_sht:
+		NUM_BATFRSTR(sht, GDK_sht_max);
+		break;
+	case TYPE_int:
+		NUM_BATFRSTR(int, GDK_int_max);
+		break;
+	case TYPE_lng:
+		NUM_BATFRSTR(lng, GDK_lng_max);
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		/* larger values go through the generic conversion */
+		NUM_BATFRSTR(hge, GDK_lng_max);
+		break;
+#endif
+	default:
+		break;
+	}
+	return k;
+}
+
+/* parse [-+]?[0-9]+(\.[0-9]*)? for a decimal with the given number
+ * of digits and scale, in the same way as DEC_FRSTR */
+static inline bool
+plain_dec(const char *p, unsigned int digits, unsigned int scale, lng *v)
+{
+	bool neg = false;
+	lng res = 0;
+	unsigned int i = 0;
+
+	if (*p == '-') {
+		neg = true;
+		p++;
+	} else if (*p == '+') {
+		p++;
+	}
+	if (!isdig(*p))
+		return false;
+	while (*p == '0')
+		p++;
+	for (; isdig(*p); p++) {
+		if (++i > digits - scale)
+			return false;
+		res = res * 10 + (*p - '0');
+	}
+	if (*p == '.') {
+		for (p++; isdig(*p); p++) {
+			if (scale == 0)
+				return false;
+			res = res * 10 + (*p - '0');
+			scale--;
+		}
+	}
+	if (*p)
+		return false;
+	while (scale > 0) {
+		res *= 10;
+		scale--;
+	}
+	*v = neg ? -res : res;
+	return true;
+}
+
+#define DEC_BATFRSTR(TYPE)						\
+	do {								\
+		TYPE *d = dst;						\
+		for (k = 0; k < n; k++) {				\
+			if (s[k] == NULL ||				\
+			    !plain_dec(s[k], t->digits, t->scale, &v))	\
+				break;					\
+			d[k] = (TYPE) v;				\
+		}							\
+	} while (0)
+
+static BUN
+dec_batfrstr(Column *c, int type, char *const *s, BUN n, void *dst)
+{
+	sql_subtype *t = &((sql_column *) c->extra)->type;
+	BUN k = 0;
+	lng v;
+
+	/* only when the result always fits in a lng */
+	if (t->digits > 18 || t->scale > t->digits)
+		return 0;
+	switch (type) {
+	case TYPE_bte:
+		DEC_BATFRSTR(bte);
+		break;
+	case TYPE_sht:
+		DEC_BATFRSTR(sht);
+		break;
+	case TYPE_int:
+		DEC_BATFRSTR(int);
+		break;
+	case TYPE_lng:
+		DEC_BATFRSTR(lng);
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		DEC_BATFRSTR(hge);
+		break;
+#endif
+	default:
+		break;
+	}
+	return k;
+}
+
+/* convert dates in the format YYYY-MM-DD */
+static BUN
+date_batfrstr(Column *c, int type, char *const *s, BUN n, void *dst)
+{
+	date *d = dst;
+	BUN k;
+
+	(void) c;
+	(void) type;
+	for (k = 0; k < n; k++) {
+		const char *p = s[k];
+		if (p == NULL ||
+		    !isdig(p[0]) || !isdig(p[1]) || !isdig(p[2]) || !isdig(p[3]) ||
+		    p[4] != '-' || !isdig(p[5]) || !isdig(p[6]) ||
+		    p[7] != '-' || !isdig(p[8]) || !isdig(p[9]) || p[10])
+			break;
+		d[k] = date_create((p[0] - '0') * 1000 + (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0'),
+				   (p[5] - '0') * 10 + (p[6] - '0'),
+				   (p[8] - '0') * 10 + (p[9] - '0'));
+		if (is_date_nil(d[k]))
+			break;
+	}
+	return k;
+}
+
 /* Literal parsing for SQL all pass through this routine */
 static void *
 _ASCIIadt_frStr(Column *c, int type, const char *s)
@@ -764,9 +958,14 @@ mvc_import_table(Client cntxt, BAT ***bats, mvc *m, bstream *bs, sql_table *t, c
 			if (col->type.type->eclass == EC_DEC) {
 				fmt[i].tostr = &dec_tostr;
 				fmt[i].frstr = &dec_frstr;
+				fmt[i].batfrstr = &dec_batfrstr;
 			} else if (col->type.type->eclass == EC_SEC) {
 				fmt[i].tostr = &dec_tostr;
 				fmt[i].frstr = &sec_frstr;
+			} else if (col->type.type->eclass == EC_NUM) {
+				fmt[i].batfrstr = &num_batfrstr;
+			} else if (col->type.type->eclass == EC_DATE) {
+				fmt[i].batfrstr = &date_batfrstr;
 			}
 			fmt[i].size = ATOMsize(fmt[i].adt);
 		}
@@ -1887,6 +2086,1009 @@ mvc_export_file(backend *b, stream *s, res_table *t)
 	return res;
 }
 
+/*
+ * Export in the Apache Arrow IPC format
+ * COPY ... INTO ARROW 'file' writes the result in the Arrow IPC file
+ * format, or in the IPC stream format if the file name ends in
+ * ".arrows".  Both consist of a schema message followed by record
+ * batch messages, each of which is a flatbuffer with the metadata
+ * followed by a body with the column buffers.  The flatbuffers are
+ * built front to back by the small builder below: a table is always
+ * written before the objects it refers to, so that all references
+ * point forward, as flatbuffers require.  The metadata is written in
+ * little-endian byte order, hence the export is only available on
+ * little-endian machines.
+ */
+
+#define ARROW_MAGIC		"ARROW1\0\0"
+#define ARROW_BATCH_ROWS	((BUN) 1 << 20)
+
+/* Arrow Type union tags */
+#define ARROW_Null		1
+#define ARROW_Int		2
+#define ARROW_FloatingPoint	3
+#define ARROW_Utf8		5
+#define ARROW_Bool		6
+#define ARROW_Decimal		7
+#define ARROW_Date		8
+#define ARROW_Time		9
+#define ARROW_Timestamp		10
+#define ARROW_Interval		11
+#define ARROW_Duration		18
+
+typedef struct {
+	char *buf;
+	size_t len, cap;
+	bool err;
+} fbbuilder;
+
+/* make room for size bytes at position pos (at or after the end) */
+static size_t
+fb_reserve(fbbuilder *fb, size_t pos, size_t size)
+{
+	if (fb->err)
+		return 0;
+	if (pos + size > fb->cap) {
+		size_t cap = fb->cap ? fb->cap : 1024;
+		char *buf;
+
+		while (cap < pos + size)
+			cap *= 2;
+		if ((buf = GDKrealloc(fb->buf, cap)) == NULL) {
+			fb->err = true;
+			return 0;
+		}
+		fb->buf = buf;
+		fb->cap = cap;
+	}
+	memset(fb->buf + fb->len, 0, pos + size - fb->len);
+	fb->len = pos + size;
+	return pos;
+}
+
+static void
+fb_put(fbbuilder *fb, size_t pos, const void *v, size_t size)
+{
+	if (!fb->err)
+		memcpy(fb->buf + pos, v, size);
+}
+
+#define fb_put8(fb, pos, v)	fb_put(fb, pos, &(uint8_t) {v}, 1)
+#define fb_put16(fb, pos, v)	fb_put(fb, pos, &(int16_t) {v}, 2)
+#define fb_put32(fb, pos, v)	fb_put(fb, pos, &(int32_t) {v}, 4)
+#define fb_put64(fb, pos, v)	fb_put(fb, pos, &(int64_t) {v}, 8)
+
+/* store a reference at pos to the object at target */
+static void
+fb_ref(fbbuilder *fb, size_t pos, size_t target)
+{
+	assert(fb->err || target > pos);
+	fb_put32(fb, pos, (uint32_t) (target - pos));
+}
+
+/* write a table with n fields of the given sizes (0 for absent
+ * fields), preceded by its vtable; the offsets of the fields within
+ * the table are returned in off */
+static size_t
+fb_table(fbbuilder *fb, int n, const uint8_t *sizes, uint16_t *off)
+{
+	size_t vt = fb_reserve(fb, (fb->len + 1) & ~(size_t) 1, 4 + 2 * n);
+	size_t tab;
+	uint16_t cur = 4;
+
+	/* lay out the fields largest first, so that they are aligned */
+	for (int sz = 8; sz > 0; sz /= 2) {
+		for (int i = 0; i < n; i++) {
+			if (sizes[i] == sz) {
+				cur = (cur + sz - 1) & ~(sz - 1);
+				off[i] = cur;
+				cur += sz;
+			} else if (sizes[i] == 0) {
+				off[i] = 0;
+			}
+		}
+	}
+	tab = fb_reserve(fb, (fb->len + 7) & ~(size_t) 7, cur);
+	fb_put16(fb, vt, 4 + 2 * n);
+	fb_put16(fb, vt + 2, cur);
+	for (int i = 0; i < n; i++)
+		fb_put16(fb, vt + 4 + 2 * i, off[i]);
+	fb_put32(fb, tab, (int32_t) (tab - vt));
+	return tab;
+}
+
+/* write a vector of n elements of the given size, returns the
+ * position of its length; the elements follow */
+static size_t
+fb_vector(fbbuilder *fb, size_t n, size_t size, size_t align)
+{
+	size_t pos;
+
+	if (align < 4)
+		align = 4;
+	pos = ((fb->len + 4 + align - 1) & ~(align - 1)) - 4;
+	pos = fb_reserve(fb, pos, 4 + n * size);
+	fb_put32(fb, pos, (int32_t) n);
+	return pos;
+}
+
+static size_t
+fb_string(fbbuilder *fb, const char *s)
+{
+	size_t n = strlen(s);
+	size_t pos = fb_vector(fb, n + 1, 1, 1);
+
+	fb_put32(fb, pos, (int32_t) n);
+	fb_put(fb, pos + 4, s, n);
+	return pos;
+}
+
+/* how a column is exported */
+struct arrowcol {
+	const char *name;
+	BAT *b;
+	sql_class eclass;
+	int type;		/* Arrow Type union tag */
+	int bitwidth;		/* Int and Decimal */
+	int precision, scale;	/* Decimal */
+	int unit;		/* FloatingPoint, Date, Time, Timestamp, Interval, Duration */
+	bool utc;		/* Timestamp */
+	/* buffers of the current record batch */
+	BUN nulls;
+	size_t len[3];
+	char *buf[3];
+};
+
+static str
+arrow_column(struct arrowcol *ac, res_col *c)
+{
+	sql_subtype *t = &c->type;
+
+	ac->name = c->name;
+	ac->eclass = t->type->eclass;
+	if (ac->b->ttype == TYPE_bit) {
+		ac->type = ARROW_Bool;
+		return MAL_SUCCEED;
+	}
+	switch (ATOMstorage(ac->b->ttype)) {
+	case TYPE_bte:
+	case TYPE_sht:
+	case TYPE_int:
+	case TYPE_lng:
+#ifdef HAVE_HGE
+	case TYPE_hge:
+#endif
+		switch (ac->eclass) {
+		case EC_DEC:
+			ac->type = ARROW_Decimal;
+			ac->bitwidth = 128;
+			ac->precision = t->digits;
+			ac->scale = t->scale;
+			return MAL_SUCCEED;
+		case EC_NUM:
+		case EC_POS:
+#ifdef HAVE_HGE
+			if (ATOMstorage(ac->b->ttype) == TYPE_hge) {
+				/* Arrow has no 128 bit integers */
+				ac->type = ARROW_Decimal;
+				ac->bitwidth = 128;
+				ac->precision = 38;
+				ac->scale = 0;
+				return MAL_SUCCEED;
+			}
+#endif
+			ac->type = ARROW_Int;
+			ac->bitwidth = 8 * ATOMsize(ac->b->ttype);
+			return MAL_SUCCEED;
+		case EC_MONTH:
+			ac->type = ARROW_Interval;
+			ac->unit = 0;	/* YEAR_MONTH */
+			return MAL_SUCCEED;
+		case EC_SEC:
+			ac->type = ARROW_Duration;
+			ac->unit = 1;	/* MILLISECOND */
+			return MAL_SUCCEED;
+		case EC_DATE:
+			ac->type = ARROW_Date;
+			ac->unit = 0;	/* DAY */
+			return MAL_SUCCEED;
+		case EC_TIME:
+		case EC_TIME_TZ:
+			ac->type = ARROW_Time;
+			ac->unit = 2;	/* MICROSECOND */
+			ac->bitwidth = 64;
+			return MAL_SUCCEED;
+		case EC_TIMESTAMP:
+		case EC_TIMESTAMP_TZ:
+			ac->type = ARROW_Timestamp;
+			ac->unit = 2;	/* MICROSECOND */
+			ac->utc = ac->eclass == EC_TIMESTAMP_TZ;
+			return MAL_SUCCEED;
+		default:
+			break;
+		}
+		break;
+	case TYPE_flt:
+	case TYPE_dbl:
+		ac->type = ARROW_FloatingPoint;
+		ac->unit = ATOMstorage(ac->b->ttype) == TYPE_flt ? 1 : 2; /* SINGLE, DOUBLE */
+		return MAL_SUCCEED;
+	case TYPE_str:
+		if (EC_VARCHAR(ac->eclass)) {
+			ac->type = ARROW_Utf8;
+			return MAL_SUCCEED;
+		}
+		break;
+	case TYPE_void:
+		ac->type = ARROW_Null;
+		return MAL_SUCCEED;
+	default:
+		break;
+	}
+	throw(SQL, "sql.export_table", SQLSTATE(42000) "COPY INTO ARROW: column %s: type %s not supported", c->name, t->type->base.name);
+}
+
+static size_t
+arrow_field(fbbuilder *fb, const struct arrowcol *ac)
+{
+	uint16_t off[6], toff[3];
+	size_t fld, pos, typ;
+
+	/* Field: name, nullable, type_type, type, dictionary, children */
+	fld = fb_table(fb, 6, (const uint8_t[6]) {4, 1, 1, 4, 0, 4}, off);
+	fb_put8(fb, fld + off[1], 1);
+	fb_put8(fb, fld + off[2], (uint8_t) ac->type);
+	pos = fb_string(fb, ac->name);
+	fb_ref(fb, fld + off[0], pos);
+	switch (ac->type) {
+	case ARROW_Int:		/* bitWidth, is_signed */
+		typ = fb_table(fb, 2, (const uint8_t[2]) {4, 1}, toff);
+		fb_put32(fb, typ + toff[0], ac->bitwidth);
+		fb_put8(fb, typ + toff[1], 1);
+		break;
+	case ARROW_Decimal:	/* precision, scale, bitWidth */
+		typ = fb_table(fb, 3, (const uint8_t[3]) {4, 4, 4}, toff);
+		fb_put32(fb, typ + toff[0], ac->precision);
+		fb_put32(fb, typ + toff[1], ac->scale);
+		fb_put32(fb, typ + toff[2], ac->bitwidth);
+		break;
+	case ARROW_Time:	/* unit, bitWidth */
+		typ = fb_table(fb, 2, (const uint8_t[2]) {2, 4}, toff);
+		fb_put16(fb, typ + toff[0], ac->unit);
+		fb_put32(fb, typ + toff[1], ac->bitwidth);
+		break;
+	case ARROW_Timestamp:	/* unit, timezone */
+		typ = fb_table(fb, 2, (const uint8_t[2]) {2, ac->utc ? 4 : 0}, toff);
+		fb_put16(fb, typ + toff[0], ac->unit);
+		if (ac->utc) {
+			pos = fb_string(fb, "UTC");
+			fb_ref(fb, typ + toff[1], pos);
+		}
+		break;
+	case ARROW_FloatingPoint: /* precision */
+	case ARROW_Date:	/* unit */
+	case ARROW_Interval:	/* unit */
+	case ARROW_Duration:	/* unit */
+		typ = fb_table(fb, 1, (const uint8_t[1]) {2}, toff);
+		fb_put16(fb, typ + toff[0], ac->unit);
+		break;
+	default:		/* Utf8, Bool, Null: no attributes */
+		typ = fb_table(fb, 0, NULL, toff);
+		break;
+	}
+	fb_ref(fb, fld + off[3], typ);
+	pos = fb_vector(fb, 0, 4, 4);
+	fb_ref(fb, fld + off[5], pos);
+	return fld;
+}
+
+static size_t
+arrow_schema(fbbuilder *fb, const struct arrowcol *cols, int ncols)
+{
+	uint16_t off[2];
+	size_t sch, vec;
+
+	/* Schema: endianness (Little is the default), fields */
+	sch = fb_table(fb, 2, (const uint8_t[2]) {0, 4}, off);
+	vec = fb_vector(fb, ncols, 4, 4);
+	fb_ref(fb, sch + off[1], vec);
+	for (int i = 0; i < ncols; i++)
+		fb_ref(fb, vec + 4 + 4 * i, arrow_field(fb, &cols[i]));
+	return sch;
+}
+
+/* start a Message with the given header type, returns the position
+ * where the header table has to be referenced */
+static size_t
+arrow_message(fbbuilder *fb, int type, lng bodylen)
+{
+	uint16_t off[4];
+	size_t msg;
+
+	fb->len = 0;
+	fb->err = false;
+	fb_reserve(fb, 0, 4);
+	/* Message: version, header_type, header, bodyLength */
+	msg = fb_table(fb, 4, (const uint8_t[4]) {2, 1, 4, bodylen ? 8 : 0}, off);
+	fb_put32(fb, 0, (int32_t) msg);	/* root table */
+	fb_put16(fb, msg + off[0], 4);	/* MetadataVersion V5 */
+	fb_put8(fb, msg + off[1], (uint8_t) type);
+	if (bodylen)
+		fb_put64(fb, msg + off[3], bodylen);
+	return msg + off[2];
+}
+
+static const char arrow_zeros[8];
+
+/* write an encapsulated message: continuation marker, length,
+ * metadata padded to a multiple of 8 bytes */
+static bool
+arrow_write_message(stream *s, fbbuilder *fb, int32_t *metalen)
+{
+	size_t pad = (8 - (fb->len + 8) % 8) % 8;
+	int32_t len = (int32_t) (fb->len + pad);
+
+	if (fb->err)
+		return false;
+	*metalen = len + 8;
+	return mnstr_write(s, "\377\377\377\377", 4, 1) == 1 &&
+		mnstr_write(s, &len, 4, 1) == 1 &&
+		mnstr_write(s, fb->buf, fb->len, 1) == 1 &&
+		(pad == 0 || mnstr_write(s, arrow_zeros, pad, 1) == 1);
+}
+
+#define arrow_pad8(n)	(((n) + 7) & ~(size_t) 7)
+
+/* fill the buffers of a column for the rows [lo, hi) */
+static str
+arrow_fill(struct arrowcol *ac, BATiter *bi, BUN lo, BUN hi)
+{
+	BUN n = hi - lo, i;
+	uint8_t *valid;
+	size_t width;
+
+	ac->nulls = 0;
+	ac->len[0] = ac->len[1] = ac->len[2] = 0;
+	if (ac->type == ARROW_Null) {
+		ac->nulls = n;
+		return MAL_SUCCEED;
+	}
+	width = ac->type == ARROW_Bool ? 0 :
+		ac->type == ARROW_Decimal ? 16 :
+		ac->type == ARROW_Utf8 ? 4 :
+		ac->type == ARROW_Date || ac->type == ARROW_Interval ? 4 :
+		ac->type == ARROW_Int || ac->type == ARROW_FloatingPoint ? ATOMsize(ac->b->ttype) :
+		8;
+	ac->len[0] = (n + 7) / 8;
+	ac->len[1] = width ? (n + (ac->type == ARROW_Utf8)) * width : (n + 7) / 8;
+	if ((ac->buf[0] = GDKzalloc(arrow_pad8(ac->len[0]))) == NULL ||
+		(ac->buf[1] = GDKzalloc(arrow_pad8(ac->len[1]))) == NULL)
+		throw(SQL, "sql.export_table", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	valid = (uint8_t *) ac->buf[0];
+
+#define ARROW_FILL(TYPE, DST, CONV)					\
+	do {								\
+		const TYPE *src = (const TYPE *) bi->base + lo;		\
+		DST *dst = (DST *) ac->buf[1];				\
+		for (i = 0; i < n; i++) {				\
+			if (is_##TYPE##_nil(src[i])) {			\
+				ac->nulls++;				\
+			} else {					\
+				valid[i / 8] |= 1 << (i % 8);		\
+				dst[i] = CONV(src[i]);			\
+			}						\
+		}							\
+	} while (0)
+#define ARROW_ASIS(v)	(v)
+#define ARROW_DAYS(v)	date_diff(v, epoch)
+#define ARROW_USEC(v)	timestamp_diff(v, unixepoch)
+
+	switch (ac->type) {
+	case ARROW_Bool: {
+		const bit *src = (const bit *) bi->base + lo;
+		uint8_t *dst = (uint8_t *) ac->buf[1];
+		for (i = 0; i < n; i++) {
+			if (is_bit_nil(src[i])) {
+				ac->nulls++;
+			} else {
+				valid[i / 8] |= 1 << (i % 8);
+				if (src[i])
+					dst[i / 8] |= 1 << (i % 8);
+			}
+		}
+		break;
+	}
+	case ARROW_Date: {
+		const date epoch = date_create(1970, 1, 1);
+		ARROW_FILL(date, int, ARROW_DAYS);
+		break;
+	}
+	case ARROW_Timestamp:
+		ARROW_FILL(timestamp, lng, ARROW_USEC);
+		break;
+	case ARROW_Time:
+		ARROW_FILL(daytime, lng, ARROW_ASIS);
+		break;
+	case ARROW_Decimal:
+		/* sign extend to 128 bits, little-endian */
+		switch (ATOMstorage(ac->b->ttype)) {
+#ifdef HAVE_HGE
+#define ARROW_DEC(TYPE)							\
+		case TYPE_##TYPE:					\
+			ARROW_FILL(TYPE, hge, ARROW_ASIS);		\
+			break
+#else
+#define ARROW_DEC(TYPE)							\
+		case TYPE_##TYPE: {					\
+			const TYPE *src = (const TYPE *) bi->base + lo;	\
+			lng *dst = (lng *) ac->buf[1];			\
+			for (i = 0; i < n; i++) {			\
+				if (is_##TYPE##_nil(src[i])) {		\
+					ac->nulls++;			\
+				} else {				\
+					valid[i / 8] |= 1 << (i % 8);	\
+					dst[2 * i] = src[i];		\
+					dst[2 * i + 1] = src[i] < 0 ? -1 : 0; \
+				}					\
+			}						\
+			break;						\
+		}
+#endif
+		ARROW_DEC(bte);
+		ARROW_DEC(sht);
+		ARROW_DEC(int);
+		ARROW_DEC(lng);
+#ifdef HAVE_HGE
+		ARROW_DEC(hge);
+#endif
+		default:
+			assert(0);
+		}
+		break;
+	case ARROW_Utf8: {
+		int32_t *offsets = (int32_t *) ac->buf[1];
+		size_t len = 0, cap = 0;
+		char *data = NULL;
+
+		for (i = 0; i < n; i++) {
+			const char *v = BUNtvar(*bi, lo + i);
+			offsets[i] = (int32_t) len;
+			if (strNil(v)) {
+				ac->nulls++;
+				continue;
+			}
+			valid[i / 8] |= 1 << (i % 8);
+			size_t l = strlen(v);
+			if (len + l > cap) {
+				char *ndata;
+				cap = cap ? cap : 1 << 16;
+				while (len + l > cap)
+					cap *= 2;
+				if ((ndata = GDKrealloc(data, arrow_pad8(cap))) == NULL) {
+					GDKfree(data);
+					throw(SQL, "sql.export_table", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+				}
+				data = ndata;
+			}
+			memcpy(data + len, v, l);
+			len += l;
+		}
+		offsets[n] = (int32_t) len;
+		if (data)
+			memset(data + len, 0, arrow_pad8(len) - len);
+		ac->buf[2] = data;
+		ac->len[2] = len;
+		break;
+	}
+	default:
+		/* the layout of these is the same in Arrow and GDK */
+		switch (ATOMstorage(ac->b->ttype)) {
+		case TYPE_bte:
+			ARROW_FILL(bte, bte, ARROW_ASIS);
+			break;
+		case TYPE_sht:
+			ARROW_FILL(sht, sht, ARROW_ASIS);
+			break;
+		case TYPE_int:
+			ARROW_FILL(int, int, ARROW_ASIS);
+			break;
+		case TYPE_lng:
+			ARROW_FILL(lng, lng, ARROW_ASIS);
+			break;
+		case TYPE_flt:
+			ARROW_FILL(flt, flt, ARROW_ASIS);
+			break;
+		case TYPE_dbl:
+			ARROW_FILL(dbl, dbl, ARROW_ASIS);
+			break;
+		default:
+			assert(0);
+		}
+		break;
+	}
+	if (ac->nulls == 0)
+		ac->len[0] = 0;	/* validity bitmap may be omitted */
+	return MAL_SUCCEED;
+}
+
+static int
+arrow_nbuffers(const struct arrowcol *ac)
+{
+	return ac->type == ARROW_Null ? 0 : ac->type == ARROW_Utf8 ? 3 : 2;
+}
+
+/* the number of rows from lo that fit in a record batch: at most
+ * ARROW_BATCH_ROWS, and with less than 2GiB of string data per column
+ * since Utf8 uses 32 bit offsets */
+static BUN
+arrow_batch_end(struct arrowcol *cols, BATiter *bis, int ncols, BUN lo, BUN cnt)
+{
+	BUN hi = cnt - lo > ARROW_BATCH_ROWS ? lo + ARROW_BATCH_ROWS : cnt;
+
+	for (int c = 0; c < ncols; c++) {
+		size_t len = 0;
+		if (cols[c].type != ARROW_Utf8)
+			continue;
+		for (BUN i = lo; i < hi; i++) {
+			const char *v = BUNtvar(bis[c], i);
+			if (!strNil(v) && (len += strlen(v)) > (size_t) GDK_int_max) {
+				hi = i > lo ? i : lo + 1;
+				break;
+			}
+		}
+	}
+	return hi;
+}
+
+str
+mvc_export_arrow(backend *be, stream *s, int res_id, bool fileformat)
+{
+	res_table *t = res_tables_find(be->results, res_id);
+	struct arrowcol *cols = NULL;
+	BATiter *bis = NULL;
+	fbbuilder fb = {0};
+	struct {
+		lng offset;
+		int32_t metalen;
+		lng bodylen;
+	} *blocks = NULL;
+	size_t nblocks = 0;
+	lng pos = 0;
+	int32_t metalen;
+	BUN cnt = 0, lo, hi;
+	int ncols, c, k;
+	str msg = MAL_SUCCEED;
+
+#ifdef WORDS_BIGENDIAN
+	(void) s;
+	(void) fileformat;
+	if (t)
+		be->results = res_tables_remove(be->results, t);
+	throw(SQL, "sql.export_table", SQLSTATE(42000) "COPY INTO ARROW: not supported on big-endian machines");
+#else
+	if (t == NULL)
+		throw(SQL, "sql.export_table", SQLSTATE(42000) "Result set not found");
+	ncols = t->nr_cols;
+	if ((cols = GDKzalloc(ncols * sizeof(*cols))) == NULL ||
+		(bis = GDKzalloc(ncols * sizeof(*bis))) == NULL) {
+		msg = createException(SQL, "sql.export_table", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto bailout;
+	}
+	for (c = 0; c < ncols; c++) {
+		if ((cols[c].b = BATdescriptor(t->cols[c].b)) == NULL) {
+			msg = createException(SQL, "sql.export_table", SQLSTATE(HY005) "Cannot access column descriptor");
+			goto bailout;
+		}
+		if (cols[c].b->ttype == TYPE_void && !is_oid_nil(cols[c].b->tseqbase)) {
+			/* materialize dense oid columns */
+			BAT *m = COLcopy(cols[c].b, TYPE_oid, true, TRANSIENT);
+			BBPunfix(cols[c].b->batCacheid);
+			if ((cols[c].b = m) == NULL) {
+				msg = createException(SQL, "sql.export_table", GDK_EXCEPTION);
+				goto bailout;
+			}
+		}
+		bis[c] = bat_iterator(cols[c].b);
+		cnt = BATcount(cols[c].b);
+		if ((msg = arrow_column(&cols[c], &t->cols[c])) != MAL_SUCCEED)
+			goto bailout;
+	}
+
+	/* schema */
+	if (fileformat) {
+		if (mnstr_write(s, ARROW_MAGIC, 8, 1) != 1)
+			goto writeerror;
+		pos = 8;
+	}
+	k = (int) arrow_message(&fb, 1, 0);	/* Schema */
+	fb_ref(&fb, k, arrow_schema(&fb, cols, ncols));
+	if (!arrow_write_message(s, &fb, &metalen))
+		goto writeerror;
+	pos += metalen;
+
+	/* record batches */
+	for (lo = 0; lo < cnt || lo == 0; lo = hi) {
+		uint16_t off[3];
+		size_t rb, vec;
+		lng bodylen = 0, bufoff = 0;
+		int nbuf = 0;
+
+		hi = arrow_batch_end(cols, bis, ncols, lo, cnt);
+		for (c = 0; c < ncols; c++) {
+			if ((msg = arrow_fill(&cols[c], &bis[c], lo, hi)) != MAL_SUCCEED)
+				goto bailout;
+			for (k = 0; k < arrow_nbuffers(&cols[c]); k++)
+				bodylen += arrow_pad8(cols[c].len[k]);
+			nbuf += arrow_nbuffers(&cols[c]);
+		}
+
+		k = (int) arrow_message(&fb, 3, bodylen);	/* RecordBatch */
+		/* RecordBatch: length, nodes, buffers */
+		rb = fb_table(&fb, 3, (const uint8_t[3]) {8, 4, 4}, off);
+		fb_ref(&fb, k, rb);
+		fb_put64(&fb, rb + off[0], (lng) (hi - lo));
+		vec = fb_vector(&fb, ncols, 16, 8);
+		fb_ref(&fb, rb + off[1], vec);
+		for (c = 0; c < ncols; c++) {
+			/* FieldNode: length, null_count */
+			fb_put64(&fb, vec + 4 + 16 * c, (lng) (hi - lo));
+			fb_put64(&fb, vec + 4 + 16 * c + 8, (lng) cols[c].nulls);
+		}
+		vec = fb_vector(&fb, nbuf, 16, 8);
+		fb_ref(&fb, rb + off[2], vec);
+		nbuf = 0;
+		for (c = 0; c < ncols; c++) {
+			for (k = 0; k < arrow_nbuffers(&cols[c]); k++, nbuf++) {
+				/* Buffer: offset, length */
+				fb_put64(&fb, vec + 4 + 16 * nbuf, bufoff);
+				fb_put64(&fb, vec + 4 + 16 * nbuf + 8, (lng) cols[c].len[k]);
+				bufoff += arrow_pad8(cols[c].len[k]);
+			}
+		}
+		if (!arrow_write_message(s, &fb, &metalen))
+			goto writeerror;
+		for (c = 0; c < ncols; c++) {
+			for (k = 0; k < arrow_nbuffers(&cols[c]); k++) {
+				size_t len = arrow_pad8(cols[c].len[k]);
+				if (len > 0 && mnstr_write(s, cols[c].buf[k], len, 1) != 1)
+					goto writeerror;
+			}
+			for (k = 0; k < 3; k++) {
+				GDKfree(cols[c].buf[k]);
+				cols[c].buf[k] = NULL;
+			}
+		}
+		if (fileformat) {
+			if (nblocks % 64 == 0) {
+				void *nblk = GDKrealloc(blocks, (nblocks + 64) * sizeof(*blocks));
+				if (nblk == NULL) {
+					msg = createException(SQL, "sql.export_table", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+					goto bailout;
+				}
+				blocks = nblk;
+			}
+			blocks[nblocks].offset = pos;
+			blocks[nblocks].metalen = metalen;
+			blocks[nblocks].bodylen = bodylen;
+			nblocks++;
+		}
+		pos += metalen + bodylen;
+		if (hi == cnt)
+			break;
+	}
+
+	/* end of stream marker */
+	if (mnstr_write(s, "\377\377\377\377\0\0\0\0", 8, 1) != 1)
+		goto writeerror;
+
+	if (fileformat) {
+		uint16_t off[4];
+		size_t ftr, vec;
+		int32_t len;
+
+		fb.len = 0;
+		fb_reserve(&fb, 0, 4);
+		/* Footer: version, schema, dictionaries, recordBatches */
+		ftr = fb_table(&fb, 4, (const uint8_t[4]) {2, 4, 4, 4}, off);
+		fb_put32(&fb, 0, (int32_t) ftr);
+		fb_put16(&fb, ftr + off[0], 4);	/* MetadataVersion V5 */
+		fb_ref(&fb, ftr + off[1], arrow_schema(&fb, cols, ncols));
+		vec = fb_vector(&fb, 0, 24, 8);
+		fb_ref(&fb, ftr + off[2], vec);
+		vec = fb_vector(&fb, nblocks, 24, 8);
+		fb_ref(&fb, ftr + off[3], vec);
+		for (size_t i = 0; i < nblocks; i++) {
+			/* Block: offset, metaDataLength, bodyLength */
+			fb_put64(&fb, vec + 4 + 24 * i, blocks[i].offset);
+			fb_put32(&fb, vec + 4 + 24 * i + 8, blocks[i].metalen);
+			fb_put64(&fb, vec + 4 + 24 * i + 16, blocks[i].bodylen);
+		}
+		if (fb.err) {
+			msg = createException(SQL, "sql.export_table", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			goto bailout;
+		}
+		len = (int32_t) fb.len;
+		if (mnstr_write(s, fb.buf, fb.len, 1) != 1 ||
+			mnstr_write(s, &len, 4, 1) != 1 ||
+			mnstr_write(s, ARROW_MAGIC, 6, 1) != 1)
+			goto writeerror;
+	}
+	goto bailout;
+
+  writeerror:
+	if (fb.err)
+		msg = createException(SQL, "sql.export_table", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	else
+		msg = createException(IO, "sql.export_table", SQLSTATE(42000) "Failed to write: %s", mnstr_peek_error(s));
+  bailout:
+	if (cols) {
+		for (c = 0; c < ncols; c++) {
+			for (k = 0; k < 3; k++)
+				GDKfree(cols[c].buf[k]);
+			if (cols[c].b) {
+				bat_iterator_end(&bis[c]);
+				BBPunfix(cols[c].b->batCacheid);
+			}
+		}
+	}
+	GDKfree(cols);
+	GDKfree(bis);
+	GDKfree(blocks);
+	GDKfree(fb.buf);
+	be->results = res_tables_remove(be->results, t);
+	return msg;
+#endif
+}
+
+/* Binary result sets, see mapi_prompt.h for the layout.  Numeric
+ * columns are sent the way they are stored, all others as text. */
+#define BINARY_CHUNK	((BUN) 1 << 16)	/* rows per chunk */
+
+struct binbuf {
+	char *buf;
+	size_t len, fill;
+};
+
+static inline bool
+binbuf_extend(struct binbuf *bb, size_t n)
+{
+	if (bb->fill + n > bb->len) {
+		size_t len = bb->len + (bb->len >> 1) + n;
+		char *buf = GDKrealloc(bb->buf, len);
+
+		if (buf == NULL)
+			return false;
+		bb->buf = buf;
+		bb->len = len;
+	}
+	return true;
+}
+
+/* reserve n bytes, followed by zero padding up to a multiple of 8 */
+static inline char *
+binbuf_reserve(struct binbuf *bb, size_t n)
+{
+	size_t pad = (8 - ((bb->fill + n) & 7)) & 7;
+	char *p;
+
+	if (!binbuf_extend(bb, n + pad))
+		return NULL;
+	p = bb->buf + bb->fill;
+	memset(p + n, 0, pad);
+	bb->fill += n + pad;
+	return p;
+}
+
+#define BIN_NULLS(TPE)											\
+	do {														\
+		const TPE *v = (const TPE *) bi->base + offset;			\
+		for (BUN r = 0; r < nr; r++)							\
+			if (is_##TPE##_nil(v[r]))							\
+				nulls[r >> 3] |= 1 << (r & 7);					\
+	} while (0)
+
+static int
+export_binary_text(backend *b, struct binbuf *bb, res_col *c, BATiter *bi, int tpe, size_t nullsoff, BUN offset, BUN nr)
+{
+	sql_class eclass = c->type.type->eclass;
+	struct time_res ts_res = {
+		.fraction = c->type.digits ? c->type.digits - 1 : 0,
+		.timezone = b->mvc->timezone,
+	};
+	size_t offs = bb->fill, start;
+	char *buf = NULL;
+	size_t len = 0;
+
+	if (eclass == EC_TIMESTAMP_TZ)
+		ts_res.has_tz = 1;
+	else if (eclass == EC_TIME_TZ)
+		ts_res.has_tz = strcmp(c->type.type->base.name, "timetz") == 0;
+	if (binbuf_reserve(bb, (nr + 1) * sizeof(uint64_t)) == NULL)
+		return -1;
+	start = bb->fill;
+	((uint64_t *) (bb->buf + offs))[0] = 0;
+	for (BUN r = 0; r < nr; r++) {
+		const void *v = BUNtail(*bi, offset + r);
+		const char *s = v;
+		ssize_t l = 0;
+
+		if (ATOMcmp(tpe, ATOMnilptr(tpe), v) == 0) {
+			bb->buf[nullsoff + (r >> 3)] |= 1 << (r & 7);
+		} else {
+			if (ATOMstorage(tpe) == TYPE_str)
+				l = (ssize_t) strlen(s);
+			else if (eclass == EC_TIMESTAMP || eclass == EC_TIMESTAMP_TZ)
+				l = sql_timestamp_tostr(&ts_res, &buf, &len, tpe, v);
+			else if (eclass == EC_TIME || eclass == EC_TIME_TZ)
+				l = sql_time_tostr(&ts_res, &buf, &len, tpe, v);
+			else if (eclass == EC_DEC)
+				l = dec_tostr((void *) (ptrdiff_t) c->type.scale, &buf, &len, tpe, v);
+			else if (eclass == EC_SEC)
+				l = dec_tostr((void *) (ptrdiff_t) 3, &buf, &len, tpe, v);
+			else
+				l = (*BATatoms[tpe].atomToStr) (&buf, &len, v, false);
+			if (l < 0 || !binbuf_extend(bb, (size_t) l)) {
+				GDKfree(buf);
+				return -1;
+			}
+			if (ATOMstorage(tpe) != TYPE_str)
+				s = buf;
+			memcpy(bb->buf + bb->fill, s, l);
+			bb->fill += l;
+		}
+		((uint64_t *) (bb->buf + offs))[r + 1] = bb->fill - start;
+	}
+	GDKfree(buf);
+	return binbuf_reserve(bb, 0) ? 0 : -1;
+}
+
+static int
+export_binary_column(backend *b, struct binbuf *bb, res_col *c, BATiter *bi, BUN offset, BUN nr)
+{
+	int tpe = bi->type == TYPE_void ? TYPE_oid : bi->type;
+	int enc = MAPI_BINARY_TEXT, scale = 0;
+	unsigned char *nulls;
+	size_t nullsoff;
+	char *p;
+
+	/* dates, times and the like are stored as integers, but sent
+	 * as text */
+	switch (tpe) {
+#ifndef WORDS_BIGENDIAN
+	case TYPE_bit:
+		enc = MAPI_BINARY_BOOL;
+		break;
+	case TYPE_bte:
+		enc = MAPI_BINARY_INT8;
+		break;
+	case TYPE_sht:
+		enc = MAPI_BINARY_INT16;
+		break;
+	case TYPE_int:
+		enc = MAPI_BINARY_INT32;
+		break;
+	case TYPE_lng:
+		enc = MAPI_BINARY_INT64;
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		enc = MAPI_BINARY_INT128;
+		break;
+#endif
+	case TYPE_flt:
+		enc = MAPI_BINARY_FLOAT32;
+		break;
+	case TYPE_dbl:
+		enc = MAPI_BINARY_FLOAT64;
+		break;
+#endif
+	default:
+		break;
+	}
+	if (enc != MAPI_BINARY_TEXT) {
+		if (c->type.type->eclass == EC_DEC)
+			scale = c->type.scale;
+		else if (c->type.type->eclass == EC_SEC)
+			scale = 3;
+	}
+
+	if ((p = binbuf_reserve(bb, 8)) == NULL)
+		return -1;
+	p[0] = (char) enc;
+	p[1] = (char) scale;
+	memset(p + 2, 0, 6);
+	nullsoff = bb->fill;
+	if ((p = binbuf_reserve(bb, (nr + 7) / 8)) == NULL)
+		return -1;
+	nulls = (unsigned char *) p;
+	memset(nulls, 0, (nr + 7) / 8);
+
+	switch (enc) {
+	case MAPI_BINARY_TEXT:
+		return export_binary_text(b, bb, c, bi, tpe, nullsoff, offset, nr);
+	case MAPI_BINARY_BOOL:
+	case MAPI_BINARY_INT8:
+		BIN_NULLS(bte);
+		break;
+	case MAPI_BINARY_INT16:
+		BIN_NULLS(sht);
+		break;
+	case MAPI_BINARY_INT32:
+		BIN_NULLS(int);
+		break;
+	case MAPI_BINARY_INT64:
+		BIN_NULLS(lng);
+		break;
+#ifdef HAVE_HGE
+	case MAPI_BINARY_INT128:
+		BIN_NULLS(hge);
+		break;
+#endif
+	case MAPI_BINARY_FLOAT32:
+		BIN_NULLS(flt);
+		break;
+	case MAPI_BINARY_FLOAT64:
+		BIN_NULLS(dbl);
+		break;
+	}
+	if ((p = binbuf_reserve(bb, nr * bi->width)) == NULL)
+		return -1;
+	memcpy(p, (const char *) bi->base + offset * bi->width, nr * bi->width);
+	return 0;
+}
+
+static int
+mvc_export_table_binary(backend *b, stream *s, res_table *t, BUN offset, BUN nr)
+{
+	struct binbuf bb = {0};
+	BAT **bats;
+	BATiter *its;
+	int i, res = 0;
+
+	if (!t)
+		return -1;
+	if (!s)
+		return 0;
+
+	bats = GDKzalloc(t->nr_cols * sizeof(BAT *));
+	its = GDKzalloc(t->nr_cols * sizeof(BATiter));
+	if (bats == NULL || its == NULL) {
+		GDKfree(bats);
+		GDKfree(its);
+		return -1;
+	}
+	for (i = 0; i < t->nr_cols && res == 0; i++) {
+		if ((bats[i] = BATdescriptor(t->cols[i].b)) == NULL) {
+			res = -1;
+			break;
+		}
+		its[i] = bat_iterator(bats[i]);
+		if (BATcount(bats[i]) < offset + nr)
+			res = -1;
+	}
+	for (BUN r = offset; res == 0 && r < offset + nr; r += BINARY_CHUNK) {
+		BUN n = offset + nr - r < BINARY_CHUNK ? offset + nr - r : BINARY_CHUNK;
+
+		bb.fill = 0;
+		for (int j = 0; res == 0 && j < t->nr_cols; j++)
+			res = export_binary_column(b, &bb, t->cols + j, &its[j], r, n);
+		if (res == 0 &&
+			(mnstr_printf(s, "%c" BUNFMT " %zu\n", BINARY_CHUNK_BEG, n, bb.fill) < 0 ||
+			 mnstr_write(s, bb.buf, 1, bb.fill) != (ssize_t) bb.fill))
+			res = -1;
+	}
+	while (--i >= 0) {
+		if (bats[i]) {
+			bat_iterator_end(&its[i]);
+			BBPunfix(bats[i]->batCacheid);
+		}
+	}
+	GDKfree(bb.buf);
+	GDKfree(bats);
+	GDKfree(its);
+	return res;
+}
+
 int
 mvc_export_result(backend *b, stream *s, int res_id, bool header, lng starttime, lng maloptimizer)
 {
@@ -1937,7 +3139,9 @@ mvc_export_result(backend *b, stream *s, int res_id, bool header, lng starttime,
 		count = t->nr_rows;
 		clean = 1;
 	}
-	if (json) {
+	if (b->binary_results && !json) {
+		res = mvc_export_table_binary(b, s, t, 0, count);
+	} else if (json) {
 		switch(count) {
 		case 0:
 			res = mvc_export_table(b, s, t, order, 0, count, "{\t", "", "}\n", "\"", "null");
@@ -2012,7 +3216,10 @@ mvc_export_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr)
 	if (mnstr_write(s, "\n", 1, 1) != 1)
 		return export_error(order);
 
-	res = mvc_export_table(b, s, t, order, offset, cnt, "[ ", ",\t", "\t]\n", "\"", "NULL");
+	if (b->binary_results)
+		res = mvc_export_table_binary(b, s, t, offset, cnt);
+	else
+		res = mvc_export_table(b, s, t, order, offset, cnt, "[ ", ",\t", "\t]\n", "\"", "NULL");
 	BBPunfix(order->batCacheid);
 	return res;
 }
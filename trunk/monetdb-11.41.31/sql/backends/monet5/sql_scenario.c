@@ -22,6 +22,7 @@
 #include "sql_result.h"
 #include "sql_gencode.h"
 #include "sql_optimizer.h"
+#include "sql_plancache.h"
 #include "sql_assert.h"
 #include "sql_execute.h"
 #include "sql_env.h"
@@ -191,6 +192,7 @@ SQLexit(Client c)
 	(void) c;		/* not used */
 	MT_lock_set(&sql_contextLock);
 	if (SQLstore) {
+		SQLplanCacheExit();
 		mvc_exit(SQLstore);
 		SQLstore = NULL;
 	}
@@ -248,6 +250,7 @@ SQLprepareClient(Client c, int login)
 		}
 		if (c->scenario && strcmp(c->scenario, "msql") == 0)
 			m->reply_size = -1;
+		m->parameterize = SQLplanCacheEnabled();
 		be = (void *) backend_create(m, c);
 		if ( be == NULL) {
 			mvc_destroy(m);
@@ -305,6 +308,8 @@ SQLprepareClient(Client c, int login)
 				m->reply_size = value;
 			} else if (sscanf(tok, "size_header=%d", &value) == 1) {
 					be->sizeheader = value != 0;
+			} else if (sscanf(tok, "binary_results=%d", &value) == 1) {
+				be->binary_results = value != 0;
 			} else if (sscanf(tok, "columnar_protocol=%d", &value) == 1) {
 				c->protocol = (value != 0) ? PROTOCOL_COLUMNAR : PROTOCOL_9;
 			} else if (sscanf(tok, "time_zone=%d", &value) == 1) {
@@ -416,6 +421,7 @@ SQLinit(Client c)
 	if (readonly)
 		SQLdebug |= 32;
 
+	SQLplanCacheInit(GDKgetenv_int("sql_plan_cache", 0));
 	if ((SQLstore = mvc_init(SQLdebug, GDKinmemory(0) ? store_mem : store_bat, readonly, single_user)) == NULL) {
 		MT_lock_unset(&sql_contextLock);
 		throw(SQL, "SQLinit", SQLSTATE(42000) "Catalogue initialization failed");
@@ -969,6 +975,8 @@ SQLparser(Client c)
 	int oldvtop, oldstop, oldvid;
 	int pstatus = 0;
 	int err = 0, opt, preparedid = -1;
+	bool cached = false;
+	const char *plankey = NULL;	/* query text as known to the plan cache */
 
 	c->query = NULL;
 	be = (backend *) c->sqlcontext;
@@ -1094,6 +1102,12 @@ SQLparser(Client c)
 			in->pos = in->len;	/* HACK: should use parsed length */
 			return MAL_SUCCEED;
 		}
+		if (strncmp(in->buf + in->pos, "binary_results ", 15) == 0) {
+			v = (int) strtol(in->buf + in->pos + 15, NULL, 10);
+			be->binary_results = v != 0;
+			in->pos = in->len;	/* HACK: should use parsed length */
+			return MAL_SUCCEED;
+		}
 		if (strncmp(in->buf + in->pos, "quit", 4) == 0) {
 			c->mode = FINISHCLIENT;
 			in->pos = in->len;	/* HACK: should use parsed length */
@@ -1161,8 +1175,16 @@ SQLparser(Client c)
 
 		m->type = Q_SCHEMA; /* TODO DEALLOCATE statements don't fit for Q_SCHEMA */
 		scanner_query_processed(&(m->scanner));
+	} else if (m->emode == m_normal &&
+		   SQLplanCacheFind(c, be, plankey = SQLplanCacheParameterize(be, c->query))) {
+		/* another session compiled this query already */
+		cached = true;
+		scanner_query_processed(&(m->scanner));
 	} else {
-		sql_rel *r = sql_symbol2relation(be, m->sym);
+		sql_rel *r = SQLplanCacheRelation(be, m->sym);
+
+		if (m->literals == NULL)
+			plankey = c->query;
 
 		if (!r || (err = mvc_status(m) && m->type != Q_TRANS && *m->errstr)) {
 			if (strlen(m->errstr) > 6 && m->errstr[5] == '!')
@@ -1180,7 +1202,8 @@ SQLparser(Client c)
 
 			err = 0;
 			setVarType(c->curprg->def, 0, 0);
-			if (backend_dumpstmt(be, c->curprg->def, r, !(m->emod & mod_exec), 0, c->query) < 0)
+			if ((m->literals && SQLplanCacheDeclare(be, c->curprg->def) < 0) ||
+			    backend_dumpstmt(be, c->curprg->def, r, !(m->emod & mod_exec), 0, c->query) < 0)
 				err = 1;
 			else
 				opt = (m->emod & mod_exec) == 0;//1;
@@ -1244,7 +1267,7 @@ SQLparser(Client c)
 			err = mvc_export_prepare(be, c->fdout, "");
 		}
 
-		if (!err) {
+		if (!err && !cached) {
 			pushEndInstruction(c->curprg->def);
 			/* check the query wrapper for errors */
 			if( msg == MAL_SUCCEED)
@@ -1252,6 +1275,7 @@ SQLparser(Client c)
 
 			/* in case we had produced a non-cachable plan, the optimizer should be called */
 			if (msg == MAL_SUCCEED && opt ) {
+				be->cacheplan = oldstop == 1 && SQLplanCacheWanted(be);
 				msg = SQLoptimizeQuery(c, c->curprg->def);
 
 				if (msg != MAL_SUCCEED) {
@@ -1268,6 +1292,11 @@ SQLparser(Client c)
 						freeException(other);
 					goto finalize;
 				}
+				if (msg == MAL_SUCCEED && !c->curprg->def->errors && oldstop == 1)
+					SQLplanCacheAdd(c, be, plankey, oldvtop);
+				/* the cached plan keeps the parameters, this one gets the literals */
+				if (msg == MAL_SUCCEED && !c->curprg->def->errors && m->literals)
+					SQLplanCacheBind(be, c->curprg->def);
 			}
 		}
 		//printFunction(c->fdout, c->curprg->def, 0, LIST_MAL_ALL);
@@ -2470,7 +2470,7 @@ dump_export_header(mvc *sql, MalBlkPtr mb, list *l, int file, const char * forma
 
 
 stmt *
-stmt_export(backend *be, stmt *t, const char *sep, const char *rsep, const char *ssep, const char *null_string, int onclient, stmt *file)
+stmt_export(backend *be, stmt *t, const char *sep, const char *rsep, const char *ssep, const char *null_string, int onclient, stmt *file, const char *format)
 {
 	MalBlkPtr mb = be->mb;
 	InstrPtr q = NULL;
@@ -2490,7 +2490,7 @@ stmt_export(backend *be, stmt *t, const char *sep, const char *rsep, const char
 		fnr = getArg(q,0);
 	}
 	if (t->type == st_list) {
-		if (dump_export_header(be->mvc, mb, l, fnr, "csv", sep, rsep, ssep, null_string, onclient) < 0)
+		if (dump_export_header(be->mvc, mb, l, fnr, format, sep, rsep, ssep, null_string, onclient) < 0)
 			return NULL;
 	} else {
 		q = newStmt(mb, sqlRef, raiseRef);
@@ -3473,6 +3473,32 @@ sql_update_jul2021_5(Client c, mvc *sql, const char *prev_schema, bool *systabfi
 	return err;		/* usually MAL_SUCCEED */
 }
 
+static str
+sql_update_arrow(Client c, mvc *sql, const char *prev_schema, bool *systabfixed)
+{
+	/* the internal function sys.copyfrom(str, str, str, int) of COPY
+	 * ARROW INTO (see sql_types.c) shifted the ids of the internal
+	 * functions after it */
+	if (*systabfixed)
+		return MAL_SUCCEED;		/* already done */
+
+	char *buf = "select id from sys.functions where name = 'copyfrom' and func = 'importArrow' and schema_id = (select id from sys.schemas where name = 'sys');\n";
+	res_table *output;
+	char *err = SQLstatementIntern(c, buf, "update", 1, 0, &output);
+	if (err == NULL) {
+		BAT *b = BATdescriptor(output->cols[0].b);
+		if (b) {
+			if (BATcount(b) == 0) {
+				err = sql_fix_system_tables(c, sql, prev_schema);
+				*systabfixed = true;
+			}
+			BBPunfix(b->batCacheid);
+		}
+		res_table_destroy(output);
+	}
+	return err;
+}
+
 int
 SQLupgrades(Client c, mvc *m)
 {
@@ -3727,6 +3753,13 @@ SQLupgrades(Client c, mvc *m)
 		return -1;
 	}
 
+	if ((err = sql_update_arrow(c, m, prev_schema, &systabfixed)) != NULL) {
+		TRC_CRITICAL(SQL_PARSER, "%s\n", err);
+		freeException(err);
+		GDKfree(prev_schema);
+		return -1;
+	}
+
 	GDKfree(prev_schema);
 	return 0;
 }
@@ -1529,6 +1529,10 @@ sqltypeinit( sql_allocator *sa)
 	/* sys_update_schemas, sys_update_tables */
 	sql_create_procedure(sa, "sys_update_schemas", "sql", "update_schemas", FALSE, 0);
 	sql_create_procedure(sa, "sys_update_tables", "sql", "update_tables", FALSE, 0);
+
+	/* arrowcopyfrom */
+	f = sql_create_union(sa, "copyfrom", "sql", "importArrow", FALSE, SCALE_FIX, 0, TABLE, 4, STR, STR, STR, INT);
+	f->varres = 1;
 }
 
 void
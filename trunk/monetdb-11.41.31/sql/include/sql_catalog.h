@@ -315,6 +315,7 @@ typedef struct sql_trans {
 
 	lng logchanges;		/* count number of changes to be applied to the wal */
 	int active;			/* is active transaction */
+	int schema_changed;	/* DDL was executed, bump the store schema version on commit */
 	int status;			/* status of the last query */
 
 	sql_catalog *cat;
@@ -748,6 +749,7 @@ typedef struct sql_session {
 	char auto_commit;
 	int level;		/* TRANSACTION isolation level */
 	int status;		/* status, ok/error */
+	ulng schema_version;	/* store schema version when the transaction started */
 	backend_stack stk;
 } sql_session;
 
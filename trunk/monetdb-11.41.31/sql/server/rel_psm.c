@@ -669,6 +669,7 @@ sequential_block(sql_query *query, sql_subtype *restype, list *restypelist, dlis
 		}	break;
 		case SQL_COPYFROM:
 		case SQL_BINCOPYFROM:
+		case SQL_ARROWCOPYFROM:
 		case SQL_INSERT:
 		case SQL_UPDATE:
 		case SQL_DELETE:
@@ -5112,9 +5112,14 @@ rel_value_exp2(sql_query *query, sql_rel **rel, symbol *se, int f, exp_kind ek)
 		return NULL;
 	}
 	case SQL_PARAMETER: {
-		if (sql->emode != m_prepare)
+		if (sql->emode != m_prepare && !sql->literals)
 			return sql_error(sql, 02, SQLSTATE(42000) "SELECT: parameters ('?') not allowed in normal queries, use PREPARE");
 		assert(se->type == type_int);
+		if (sql->literals) { /* a literal that became a parameter of the plan cache */
+			sql_arg *a = sql_bind_paramnr(sql, se->data.i_val);
+
+			return exp_atom_ref(sql->sa, se->data.i_val, &a->type);
+		}
 		return exp_atom_ref(sql->sa, se->data.i_val, NULL);
 	}
 	case SQL_NULL:
@@ -66,6 +66,7 @@ rel_parse(mvc *m, sql_schema *s, const char *query, char emode)
 	bstream_next(m->scanner.rs);
 
 	m->params = NULL;
+	m->literals = NULL;
 	m->sym = NULL;
 	m->errstr[0] = '\0';
 	/* via views we give access to protected objects */
@@ -180,6 +181,7 @@ rel_semantic(sql_query *query, symbol *s)
 	case SQL_MERGE:
 	case SQL_COPYFROM:
 	case SQL_BINCOPYFROM:
+	case SQL_ARROWCOPYFROM:
 	case SQL_COPYLOADER:
 	case SQL_COPYTO:
 		return rel_updates(query, s);
@@ -1770,6 +1770,84 @@ bincopyfrom(sql_query *query, dlist *qname, dlist *columns, dlist *files, int co
 	return res;
 }
 
+static sql_rel *
+arrowcopyfrom(sql_query *query, dlist *qname, dlist *columns, const char *filename, int constraint, int onclient)
+{
+	mvc *sql = query->sql;
+	char *sname = qname_schema(qname);
+	char *tname = qname_schema_object(qname);
+	sql_table *t = NULL;
+	node *n;
+	sql_rel *res;
+	list *exps, *args;
+	sql_subtype strtpe;
+	sql_exp *import;
+	sql_subfunc *f = sql_find_func(sql, "sys", "copyfrom", 4, F_UNION, NULL);
+	list *collist;
+	int i;
+
+	if (!f) {
+		sql->session->status = 0; /* if the function was not found clean the error */
+		sql->errstr[0] = '\0';
+		return sql_error(sql, 02, SQLSTATE(42000) "COPY ARROW INTO: function sys.copyfrom for Arrow files is missing from the catalog");
+	}
+	if (!onclient && !copy_allowed(sql, 1))
+		return sql_error(sql, 02, SQLSTATE(42000) "COPY ARROW INTO: insufficient privileges: "
+				 "COPY ARROW INTO from file requires database administrator rights, "
+				 "use 'COPY ARROW INTO \"%s\" FROM file ON CLIENT' instead", tname);
+	if (!onclient && !MT_path_absolute(filename)) {
+		char *fn = ATOMformat(TYPE_str, filename);
+		sql_error(sql, 02, SQLSTATE(42000) "COPY ARROW INTO: filename must "
+			  "have absolute path: %s", fn);
+		GDKfree(fn);
+		return NULL;
+	}
+
+	t = find_table_or_view_on_scope(sql, NULL, sname, tname, "COPY ARROW INTO", false);
+	if (insert_allowed(sql, t, tname, "COPY ARROW INTO", "copy arrow into") == NULL)
+		return NULL;
+
+	collist = check_table_columns(sql, t, columns, "COPY ARROW INTO", tname);
+	if (!collist)
+		return NULL;
+
+	f->res = table_column_types(sql->sa, t);
+	sql_find_subtype(&strtpe, "varchar", 0, 0);
+	args = append( append( append( append( new_exp_list(sql->sa),
+		exp_atom_str(sql->sa, t->s?t->s->base.name:NULL, &strtpe)),
+		exp_atom_str(sql->sa, t->base.name, &strtpe)),
+		exp_atom_str(sql->sa, filename, &strtpe)),
+		exp_atom_int(sql->sa, onclient));
+
+	// for each column of the table, pass the position of the field in
+	// the Arrow file that it is loaded from, or -1 if it isn't loaded
+	for (i = 0; i < ol_length(t->columns); i++) {
+		int fieldnr = -1, j = 0;
+
+		for (n = collist->h; n; n = n->next, j++) {
+			sql_column *c = n->data;
+			if (i == c->colnr) {
+				fieldnr = j;
+				break;
+			}
+		}
+		append(args, exp_atom_int(sql->sa, fieldnr));
+	}
+
+	import = exp_op(sql->sa, args, f);
+
+	exps = new_exp_list(sql->sa);
+	for (n = ol_first_node(t->columns); n; n = n->next) {
+		sql_column *c = n->data;
+		append(exps, exp_column(sql->sa, t->base.name, c->base.name, &c->type, CARD_MULTI, c->null, 0));
+	}
+	res = rel_table_func(sql->sa, NULL, import, exps, TABLE_PROD_FUNC);
+	res = rel_insert_table(query, t, t->base.name, res);
+	if (res && !constraint)
+		res->flag |= UPD_NO_CONSTRAINT;
+	return res;
+}
+
 static sql_rel *
 copyfromloader(sql_query *query, dlist *qname, symbol *fcall)
 {
@@ -1812,7 +1890,7 @@ copyfromloader(sql_query *query, dlist *qname, symbol *fcall)
 }
 
 static sql_rel *
-rel_output(mvc *sql, sql_rel *l, sql_exp *sep, sql_exp *rsep, sql_exp *ssep, sql_exp *null_string, sql_exp *file, sql_exp *onclient)
+rel_output(mvc *sql, sql_rel *l, sql_exp *sep, sql_exp *rsep, sql_exp *ssep, sql_exp *null_string, sql_exp *file, sql_exp *onclient, sql_exp *format)
 {
 	sql_rel *rel = rel_create(sql->sa);
 	list *exps = new_exp_list(sql->sa);
@@ -1826,6 +1904,8 @@ rel_output(mvc *sql, sql_rel *l, sql_exp *sep, sql_exp *rsep, sql_exp *ssep, sql
 	if (file) {
 		append(exps, file);
 		append(exps, onclient);
+		if (format)
+			append(exps, format);
 	}
 	rel->l = l;
 	rel->r = NULL;
@@ -1838,14 +1918,15 @@ rel_output(mvc *sql, sql_rel *l, sql_exp *sep, sql_exp *rsep, sql_exp *ssep, sql
 }
 
 static sql_rel *
-copyto(sql_query *query, symbol *sq, const char *filename, dlist *seps, const char *null_string, int onclient)
+copyto(sql_query *query, symbol *sq, const char *filename, dlist *seps, const char *null_string, int onclient, const char *format)
 {
 	mvc *sql = query->sql;
-	const char *tsep = seps->h->data.sval;
-	const char *rsep = seps->h->next->data.sval;
-	const char *ssep = (seps->h->next->next)?seps->h->next->next->data.sval:"\"";
+	/* binary formats have no separators */
+	const char *tsep = seps ? seps->h->data.sval : "|";
+	const char *rsep = seps ? seps->h->next->data.sval : "\n";
+	const char *ssep = (seps && seps->h->next->next)?seps->h->next->next->data.sval:"\"";
 	const char *ns = (null_string)?null_string:"null";
-	sql_exp *tsep_e, *rsep_e, *ssep_e, *ns_e, *fname_e, *oncl_e;
+	sql_exp *tsep_e, *rsep_e, *ssep_e, *ns_e, *fname_e, *oncl_e, *fmt_e;
 	exp_kind ek = {type_value, card_relation, TRUE};
 	sql_rel *r = rel_subquery(query, NULL, sq, ek);
 
@@ -1861,7 +1942,10 @@ copyto(sql_query *query, symbol *sq, const char *filename, dlist *seps, const ch
 	ns_e = exp_atom_clob(sql->sa, ns);
 	oncl_e = exp_atom_int(sql->sa, onclient);
 	fname_e = filename?exp_atom_clob(sql->sa, filename):NULL;
+	fmt_e = format?exp_atom_clob(sql->sa, format):NULL;
 
+	if (format && onclient)
+		return sql_error(sql, 02, SQLSTATE(42000) "COPY INTO %s: writing to a file ON CLIENT is not supported", format);
 	if (!onclient && filename) {
 		struct stat fs;
 		if (!copy_allowed(sql, 0))
@@ -1876,7 +1960,7 @@ copyto(sql_query *query, symbol *sq, const char *filename, dlist *seps, const ch
 					 "exists: %s", filename);
 	}
 
-	return rel_output(sql, r, tsep_e, rsep_e, ssep_e, ns_e, fname_e, oncl_e);
+	return rel_output(sql, r, tsep_e, rsep_e, ssep_e, ns_e, fname_e, oncl_e, fmt_e);
 }
 
 sql_exp *
@@ -1923,6 +2007,7 @@ rel_parse_val(mvc *m, sql_schema *sch, char *query, sql_subtype *tpe, char emode
 	bstream_next(m->scanner.rs);
 
 	m->params = NULL;
+	m->literals = NULL;
 	m->sym = NULL;
 	m->errstr[0] = '\0';
 	/* via views we give access to protected objects */
@@ -2000,6 +2085,14 @@ rel_updates(sql_query *query, symbol *s)
 		sql->type = Q_UPDATE;
 	}
 		break;
+	case SQL_ARROWCOPYFROM:
+	{
+		dlist *l = s->data.lval;
+
+		ret = arrowcopyfrom(query, l->h->data.lval, l->h->next->data.lval, l->h->next->next->data.sval, l->h->next->next->next->data.i_val, l->h->next->next->next->next->data.i_val);
+		sql->type = Q_UPDATE;
+	}
+		break;
 	case SQL_COPYLOADER:
 	{
 		dlist *l = s->data.lval;
@@ -2016,7 +2109,7 @@ rel_updates(sql_query *query, symbol *s)
 	{
 		dlist *l = s->data.lval;
 
-		ret = copyto(query, l->h->data.sym, l->h->next->data.sval, l->h->next->next->data.lval, l->h->next->next->next->data.sval, l->h->next->next->next->next->data.i_val);
+		ret = copyto(query, l->h->data.sym, l->h->next->data.sval, l->h->next->next->data.lval, l->h->next->next->next->data.sval, l->h->next->next->next->next->data.i_val, l->h->next->next->next->next->next ? l->h->next->next->next->next->next->data.sval : NULL);
 		sql->type = Q_UPDATE;
 	}
 		break;
@@ -722,12 +722,14 @@ mvc_create(sql_store *store, sql_allocator *pa, int clientid, int debug, bstream
 	m->sp = (uintptr_t)(&m);
 
 	m->params = NULL;
+	m->literals = NULL;
 	m->sizeframes = MAXPARAMS;
 	m->frames = SA_NEW_ARRAY(pa, sql_frame*, m->sizeframes);
 	m->topframes = 0;
 	m->frame = 0;
 
 	m->use_views = 0;
+	m->parameterize = 0;
 	if (!m->frames) {
 		qc_destroy(m->qc);
 		return NULL;
@@ -809,6 +811,7 @@ mvc_reset(mvc *m, bstream *rs, stream *ws, int debug)
 	m->errstr[0] = '\0';
 
 	m->params = NULL;
+	m->literals = NULL;
 	/* reset frames to the set of global variables */
 	stack_pop_until(m, 0);
 	m->frame = 0;
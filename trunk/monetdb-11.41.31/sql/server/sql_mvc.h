@@ -115,6 +115,7 @@ typedef struct mvc {
 	struct scanner scanner;
 
 	list *params;
+	list *literals;		/* literals that may become parameters of a cached plan */
 	sql_func *forward;	/* forward definitions for recursive functions */
 	list *global_vars; /* SQL declared variables on the global scope */
 	sql_frame **frames;	/* stack of frames with variables */
@@ -125,7 +126,8 @@ typedef struct mvc {
 
 	int8_t use_views:1,
 		   schema_path_has_sys:1, /* speed up object search */
-		   schema_path_has_tmp:1;
+		   schema_path_has_tmp:1,
+		   parameterize:1; /* collect literals for the plan cache */
 	struct qc *qc;
 	int clientid;		/* id of the owner */
 
@@ -17,12 +17,12 @@
 #include "sql_env.h"
 #include "rel_sequence.h"	/* for sql_next_seq_name() */
 
-static int sqlerror(mvc *sql, const char *err);
 static int sqlformaterror(mvc *sql, _In_z_ _Printf_format_string_ const char *format, ...)
 	        __attribute__((__format__(__printf__, 2, 3)));
 
 static void *ma_alloc(sql_allocator *sa, size_t sz);
 static void ma_free(void *p);
+static void like_pattern_literal(mvc *m, symbol *pattern, symbol *e);
 
 #include <unistd.h>
 #include <string.h>
@@ -170,6 +170,7 @@ uescape_xform(char *restrict s, const char *restrict esc)
 
 /* reentrant parser */
 %define api.pure
+%locations
 %union {
 	int		i_val,bval;
 	lng		l_val,operation;
@@ -180,7 +181,8 @@ uescape_xform(char *restrict s, const char *restrict esc)
 	sql_subtype	type;
 }
 %{
-extern int sqllex( YYSTYPE *yylval, void *m );
+extern int sqllex( YYSTYPE *yylval, YYLTYPE *yylloc, void *m );
+static int sqlerror(YYLTYPE *loc, mvc *sql, const char *err);
 /* enable to activate debugging support
 int yydebug=1;
 */
@@ -622,7 +624,7 @@ int yydebug=1;
 	sqlDOUBLE sqlREAL PRECISION PARTIAL SIMPLE ACTION CASCADE RESTRICT
 	BOOL_FALSE BOOL_TRUE
 	CURRENT_DATE CURRENT_TIMESTAMP CURRENT_TIME LOCALTIMESTAMP LOCALTIME
-	BIG LITTLE NATIVE ENDIAN
+	BIG LITTLE NATIVE ENDIAN ARROW
 	LEX_ERROR 
 	
 /* the tokens used in geom */
@@ -770,7 +772,7 @@ sqlstmt:
 
  | SQL_DEBUG 		{
 			  if (m->scanner.mode == LINE_1) {
-				yyerror(m, "SQL debugging only supported in interactive mode");
+				yyerror(&@$, m, "SQL debugging only supported in interactive mode");
 				YYABORT;
 			  }
 		  	  m->emod |= mod_debug;
@@ -1228,7 +1230,7 @@ alter_statement:
  | ALTER USER ident opt_with_encrypted_password user_schema user_schema_path
 	{ dlist *l = L(), *p = L();
 	  if (!$4 && !$5 && !$6) {
-		yyerror(m, "ALTER USER: At least one property should be updatd");
+		yyerror(&@$, m, "ALTER USER: At least one property should be updatd");
 		YYABORT;
 	  }
 	  append_string(l, $3);
@@ -2370,7 +2372,7 @@ while_statement:
 		  char *label = $1?$1:$8;
 		  if ($1 && $8 && strcmp($1, $8) != 0) {
 			$$ = NULL;
-			yyerror(m, "WHILE: labels should match");
+			yyerror(&@$, m, "WHILE: labels should match");
 			YYABORT;
 		  }
  		  l = L();
@@ -2778,6 +2780,14 @@ copyfrom_stmt:
 	  append_int(l, $9);
 	  append_int(l, $2);
 	  $$ = _symbol_create_list( SQL_BINCOPYFROM, l ); }
+  | COPY ARROW INTO qname opt_column_list FROM string opt_on_location opt_constraint
+	{ dlist *l = L();
+	  append_list(l, $4);
+	  append_list(l, $5);
+	  append_string(l, $7);
+	  append_int(l, $9);
+	  append_int(l, $8);
+	  $$ = _symbol_create_list( SQL_ARROWCOPYFROM, l ); }
   | COPY query_expression_def INTO string opt_on_location opt_seps opt_null_string
 	{ dlist *l = L();
 	  append_symbol(l, $2);
@@ -2786,6 +2796,15 @@ copyfrom_stmt:
 	  append_string(l, $7);
 	  append_int(l, $5);
 	  $$ = _symbol_create_list( SQL_COPYTO, l ); }
+  | COPY query_expression_def INTO ARROW string opt_on_location
+	{ dlist *l = L();
+	  append_symbol(l, $2);
+	  append_string(l, $5);
+	  append_list(l, NULL);
+	  append_string(l, NULL);
+	  append_int(l, $6);
+	  append_string(l, sa_strdup(SA, "arrow"));
+	  $$ = _symbol_create_list( SQL_COPYTO, l ); }
   | COPY query_expression_def INTO STDOUT opt_seps opt_null_string
 	{ dlist *l = L();
 	  append_symbol(l, $2);
@@ -3251,7 +3270,7 @@ select_no_parens_orderby:
 					_symbol_create_list( SQL_FROM, append_symbol(L(), $1)), NULL, NULL, NULL, $2, _symbol_create_list(SQL_NAME, append_list(append_string(L(),"inner"),NULL)), $3, $4, $5, $6, NULL);
 			}
 	  	} else {
-			yyerror(m, "missing SELECT operator");
+			yyerror(&@$, m, "missing SELECT operator");
 			YYABORT;
 	  	}
 	 } 
@@ -3387,7 +3406,7 @@ table_ref:
 				}
  |  subquery_with_orderby
 				{ $$ = NULL;
-				  yyerror(m, "subquery table reference needs alias, use AS xxx");
+				  yyerror(&@$, m, "subquery table reference needs alias, use AS xxx");
 				  YYABORT;
 				}
  |  joined_table 		{ $$ = $1;
@@ -3593,8 +3612,12 @@ comparison_predicate:
 		  append_symbol(l, $1);
 		  append_string(l, $2);
 		  append_symbol(l, $4);
-		  if ($3 > -1)
+		  if ($3 > -1) {
 		     append_int(l, $3);
+		  } else {
+		     sql_add_literal(m, $1, $4);
+		     sql_add_literal(m, $4, $1);
+		  }
 		  $$ = _symbol_create_list(SQL_COMPARE, l ); }
  |  pred_exp '=' opt_any_all_some pred_exp
 		{ dlist *l = L();
@@ -3602,8 +3625,12 @@ comparison_predicate:
 		  append_symbol(l, $1);
 		  append_string(l, sa_strdup(SA, "="));
 		  append_symbol(l, $4);
-		  if ($3 > -1)
+		  if ($3 > -1) {
 		     append_int(l, $3);
+		  } else {
+		     sql_add_literal(m, $1, $4);
+		     sql_add_literal(m, $4, $1);
+		  }
 		  $$ = _symbol_create_list(SQL_COMPARE, l ); }
  ;
 
@@ -3614,6 +3641,8 @@ between_predicate:
 		  append_int(l, $3);
 		  append_symbol(l, $4);
 		  append_symbol(l, $6);
+		  sql_add_literal(m, $4, $1);
+		  sql_add_literal(m, $6, $1);
 		  $$ = _symbol_create_list(SQL_NOT_BETWEEN, l ); }
  |  pred_exp BETWEEN opt_bounds pred_exp AND pred_exp
 		{ dlist *l = L();
@@ -3621,6 +3650,8 @@ between_predicate:
 		  append_int(l, $3);
 		  append_symbol(l, $4);
 		  append_symbol(l, $6);
+		  sql_add_literal(m, $4, $1);
+		  sql_add_literal(m, $6, $1);
 		  $$ = _symbol_create_list(SQL_BETWEEN, l ); }
  ;
 
@@ -3637,6 +3668,7 @@ like_predicate:
 		  append_symbol(l, $3);
 		  append_int(l, FALSE);  /* case sensitive */
 		  append_int(l, TRUE);  /* anti */
+		  like_pattern_literal(m, $3, $1);
 		  $$ = _symbol_create_list( SQL_LIKE, l ); }
  |  pred_exp NOT_ILIKE like_exp
 		{ dlist *l = L();
@@ -3644,6 +3676,7 @@ like_predicate:
 		  append_symbol(l, $3);
 		  append_int(l, TRUE);  /* case insensitive */
 		  append_int(l, TRUE);  /* anti */
+		  like_pattern_literal(m, $3, $1);
 		  $$ = _symbol_create_list( SQL_LIKE, l ); }
  |  pred_exp LIKE like_exp
 		{ dlist *l = L();
@@ -3651,6 +3684,7 @@ like_predicate:
 		  append_symbol(l, $3);
 		  append_int(l, FALSE);  /* case sensitive */
 		  append_int(l, FALSE);  /* anti */
+		  like_pattern_literal(m, $3, $1);
 		  $$ = _symbol_create_list( SQL_LIKE, l ); }
  |  pred_exp ILIKE like_exp
 		{ dlist *l = L();
@@ -3658,6 +3692,7 @@ like_predicate:
 		  append_symbol(l, $3);
 		  append_int(l, TRUE);  /* case insensitive */
 		  append_int(l, FALSE);  /* anti */
+		  like_pattern_literal(m, $3, $1);
 		  $$ = _symbol_create_list( SQL_LIKE, l ); }
  ;
 
@@ -3692,12 +3727,16 @@ in_predicate:
 
 		  append_symbol(l, $1);
 		  append_list(l, $4);
+		  for (dnode *n = $4->h; n; n = n->next)
+		     sql_add_literal(m, n->data.sym, $1);
 		  $$ = _symbol_create_list(SQL_NOT_IN, l ); }
  |  pred_exp sqlIN '(' value_commalist ')'
 		{ dlist *l = L();
 
 		  append_symbol(l, $1);
 		  append_list(l, $4);
+		  for (dnode *n = $4->h; n; n = n->next)
+		     sql_add_literal(m, n->data.sym, $1);
 		  $$ = _symbol_create_list(SQL_IN, l ); }
  |  '(' pred_exp_list ')' NOT_IN '(' value_commalist ')'
 		{ dlist *l = L();
@@ -4293,6 +4332,8 @@ atom:
 		AtomNode *an = (AtomNode*)$1;
 		atom *a = an->a; 
 		an->a = atom_dup(SA, a); 
+		an->start = @1.first_column;
+		an->end = @1.last_column;
 		$$ = $1;
 	}
  ;
@@ -4879,7 +4920,7 @@ interval_expression:
 
 		$$ = NULL;
 	  	if ( (tpe = parse_interval_qualifier( m, $4, &sk, &ek, &sp, &ep )) < 0){
-			yyerror(m, "incorrect interval");
+			yyerror(&@$, m, "incorrect interval");
 			YYABORT;
 	  	} else {
 			int d = inttype2digits(sk, ek);
@@ -4892,7 +4933,7 @@ interval_expression:
 			}
 	  	}
 	  	if (!r || (tpe = parse_interval( m, $2, $3, sk, ek, sp, ep, &i)) < 0) { 
-			yyerror(m, "incorrect interval");
+			yyerror(&@$, m, "incorrect interval");
 			$$ = NULL;
 			YYABORT;
 	  	} else {
@@ -5042,7 +5083,7 @@ nonzero:
 		{ $$ = $1;
 		  if ($$ <= 0) {
 			$$ = -1;
-			yyerror(m, "Positive value greater than 0 expected");
+			yyerror(&@$, m, "Positive value greater than 0 expected");
 			YYABORT;
 		  }
 		}
@@ -5053,7 +5094,7 @@ nonzerolng:
 		{ $$ = $1;
 		  if ($$ <= 0) {
 			$$ = -1;
-			yyerror(m, "Positive value greater than 0 expected");
+			yyerror(&@$, m, "Positive value greater than 0 expected");
 			YYABORT;
 		  }
 		}
@@ -5063,7 +5104,7 @@ poslng:
 	lngval 	{ $$ = $1;
 		  if ($$ < 0) {
 			$$ = -1;
-			yyerror(m, "Positive value expected");
+			yyerror(&@$, m, "Positive value expected");
 			YYABORT;
 		  }
 		}
@@ -5073,7 +5114,7 @@ posint:
 	intval 	{ $$ = $1;
 		  if ($$ < 0) {
 			$$ = -1;
-			yyerror(m, "Positive value expected");
+			yyerror(&@$, m, "Positive value expected");
 			YYABORT;
 		  }
 		}
@@ -5084,7 +5125,7 @@ data_type:
 			{ sql_find_subtype(&$$, "char", 1, 0); }
  |  varchar
 			{ $$.type = NULL;
-			  yyerror(m, "CHARACTER VARYING needs a mandatory length specification");
+			  yyerror(&@$, m, "CHARACTER VARYING needs a mandatory length specification");
 			  YYABORT;
 			}
  |  clob		{ sql_find_subtype(&$$, "clob", 0, 0); }
@@ -5402,6 +5443,7 @@ non_reserved_word:
 
 | ACTION	{ $$ = sa_strdup(SA, "action"); }
 | ANALYZE	{ $$ = sa_strdup(SA, "analyze"); }
+| ARROW		{ $$ = sa_strdup(SA, "arrow"); }
 | AUTO_COMMIT	{ $$ = sa_strdup(SA, "auto_commit"); }
 | BIG	{ $$ = sa_strdup(SA, "big"); }
 | CACHE		{ $$ = sa_strdup(SA, "cache"); }
@@ -6142,7 +6184,7 @@ XML_aggregate:
 	
 			s->orderby = $4;
 	  	} else {
-			yyerror(m, "ORDER BY: missing select operator");
+			yyerror(&@$, m, "ORDER BY: missing select operator");
 			YYABORT;
 		}
 	  }
@@ -6208,6 +6250,7 @@ char *token2string(tokens token)
 	SQL(ALTER_USER);
 	SQL(ANALYZE);
 	SQL(AND);
+	SQL(ARROWCOPYFROM);
 	SQL(ASSIGN);
 	SQL(ATOM);
 	SQL(BETWEEN);
@@ -6413,11 +6456,26 @@ sqlformaterror(mvc * sql, _In_z_ _Printf_format_string_ const char *format, ...)
 }
 
 static int 
-sqlerror(mvc * sql, const char *err)
+sqlerror(YYLTYPE *loc, mvc * sql, const char *err)
 {
+	(void) loc;
 	return sqlformaterror(sql, "%s", err);
 }
 
+/* patterns without wildcards are better off as literals, they are turned
+ * into equality comparisons by the optimizer */
+static void
+like_pattern_literal(mvc *m, symbol *pattern, symbol *e)
+{
+	dnode *n = pattern->data.lval->h;
+	AtomNode *an = (AtomNode *) n->data.sym;
+
+	if (n->next == NULL && an && an->s.token == SQL_ATOM && an->a &&
+	    an->a->data.vtype == TYPE_str && !an->a->isnull &&
+	    (strchr(an->a->data.val.sval, '%') || strchr(an->a->data.val.sval, '_')))
+		sql_add_literal(m, &an->s, e);
+}
+
 static void *ma_alloc(sql_allocator *sa, size_t sz)
 {
 	return sa_alloc(sa, sz);
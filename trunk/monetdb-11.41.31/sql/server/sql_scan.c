@@ -204,6 +204,7 @@ scanner_init_keywords(void)
 	failed += keywords_insert("LITTLE", LITTLE);
 	failed += keywords_insert("NATIVE", NATIVE);
 	failed += keywords_insert("ENDIAN", ENDIAN);
+	failed += keywords_insert("ARROW", ARROW);
 
 	failed += keywords_insert("REFERENCES", REFERENCES);
 
@@ -1391,10 +1392,10 @@ sql_get_next_token(YYSTYPE *yylval, void *parm)
 }
 
 /* also see sql_parser.y */
-extern int sqllex( YYSTYPE *yylval, void *m );
+extern int sqllex( YYSTYPE *yylval, YYLTYPE *yylloc, void *m );
 
 int
-sqllex(YYSTYPE * yylval, void *parm)
+sqllex(YYSTYPE * yylval, YYLTYPE * yylloc, void *parm)
 {
 	int token;
 	mvc *c = (mvc *) parm;
@@ -1407,10 +1408,10 @@ sqllex(YYSTYPE * yylval, void *parm)
 	token = sql_get_next_token(yylval, parm);
 
 	if (token == NOT) {
-		int next = sqllex(yylval, parm);
+		int next = sqllex(yylval, yylloc, parm);
 
 		if (next == NOT) {
-			return sqllex(yylval, parm);
+			return sqllex(yylval, yylloc, parm);
 		} else if (next == BETWEEN) {
 			token = NOT_BETWEEN;
 		} else if (next == sqlIN) {
@@ -1432,12 +1433,18 @@ sqllex(YYSTYPE * yylval, void *parm)
 			/* skip the skipped stuff also in the buffer */
 			lc->rs->pos += prev;
 			lc->yycur -= prev;
+			lc->yysval -= prev;
 		}
 	}
 
 	if (lc->log)
 		mnstr_write(lc->log, lc->rs->buf+pos, lc->rs->pos + lc->yycur - pos, 1);
 
+	/* offsets of the token in the statement, used to locate literals */
+	yylloc->first_line = yylloc->last_line = 1;
+	yylloc->first_column = (int) lc->yysval;
+	yylloc->last_column = (int) lc->yycur;
+
 	lc->started += (token != EOF);
 	return token;
 }
@@ -66,7 +66,7 @@ sql_bind_param(mvc *sql, const char *name)
 	return NULL;
 }
 
-static sql_arg *
+sql_arg *
 sql_bind_paramnr(mvc *sql, int nr)
 {
 	int i=0;
@@ -86,6 +86,21 @@ void
 sql_destroy_params(mvc *sql)
 {
 	sql->params = NULL;
+	sql->literals = NULL;
+}
+
+void
+sql_add_literal(mvc *sql, symbol *s, symbol *other)
+{
+	AtomNode *an = (AtomNode *) s;
+
+	if (!sql->parameterize || sql->emode != m_normal ||
+	    !s || s->token != SQL_ATOM || !an->a || an->end <= an->start ||
+	    !other || other->token == SQL_ATOM)
+		return;
+	if (!sql->literals && !(sql->literals = sa_list(sql->sa)))
+		return;
+	list_append(sql->literals, an);
 }
 
 sql_schema *
@@ -62,11 +62,16 @@ typedef enum {
 
 extern void sql_add_param(mvc *sql, const char *name, sql_subtype *st);
 extern sql_arg *sql_bind_param(mvc *sql, const char *name);
+extern sql_arg *sql_bind_paramnr(mvc *sql, int nr);
 /* once the type of the '?' parameters is known it's set using the set_type
  * function */
 extern int set_type_param(mvc *sql, sql_subtype *type, int nr);
 extern void sql_destroy_params(mvc *sql);	/* used in backend */
 
+/* literals compared against non literal expressions in plain queries are
+ * collected, the plan cache may turn them into parameters */
+extern void sql_add_literal(mvc *sql, symbol *s, symbol *other);
+
 extern char *symbol2string(mvc *sql, symbol *s, int expression, char **err);
 //extern char *dlist2string(mvc *sql, dlist *s, int expression, char **err);
 
@@ -287,6 +287,7 @@ newAtomNode(sql_allocator *sa, atom *data)
 	if (s) {
 		symbol_init(s, SQL_ATOM, type_symbol);
 		an->a = data;
+		an->start = an->end = 0;
 	}
 	return s;
 }
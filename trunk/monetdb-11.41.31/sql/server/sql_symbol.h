@@ -82,6 +82,7 @@ typedef struct SelectNode {
 typedef struct AtomNode {
 	symbol s;
 	struct atom *a;
+	int start, end;		/* position of the literal in the query text */
 } AtomNode;
 
 extern symbol *symbol_create(sql_allocator *sa, tokens token, char *data);
@@ -21,6 +21,7 @@ typedef enum tokens {
 	SQL_ATOM,
 	SQL_BETWEEN,
 	SQL_BINCOPYFROM,
+	SQL_ARROWCOPYFROM,
 	SQL_BINOP,
 	SQL_CACHE,
 	SQL_CALL,
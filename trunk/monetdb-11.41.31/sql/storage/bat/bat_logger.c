@@ -2662,9 +2662,15 @@ bl_tstart(sqlstore *store, bool flush)
 }
 
 static int
-bl_tend(sqlstore *store)
+bl_tend(sqlstore *store, ulng *lsn)
 {
-	return log_tend(store->logger) == GDK_SUCCEED ? LOG_OK : LOG_ERR;
+	return log_tend(store->logger, lsn) == GDK_SUCCEED ? LOG_OK : LOG_ERR;
+}
+
+static int
+bl_tsync(sqlstore *store, ulng lsn)
+{
+	return log_tsync(store->logger, lsn) == GDK_SUCCEED ? LOG_OK : LOG_ERR;
 }
 
 static int
@@ -3085,6 +3091,7 @@ bat_logger_init( logger_functions *lf )
 	lf->log_isnew = bl_log_isnew;
 	lf->log_tstart = bl_tstart;
 	lf->log_tend = bl_tend;
+	lf->log_tsync = bl_tsync;
 	lf->log_tdone = bl_tdone;
 	lf->log_sequence = bl_sequence;
 	lf->get_snapshot_files = bl_snapshot;
@@ -259,7 +259,8 @@ typedef int (*logger_get_sequence_fptr) (struct sqlstore *store, int seq, lng *i
 
 typedef int (*log_isnew_fptr)(struct sqlstore *store);
 typedef int (*log_tstart_fptr) (struct sqlstore *store, bool flush);
-typedef int (*log_tend_fptr) (struct sqlstore *store);
+typedef int (*log_tend_fptr) (struct sqlstore *store, ulng *lsn);
+typedef int (*log_tsync_fptr) (struct sqlstore *store, ulng lsn);
 typedef int (*log_tdone_fptr) (struct sqlstore *store, ulng commit_ts);
 typedef lng (*log_save_id_fptr) (struct sqlstore *store);
 typedef int (*log_sequence_fptr) (struct sqlstore *store, int seq, lng id);
@@ -293,6 +294,7 @@ typedef struct logger_functions {
 	log_isnew_fptr log_isnew;
 	log_tstart_fptr log_tstart;
 	log_tend_fptr log_tend;
+	log_tsync_fptr log_tsync;
 	log_tdone_fptr log_tdone;
 	log_save_id_fptr log_save_id;
 	log_sequence_fptr log_sequence;
@@ -458,6 +460,7 @@ typedef struct sqlstore {
 	ATOMIC_TYPE lastactive;	/* timestamp of last active client */
     ATOMIC_TYPE timestamp;	/* timestamp counter */
     ATOMIC_TYPE transaction;/* transaction id counter */
+	ATOMIC_TYPE schema_version;	/* bumped by each commit of a transaction with DDL */
 	ulng oldest;
 	ulng oldest_pending;
 	int readonly;			/* store is readonly */
@@ -3783,7 +3783,7 @@ sql_trans_commit(sql_trans *tr)
 
 	if (!list_empty(tr->changes)) {
 		int flush = 0;
-		ulng commit_ts = 0, oldest = 0;
+		ulng commit_ts = 0, oldest = 0, lsn = 0;
 
 		MT_lock_set(&store->commit);
 
@@ -3823,7 +3823,7 @@ sql_trans_commit(sql_trans *tr)
 				ok = store->logger_api.log_sequence(store, OBJ_SID, store->obj_id);
 			store->prev_oid = store->obj_id;
 			if (ok == LOG_OK && !flush)
-				ok = store->logger_api.log_tend(store); /* flush/sync */
+				ok = store->logger_api.log_tend(store, &lsn); /* flush, sync after releasing the commit lock */
 			store_lock(store);
 			commit_ts = tr->parent ? tr->parent->tid : store_timestamp(store);
 			if (ok == LOG_OK && !flush)					/* mark as done */
@@ -3853,7 +3853,7 @@ sql_trans_commit(sql_trans *tr)
 		/* when directly flushing: flush logger after changes got applied */
 		if (flush) {
 			if (ok == LOG_OK) {
-				ok = store->logger_api.log_tend(store); /* flush/sync */
+				ok = store->logger_api.log_tend(store, &lsn); /* flush/sync */
 				if (ok == LOG_OK)
 					ok = store->logger_api.log_tdone(store, commit_ts); /* mark as done */
 			}
@@ -3888,9 +3888,23 @@ sql_trans_commit(sql_trans *tr)
 			}
 			n = next;
 		}
+		/* sessions starting from here on see the new catalog */
+		if (ok == LOG_OK && tr->schema_changed) {
+			if (tr->parent)
+				tr->parent->schema_changed = 1;
+			else
+				(void) ATOMIC_INC(&store->schema_version);
+		}
+		tr->schema_changed = 0;
 		tr->ts = commit_ts;
 		store_unlock(store);
 		MT_lock_unset(&store->commit);
+		/* group commit: a single sync covers all transactions that
+		 * wrote their log records while the previous sync was busy;
+		 * the changes are visible already, so a failing sync is
+		 * fatal (see log_tsync) */
+		if (ok == LOG_OK && lsn)
+			ok = store->logger_api.log_tsync(store, lsn);
 		list_destroy(tr->changes);
 		tr->changes = NULL;
 	} else if (ATOMIC_GET(&store->nr_active) == 1) { /* just me cleanup */
@@ -6845,6 +6859,7 @@ sql_trans_begin(sql_session *s)
 	store_lock(store);
 	TRC_DEBUG(SQL_STORE, "Enter sql_trans_begin for transaction: " ULLFMT "\n", tr->tid);
 	tr->ts = store_timestamp(store);
+	s->schema_version = (ulng) ATOMIC_GET(&store->schema_version);
 	if (!(s->schema = find_sql_schema(tr, s->schema_name))) {
 		TRC_DEBUG(SQL_STORE, "Exit sql_trans_begin for transaction: " ULLFMT " with error, the schema %s was not found\n", tr->tid, s->schema_name);
 		store_unlock(store);
@@ -6873,6 +6888,7 @@ sql_trans_end(sql_session *s, int ok)
 	}
 	assert(s->tr->active);
 	s->tr->active = 0;
+	s->tr->schema_changed = 0;
 	s->auto_commit = s->ac_on_commit;
 	sqlstore *store = s->tr->store;
 	store_lock(store);